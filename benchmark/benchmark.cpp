@@ -0,0 +1,467 @@
+//
+// Benchmarks for the WAVLIB hot paths
+//
+// Usage: wavlib_benchmark [--filter <substring>] [--min-time <seconds>] [--quick] [--json <file>|-]
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "wavlib.h"
+
+// Every heap allocation in the process is counted, including the ones made by pool workers
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> allocated{0};
+
+static void* allocate(std::size_t size, std::size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated.fetch_add(size, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(size == 0 ? 1 : size);
+    } else {
+#if _WIN32
+        p = _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+        p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// Kept out of line, GCC would otherwise see free() on a pointer from operator new and warn with -Wmismatched-new-delete
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void release(void* p, std::size_t alignment) {
+    if (alignment <= alignof(std::max_align_t)) {
+        std::free(p);
+    } else {
+#if _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size, 0); }
+void* operator new[](std::size_t size) { return allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void* p) noexcept { release(p, 0); }
+void operator delete[](void* p) noexcept { release(p, 0); }
+void operator delete(void* p, std::size_t) noexcept { release(p, 0); }
+void operator delete[](void* p, std::size_t) noexcept { release(p, 0); }
+void operator delete(void* p, std::align_val_t alignment) noexcept { release(p, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* p, std::align_val_t alignment) noexcept { release(p, static_cast<std::size_t>(alignment)); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept { release(p, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { release(p, static_cast<std::size_t>(alignment)); }
+
+struct OPTIONS {
+    std::string filter;
+    std::string json;
+    double min_time = 0.5;
+    bool quick = false;
+};
+
+struct RESULT {
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double mb_per_s = 0;
+    double samples_per_s = 0;
+    double allocs_per_op = 0;
+    double bytes_allocated_per_op = 0;
+};
+
+class SUITE {
+public:
+    explicit SUITE(const OPTIONS& options) : options(options), log(options.json == "-" ? stderr : stdout) {}
+
+    template<typename BODY>
+    void run(const std::string& name, const uint64_t bytes, const uint64_t samples, BODY&& body) {
+        /** bytes and samples are what one call of body processes **/
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+        // The first call warms caches, plans and per-thread workspaces
+        body();
+
+        RESULT result;
+        result.name = name;
+        const uint64_t allocations_before = allocations.load();
+        const uint64_t allocated_before = allocated.load();
+        const auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            body();
+            result.iterations++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < options.min_time);
+
+        const auto iterations = static_cast<double>(result.iterations);
+        result.ns_per_op = elapsed * 1e9 / iterations;
+        result.mb_per_s = static_cast<double>(bytes) * iterations / elapsed / 1e6;
+        result.samples_per_s = static_cast<double>(samples) * iterations / elapsed;
+        result.allocs_per_op = static_cast<double>(allocations.load() - allocations_before) / iterations;
+        result.bytes_allocated_per_op = static_cast<double>(allocated.load() - allocated_before) / iterations;
+        std::fprintf(log, "%-40s %12.0f ns/op %10.1f MB/s %12.3e samples/s %8.1f allocs/op\n",
+                     result.name.c_str(), result.ns_per_op, result.mb_per_s, result.samples_per_s, result.allocs_per_op);
+        std::fflush(log);
+        results.push_back(result);
+    }
+
+    bool write_json() const {
+        if (options.json.empty()) {
+            return true;
+        }
+        FILE* out = options.json == "-" ? stdout : std::fopen(options.json.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", options.json.c_str());
+            return false;
+        }
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        std::fprintf(out, "{\n  \"context\": {\n");
+        std::fprintf(out, "    \"date\": \"%s\",\n", date);
+        std::fprintf(out, "    \"threads\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(out, "    \"simd\": \"%s\",\n", simd());
+        std::fprintf(out, "    \"min_time\": %g\n", options.min_time);
+        std::fprintf(out, "  },\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const RESULT& r = results[i];
+            std::fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, \"mb_per_s\": %.3f, "
+                              "\"samples_per_s\": %.1f, \"allocs_per_op\": %.2f, \"bytes_allocated_per_op\": %.1f}%s\n",
+                         r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.mb_per_s,
+                         r.samples_per_s, r.allocs_per_op, r.bytes_allocated_per_op, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+        if (out != stdout) {
+            std::fclose(out);
+        }
+        return true;
+    }
+
+    static const char* simd() {
+#if defined(WAVLIB_NO_SIMD)
+        return "none";
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER) && !defined(__clang__)
+        return "x86";
+#else
+        return __builtin_cpu_supports("avx2") ? "avx2" : __builtin_cpu_supports("ssse3") ? "ssse3" : "sse2";
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+        return "neon";
+#else
+        return "none";
+#endif
+    }
+
+private:
+    OPTIONS options;
+    FILE* log;  // The table goes to stderr when the JSON document takes stdout
+    std::vector<RESULT> results;
+};
+
+struct SOURCE {
+    /** One synthetic file on disk **/
+    std::string name;
+    std::string path;
+    WAVLIB::FORMAT::WAV audio;
+};
+
+static WAVLIB::FORMAT::WAV synthesize(const unsigned short format, const unsigned short bits, const unsigned short channels, const double seconds) {
+    /** A few tones plus noise, scaled to the native range of the format **/
+    WAVLIB::FORMAT::WAV audio;
+    audio.format = format;
+    audio.channels = channels;
+    audio.sample_rate = 48000;
+    audio.sample_size = bits;
+    const auto frames = static_cast<uint64_t>(seconds * audio.sample_rate);
+    audio.audio.resize(frames * channels);
+    std::mt19937 rng(bits * 31 + channels);
+    std::uniform_real_distribution<double> noise(-0.05, 0.05);
+    const double full = format == 3 || bits == 32 ? 2147483647.0 : std::ldexp(1.0, bits - 1) - 1.0;
+    for (uint64_t i = 0; i < frames; i++) {
+        for (unsigned short c = 0; c < channels; c++) {
+            const double t = static_cast<double>(i) / audio.sample_rate;
+            const double value = 0.4 * std::sin(2 * WAVLIB_PI * 440.0 * (c + 1) * t) + 0.3 * std::sin(2 * WAVLIB_PI * 3150.0 * t) + noise(rng);
+            auto sample = static_cast<int>(std::lround(value * full));
+            if (bits == 8) {
+                sample += 128;
+            }
+            audio.audio[i * channels + c] = sample;
+        }
+    }
+    return audio;
+}
+
+static uint64_t payload(const WAVLIB::FORMAT::WAV& audio) {
+    return audio.audio.size() * (audio.sample_size / 8);
+}
+
+static const SOURCE* find(const std::vector<SOURCE>& sources, const std::string& name) {
+    for (const SOURCE& source : sources) {
+        if (source.name == name) {
+            return &source;
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    OPTIONS options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.min_time = std::atof(argv[++i]);
+        } else if (arg == "--quick") {
+            options.quick = true;
+            options.min_time = 0.05;
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter <substring>] [--min-time <seconds>] [--quick] [--json <file>|-]\n", argv[0]);
+            return 1;
+        }
+    }
+    SUITE suite(options);
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "wavlib_benchmark";
+    std::filesystem::create_directories(directory);
+
+    // Synthetic inputs: every bit depth, mono and stereo, a short and a long clip
+    struct SHAPE {
+        const char* name;
+        unsigned short format;
+        unsigned short bits;
+    };
+    const SHAPE shapes[] = {{"u8", 1, 8}, {"s16", 1, 16}, {"s24", 1, 24}, {"s32", 1, 32}, {"f32", 3, 32}};
+    const double durations[] = {1.0, options.quick ? 5.0 : 60.0};
+    std::vector<SOURCE> sources;
+    for (const SHAPE& shape : shapes) {
+        for (const unsigned short channels : {1, 2}) {
+            for (const double seconds : durations) {
+                SOURCE source;
+                source.name = std::string(shape.name) + "/" + std::to_string(channels) + "ch/" + std::to_string(static_cast<int>(seconds)) + "s";
+                source.path = (directory / (std::string(shape.name) + "_" + std::to_string(channels) + "ch_" + std::to_string(static_cast<int>(seconds)) + "s.wav")).string();
+                source.audio = synthesize(shape.format, shape.bits, channels, seconds);
+                if (!WAVLIB::DUMP(source.path, source.audio)) {
+                    std::fprintf(stderr, "cannot write %s\n", source.path.c_str());
+                    return 1;
+                }
+                sources.push_back(std::move(source));
+            }
+        }
+    }
+
+    for (const SOURCE& source : sources) {
+        const uint64_t bytes = payload(source.audio);
+        const uint64_t samples = source.audio.audio.size();
+        suite.run("load/" + source.name, bytes, samples, [&] {
+            WAVLIB::FORMAT::WAV audio;
+            WAVLIB::LOAD(source.path, audio);
+        });
+        suite.run("load_mapped/" + source.name, bytes, samples, [&] {
+            WAVLIB::FORMAT::MAPPED_WAV audio;
+            WAVLIB::LOAD(source.path, audio);
+        });
+        suite.run("load_planar/" + source.name, bytes, samples, [&] {
+            WAVLIB::FORMAT::PLANAR audio;
+            WAVLIB::LOAD(source.path, audio);
+        });
+        // Loading into the same objects again is the steady state of a server loop
+        WAVLIB::FORMAT::WAV reused;
+        suite.run("load_reuse/" + source.name, bytes, samples, [&] {
+            WAVLIB::LOAD(source.path, reused);
+        });
+        WAVLIB::FORMAT::PLANAR reused_planar;
+        suite.run("load_planar_reuse/" + source.name, bytes, samples, [&] {
+            WAVLIB::LOAD(source.path, reused_planar);
+        });
+        const std::string target = source.path + ".out";
+        WAVLIB::FORMAT::WAV audio = source.audio;
+        suite.run("dump/" + source.name, bytes, samples, [&] {
+            WAVLIB::DUMP(target, audio);
+        });
+        std::filesystem::remove(target);
+    }
+
+    // Header probe and level statistics over every generated file at once
+    {
+        std::vector<std::string> paths;
+        uint64_t bytes = 0;
+        uint64_t samples = 0;
+        for (const SOURCE& source : sources) {
+            paths.push_back(source.path);
+            bytes += payload(source.audio);
+            samples += source.audio.audio.size();
+        }
+        std::vector<WAVLIB::FORMAT::INFO> info;
+        std::vector<WAVLIB::FORMAT::STATS> stats;
+        std::vector<std::string> errors;
+        suite.run("probe/all", bytes, samples, [&] {
+            WAVLIB::PROBE(paths, info, errors);
+        });
+        suite.run("scan/all", bytes, samples, [&] {
+            WAVLIB::SCAN(paths, stats, errors);
+        });
+    }
+
+    const std::string longest = std::to_string(static_cast<int>(durations[1])) + "s";
+
+    // Two second crops out of the long stereo 16-bit file
+    const SOURCE* stereo = find(sources, "s16/2ch/" + longest);
+    WAVLIB::RANGE_READER reader;
+    if (stereo != nullptr && reader.open(stereo->path) && reader.frames() > 96000) {
+        uint64_t position = 0;
+        suite.run("range_read/2s/" + stereo->name, 96000 * reader.format.channels * 2, 96000 * reader.format.channels, [&] {
+            std::vector<int> crop;
+            position = (position + 7919 * 13) % (reader.frames() - 96000);
+            reader.read(position, position + 96000, crop);
+        });
+    }
+
+    // FLAC at the fastest, the default and the smallest preset, then decoding the default back
+    if (stereo != nullptr) {
+        const uint64_t samples = stereo->audio.audio.size();
+        const uint64_t bytes = payload(stereo->audio);
+        const std::string target = stereo->path + ".flac";
+        for (const unsigned level : {0u, 5u, 8u}) {
+            suite.run("dump_flac/" + std::to_string(level) + "/" + stereo->name, bytes, samples, [&] {
+                WAVLIB::DUMP(target, stereo->audio, level);
+            });
+        }
+        if (WAVLIB::DUMP(target, stereo->audio, 5)) {
+            WAVLIB::FORMAT::WAV decoded;
+            suite.run("load_flac/" + stereo->name, bytes, samples, [&] {
+                WAVLIB::LOAD(target, decoded);
+            });
+        }
+        std::filesystem::remove(target);
+    }
+
+    // Time-scale modification, one variant and a batch of augmentation variants sharing the analysis
+    if (stereo != nullptr) {
+        const WAVLIB::FORMAT::WAV& audio = stereo->audio;
+        const uint64_t samples = audio.audio.size();
+        const uint64_t bytes = samples * audio.sample_size / 8;
+        WAVLIB::FORMAT::WAV stretched;
+        suite.run("tsm/ola/1.25/" + stereo->name, bytes, samples, [&] {
+            WAVLIB::F::OLA(audio, stretched, 1.25f);
+        });
+        suite.run("tsm/wsola/1.25/" + stereo->name, bytes, samples, [&] {
+            WAVLIB::F::WSOLA(audio, stretched, 1.25f);
+        });
+        suite.run("tsm/pv/1.25/" + stereo->name, bytes, samples, [&] {
+            WAVLIB::F::PV(audio, stretched, 1.25f);
+        });
+        const std::vector<float> rates = {0.8f, 0.9f, 1.1f, 1.2f};
+        std::vector<WAVLIB::FORMAT::WAV> variants;
+        suite.run("tsm/pv_batch4/" + stereo->name, bytes, samples, [&] {
+            WAVLIB::F::PV(audio, variants, rates);
+        });
+    }
+
+    for (const int n : {256, 512, 1024, 4096}) {
+        const std::string size = std::to_string(n);
+        suite.run("window/hann/" + size, n * sizeof(float), n, [&] {
+            WAVLIB::COMPLEX_VEC window;
+            WAVLIB::W::Hann(window, n);
+        });
+        suite.run("window/kaiser/" + size, n * sizeof(float), n, [&] {
+            WAVLIB::REAL_VEC window;
+            WAVLIB::W::Kaiser(window, n);
+        });
+        suite.run("window/cached_hann/" + size, n * sizeof(float), n, [&] {
+            auto window = WAVLIB::W::Hann(n);
+        });
+
+        WAVLIB::COMPLEX_VEC in(n), out;
+        std::vector<float> real(n);
+        for (int i = 0; i < n; i++) {
+            real[i] = static_cast<float>(std::sin(0.01 * i * i));
+            in[i] = real[i];
+        }
+        suite.run("fft/c2c/" + size, n * sizeof(std::complex<float>), n, [&] {
+            WAVLIB::S::FFT(in, out);
+        });
+        suite.run("fft/r2c/" + size, n * sizeof(float), n, [&] {
+            WAVLIB::S::RFFT(real, out);
+        });
+    }
+
+    // Transforms and resampling on the long mono float clip
+    WAVLIB::FORMAT::PLANAR planar;
+    const SOURCE* mono = find(sources, "f32/1ch/" + longest);
+    if (mono != nullptr && WAVLIB::LOAD(mono->path, planar)) {
+        const auto channel = planar.channel(0);
+        const uint64_t bytes = planar.frames * sizeof(float);
+        auto window = WAVLIB::W::Hann(400);
+        WAVLIB::COMPLEX_VEC spectrum;
+        suite.run("stft/400x160/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::STFT(channel, spectrum, 512, 160, *window);
+        });
+        WAVLIB::REAL_VEC restored;
+        suite.run("istft/400x160/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::ISTFT(spectrum, restored, 512, 160, *window);
+        });
+        WAVLIB::REAL_VEC mel;
+        suite.run("mel/400x160x80/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::MEL(channel, mel, 16000);
+        });
+        WAVLIB::REAL_VEC mfcc;
+        suite.run("mfcc/400x160x40x13/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::MFCC(channel, mfcc, 16000);
+        });
+        WAVLIB::REAL_VEC cepstra;
+        suite.run("cepstrum/80x13/" + mono->name, mel.size() * sizeof(float), mel.size() / 80, [&] {
+            WAVLIB::S::CEPSTRUM(mel, cepstra, 80);
+        });
+        std::vector<WAVLIB::REAL_VEC> bands;
+        suite.run("wavedec/db4x5/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::WAVEDEC(channel, bands, "db4", 5);
+        });
+        WAVLIB::REAL_VEC reconstructed;
+        suite.run("waverec/db4x5/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::WAVEREC(bands, reconstructed, "db4");
+        });
+        WAVLIB::REAL_VEC resampled;
+        suite.run("resample/48000-16000/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::RESAMPLE(channel, resampled, 48000, 16000);
+        });
+        suite.run("resample/48000-44100/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::S::RESAMPLE(channel, resampled, 48000, 44100);
+        });
+        // Whole request path with every output reused, expected to allocate nothing
+        WAVLIB::FORMAT::PLANAR loaded;
+        WAVLIB::FORMAT::PLANAR narrow;
+        suite.run("pipeline/load-resample-stft/" + mono->name, bytes, planar.frames, [&] {
+            WAVLIB::LOAD(mono->path, loaded);
+            WAVLIB::S::RESAMPLE(loaded, narrow, 16000);
+            WAVLIB::S::STFT(narrow.channel(0), spectrum, 512, 160, *window);
+        });
+    }
+
+    for (const SOURCE& source : sources) {
+        std::filesystem::remove(source.path);
+    }
+    return suite.write_json() ? 0 : 1;
+}
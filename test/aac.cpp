@@ -0,0 +1,42 @@
+//
+// AAC decoder against FFmpeg on ADTS and MP4 files from FFmpeg's encoder, see data/generate.py
+//
+
+#include <vector>
+
+#include "check.h"
+
+struct FIXTURE {
+    const char* name;
+    unsigned short channels;
+    unsigned int sample_rate;
+    bool mp4;
+};
+
+static const FIXTURE fixtures[] = {
+    {"stereo_44k.m4a", 2, 44100, true},     // Mid/side and intensity stereo, edit list drops the priming
+    {"mono_22k.aac", 1, 22050, false},      // ADTS, every decoded sample stays in
+    {"surround_48k.m4a", 6, 48000, true},   // 5.1, center first in the stream and third in the output
+};
+
+static void decode(const FIXTURE& fixture) {
+    // The reference is FFmpeg
+    WAVLIB::FORMAT::PLANAR audio;
+    WAVLIB::FORMAT::INFO info;
+    if (!lossy("aac", fixture.name, fixture.channels, fixture.sample_rate, audio, info)) {
+        return;
+    }
+
+    // The moov box gives the exact length, an ADTS stream only an estimate
+    CHECK(info.exact || !fixture.mp4);
+    if (info.exact) {
+        CHECK(info.frames == audio.frames);
+    }
+}
+
+int main() {
+    for (const FIXTURE& fixture : fixtures) {
+        decode(fixture);
+    }
+    return finish("aac");
+}
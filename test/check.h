@@ -0,0 +1,143 @@
+//
+// Checks shared by the WAVLIB regression tests
+//
+// A failed check prints its location and the test keeps going, finish() turns the failures into the exit code
+//
+
+#ifndef WAVLIB_TEST_CHECK_H
+#define WAVLIB_TEST_CHECK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "wavlib.h"
+
+inline int failures = 0;
+
+#define CHECK(condition) check_true((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(value, expected, tolerance) check_near((value), (expected), (tolerance), #value, __FILE__, __LINE__)
+
+inline bool check_true(const bool condition, const char* expression, const char* file, const int line) {
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+        failures++;
+    }
+    return condition;
+}
+
+inline bool check_near(const double value, const double expected, const double tolerance, const char* expression, const char* file, const int line) {
+    // NaN never passes
+    if (!(std::abs(value - expected) <= tolerance)) {
+        std::fprintf(stderr, "%s:%d: %s is %.9g, expected %.9g within %.3g\n", file, line, expression, value, expected, tolerance);
+        failures++;
+        return false;
+    }
+    return true;
+}
+
+inline std::string data(const std::string& name) {
+    /** Path of a file in test/data **/
+    return std::string(WAVLIB_TEST_DATA) + "/" + name;
+}
+
+template<typename T = float>
+inline std::vector<T> reference(const std::string& name) {
+    /** Raw little-endian values from a file in test/data **/
+    std::ifstream file(data(name), std::ios::binary | std::ios::ate);
+    std::vector<T> values(file ? static_cast<uint64_t>(file.tellg()) / sizeof(T) : 0);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    return values;
+}
+
+inline double worst(const WAVLIB::REAL_VEC& values, const float* expected, const uint64_t size) {
+    /** Largest absolute difference, infinite when the sizes differ or there is nothing to compare **/
+    double error = values.size() == size && size != 0 ? 0.0 : INFINITY;
+    for (uint64_t i = 0; i < values.size() && i < size; i++) {
+        error = std::max(error, std::abs(static_cast<double>(values[i]) - static_cast<double>(expected[i])));
+    }
+    return error;
+}
+
+inline double worst(const WAVLIB::REAL_VEC& values, const std::vector<float>& expected) {
+    return worst(values, expected.data(), expected.size());
+}
+
+inline bool compare(const WAVLIB::FORMAT::PLANAR& audio, const WAVLIB::FORMAT::PLANAR& expected, const double tolerance) {
+    /** A decode against a reference decode, every sample within tolerance and the RMS error within one 16-bit step **/
+    /** Returns false when the two don't even have the same shape **/
+    if (!CHECK(audio.channels == expected.channels && audio.frames == expected.frames && audio.frames > 0)) {
+        return false;
+    }
+    double largest = 0.0;
+    double squares = 0.0;
+    for (unsigned short c = 0; c < audio.channels; c++) {
+        for (uint64_t n = 0; n < audio.frames; n++) {
+            const double error = static_cast<double>(audio.channel(c)[n]) - static_cast<double>(expected.channel(c)[n]);
+            largest = std::max(largest, std::abs(error));
+            squares += error * error;
+        }
+    }
+    CHECK_NEAR(largest, 0.0, tolerance);
+    CHECK_NEAR(std::sqrt(squares / static_cast<double>(audio.frames * audio.channels)), 0.0, 1.0 / 32768.0);
+    return true;
+}
+
+inline void range(const std::string& path, const WAVLIB::FORMAT::PLANAR& audio) {
+    /** A segment from RANGE_READER decodes on its own and has to match the whole-file decode exactly **/
+    WAVLIB::RANGE_READER reader;
+    CHECK(reader.open(path));
+    CHECK(reader.frames() == audio.frames);
+    if (!CHECK(audio.frames > 100)) {
+        return;
+    }
+    const uint64_t start = audio.frames / 3;
+    const uint64_t end = audio.frames - 100;
+    WAVLIB::FORMAT::PLANAR segment;
+    CHECK(reader.read(start, end, segment));
+    bool same = segment.channels == audio.channels && segment.frames == end - start;
+    for (unsigned short c = 0; c < segment.channels && same; c++) {
+        for (uint64_t n = 0; n < segment.frames && same; n++) {
+            same = segment.channel(c)[n] == audio.channel(c)[start + n];
+        }
+    }
+    CHECK(same);
+}
+
+inline bool lossy(const std::string& codec, const std::string& name, const unsigned short channels, const unsigned int sample_rate,
+                  WAVLIB::FORMAT::PLANAR& audio, WAVLIB::FORMAT::INFO& info) {
+    /** A lossy decode against the reference decoder's output next to it in name + ".flac", then RANGE_READER and PROBE **/
+    /** Returns false when the decode is too far off for the codec-specific checks to mean anything **/
+    const std::string path = data(name);
+    // The reference is rounded to 16 bits, so half a step plus the float error of the synthesis
+    const double tolerance = 0.5 / 32768.0 + 4e-6;
+
+    WAVLIB::FORMAT::PLANAR expected;
+    CHECK(WAVLIB::LOAD(path, audio));
+    CHECK(WAVLIB::LOAD(path + ".flac", expected));
+    CHECK(audio.channels == channels && audio.sample_rate == sample_rate);
+    if (!compare(audio, expected, tolerance)) {
+        std::fprintf(stderr, "  %s\n", name.c_str());
+        return false;
+    }
+    range(path, audio);
+
+    CHECK(WAVLIB::PROBE(path, info));
+    CHECK(info.codec == codec && info.channels == channels && info.sample_rate == sample_rate);
+    return true;
+}
+
+inline int finish(const char* test) {
+    if (failures == 0) {
+        std::printf("%s: all checks passed\n", test);
+        return 0;
+    }
+    std::fprintf(stderr, "%s: %d checks failed\n", test, failures);
+    return 1;
+}
+
+#endif // WAVLIB_TEST_CHECK_H
@@ -0,0 +1,282 @@
+#
+# Recreates the test fixtures with the reference encoders and decoders, needs numpy, soundfile
+# (libsndfile with libFLAC, LAME and mpg123) and PyAV (FFmpeg's AAC encoder and decoder). The mel and MFCC
+# references follow librosa step by step, and match librosa itself when it is installed. The wavelet filters
+# are factorized again in 40 digits with mpmath, and the transforms follow pywt, checked against it when installed
+#
+# Usage: python3 generate.py, run from test/data
+#
+
+import numpy as np
+import soundfile as sf
+
+
+def pattern(frames, channels, bits):
+    # Two triangles and a little noise per channel, integers only so the tests can rebuild them exactly
+    full = 1 << (bits - 1)
+    noise = max(full >> 9, 2)
+    out = np.zeros((frames, channels), dtype=np.int64)
+    for c in range(channels):
+        state = 12345 + 977 * c
+        P = 200 + 30 * c
+        Q = 37 + c
+        for n in range(frames):
+            state = (state * 1103515245 + 12345) & 0x7fffffff
+            x = abs(2 * (n % P) - P) * (full // 2) // P - full // 4
+            x += abs(2 * (n % Q) - Q) * (full // 4) // Q - full // 8
+            x += (state >> 16) % noise - noise // 2
+            out[n, c] = x
+    return out
+
+
+def flac():
+    sf.write("s16_stereo.flac", pattern(5000, 2, 16).astype(np.int16), 44100, subtype="PCM_16")
+    sf.write("s16_stereo_fast.flac", pattern(5000, 2, 16).astype(np.int16), 44100, subtype="PCM_16", compression_level=0.0)
+    # soundfile takes the samples left aligned in the wider integer type
+    sf.write("s24_mono.flac", (pattern(5000, 1, 24) << 8).astype(np.int32), 48000, subtype="PCM_24")
+    sf.write("s8_3ch.flac", (pattern(5000, 3, 8) << 8).astype(np.int16), 8000, subtype="PCM_S8")
+
+
+def music(frames, channels, rate):
+    # A chord with vibrato and a sweep, different per channel
+    t = np.arange(frames) / rate
+    out = np.zeros((frames, channels))
+    for c in range(channels):
+        f = 220.0 * (1 + 0.25 * c)
+        x = 0.3 * np.sin(2 * np.pi * f * t + 2 * np.sin(2 * np.pi * 5 * t))
+        x += 0.2 * np.sin(2 * np.pi * 1.5 * f * t)
+        x += 0.1 * np.sin(2 * np.pi * (300 + 3000 * t / t[-1]) * t * (1 + c))
+        out[:, c] = x
+    return out.astype(np.float32)
+
+
+def reference(source, target):
+    # What mpg123 decodes, rounded to 16 bits and kept losslessly as FLAC
+    decoded, rate = sf.read(source, dtype="float32", always_2d=True)
+    pcm = np.clip(np.round(decoded.astype(np.float64) * 32768), -32768, 32767).astype(np.int16)
+    sf.write(target, pcm, rate, subtype="PCM_16")
+
+
+def mp3():
+    # MPEG-1 joint stereo CBR, MPEG-2 VBR with a Xing header and MPEG-2.5
+    for name, rate, channels, mode, level in [("joint_44k_cbr", 44100, 2, "CONSTANT", 0.5),
+                                              ("mono_22k_vbr", 22050, 1, "VARIABLE", 0.5),
+                                              ("mono_8k_cbr", 8000, 1, "CONSTANT", 0.9)]:
+        sf.write(name + ".mp3", music(int(rate * 0.3), channels, rate), rate, format="MP3", subtype="MPEG_LAYER_III",
+                 bitrate_mode=mode, compression_level=level)
+        reference(name + ".mp3", name + ".mp3.flac")
+
+
+def aac():
+    # ADTS and MP4 from FFmpeg's encoder, clicks every 50 ms force short windows, FFmpeg's decoder gives the reference
+    import av
+
+    for name, container, rate, layout in [("stereo_44k.m4a", "ipod", 44100, "stereo"),
+                                          ("mono_22k.aac", "adts", 22050, "mono"),
+                                          ("surround_48k.m4a", "ipod", 48000, "5.1")]:
+        channels = {"mono": 1, "stereo": 2, "5.1": 6}[layout]
+        frames = int(rate * 0.3)
+        x = music(frames, channels, rate)
+        x[::rate // 20] += 0.3
+        with av.open(name, "w", format=container) as out:
+            # Noise substitution fills bands with random lines, which no two decoders draw the same
+            stream = out.add_stream("aac", rate=rate, layout=layout, options={"aac_pns": "0"})
+            stream.bit_rate = 48000 * channels
+            for first in range(0, frames, 1024):
+                frame = av.AudioFrame.from_ndarray(np.ascontiguousarray(x[first:first + 1024].T), format="fltp", layout=layout)
+                frame.sample_rate = rate
+                frame.pts = first
+                out.mux(stream.encode(frame))
+            out.mux(stream.encode(None))
+        with av.open(name) as source:
+            decoded = np.concatenate([frame.to_ndarray() for frame in source.decode(audio=0)], axis=1).T
+        # FFmpeg drops the priming an edit list asks for but keeps the padding at the end, ADTS keeps both
+        if container == "ipod":
+            decoded = decoded[:frames]
+        pcm = np.clip(np.round(decoded.astype(np.float64) * 32768), -32768, 32767).astype(np.int16)
+        sf.write(name + ".flac", pcm, rate, subtype="PCM_16")
+
+
+def slaney(f):
+    # librosa.hz_to_mel, linear below 1 kHz and logarithmic above
+    f = np.asanyarray(f, dtype=np.float64)
+    m = 3.0 * f / 200.0
+    return np.where(f >= 1000.0, 15.0 + np.log(np.maximum(f, 1e-10) / 1000.0) / (np.log(6.4) / 27.0), m)
+
+
+def unslaney(m):
+    m = np.asanyarray(m, dtype=np.float64)
+    return np.where(m >= 15.0, 1000.0 * np.exp(np.log(6.4) / 27.0 * (m - 15.0)), 200.0 * m / 3.0)
+
+
+def filterbank(rate, n_fft, n_mels):
+    # librosa.filters.mel with htk=False and norm="slaney"
+    bins = np.linspace(0, rate / 2, 1 + n_fft // 2)
+    edges = unslaney(np.linspace(slaney(0.0), slaney(rate / 2), n_mels + 2))
+    widths = np.diff(edges)
+    ramps = edges[:, None] - bins[None, :]
+    weights = np.maximum(0, np.minimum(-ramps[:-2] / widths[:-1, None], ramps[2:] / widths[1:, None]))
+    return weights * (2.0 / (edges[2:n_mels + 2] - edges[:n_mels]))[:, None]
+
+
+def melspectrogram(x, rate, n_fft, hop, n_mels):
+    # librosa.feature.melspectrogram with center=True, pad_mode="reflect" and a periodic Hann window, in dB
+    padded = np.pad(x.astype(np.float64), n_fft // 2, mode="reflect")
+    window = 0.5 - 0.5 * np.cos(2 * np.pi * np.arange(n_fft) / n_fft)
+    frames = 1 + (len(padded) - n_fft) // hop
+    spectrum = np.array([np.fft.rfft(window * padded[t * hop:t * hop + n_fft]) for t in range(frames)])
+    power = filterbank(rate, n_fft, n_mels) @ (np.abs(spectrum) ** 2).T
+    db = 10.0 * np.log10(np.maximum(power, 1e-10))
+    # librosa.feature.mfcc clips at top_db 80, which the signal stays well inside of
+    assert db.min() > db.max() - 80.0
+    return db
+
+
+def mfcc(db, n_mfcc, lifter):
+    # Orthonormal DCT-II over the mel axis, then librosa's lifter
+    n = db.shape[0]
+    k = np.arange(n)
+    basis = np.cos(np.pi / n * (k[None, :] + 0.5) * k[:, None]) * np.sqrt(2.0 / n)
+    basis[0] /= np.sqrt(2.0)
+    out = (basis @ db)[:n_mfcc]
+    if lifter > 0:
+        out *= (1 + (lifter / 2) * np.sin(np.pi * np.arange(1, n_mfcc + 1) / lifter))[:, None]
+    return out
+
+
+def features():
+    # A quarter second at 16 kHz, references as raw float32 in frame order, frames x mels and frames x coefficients
+    rate = 16000
+    x = music(4000, 1, rate)[:, 0] + 0.01 * np.random.RandomState(7).randn(4000).astype(np.float32)
+    x = x.astype(np.float32)
+    sf.write("tones_16k.wav", x, rate, subtype="FLOAT")
+    for n_fft, hop, n_mels, n_mfcc, lifter in [(400, 160, 40, 13, 0), (512, 128, 64, 20, 22)]:
+        db = melspectrogram(x, rate, n_fft, hop, n_mels)
+        cepstrum = mfcc(db, n_mfcc, lifter)
+        try:
+            import librosa
+            S = librosa.feature.melspectrogram(y=x, sr=rate, n_fft=n_fft, hop_length=hop, n_mels=n_mels, pad_mode="reflect")
+            assert np.allclose(librosa.power_to_db(S, top_db=None), db, atol=1e-3)
+            M = librosa.feature.mfcc(y=x, sr=rate, n_mfcc=n_mfcc, n_fft=n_fft, hop_length=hop, n_mels=n_mels, lifter=lifter, pad_mode="reflect")
+            assert np.allclose(M, cepstrum, atol=1e-3)
+        except ImportError:
+            pass
+        db.T.astype("<f4").tofile("tones_16k.mel%d.f32" % n_mels)
+        cepstrum.T.astype("<f4").tofile("tones_16k.mfcc%d.f32" % n_mfcc)
+
+
+def orders():
+    return [("db", n) for n in range(1, 21)] + [("sym", n) for n in range(2, 21)]
+
+
+def daubechies(order, symlet):
+    # Scaling filter rec_lo from the zeros of P(y) = sum(C(order - 1 + k, k) y^k), y = sin^2(w / 2), in 40 digits
+    import mpmath
+    mpmath.mp.dps = 40
+    p = [mpmath.binomial(order - 1 + k, k) for k in range(order)]
+    y = mpmath.polyroots(p[::-1], maxsteps=400, extraprec=200) if order > 1 else []
+    groups = []
+    for r in y:
+        c = 1 - 2 * mpmath.mpc(r)
+        z = c + mpmath.sqrt(c * c - 1)
+        z = z if abs(z) < 1 else c - mpmath.sqrt(c * c - 1)
+        if abs(mpmath.im(r)) < mpmath.mpf(10) ** -20:
+            groups.append([mpmath.mpf(mpmath.re(z))])
+        elif mpmath.im(r) > 0:
+            groups.append([z, mpmath.conj(z)])
+
+    def expand(mask):
+        # q from one zero of every group, times (1 + z^-1)^order, scaled to sum to sqrt(2)
+        q = [mpmath.mpc(1)]
+        for g, zeros in enumerate(groups):
+            for z in zeros:
+                root = 1 / z if mask >> g & 1 else z
+                q = [a - root * b for a, b in zip(q + [0], [0] + q)]
+        h = q
+        for _ in range(order):
+            h = [a + b for a, b in zip(h + [0], [0] + h)]
+        total = mpmath.re(sum(h))
+        return q, [mpmath.re(c) * mpmath.sqrt(2) / total for c in h]
+
+    mask = 0
+    if symlet:
+        # Least squared distance of the unwrapped phase of q from the line through its ends, mirror images tie
+        w = np.pi * np.arange(1, 512) / 512
+        costs = []
+        for m in range(1 << len(groups)):
+            q = np.array([complex(c) for c in expand(m)[0]])
+            a = np.unwrap(np.angle(np.polyval(q[::-1] / q.sum(), np.exp(-1j * w))))
+            costs.append(np.sum((a - a[-1] / w[-1] * w) ** 2))
+        best = min(costs)
+        tied = [m for m in range(len(costs)) if costs[m] <= best + 1e-9 * max(1.0, best)]
+        assert len(tied) == 2
+        # pywt orients the pair this way, the first dec_lo tap is the last rec_lo tap
+        first = [float(expand(m)[1][-1]) for m in tied]
+        smaller = order in (2, 3, 4, 7, 8, 11, 13, 19)
+        mask = tied[int(np.argmin(first) if smaller else np.argmax(first))]
+    return np.array([float(c) for c in expand(mask)[1]])
+
+def dwt(x, dec_lo, mode):
+    # pywt.dwt, cA[o] = sum(f[j] x[2o + 1 - j]) over the extended signal, or x[2o + F / 2 - j] when periodic
+    F = len(dec_lo)
+    dec_hi = dec_lo[::-1] * (-1.0) ** (np.arange(F) + 1)
+    if mode == "periodization":
+        x = np.append(x, x[-1]) if len(x) % 2 else x
+        index = (2 * np.arange(len(x) // 2)[:, None] + F // 2 - np.arange(F)[None, :]) % len(x)
+        return x[index] @ dec_lo, x[index] @ dec_hi
+    # numpy.pad repeats the mirror images when the pad is longer than the signal, as pywt does
+    pad = {"symmetric": "symmetric", "reflect": "reflect", "zero": "constant", "constant": "edge"}[mode]
+    extended = np.pad(x, F - 1, mode=pad)
+    length = (len(x) + F - 1) // 2
+    return np.convolve(extended, dec_lo)[F::2][:length], np.convolve(extended, dec_hi)[F::2][:length]
+
+
+def swt(x, dec_lo, level):
+    # pywt.swt(..., trim_approx=True), periodic, the filters spread 2^(l - 1) apart at level l
+    F = len(dec_lo)
+    dec_hi = dec_lo[::-1] * (-1.0) ** (np.arange(F) + 1)
+    details = []
+    for l in range(1, level + 1):
+        d = 1 << (l - 1)
+        index = (np.arange(len(x))[:, None] + (F // 2 - np.arange(F)[None, :]) * d) % len(x)
+        x, detail = x[index] @ dec_lo, x[index] @ dec_hi
+        details.insert(0, detail)
+    return [x] + details
+
+
+def wavelets():
+    # rec_lo of every filter as float64, then one level of every mode on a 37 and a 5 sample signal and two SWT levels
+    # on 32 samples as float32, all in the order of orders() and the modes below
+    x = np.random.RandomState(11).randn(37).astype(np.float32).astype(np.float64)
+    modes = ["symmetric", "reflect", "zero", "constant", "periodization"]
+    filters, transforms, stationary = [], [], []
+    for family, order in orders():
+        rec_lo = daubechies(order, family == "sym")
+        dec_lo = rec_lo[::-1]
+        filters.append(rec_lo)
+        for mode in modes:
+            for signal in (x, x[:5]):
+                transforms.extend(dwt(signal, dec_lo, mode))
+        stationary.extend(swt(x[:32], dec_lo, 2))
+        try:
+            import pywt
+            w = pywt.Wavelet("%s%d" % (family, order))
+            assert np.allclose(w.rec_lo, rec_lo, atol=1e-12)
+            for mode in modes:
+                for signal in (x, x[:5]):
+                    assert np.allclose(pywt.dwt(signal, w, mode), dwt(signal, dec_lo, mode), atol=1e-10)
+            assert np.allclose(pywt.swt(x[:32], w, 2, trim_approx=True), swt(x[:32], dec_lo, 2), atol=1e-10)
+        except ImportError:
+            pass
+    x.astype("<f4").tofile("wavelet_signal.f32")
+    np.concatenate(filters).astype("<f8").tofile("wavelet_filters.f64")
+    np.concatenate(transforms).astype("<f4").tofile("wavelet_dwt.f32")
+    np.concatenate(stationary).astype("<f4").tofile("wavelet_swt.f32")
+
+
+if __name__ == "__main__":
+    flac()
+    mp3()
+    aac()
+    features()
+    wavelets()
@@ -0,0 +1,186 @@
+//
+// FFT and RFFT against the O(n^2) DFT, the plan cache, window shapes, the STFT/ISTFT round trip and the resampler
+//
+
+#include <random>
+#include <vector>
+
+#include "check.h"
+
+static double largest(const WAVLIB::COMPLEX_VEC& values) {
+    double peak = 0.0;
+    for (const auto& v : values) {
+        peak = std::max(peak, static_cast<double>(std::abs(v)));
+    }
+    return peak;
+}
+
+static double difference(const WAVLIB::COMPLEX_VEC& values, const WAVLIB::COMPLEX_VEC& expected, const uint64_t count) {
+    /** Largest error over the first count values, relative to the largest expected value **/
+    if (values.size() < count || expected.size() < count) {
+        return INFINITY;
+    }
+    double error = 0.0;
+    for (uint64_t i = 0; i < count; i++) {
+        error = std::max(error, static_cast<double>(std::abs(values[i] - expected[i])));
+    }
+    return error / std::max(largest(expected), 1e-30);
+}
+
+static void transform(const uint64_t n) {
+    std::mt19937 random(static_cast<unsigned>(n));
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    WAVLIB::COMPLEX_VEC x(n);
+    std::vector<float> real(n);
+    for (uint64_t i = 0; i < n; i++) {
+        x[i] = {uniform(random), uniform(random)};
+        real[i] = x[i].real();
+    }
+
+    // Complex: every radix, the Bluestein sizes 17, 97 and 1031, and back again
+    WAVLIB::COMPLEX_VEC expected;
+    WAVLIB::COMPLEX_VEC spectrum;
+    WAVLIB::COMPLEX_VEC inverse;
+    CHECK(WAVLIB::S::DFT(x, expected));
+    CHECK(WAVLIB::S::FFT(x, spectrum));
+    if (!CHECK_NEAR(difference(spectrum, expected, n), 0.0, 1e-5)) {
+        std::fprintf(stderr, "  FFT of %llu points\n", static_cast<unsigned long long>(n));
+    }
+    CHECK(WAVLIB::S::IFFT(spectrum, inverse));
+    if (!CHECK_NEAR(difference(inverse, x, n), 0.0, 1e-5)) {
+        std::fprintf(stderr, "  IFFT of %llu points\n", static_cast<unsigned long long>(n));
+    }
+
+    // Real: the n / 2 + 1 bins of the DFT of the real parts, even sizes take the half size complex path
+    WAVLIB::COMPLEX_VEC promoted(real.begin(), real.end());
+    WAVLIB::COMPLEX_VEC half;
+    std::vector<float> back;
+    CHECK(WAVLIB::S::DFT(promoted, expected));
+    CHECK(WAVLIB::S::RFFT(real, half));
+    CHECK(half.size() == n / 2 + 1);
+    if (!CHECK_NEAR(difference(half, expected, n / 2 + 1), 0.0, 1e-5)) {
+        std::fprintf(stderr, "  RFFT of %llu points\n", static_cast<unsigned long long>(n));
+    }
+    CHECK(WAVLIB::S::IRFFT(half, back, n));
+    double error = back.size() == n ? 0.0 : INFINITY;
+    for (uint64_t i = 0; i < n && i < back.size(); i++) {
+        error = std::max(error, static_cast<double>(std::abs(back[i] - real[i])));
+    }
+    if (!CHECK_NEAR(error, 0.0, 1e-5)) {
+        std::fprintf(stderr, "  IRFFT of %llu points\n", static_cast<unsigned long long>(n));
+    }
+}
+
+static void plans() {
+    // One plan per size, shared by every caller, and none at all for size 0
+    CHECK(WAVLIB::PLAN::FFT::get(1000) == WAVLIB::PLAN::FFT::get(1000));
+    CHECK(WAVLIB::PLAN::RFFT::get(1000) == WAVLIB::PLAN::RFFT::get(1000));
+    CHECK(WAVLIB::PLAN::FFT::get(1000) != WAVLIB::PLAN::FFT::get(1031));
+    CHECK(WAVLIB::PLAN::FFT::get(0) == nullptr);
+    CHECK(WAVLIB::PLAN::RFFT::get(0) == nullptr);
+    WAVLIB::COMPLEX_VEC out;
+    CHECK(!WAVLIB::S::FFT(WAVLIB::COMPLEX_VEC(), out));
+}
+
+static void windows() {
+    // out always ends up window_length long, whatever it held before
+    WAVLIB::REAL_VEC out(4, 7.0f);
+    CHECK(WAVLIB::W::Hann(out, 1));
+    CHECK(out == WAVLIB::REAL_VEC{1.0f});
+    out.assign(9, 7.0f);
+    CHECK(WAVLIB::W::Hann(out, 4));
+    CHECK(out.size() == 4);
+    CHECK_NEAR(out[0], 0.0, 1e-7);
+    CHECK_NEAR(out[2], 1.0, 1e-7);
+    WAVLIB::COMPLEX_VEC complex(6, {7.0f, 7.0f});
+    CHECK(WAVLIB::W::Hamming(complex, 5, false));
+    CHECK(complex.size() == 5);
+    for (const auto& v : complex) {
+        CHECK(v.imag() == 0.0f);
+    }
+
+    // Symmetric Bartlett runs 0, 0.5, 1, 0.5, 0 up to its last sample, the periodic one stops short of it
+    out.assign(8, 7.0f);
+    CHECK(WAVLIB::W::Bartlett(out, 5, false));
+    const WAVLIB::REAL_VEC symmetric{0.0f, 0.5f, 1.0f, 0.5f, 0.0f};
+    CHECK_NEAR(worst(out, symmetric.data(), symmetric.size()), 0.0, 1e-7);
+    CHECK(WAVLIB::W::Bartlett(out, 4));
+    const WAVLIB::REAL_VEC periodic{0.0f, 0.5f, 1.0f, 0.5f};
+    CHECK_NEAR(worst(out, periodic.data(), periodic.size()), 0.0, 1e-7);
+}
+
+static void stft() {
+    // A periodic Hann window at 75% overlap sums to a constant, so ISTFT gives the signal back
+    const uint64_t size = 10007;
+    std::vector<float> x(size);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (float& v : x) {
+        v = uniform(random);
+    }
+    const auto window = WAVLIB::W::Hann(512);
+    WAVLIB::COMPLEX_VEC spectrum;
+    WAVLIB::REAL_VEC back;
+    CHECK(WAVLIB::S::STFT(WAVLIB::FORMAT::SPAN<const float>(x.data(), size), spectrum, 512, 128, WAVLIB::FORMAT::SPAN<const float>(*window)));
+    CHECK(spectrum.size() == (1 + size / 128) * 257);
+    CHECK(WAVLIB::S::ISTFT(spectrum, back, 512, 128, WAVLIB::FORMAT::SPAN<const float>(*window), true, false, true, static_cast<int64_t>(size)));
+    CHECK_NEAR(worst(back, x.data(), size), 0.0, 1e-5);
+
+    // The complex overloads take a two-sided spectrum
+    WAVLIB::COMPLEX_VEC signal(x.begin(), x.end());
+    WAVLIB::COMPLEX_VEC hann;
+    WAVLIB::COMPLEX_VEC inverse;
+    CHECK(WAVLIB::W::Hann(hann, 400));
+    CHECK(WAVLIB::S::STFT(signal, spectrum, 400, 100, hann));
+    CHECK(spectrum.size() == (1 + size / 100) * 400);
+    CHECK(WAVLIB::S::ISTFT(spectrum, inverse, 400, 100, hann, true, false, false, static_cast<int64_t>(size)));
+    CHECK_NEAR(difference(inverse, signal, size), 0.0, 1e-5);
+
+    // A window longer than the frame keeps its centered frame_size samples, the same taper as a 400 sample window cut by hand
+    const auto longer = WAVLIB::W::Hann(512);
+    const std::vector<float> cut(longer->begin() + 56, longer->begin() + 456);
+    WAVLIB::COMPLEX_VEC trimmed;
+    CHECK(WAVLIB::S::STFT(WAVLIB::FORMAT::SPAN<const float>(x.data(), size), spectrum, 400, 100, WAVLIB::FORMAT::SPAN<const float>(*longer)));
+    CHECK(WAVLIB::S::STFT(WAVLIB::FORMAT::SPAN<const float>(x.data(), size), trimmed, 400, 100, WAVLIB::FORMAT::SPAN<const float>(cut.data(), cut.size())));
+    CHECK(spectrum == trimmed);
+    CHECK(WAVLIB::S::ISTFT(spectrum, back, 400, 100, WAVLIB::FORMAT::SPAN<const float>(*longer), true, false, true, static_cast<int64_t>(size)));
+    CHECK_NEAR(worst(back, x.data(), size), 0.0, 1e-4);
+}
+
+static void resample(const unsigned in_rate, const unsigned out_rate) {
+    // A 1 kHz tone comes out as the same tone, output n sits at input time n * in_rate / out_rate
+    const uint64_t size = in_rate / 2;
+    std::vector<float> x(size);
+    for (uint64_t i = 0; i < size; i++) {
+        x[i] = static_cast<float>(0.5 * std::sin(2.0 * WAVLIB_PI * 1000.0 * static_cast<double>(i) / in_rate));
+    }
+    WAVLIB::REAL_VEC y;
+    CHECK(WAVLIB::S::RESAMPLE(WAVLIB::FORMAT::SPAN<const float>(x.data(), size), y, in_rate, out_rate));
+    CHECK(y.size() == (size * out_rate + in_rate - 1) / in_rate);
+    // The filter reaches 32 input samples either way, the ends see the zeros past the signal
+    const uint64_t edge = 64 * out_rate / in_rate + 64;
+    double error = y.size() > 2 * edge ? 0.0 : INFINITY;
+    for (uint64_t n = edge; n + edge < y.size(); n++) {
+        const double expected = 0.5 * std::sin(2.0 * WAVLIB_PI * 1000.0 * static_cast<double>(n) / out_rate);
+        error = std::max(error, std::abs(static_cast<double>(y[n]) - expected));
+    }
+    if (!CHECK_NEAR(error, 0.0, 1e-3)) {
+        std::fprintf(stderr, "  %u Hz to %u Hz\n", in_rate, out_rate);
+    }
+}
+
+int main() {
+    for (uint64_t n = 1; n <= 17; n++) {
+        transform(n);
+    }
+    for (const uint64_t n : {97, 1000, 1031, 4096}) {
+        transform(n);
+    }
+    plans();
+    windows();
+    stft();
+    resample(44100, 48000);
+    resample(48000, 16000);
+    resample(16000, 22050);
+    return finish("fft");
+}
@@ -0,0 +1,212 @@
+//
+// FLAC decoder against files written by the reference encoder (libFLAC), see data/generate.py,
+// and the encoder through a bit-exact round trip
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "check.h"
+
+struct FIXTURE {
+    const char* name;
+    unsigned short channels;
+    unsigned int sample_rate;
+    unsigned short bits;
+};
+
+static const uint64_t frames = 5000;
+
+static const FIXTURE fixtures[] = {
+    {"s16_stereo.flac", 2, 44100, 16},       // Default preset, LPC subframes and stereo decorrelation
+    {"s16_stereo_fast.flac", 2, 44100, 16},  // Fastest preset, fixed predictors
+    {"s24_mono.flac", 1, 48000, 24},
+    {"s8_3ch.flac", 3, 8000, 8},
+};
+
+static std::vector<int> pattern(const uint64_t count, const unsigned short channels, const unsigned short bits) {
+    /** Interleaved copy of the integers generate.py encoded, two triangles and a little noise per channel **/
+    const int64_t full = int64_t(1) << (bits - 1);
+    const int64_t noise = std::max<int64_t>(full >> 9, 2);
+    std::vector<int> out(count * channels);
+    for (unsigned short c = 0; c < channels; c++) {
+        uint64_t state = 12345 + 977 * c;
+        const int64_t P = 200 + 30 * c;
+        const int64_t Q = 37 + c;
+        for (uint64_t n = 0; n < count; n++) {
+            state = (state * 1103515245 + 12345) & 0x7fffffff;
+            const auto i = static_cast<int64_t>(n);
+            int64_t x = std::llabs(2 * (i % P) - P) * (full / 2) / P - full / 4;
+            x += std::llabs(2 * (i % Q) - Q) * (full / 4) / Q - full / 8;
+            x += static_cast<int64_t>(state >> 16) % noise - noise / 2;
+            out[n * channels + c] = static_cast<int>(x);
+        }
+    }
+    return out;
+}
+
+static void decode(const FIXTURE& fixture) {
+    const std::string path = data(fixture.name);
+    const std::vector<int> expected = pattern(frames, fixture.channels, fixture.bits);
+
+    // FORMAT::WAV holds 8-bit samples unsigned, the way a WAV file stores them
+    std::vector<int> stored = expected;
+    if (fixture.bits == 8) {
+        for (int& x : stored) {
+            x += 128;
+        }
+    }
+    WAVLIB::FORMAT::WAV audio;
+    CHECK(WAVLIB::LOAD(path, audio));
+    CHECK(audio.channels == fixture.channels);
+    CHECK(audio.sample_rate == fixture.sample_rate);
+    CHECK(audio.sample_size == fixture.bits);
+    CHECK(audio.audio == stored);
+
+    // Planar floats are the integers over full scale, exact up to 24 bits
+    WAVLIB::FORMAT::PLANAR planar;
+    CHECK(WAVLIB::LOAD(path, planar));
+    CHECK(planar.channels == fixture.channels && planar.frames == frames);
+    const float scale = 1.0f / static_cast<float>(1 << (fixture.bits - 1));
+    uint64_t mismatches = 0;
+    for (unsigned short c = 0; c < planar.channels && planar.frames == frames; c++) {
+        const auto channel = planar.channel(c);
+        for (uint64_t n = 0; n < frames; n++) {
+            mismatches += channel[n] != static_cast<float>(expected[n * fixture.channels + c]) * scale;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // A range across the block boundary at 4096
+    WAVLIB::RANGE_READER reader;
+    CHECK(reader.open(path));
+    CHECK(reader.frames() == frames);
+    std::vector<int> range;
+    CHECK(reader.read(1234, 4321, range));
+    CHECK(range == std::vector<int>(stored.begin() + 1234 * fixture.channels, stored.begin() + 4321 * fixture.channels));
+
+    WAVLIB::FORMAT::INFO info;
+    CHECK(WAVLIB::PROBE(path, info));
+    CHECK(info.codec == "flac" && info.frames == frames && info.exact);
+
+    // SCAN streams the frames through the levels, peak and silence come out exact
+    std::vector<WAVLIB::FORMAT::STATS> stats;
+    std::vector<std::string> errors;
+    double peak = 0.0;
+    double squares = 0.0;
+    uint64_t silent = 0;
+    for (const int x : expected) {
+        const double a = std::abs(static_cast<double>(x) * scale);
+        peak = std::max(peak, a);
+        squares += a * a;
+        silent += a < 0.001 ? 1 : 0;
+    }
+    const double count = static_cast<double>(expected.size());
+    if (CHECK(WAVLIB::SCAN({path}, stats, errors)) && CHECK(stats.size() == 1)) {
+        CHECK(stats[0].info.frames == frames && stats[0].info.exact);
+        CHECK(stats[0].peak == static_cast<float>(peak) && stats[0].clipped == 0);
+        CHECK_NEAR(stats[0].rms, std::sqrt(squares / count), 1e-6);
+        CHECK_NEAR(stats[0].silence, static_cast<double>(silent) / count, 1e-12);
+    }
+}
+
+static WAVLIB::FORMAT::WAV signal(const int kind, const uint64_t count, const unsigned short channels, const unsigned short bits) {
+    /** 0 the fixture pattern, 1 full scale extremes, 2 white noise that only a verbatim subframe can hold, 3 silence **/
+    WAVLIB::FORMAT::WAV audio;
+    audio.format = 1;
+    audio.channels = channels;
+    audio.sample_rate = 44100;
+    audio.sample_size = bits;
+    const int64_t full = int64_t(1) << (bits - 1);
+    std::mt19937_64 random(bits * 131 + channels);
+    audio.audio = pattern(count, channels, bits);
+    for (uint64_t i = 0; i < audio.audio.size(); i++) {
+        if (kind == 1) {
+            audio.audio[i] = static_cast<int>(i % 3 == 0 ? full - 1 : i % 3 == 1 ? -full : 0);
+        } else if (kind == 2) {
+            audio.audio[i] = static_cast<int>(static_cast<int64_t>(random() % static_cast<uint64_t>(2 * full)) - full);
+        } else if (kind == 3) {
+            audio.audio[i] = 0;
+        }
+        if (bits == 8) {
+            audio.audio[i] += 128;
+        }
+    }
+    return audio;
+}
+
+static void round_trip() {
+    // Frame counts around the 4096 block size, every supported depth, and the fastest, default and smallest preset
+    const std::string path = "wavlib_test_round_trip.flac";
+    for (const unsigned short bits : {8, 16, 24, 32}) {
+        for (const unsigned short channels : {1, 2, 6}) {
+            for (const uint64_t count : {1, 4095, 4097, 20000}) {
+                for (const int kind : {0, 1, 2, 3}) {
+                    const WAVLIB::FORMAT::WAV in = signal(kind, count, channels, bits);
+                    for (const unsigned level : {0u, 5u, 8u}) {
+                        WAVLIB::FORMAT::WAV out;
+                        const bool written = CHECK(WAVLIB::DUMP(path, in, level));
+                        if (!written || !CHECK(WAVLIB::LOAD(path, out))) {
+                            std::fprintf(stderr, "  %u bits, %u channels, %llu frames, signal %d, level %u\n", bits, channels, static_cast<unsigned long long>(count), kind, level);
+                            continue;
+                        }
+                        if (!CHECK(out.channels == channels && out.sample_size == bits && out.audio == in.audio)) {
+                            std::fprintf(stderr, "  %u bits, %u channels, %llu frames, signal %d, level %u\n", bits, channels, static_cast<unsigned long long>(count), kind, level);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::remove(path.c_str());
+
+    // The level overload only writes FLAC, so it refuses a name that promises a WAV file
+    CHECK(!WAVLIB::DUMP("wavlib_test_round_trip.WAV", signal(0, 16, 1, 16), 5));
+}
+
+static void oversized() {
+    // A STREAMINFO count 2^32 * 15 frames too high, the output must be sized by the payload and not by the header
+    std::ifstream in(data("s16_stereo.flac"), std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!CHECK(bytes.size() > 22 && std::string(bytes.data(), 4) == "fLaC")) {
+        return;
+    }
+    bytes[21] = static_cast<char>(bytes[21] | 0x0F);
+    const std::string path = "wavlib_test_oversized.flac";
+    std::ofstream(path, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+    WAVLIB::FORMAT::WAV audio;
+    WAVLIB::FORMAT::PLANAR planar;
+    CHECK(WAVLIB::LOAD(path, audio) && audio.audio.size() == frames * 2);
+    CHECK(WAVLIB::LOAD(path, planar) && planar.frames == frames);
+    std::remove(path.c_str());
+}
+
+static void batch() {
+    // A broken file gets its own error and the good file next to it still loads, into the caller's buffers
+    const std::string bad = "wavlib_test_batch_bad.flac";
+    std::ofstream(bad, std::ios::binary) << "fLaC and nothing a decoder could use";
+    const std::vector<std::string> names = {bad, data("s16_stereo.flac")};
+    std::vector<WAVLIB::FORMAT::WAV> audio(2);
+    audio[1].audio.reserve(frames * 2);
+    const int* reused = audio[1].audio.data();
+    std::vector<std::string> errors;
+    CHECK(!WAVLIB::LOAD(names, audio, errors));
+    CHECK(errors.size() == 2 && !errors[0].empty() && errors[1].empty());
+    CHECK(audio.size() == 2 && audio[0].audio.empty() && audio[1].audio.size() == frames * 2);
+    CHECK(audio[1].audio.data() == reused);
+    std::remove(bad.c_str());
+}
+
+int main() {
+    for (const FIXTURE& fixture : fixtures) {
+        decode(fixture);
+    }
+    oversized();
+    batch();
+    round_trip();
+    return finish("flac");
+}
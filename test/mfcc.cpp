@@ -0,0 +1,48 @@
+//
+// Mel spectrogram and MFCC against librosa, see data/generate.py
+//
+
+#include <vector>
+
+#include "check.h"
+
+struct SETTING {
+    int n_fft;
+    int hop_length;
+    int n_mels;
+    int n_mfcc;
+    int lifter;
+};
+
+static const SETTING settings[] = {
+    {400, 160, 40, 13, 0},   // The defaults
+    {512, 128, 64, 20, 22},  // Power of two FFT and a lifter
+};
+
+static void compare(const WAVLIB::FORMAT::PLANAR& audio, const SETTING& s) {
+    const auto signal = audio.channel(0);
+
+    // Power in dB, float32 against float64 is good to a few ten-thousandths of a dB
+    WAVLIB::REAL_VEC mel;
+    CHECK(WAVLIB::S::MEL(signal, mel, audio.sample_rate, s.n_fft, s.hop_length, s.n_mels, true, "reflect", "db"));
+    CHECK_NEAR(worst(mel, reference("tones_16k.mel" + std::to_string(s.n_mels) + ".f32")), 0.0, 2e-4);
+
+    WAVLIB::REAL_VEC mfcc;
+    CHECK(WAVLIB::S::MFCC(signal, mfcc, audio.sample_rate, s.n_mfcc, s.n_fft, s.hop_length, s.n_mels, s.lifter));
+    CHECK_NEAR(worst(mfcc, reference("tones_16k.mfcc" + std::to_string(s.n_mfcc) + ".f32")), 0.0, 2e-3);
+
+    // The cepstrum of the mel frames is the same MFCC
+    WAVLIB::REAL_VEC cepstrum;
+    CHECK(WAVLIB::S::CEPSTRUM(mel, cepstrum, s.n_mels, s.n_mfcc, s.lifter));
+    CHECK_NEAR(worst(cepstrum, std::vector<float>(mfcc.begin(), mfcc.end())), 0.0, 1e-5);
+}
+
+int main() {
+    WAVLIB::FORMAT::PLANAR audio;
+    if (CHECK(WAVLIB::LOAD(data("tones_16k.wav"), audio)) && CHECK(audio.channels == 1 && audio.frames == 4000)) {
+        for (const SETTING& setting : settings) {
+            compare(audio, setting);
+        }
+    }
+    return finish("mfcc");
+}
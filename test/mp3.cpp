@@ -0,0 +1,33 @@
+//
+// MP3 decoder against mpg123 on files from LAME, see data/generate.py
+//
+
+#include <vector>
+
+#include "check.h"
+
+struct FIXTURE {
+    const char* name;
+    unsigned short channels;
+    unsigned int sample_rate;
+};
+
+static const FIXTURE fixtures[] = {
+    {"joint_44k_cbr.mp3", 2, 44100},  // MPEG-1, joint stereo
+    {"mono_22k_vbr.mp3", 1, 22050},   // MPEG-2, Xing header with a LAME tag
+    {"mono_8k_cbr.mp3", 1, 8000},     // MPEG-2.5
+};
+
+static void decode(const FIXTURE& fixture) {
+    // The reference is mpg123
+    WAVLIB::FORMAT::PLANAR audio;
+    WAVLIB::FORMAT::INFO info;
+    lossy("mp3", fixture.name, fixture.channels, fixture.sample_rate, audio, info);
+}
+
+int main() {
+    for (const FIXTURE& fixture : fixtures) {
+        decode(fixture);
+    }
+    return finish("mp3");
+}
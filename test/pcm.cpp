@@ -0,0 +1,157 @@
+//
+// PCM conversion through a DUMP/LOAD round trip for every sample type, and float input clipped by WRITER
+//
+// Built twice, the second time with WAVLIB_NO_SIMD, so the scalar code and the SIMD kernels are held to the same values
+//
+
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.h"
+
+#ifdef WAVLIB_NO_SIMD
+static const char* test = "pcm_scalar";
+static const std::string path = "wavlib_test_pcm_scalar.wav";
+#else
+static const char* test = "pcm";
+static const std::string path = "wavlib_test_pcm.wav";
+#endif
+
+struct TYPE {
+    const char* name;
+    unsigned short format;
+    unsigned short bits;
+};
+
+static const TYPE types[] = {
+    {"u8", 1, 8},
+    {"s16", 1, 16},
+    {"s24", 1, 24},
+    {"s32", 1, 32},
+    {"f32", 3, 32},
+    {"f64", 3, 64},
+};
+
+// Every kernel tail and a run long enough for the encode blocks and the SIMD loops
+static const uint64_t counts[] = {0, 1, 7, 13, 1000001};
+
+static const unsigned short channels = 2;
+
+static WAVLIB::FORMAT::WAV header(const TYPE& type) {
+    WAVLIB::FORMAT::WAV audio;
+    audio.format = type.format;
+    audio.channels = channels;
+    audio.sample_rate = 48000;
+    audio.sample_size = type.bits;
+    return audio;
+}
+
+static std::vector<int> samples(const TYPE& type, const uint64_t count) {
+    /** Random samples in the native int32 range of the type, starting with both ends of it **/
+    /** f32 only gets multiples of 256, the int32 values a float holds exactly **/
+    const int bits = type.format == 3 ? 32 : type.bits;
+    const int64_t full = int64_t(1) << (bits - 1);
+    const int64_t offset = type.bits == 8 ? 128 : 0;
+    const int64_t step = type.format == 3 && type.bits == 32 ? 256 : 1;
+    std::mt19937_64 random(type.bits * 7 + type.format + count);
+    std::vector<int> values(count * channels);
+    for (uint64_t i = 0; i < values.size(); i++) {
+        const int64_t value = i == 0 ? -full : i == 1 ? full - step : static_cast<int64_t>(random() % static_cast<uint64_t>(2 * full)) - full;
+        values[i] = static_cast<int>(value / step * step + offset);
+    }
+    return values;
+}
+
+static float normalized(const TYPE& type, const int value) {
+    /** The PLANAR sample of a native int32 sample **/
+    if (type.format == 3) {
+        return static_cast<float>(static_cast<double>(value) / 2147483648.0);
+    }
+    const int offset = type.bits == 8 ? 128 : 0;
+    return static_cast<float>(value - offset) * static_cast<float>(1.0 / static_cast<double>(int64_t(1) << (type.bits - 1)));
+}
+
+static bool planar(const TYPE& type, const WAVLIB::FORMAT::PLANAR& audio, const std::vector<int>& values) {
+    if (audio.channels != channels || audio.frames * channels != values.size()) {
+        return false;
+    }
+    for (uint64_t n = 0; n < audio.frames; n++) {
+        for (unsigned short c = 0; c < channels; c++) {
+            if (audio.channel(c)[n] != normalized(type, values[n * channels + c])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void round_trip(const TYPE& type, const uint64_t count) {
+    // Integer samples come back bit-exact, as int32 and on the float scale
+    WAVLIB::FORMAT::WAV in = header(type);
+    in.audio = samples(type, count);
+    WAVLIB::FORMAT::WAV out;
+    WAVLIB::FORMAT::PLANAR scaled;
+    const bool loaded = CHECK(WAVLIB::DUMP(path, in)) && CHECK(WAVLIB::LOAD(path, out)) && CHECK(WAVLIB::LOAD(path, scaled));
+    const bool same = loaded && out.format == type.format && out.sample_size == type.bits && out.channels == channels && out.audio == in.audio;
+    if (!CHECK(same && planar(type, scaled, in.audio))) {
+        std::fprintf(stderr, "  %s, %llu frames\n", type.name, static_cast<unsigned long long>(count));
+    }
+}
+
+static int quantized(const TYPE& type, const float value) {
+    /** The native int32 sample a float input has to become, clipped to full scale **/
+    if (type.format == 3) {
+        const double scaled = static_cast<double>(value) * 2147483648.0;
+        return scaled >= 2147483647.0 ? std::numeric_limits<int>::max() : scaled <= -2147483648.0 ? std::numeric_limits<int>::min() : static_cast<int>(std::lrint(scaled));
+    }
+    const double full = static_cast<double>(int64_t(1) << (type.bits - 1));
+    const double clipped = std::min(std::max(static_cast<double>(value) * full, -full), full - 1.0);
+    return static_cast<int>(std::lrint(clipped)) + (type.bits == 8 ? 128 : 0);
+}
+
+static void clipping(const TYPE& type, const uint64_t count) {
+    // Full scale, past it in both directions, and values that have to round
+    const float pattern[] = {0.0f, 1.0f, -1.0f, 1.5f, -2.0f, 0.25f, -0.25f, 1e30f, -1e30f, 0.9999999f, -0.9999999f, 0.3f, -0.7f};
+    std::vector<float> in(count * channels);
+    for (uint64_t i = 0; i < in.size(); i++) {
+        in[i] = pattern[i % (sizeof(pattern) / sizeof(pattern[0]))];
+    }
+    WAVLIB::WRITER writer;
+    CHECK(writer.open(path, header(type)));
+    CHECK(writer.write(in));
+    CHECK(writer.close());
+
+    std::vector<int> expected(in.size());
+    for (uint64_t i = 0; i < in.size(); i++) {
+        expected[i] = quantized(type, in[i]);
+    }
+    WAVLIB::FORMAT::WAV out;
+    WAVLIB::FORMAT::PLANAR scaled;
+    if (!CHECK(WAVLIB::LOAD(path, out) && out.audio == expected)) {
+        std::fprintf(stderr, "  %s float input, %llu frames\n", type.name, static_cast<unsigned long long>(count));
+    }
+    // Float files keep what was written, whatever its level, integer ones hold the clipped value
+    bool kept = WAVLIB::LOAD(path, scaled) && scaled.frames == count;
+    for (uint64_t n = 0; n < scaled.frames && kept; n++) {
+        for (unsigned short c = 0; c < channels && kept; c++) {
+            const float value = in[n * channels + c];
+            kept = scaled.channel(c)[n] == (type.format == 3 ? value : normalized(type, expected[n * channels + c]));
+        }
+    }
+    if (!CHECK(kept)) {
+        std::fprintf(stderr, "  %s float input read back as PLANAR, %llu frames\n", type.name, static_cast<unsigned long long>(count));
+    }
+}
+
+int main() {
+    for (const TYPE& type : types) {
+        for (const uint64_t count : counts) {
+            round_trip(type, count);
+            clipping(type, count);
+        }
+    }
+    std::remove(path.c_str());
+    return finish(test);
+}
@@ -0,0 +1,116 @@
+//
+// Time-scale modification: output lengths, batched and streamed variants, and that the pitch stays put
+//
+
+#include <random>
+#include <vector>
+
+#include "check.h"
+
+static WAVLIB::FORMAT::WAV tone(const unsigned short channels, const uint64_t frames, const double frequency) {
+    /** 16-bit sine at 16 kHz, every channel the same **/
+    WAVLIB::FORMAT::WAV audio;
+    audio.format = 1;
+    audio.channels = channels;
+    audio.sample_rate = 16000;
+    audio.sample_size = 16;
+    audio.audio.resize(frames * channels);
+    for (uint64_t n = 0; n < frames; n++) {
+        const int x = static_cast<int>(std::lround(12000.0 * std::sin(2.0 * WAVLIB_PI * frequency * static_cast<double>(n) / 16000.0)));
+        for (unsigned short c = 0; c < channels; c++) {
+            audio.audio[n * channels + c] = x;
+        }
+    }
+    return audio;
+}
+
+static double frequency(const WAVLIB::FORMAT::WAV& audio) {
+    /** Zero crossings of channel 0 over the middle 60 percent, away from the edges **/
+    const uint64_t frames = audio.audio.size() / audio.channels;
+    const uint64_t first = frames / 5;
+    const uint64_t last = frames - frames / 5;
+    uint64_t crossings = 0;
+    for (uint64_t n = first + 1; n < last; n++) {
+        crossings += (audio.audio[(n - 1) * audio.channels] < 0) != (audio.audio[n * audio.channels] < 0);
+    }
+    return static_cast<double>(crossings) / 2.0 * audio.sample_rate / static_cast<double>(last - first - 1);
+}
+
+static uint64_t stretched(const uint64_t frames, const float rate) {
+    return static_cast<uint64_t>(std::nearbyint(static_cast<double>(frames) / static_cast<double>(rate)));
+}
+
+static void lengths() {
+    const WAVLIB::FORMAT::WAV in = tone(2, 16001, 440.0);
+    for (const float rate : {0.5f, 0.8f, 1.0f, 1.25f, 2.0f}) {
+        WAVLIB::FORMAT::WAV ola, wsola, pv;
+        CHECK(WAVLIB::F::OLA(in, ola, rate));
+        CHECK(WAVLIB::F::WSOLA(in, wsola, rate));
+        CHECK(WAVLIB::F::PV(in, pv, rate));
+        for (const WAVLIB::FORMAT::WAV* out : {&ola, &wsola, &pv}) {
+            CHECK(out->channels == 2 && out->sample_rate == 16000 && out->sample_size == 16);
+            CHECK(out->audio.size() == stretched(16001, rate) * 2);
+        }
+        // A pitch preserving stretch keeps the 440 Hz tone
+        CHECK_NEAR(frequency(wsola), 440.0, 440.0 * 0.02);
+        CHECK_NEAR(frequency(pv), 440.0, 440.0 * 0.02);
+    }
+}
+
+static void batched() {
+    // Every variant of one batched call equals its own single call
+    const WAVLIB::FORMAT::WAV in = tone(1, 12000, 300.0);
+    const std::vector<float> rates = {0.7f, 1.0f, 1.5f};
+    std::vector<WAVLIB::FORMAT::WAV> wsola, pv;
+    CHECK(WAVLIB::F::WSOLA(in, wsola, rates));
+    CHECK(WAVLIB::F::PV(in, pv, rates));
+    CHECK(wsola.size() == rates.size() && pv.size() == rates.size());
+    for (uint64_t i = 0; i < rates.size() && i < wsola.size() && i < pv.size(); i++) {
+        WAVLIB::FORMAT::WAV single;
+        CHECK(WAVLIB::F::WSOLA(in, single, rates[i]));
+        CHECK(single.audio == wsola[i].audio);
+        CHECK(WAVLIB::F::PV(in, single, rates[i]));
+        CHECK(single.audio == pv[i].audio);
+    }
+}
+
+template<typename ENGINE>
+static std::vector<float> stream(ENGINE&& engine, const std::vector<float>& in, const unsigned short channels, const uint64_t block) {
+    /** Feed in blocks of random size up to block frames, block 0 pushes everything at once **/
+    std::vector<float> out;
+    auto emit = [&](const float* samples, const uint64_t frames) {
+        out.insert(out.end(), samples, samples + frames * channels);
+    };
+    std::mt19937 random(7);
+    const uint64_t frames = in.size() / channels;
+    for (uint64_t first = 0; first < frames;) {
+        const uint64_t count = block == 0 ? frames : std::min<uint64_t>(frames - first, 1 + random() % block);
+        engine.push(in.data() + first * channels, count, emit);
+        first += count;
+    }
+    engine.flush(emit);
+    return out;
+}
+
+static void streaming() {
+    // Chunking does not change the stream, and flush leaves round(frames / rate) frames
+    std::vector<float> in(9001 * 2);
+    for (uint64_t i = 0; i < in.size(); i++) {
+        in[i] = static_cast<float>(std::sin(0.05 * static_cast<double>(i / 2)) * (i % 2 == 0 ? 0.5 : 0.25));
+    }
+    for (const float rate : {0.6f, 1.3f}) {
+        const std::vector<float> wsola = stream(WAVLIB::ONLINE::WSOLA(2, rate), in, 2, 0);
+        const std::vector<float> pv = stream(WAVLIB::ONLINE::PV(2, rate), in, 2, 0);
+        CHECK(wsola.size() == stretched(9001, rate) * 2);
+        CHECK(pv.size() == stretched(9001, rate) * 2);
+        CHECK(stream(WAVLIB::ONLINE::WSOLA(2, rate), in, 2, 700) == wsola);
+        CHECK(stream(WAVLIB::ONLINE::PV(2, rate), in, 2, 700) == pv);
+    }
+}
+
+int main() {
+    lengths();
+    batched();
+    streaming();
+    return finish("tsm");
+}
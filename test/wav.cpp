@@ -0,0 +1,293 @@
+//
+// RIFF chunk walker against small files built here byte by byte, one per layout the loader has to understand,
+// and the header WRITER patches on close, including the switch to RF64 past 4 GB
+//
+// Every file goes through LOAD, the memory map and the streaming READER, which walk the chunks each in their own way
+//
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+static const std::string path = "wavlib_test_chunks.wav";
+
+static void u16(std::string& out, const uint32_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+static void u32(std::string& out, const uint32_t value) {
+    u16(out, value & 0xFFFF);
+    u16(out, value >> 16);
+}
+
+static void u64(std::string& out, const uint64_t value) {
+    u32(out, static_cast<uint32_t>(value));
+    u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static std::string chunk(const char* id, const std::string& payload, const uint32_t size = 0) {
+    /** A chunk and its pad byte, size overrides the real payload size when it isn't 0 **/
+    std::string out(id, 4);
+    u32(out, size != 0 ? size : static_cast<uint32_t>(payload.size()));
+    out += payload;
+    if (payload.size() & 1) {
+        out += '\0';
+    }
+    return out;
+}
+
+static std::string fmt(const unsigned short format, const unsigned short channels, const unsigned short bits, const unsigned short sub_format = 0) {
+    /** fmt payload, WAVE_FORMAT_EXTENSIBLE (0xFFFE) carries sub_format in its GUID **/
+    std::string out;
+    u16(out, format);
+    u16(out, channels);
+    u32(out, 48000);
+    u32(out, 48000u * channels * bits / 8);
+    u16(out, channels * bits / 8);
+    u16(out, bits);
+    if (format == 0xFFFE) {
+        u16(out, 22);
+        u16(out, bits);
+        u32(out, channels == 2 ? 0x3 : 0x4);
+        u16(out, sub_format);
+        out += std::string("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 14);
+    }
+    return out;
+}
+
+static std::string s16(const std::vector<int>& samples) {
+    std::string out;
+    for (const int sample : samples) {
+        u16(out, static_cast<uint32_t>(sample) & 0xFFFF);
+    }
+    return out;
+}
+
+static std::string riff(const std::string& body, const char* tag = "RIFF", const uint32_t size = 0) {
+    std::string out(tag, 4);
+    u32(out, size != 0 ? size : static_cast<uint32_t>(body.size() + 4));
+    return out + "WAVE" + body;
+}
+
+static void save(const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+static bool streamed(const std::vector<int>& samples, const unsigned short format) {
+    /** READER parses the header forward only and then pulls the samples block by block **/
+    WAVLIB::READER reader;
+    if (!reader.open(path) || reader.format.format != format) {
+        return false;
+    }
+    std::vector<int> out;
+    std::vector<int> block;
+    uint64_t frames;
+    while ((frames = reader.read(block, 3)) != 0) {
+        out.insert(out.end(), block.begin(), block.begin() + static_cast<std::ptrdiff_t>(frames * reader.format.channels));
+    }
+    return out == samples;
+}
+
+static void loads(const char* name, const std::vector<int>& samples, const unsigned short format, const unsigned short channels) {
+    // The whole-file load, the mapping and the stream all agree on the header and the samples
+    WAVLIB::FORMAT::WAV audio;
+    WAVLIB::FORMAT::MAPPED_WAV mapped;
+    const bool loaded = CHECK(WAVLIB::LOAD(path, audio));
+    const bool same = loaded && audio.format == format && audio.channels == channels && audio.audio == samples;
+    const bool map = CHECK(WAVLIB::LOAD(path, mapped)) && mapped.format == format && mapped.frames * channels == samples.size();
+    if (!CHECK(same && map && streamed(samples, format))) {
+        std::fprintf(stderr, "  %s\n", name);
+    }
+}
+
+class SINK : public std::streambuf {
+    /** Seekable stream that keeps the first bytes, where the header goes, and only counts the rest **/
+public:
+    std::string head = std::string(128, '\0');
+    uint64_t position = 0;
+    uint64_t end = 0;
+
+protected:
+    std::streamsize xsputn(const char* s, const std::streamsize n) override {
+        for (uint64_t i = 0; position + i < head.size() && i < static_cast<uint64_t>(n); i++) {
+            head[position + i] = s[i];
+        }
+        position += static_cast<uint64_t>(n);
+        end = std::max(end, position);
+        return n;
+    }
+
+    int_type overflow(const int_type c) override {
+        if (c != traits_type::eof()) {
+            const char value = traits_type::to_char_type(c);
+            xsputn(&value, 1);
+        }
+        return c;
+    }
+
+    pos_type seekoff(const off_type offset, const std::ios_base::seekdir dir, const std::ios_base::openmode) override {
+        position = static_cast<uint64_t>((dir == std::ios_base::beg ? 0 : dir == std::ios_base::cur ? static_cast<off_type>(position) : static_cast<off_type>(end)) + offset);
+        return static_cast<pos_type>(position);
+    }
+
+    pos_type seekpos(const pos_type target, const std::ios_base::openmode) override {
+        position = static_cast<uint64_t>(target);
+        return target;
+    }
+};
+
+static void rejected(const char* name) {
+    WAVLIB::FORMAT::WAV audio;
+    WAVLIB::FORMAT::MAPPED_WAV mapped;
+    WAVLIB::READER reader;
+    if (!CHECK(!WAVLIB::LOAD(path, audio) && !WAVLIB::LOAD(path, mapped) && !reader.open(path))) {
+        std::fprintf(stderr, "  %s\n", name);
+    }
+}
+
+static void extensible() {
+    // The real format tag sits in the first two bytes of the sub format GUID
+    const std::vector<int> samples = {1, -2, 300, -32768, 32767, 0};
+    save(riff(chunk("fmt ", fmt(0xFFFE, 2, 16, 1)) + chunk("data", s16(samples))));
+    loads("extensible PCM", samples, 1, 2);
+
+    std::string floats;
+    for (const float value : {0.5f, -0.25f, 1.0f}) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        u32(floats, bits);
+    }
+    save(riff(chunk("fmt ", fmt(0xFFFE, 1, 32, 3)) + chunk("data", floats)));
+    WAVLIB::FORMAT::PLANAR audio;
+    const bool loaded = CHECK(WAVLIB::LOAD(path, audio)) && audio.channels == 1 && audio.frames == 3;
+    CHECK(loaded && audio.channel(0)[0] == 0.5f && audio.channel(0)[1] == -0.25f && audio.channel(0)[2] == 1.0f);
+
+    // print names the sub format, not the extensible tag
+    WAVLIB::FORMAT::WAV wav;
+    std::ostringstream printed;
+    std::streambuf* const console = std::cout.rdbuf(printed.rdbuf());
+    const bool shown = WAVLIB::LOAD(path, wav) && WAVLIB::print(wav);
+    std::cout.rdbuf(console);
+    CHECK(shown && printed.str().find("Type of format: IEEE float\n") == 0);
+}
+
+static void metadata() {
+    // LIST, fact and an odd-sized chunk ahead of the samples, its pad byte must be skipped as well
+    const std::vector<int> samples = {7, -7, 8, -8, 9};
+    std::string fact;
+    u32(fact, 5);
+    const std::string body = chunk("fmt ", fmt(1, 1, 16)) + chunk("LIST", std::string("INFOISFT\x03\x00\x00\x00id3\x00", 16)) + chunk("fact", fact) +
+                             chunk("odd ", "abc") + chunk("data", s16(samples)) + chunk("LIST", std::string("INFO", 4));
+    save(riff(body));
+    loads("LIST, fact and odd chunks", samples, 1, 1);
+
+    // The index holds every chunk in file order, with payload offsets counted from the start of the file
+    WAVLIB::FORMAT::MAPPED_WAV mapped;
+    const std::vector<std::string> ids = {"fmt ", "LIST", "fact", "odd ", "data", "LIST"};
+    const std::vector<uint64_t> offsets = {20, 44, 68, 80, 92, 110};
+    bool indexed = CHECK(WAVLIB::LOAD(path, mapped)) && mapped.chunks.size() == ids.size();
+    for (uint64_t i = 0; indexed && i < ids.size(); i++) {
+        indexed = mapped.chunks[i].id == ids[i] && mapped.chunks[i].offset == offsets[i];
+    }
+    CHECK(indexed);
+    CHECK(mapped.chunk("odd ").size == 3 && std::string(mapped.chunk("odd ").data, 3) == "abc");
+    CHECK(mapped.chunk("fact").size == 4 && mapped.chunk("fact").data[0] == 5);
+}
+
+static void rf64() {
+    // RF64 keeps the real sizes in ds64, the RIFF and data fields only hold 0xFFFFFFFF
+    const std::vector<int> samples = {100, -100, 200, -200, 300, -300, 400, -400};
+    std::string ds64;
+    u64(ds64, 4 + 36 + 24 + 8 + samples.size() * 2);
+    u64(ds64, samples.size() * 2);
+    u64(ds64, samples.size() / 2);
+    u32(ds64, 0);
+    const std::string body = chunk("ds64", ds64) + chunk("fmt ", fmt(1, 2, 16)) + chunk("data", s16(samples), 0xFFFFFFFF);
+    save(riff(body, "RF64", 0xFFFFFFFF));
+    loads("RF64", samples, 1, 2);
+
+    // A trailing chunk after the samples, so the size in ds64 has to be the one that counts
+    save(riff(body + chunk("LIST", std::string("INFO", 4)), "RF64", 0xFFFFFFFF));
+    loads("RF64 with a trailing chunk", samples, 1, 2);
+}
+
+static void unknown_size() {
+    // A stream that never came back to patch its sizes, the samples run to the end of the file
+    const std::vector<int> samples = {1, 2, 3, 4, 5, 6, 7};
+    save(riff(chunk("fmt ", fmt(1, 1, 16)) + chunk("data", s16(samples), 0xFFFFFFFF), "RIFF", 0xFFFFFFFF));
+    loads("data size 0xFFFFFFFF", samples, 1, 1);
+}
+
+static void truncated() {
+    // The header promises 100 bytes but only 10 whole frames and half of another are there
+    std::vector<int> samples(21);
+    for (uint64_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<int>(i * 1000) - 10000;
+    }
+    save(riff(chunk("fmt ", fmt(1, 2, 16)) + chunk("data", s16(samples), 100)));
+    samples.pop_back();
+    loads("truncated data", samples, 1, 2);
+}
+
+static void unsupported() {
+    // ADPCM, mu-law and an extensible file with an ADPCM GUID have no PCM decoder and must not load as noise
+    save(riff(chunk("fmt ", fmt(2, 1, 16)) + chunk("data", s16({1, 2, 3, 4}))));
+    rejected("ADPCM");
+    save(riff(chunk("fmt ", fmt(7, 1, 8)) + chunk("data", std::string("\x01\x02\x03\x04", 4))));
+    rejected("mu-law");
+    save(riff(chunk("fmt ", fmt(0xFFFE, 1, 16, 2)) + chunk("data", s16({1, 2, 3, 4}))));
+    rejected("extensible ADPCM");
+}
+
+static void writer() {
+    // A short stream keeps its JUNK chunk, which every reader steps over
+    const std::vector<int> samples = {5, -5, 6, -6, 7};
+    WAVLIB::FORMAT::WAV head;
+    head.format = 1;
+    head.channels = 1;
+    head.sample_rate = 48000;
+    head.sample_size = 16;
+    WAVLIB::WRITER out;
+    CHECK(out.open(path, head) && out.write(samples) && out.close());
+    loads("WRITER", samples, 1, 1);
+    WAVLIB::FORMAT::WAV audio;
+    CHECK(WAVLIB::LOAD(path, audio) && audio.chunks.size() == 3 && audio.chunks[0].id == "JUNK" && audio.chunks[2].size == 10);
+
+    // Past 4 GB the same 80 header bytes are rewritten as RF64, ds64 takes the place of JUNK
+    SINK sink;
+    std::ostream stream(&sink);
+    head.sample_size = 32;
+    head.channels = 2;
+    const uint64_t block = 1 << 20;
+    const std::vector<int> zeros(block * 2);
+    const uint64_t frames = (uint64_t(1) << 29) + 3;
+    CHECK(out.open(stream, head));
+    for (uint64_t n = 0; n < frames; n += block) {
+        out.write(zeros.data(), std::min(block, frames - n));
+    }
+    CHECK(out.close());
+    const uint64_t data_size = frames * 8;
+    CHECK(sink.end == 80 + data_size);
+    CHECK(sink.head.compare(0, 4, "RF64") == 0 && sink.head.compare(12, 4, "ds64") == 0);
+    std::istringstream header(sink.head.substr(0, 80));
+    WAVLIB::READER reader;
+    CHECK(reader.open(header) && reader.format.format == 1 && reader.format.channels == 2 && reader.format.data_size == data_size);
+}
+
+int main() {
+    extensible();
+    metadata();
+    rf64();
+    unknown_size();
+    truncated();
+    unsupported();
+    writer();
+    std::remove(path.c_str());
+    return finish("wav");
+}
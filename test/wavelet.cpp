@@ -0,0 +1,110 @@
+//
+// Daubechies and symlet filters, DWT and SWT against PyWavelets, see data/generate.py
+//
+
+#include <vector>
+
+#include "check.h"
+
+struct FIRST {
+    unsigned order;
+    double tap;
+};
+
+// dec_lo[0] of pywt.Wavelet("symN"), which tells the two mirror images of a symlet apart
+static const FIRST symlets[] = {
+    {2, -0.12940952255092145},   {3, 0.035226291882100656},    {4, -0.07576571478927333},   {5, 0.027333068345077982},
+    {6, 0.015404109327027373},   {7, 0.002681814568257878},    {8, -0.0033824159510061256}, {9, 0.0014009155259146807},
+    {10, 0.0007701598091144901}, {11, 0.00017172195069934854}, {12, 0.00011196719424656033}, {13, 6.820325263075319e-05},
+    {14, 4.4618977991475265e-05}, {15, 2.866070852531808e-05}, {16, 6.230006701220761e-06},  {17, 4.297343327345983e-06},
+    {18, 2.6126125564836423e-06}, {19, 5.487732768215838e-07}, {20, 3.695537474835221e-07},
+};
+
+static const char* modes[] = {"symmetric", "reflect", "zero", "constant", "periodization"};
+
+static void filter(const unsigned order, const bool symlet, const double* expected) {
+    // The double precision factorization against 40 digits, then the properties every orthogonal filter has
+    const std::vector<double> h = WAVLIB::PLAN::WAVELET::daubechies(order, symlet);
+    CHECK(h.size() == 2 * order);
+    double error = 0.0;
+    double sum = 0.0;
+    for (uint64_t k = 0; k < h.size(); k++) {
+        error = std::max(error, std::abs(h[k] - expected[k]));
+        sum += h[k];
+    }
+    CHECK_NEAR(error, 0.0, 1e-10);
+    CHECK_NEAR(sum, std::sqrt(2.0), 1e-12);
+    for (uint64_t shift = 0; shift < h.size(); shift += 2) {
+        double product = 0.0;
+        for (uint64_t k = 0; k + shift < h.size(); k++) {
+            product += h[k] * h[k + shift];
+        }
+        CHECK_NEAR(product, shift == 0 ? 1.0 : 0.0, 1e-11);
+    }
+    if (symlet) {
+        for (const FIRST& first : symlets) {
+            if (first.order == order) {
+                CHECK_NEAR(h.back() / first.tap, 1.0, 1e-8);
+            }
+        }
+    }
+}
+
+static void transform(const std::string& name, const float* x, const uint64_t size, const char* mode, const float*& expected) {
+    // One level against pywt.dwt, then back through IDWT, which ends with the signal
+    WAVLIB::REAL_VEC approx, detail, inverse;
+    const uint64_t taps = WAVLIB::PLAN::WAVELET::get(name)->taps();
+    const bool periodization = std::string(mode) == "periodization";
+    const uint64_t length = periodization ? (size + 1) / 2 : (size + taps - 1) / 2;
+    if (!CHECK(WAVLIB::S::DWT({x, size}, approx, detail, name, mode))) {
+        std::fprintf(stderr, "  %s %s on %llu samples\n", name.c_str(), mode, static_cast<unsigned long long>(size));
+        expected += 2 * length;
+        return;
+    }
+    CHECK_NEAR(worst(approx, expected, length), 0.0, 2e-5);
+    CHECK_NEAR(worst(detail, expected + length, length), 0.0, 2e-5);
+    expected += 2 * length;
+    if (CHECK(WAVLIB::S::IDWT(approx, detail, inverse, name, mode)) && CHECK(inverse.size() >= size)) {
+        inverse.resize(size);
+        CHECK_NEAR(worst(inverse, x, size), 0.0, 2e-5);
+    }
+}
+
+int main() {
+    const std::vector<double> filters = reference<double>("wavelet_filters.f64");
+    const std::vector<float> x = reference<float>("wavelet_signal.f32");
+    const std::vector<float> dwt = reference<float>("wavelet_dwt.f32");
+    const std::vector<float> swt = reference<float>("wavelet_swt.f32");
+    if (!CHECK(filters.size() == 838 && x.size() == 37 && dwt.size() == 14660 && swt.size() == 3744)) {
+        return finish("wavelet");
+    }
+    const double* taps = filters.data();
+    const float* bands = dwt.data();
+    const float* stationary = swt.data();
+    for (const bool symlet : {false, true}) {
+        for (unsigned order = symlet ? 2 : 1; order <= 20; order++) {
+            const std::string name = (symlet ? "sym" : "db") + std::to_string(order);
+            filter(order, symlet, taps);
+            taps += 2 * order;
+
+            // Every mode, on a signal longer than most filters and one shorter than all but db1 and db2
+            for (const char* mode : modes) {
+                transform(name, x.data(), x.size(), mode, bands);
+                transform(name, x.data(), 5, mode, bands);
+            }
+
+            // Two undecimated levels against pywt.swt(..., trim_approx=True)
+            std::vector<WAVLIB::REAL_VEC> levels;
+            WAVLIB::REAL_VEC inverse;
+            if (CHECK(WAVLIB::S::SWT({x.data(), 32}, levels, name, 2)) && CHECK(levels.size() == 3)) {
+                for (uint64_t i = 0; i < 3; i++) {
+                    CHECK_NEAR(worst(levels[i], stationary + 32 * i, 32), 0.0, 2e-5);
+                }
+                CHECK(WAVLIB::S::ISWT(levels, inverse, name));
+                CHECK_NEAR(worst(inverse, x.data(), 32), 0.0, 2e-5);
+            }
+            stationary += 3 * 32;
+        }
+    }
+    return finish("wavelet");
+}
@@ -1,644 +1,13504 @@
-//
-// Created by bobqianic on 18/08/2023.
-//
-
-// Include necessary libraries
-#include <string>
-#include <vector>
-#include <iostream>
-#include <fstream>
-#include <algorithm>
-#include <memory>
-#include <complex>
-#include <cmath>
-#include <functional>
-
-#if _WIN32
-#define NOMINMAX
-#include <windows.h>
-#endif
-
-#ifndef WAVLIB_PI
-#define WAVLIB_PI 3.1415927410125732
-#endif
-
-// Include guards
-#ifndef WAV_LIB_H
-#define WAV_LIB_H
-
-class WAVLIB {
-public:
-    struct FORMAT {
-        struct WAV {
-            unsigned short format{};      // Type of format (1 is PCM)
-            unsigned short channels{};    // Number of Channels
-            unsigned int sample_rate{};   // Number of Samples per second
-            unsigned int data_rate{};     // (Sample Rate * BitsPerSample * Channels) / 8
-            unsigned short sample_size{}; // Bits per sample
-            unsigned int data_size{};     // Size of the data section
-            std::vector<int> audio;       // Audio data
-        };
-    };
-
-    typedef std::vector<std::complex<float>> COMPLEX_VEC;
-
-    static bool LOAD(const std::string& filename, FORMAT::WAV& audio) {
-        std::ifstream file(filename, std::ios::binary);
-        bool result = LOAD::WAV(file, audio);
-        if (file.is_open()) {
-            file.close();
-        }
-        return result;
-    }
-
-#if _WIN32
-    static bool LOAD(const std::wstring& filename, FORMAT::WAV& audio) {
-        std::ifstream file(ONLY_WIN32::WStringToString(filename), std::ios::binary);
-        bool result = LOAD::WAV(file, audio);
-        if (file.is_open()) {
-            file.close();
-        }
-        return result;
-    }
-#endif
-
-    static bool DUMP(const std::string& filename, FORMAT::WAV& audio) {
-        std::ofstream file(filename, std::ios::binary);
-        bool result = DUMP::WAV(file, audio);
-        if (file.is_open()) {
-            file.close();
-        }
-        return result;
-    }
-
-#if _WIN32
-    static bool DUMP(const std::wstring& filename, FORMAT::WAV& audio) {
-        std::ofstream file(ONLY_WIN32::WStringToString(filename), std::ios::binary);
-        bool result = DUMP::WAV(file, audio);
-        if (file.is_open()) {
-            file.close();
-        }
-        return result;
-    }
-#endif
-
-    static bool print(const FORMAT::WAV& audio) {
-        return OUTPUT::audio_info(audio);
-    }
-
-    static bool print(const COMPLEX_VEC& vec) {
-        return OUTPUT::vector_info(vec);
-    }
-
-    template<typename T>
-    static bool print(T value) {
-        std::cout << value << std::endl;
-        return true;
-    }
-
-    struct F {
-        static bool WSOLA(FORMAT::WAV& audio) {
-
-        }
-    };
-
-    struct W {
-        /** Window Functions **/
-        static bool Hann(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            return WINDOW::Hann(out, window_length, periodic);
-        }
-
-        static bool Hamming(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
-            return WINDOW::Hamming(out, window_length, periodic, alpha, beta);
-        }
-
-        static bool Kaiser(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float beta=12.0) {
-            return WINDOW::Kaiser(out, window_length, periodic, beta);
-        }
-
-        static bool Blackman(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            return WINDOW::Blackman(out, window_length, periodic);
-        }
-
-        static bool Bartlett(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            return WINDOW::Bartlett(out, window_length, periodic);
-        }
-    };
-
-private:
-    struct endian {
-        static void flipEndianness(char* data, unsigned int length) {
-            std::reverse(data, data + length);
-        }
-
-        static bool LittleEndian() {
-            union one {
-                int value;
-                char byte[sizeof(int)];
-            };
-
-            one tester{};
-            tester.value = 1;
-            return tester.byte[0] == 1;
-        }
-
-        static bool isLittleEndian() {
-            static bool system = LittleEndian();
-            return system;
-        }
-    };
-
-    struct integer {
-        static int16_t char_2_int16(const char* data, const uint64_t length = 2, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (needSwap || length < 2) {
-                char buffer[2] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (2 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (2 - length), buffer + 2);
-                }
-                return *reinterpret_cast<const int16_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const int16_t*>(data);
-        }
-
-        static uint16_t char_2_uint16(const char* data, const uint64_t length = 2, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (needSwap || length < 2) {
-                char buffer[2] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (2 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (2 - length), buffer + 2);
-                }
-                return *reinterpret_cast<const uint16_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const uint16_t*>(data);
-        }
-
-        static int32_t char_2_int32(const char* data, const uint64_t length = 4, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (length == 2) {
-                return static_cast<int32_t>(char_2_int16(data, 2, LittleEndian));
-            }
-
-            if (needSwap || length < 4) {
-                char buffer[4] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (4 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (4 - length), buffer + 4);
-                }
-                return *reinterpret_cast<const int32_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const int32_t*>(data);
-        }
-
-        static uint32_t char_2_uint32(const char* data, const uint64_t length = 4, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (length == 2) {
-                return static_cast<uint32_t>(char_2_uint16(data, 2, LittleEndian));
-            }
-
-            if (needSwap || length < 4) {
-                char buffer[4] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (4 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (4 - length), buffer + 4);
-                }
-                return *reinterpret_cast<const uint32_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const uint32_t*>(data);
-        }
-
-        static int64_t char_2_int64(const char* data, const uint64_t length = 8, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (length == 2) {
-                return static_cast<int64_t>(char_2_int16(data, 2, LittleEndian));
-            } else if (length == 4) {
-                return static_cast<int64_t>(char_2_int32(data, 4, LittleEndian));
-            }
-
-            if (needSwap || length < 8) {
-                char buffer[8] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (8 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (8 - length), buffer + 8);
-                }
-                return *reinterpret_cast<const int64_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const int64_t*>(data);
-        }
-
-        static uint64_t char_2_uint64(const char* data, const uint64_t length = 8, const bool LittleEndian = true) {
-            bool needSwap = endian::isLittleEndian() != LittleEndian;
-
-            if (length == 2) {
-                return static_cast<uint64_t>(char_2_uint16(data, 2, LittleEndian));
-            } else if (length == 4) {
-                return static_cast<uint64_t>(char_2_uint32(data, 4, LittleEndian));
-            }
-
-            if (needSwap || length < 8) {
-                char buffer[8] = {0};
-                std::copy(data, data + length, LittleEndian ? buffer : buffer + (8 - length));
-                if (needSwap && length > 1) {
-                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (8 - length), buffer + 8);
-                }
-                return *reinterpret_cast<const uint64_t*>(buffer);
-            }
-
-            return *reinterpret_cast<const uint64_t*>(data);
-        }
-    };
-
-    struct character {
-        /*Convert integer to char array*/
-        template<typename integer>
-        static void int2Char(const integer& data, char* out, const bool LittleEndian = true) {
-            const char* p = reinterpret_cast<const char*>(&data);
-            std::copy(p, p + sizeof(decltype(data)), out);
-            if (endian::isLittleEndian() != LittleEndian) {
-                endian::flipEndianness(out, sizeof(decltype(data)));
-            }
-        }
-    };
-
-    struct DATA {
-        static std::string read(std::ifstream& file, uint64_t length) {
-            if (!file.is_open()) {
-                return "";
-            }
-            std::string buffer(length, '\0'); // Preallocate the string with the given length
-            file.read(&buffer[0], static_cast<int64_t>(length));
-            return buffer;
-        }
-
-        static bool write(std::ofstream& file, const std::string& data) {
-            if (!file.is_open()) {
-                return false;
-            }
-            file.write(data.c_str(), static_cast<int64_t>(data.size()));
-            return true;
-        }
-
-        template<typename integer>
-        static bool write(std::ofstream& file, const integer& data) {
-            if (!file.is_open()) {
-                return false;
-            }
-            char buffer[sizeof(decltype(data))];
-            character::int2Char(data, buffer);
-            file.write(buffer, sizeof(decltype(data)));
-            return true;
-        }
-    };
-
-#if _WIN32
-    struct ONLY_WIN32 {
-        static std::string WStringToString(const std::wstring& wstr){
-            int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
-            std::string strTo(sizeNeeded, 0);
-            WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], sizeNeeded, NULL, NULL);
-            return strTo;
-        }
-    };
-#endif
-
-    struct LOAD {
-        static bool WAV(std::ifstream& file, FORMAT::WAV& audio) {
-            if (!file.is_open()) {
-                return false;
-            }
-
-            // Read RIFF header
-            if (DATA::read(file, 4) != "RIFF") {
-                return false;
-            }
-
-            file.seekg(4, std::ios::cur);
-
-            // Read File-Type header
-            if (DATA::read(file, 4) != "WAVE") {
-                return false;
-            }
-
-            file.seekg(8, std::ios::cur);
-
-            // Read format
-            audio.format = integer::char_2_int16(DATA::read(file, 2).c_str());
-
-            // Read channel
-            audio.channels = integer::char_2_int16(DATA::read(file, 2).c_str());
-
-            // Read sample rate
-            audio.sample_rate = integer::char_2_int32(DATA::read(file, 4).c_str());
-
-            // Read data rate
-            audio.data_rate = integer::char_2_int32(DATA::read(file, 4).c_str());
-
-            file.seekg(2, std::ios::cur);
-
-            // Read sample size
-            audio.sample_size = integer::char_2_int16(DATA::read(file, 2).c_str());
-            if (audio.sample_size < 8 || audio.sample_size > 32) {
-                return false;
-            }
-
-            // Read data size
-            while (!file.eof()) {
-                if (DATA::read(file, 4) == "data") {
-                    audio.data_size = integer::char_2_int32(DATA::read(file, 4).c_str());
-                    break;
-                }
-                file.seekg(-3, std::ios::cur);
-            }
-
-            int sample_byte = audio.sample_size / 8;
-            audio.audio.reserve(audio.data_size / sample_byte);
-            std::unique_ptr<char[]> buffer(new char [1024 * 1024 * 4]);
-
-            for (uint64_t i = 0; i < audio.audio.size(); i+= 1024 * 1024 * 4) {
-                file.read(buffer.get(), 1024 * 1024 * 4);
-                std::streamsize bytes_read = file.gcount();
-                for (uint64_t j = 0; j < bytes_read; j+=sample_byte) {
-                    audio.audio.push_back(integer::char_2_int32(buffer.get(), sample_byte));
-                }
-            }
-
-            return true;
-        }
-    };
-
-    struct DUMP {
-        static bool WAV(std::ofstream& file, FORMAT::WAV& audio) {
-            if (!file.is_open()) {
-                return false;
-            }
-
-            // write RIFF
-            DATA::write(file, "RIFF");
-
-            // write size of the overall file
-            DATA::write(file, static_cast<unsigned int>(audio.data_size + 44));
-
-            // write file type header
-            DATA::write(file, "WAVE");
-
-            // write format chunk marker
-            DATA::write(file, "fmt ");
-
-            // write length of format data as listed above
-            DATA::write(file, static_cast<unsigned int>(16));
-
-            // write type of format (1 is PCM)
-            DATA::write(file, static_cast<unsigned short>(audio.format));
-
-            // write number of channels
-            DATA::write(file, static_cast<unsigned short>(audio.channels));
-
-            // write sample rate
-            DATA::write(file, static_cast<unsigned int>(audio.sample_rate));
-
-            // write data rate
-            DATA::write(file, static_cast<unsigned int>(audio.data_rate));
-
-            // write ???
-            DATA::write(file, static_cast<unsigned short>((audio.sample_size * audio.channels) / 8));
-
-            // write sample size
-            DATA::write(file, static_cast<unsigned short>(audio.sample_size));
-
-            // write “data” chunk header
-            DATA::write(file, "data");
-
-            // write size of the data section
-            DATA::write(file, static_cast<unsigned int>(audio.data_size));
-
-            // write audio data
-            int offset = audio.sample_size / 8;
-            std::unique_ptr<char[]> buffer_main(new char [1024 * 1024 * 4]);
-            std::unique_ptr<char[]> buffer_slave(new char [4]);
-
-            for (uint64_t i = 0; i < audio.audio.size(); i+= 1024 * 1024) {
-                for (uint64_t j = i; j < std::min(i + static_cast<uint64_t>(1024 * 1024), static_cast<uint64_t>(audio.audio.size())); j++) {
-                    character::int2Char(audio.audio[j], buffer_slave.get());
-                    for (uint64_t k = 0; k < offset; k++) {
-                        buffer_main[(j - i) * offset + k] = buffer_slave[k];
-                    }
-                }
-                file.write(buffer_main.get(), std::min(static_cast<uint64_t>(1024 * 1024 * (audio.sample_size / 8)), (audio.audio.size() - i) * (audio.sample_size / 8)));
-            }
-
-            return true;
-        }
-    };
-
-    struct SIGNAL {
-        static bool DFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
-            /** Discrete Fourier Transform **/
-
-        }
-
-        static bool FFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
-            /** Fast Fourier Transform **/
-
-        }
-
-        static bool STFT(COMPLEX_VEC& in,
-                         COMPLEX_VEC& out,
-                         const int frame_size,
-                         const int hop_length,
-                         COMPLEX_VEC& window,
-                         const bool center = true,
-                         const std::string& pad_mode = "reflect",
-                         const bool normalized = false,
-                         const bool onesided = false) {
-            /** Short-Time Fourier Transform **/
-            /** Please ensure the window is set to periodic **/
-
-        }
-
-        static bool WT() {
-            /** Wavelet Transform **/
-
-        }
-    };
-
-    struct WINDOW {
-        static bool Hann(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            if (window_length < 1) {
-                return false;
-            }
-            if (out.size() < window_length) {
-                out.resize(window_length);
-            }
-            if (window_length == 1) {
-                out[out.size() - 1].real(1);
-                return true;
-            }
-            int offset = 0;
-            if (!periodic) {
-                offset = -1;
-            }
-            for (int i = 0; i < window_length; i++) {
-                out[i].real(static_cast<float>(0.5 * (1.0 - cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)))));
-            }
-            return true;
-        }
-
-        static bool Hamming(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
-            if (window_length < 1) {
-                return false;
-            }
-            if (out.size() < window_length) {
-                out.resize(window_length);
-            }
-            if (window_length == 1) {
-                out[out.size() - 1].real(1);
-                return true;
-            }
-            int offset = 0;
-            if (!periodic) {
-                offset = -1;
-            }
-            for (int i = 0; i < window_length; i++) {
-                out[i].real(alpha - beta * cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)));
-            }
-            return true;
-        }
-
-        static bool Kaiser(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float beta=12.0) {
-            /** Note: beta = alpha * pi **/
-            if (window_length < 1) {
-                return false;
-            }
-            if (out.size() < window_length) {
-                out.resize(window_length);
-            }
-            if (window_length == 1) {
-                out[out.size() - 1].real(1);
-                return true;
-            }
-            int offset = 0;
-            if (!periodic) {
-                offset = -1;
-            }
-            for (int i = 0; i < window_length; i++) {
-                out[i].real(std::cyl_bessel_if(0, beta * sqrtf(static_cast<float>(1.0) - powf(static_cast<float>((i - (window_length + offset) / 2.0) / ((window_length + offset) / 2.0)), 2.0))) / std::cyl_bessel_if(0, beta));
-            }
-            return true;
-        }
-
-        static bool Blackman(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            if (window_length < 1) {
-                return false;
-            }
-            if (out.size() < window_length) {
-                out.resize(window_length);
-            }
-            if (window_length == 1) {
-                out[out.size() - 1].real(1);
-                return true;
-            }
-            int offset = 0;
-            if (!periodic) {
-                offset = -1;
-            }
-            for (int i = 0; i < window_length; i++) {
-                out[i].real(static_cast<float>(0.42 - 0.5 * cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)) + 0.08 * cosf(static_cast<float>(4.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset))));
-            }
-            return true;
-        }
-
-        static bool Bartlett(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
-            if (window_length < 1) {
-                return false;
-            }
-            if (out.size() < window_length) {
-                out.resize(window_length);
-            }
-            if (window_length == 1) {
-                out[out.size() - 1].real(1);
-                return true;
-            }
-            int offset = 0;
-            if (!periodic) {
-                offset = -1;
-            }
-            int i = 0;
-            for (; i <= (window_length + offset) / 2; i++) {
-                out[i].real(static_cast<float>(static_cast<float>(2.0 * i) / static_cast<float>(window_length + offset)));
-            }
-            for (; i < (window_length + offset); i++) {
-                out[i].real(static_cast<float>(2.0 - (static_cast<float>(2.0 * i) / static_cast<float>(window_length + offset))));
-            }
-            return true;
-        }
-    };
-
-    struct OUTPUT {
-        static bool audio_info(const FORMAT::WAV& audio) {
-            if (audio.format == 1) {
-                std::cout << "Type of format: PCM" << std::endl;
-            } else {
-                std::cout << "Type of format: Unknown" << std::endl;
-            }
-            std::cout << "Number of Channels: " << audio.channels << std::endl;
-            std::cout << "Sample Rate: " << audio.sample_rate << std::endl;
-            std::cout << "Bit Depth: " << audio.sample_size << std::endl;
-            std::cout << "Data Rate: " << audio.data_rate << std::endl;
-            std::cout << "Data Size: " << audio.data_size << std::endl;
-            return true;
-        }
-
-        static bool vector_info(const COMPLEX_VEC& vec) {
-            std::cout << "[";
-            for (int64_t i = 0; i < vec.size() - 1; i++) {
-                std::cout << vec[i] << ", ";
-            }
-            std::cout << vec[vec.size() - 1] << "]" << std::endl;
-            return true;
-        }
-    };
-
-    struct PADDING {
-        static bool reflection(COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad) {
-            if (out.size() < in.size() + pad[0] + pad[1]) {
-                out.resize(in.size() + pad[0] + pad[1]);
-            }
-            if (pad[0] > in.size() || pad[1] > in.size()) {
-                return false;
-            }
-            std::reverse_copy(in.begin() + 1, in.begin() + 1 + pad[0], out.begin());
-            std::copy(in.begin(), in.end(), out.begin() + pad[0]);
-            std::reverse_copy(in.end() - 1 - pad[1], in.end() - 1, out.begin() + pad[0] + pad[1] + static_cast<int64_t>(in.size()));
-            return true;
-        }
-
-        static bool constant(COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad, std::complex<float> value) {
-            if (out.size() < in.size() + pad[0] + pad[1]) {
-                out.resize(in.size() + pad[0] + pad[1]);
-            }
-            std::fill(out.begin(), out.begin() + pad[0], value);
-            std::copy(in.begin(), in.end(), out.begin() + pad[0]);
-            std::fill(out.begin() + pad[0] + static_cast<int64_t>(in.size()), out.begin() + pad[0] + pad[1] + static_cast<int64_t>(in.size()), value);
-            return true;
-        }
-
-        static bool replication(COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad) {
-            
-        }
-    };
-
-};
-
-#endif // WAV_LIB_H
+//
+// Created by bobqianic on 18/08/2023.
+//
+
+// Include necessary libraries
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <complex>
+#include <cmath>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <new>
+#include <array>
+#include <utility>
+#include <system_error>
+#include <exception>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+
+#if _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SIMD kernels, the widest instruction set is picked at runtime
+#if !defined(WAVLIB_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define WAVLIB_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define WAVLIB_TARGET(x)
+#else
+#define WAVLIB_TARGET(x) __attribute__((target(x)))
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WAVLIB_SSE2 1
+#endif
+#elif !defined(WAVLIB_NO_SIMD) && (defined(__ARM_NEON) || defined(__aarch64__)) && !defined(__ARM_BIG_ENDIAN)
+#define WAVLIB_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifndef WAVLIB_PI
+#define WAVLIB_PI 3.1415927410125732
+#endif
+
+// Instrumentation, WAVLIB_SCOPE and WAVLIB_COUNT compile to nothing unless WAVLIB_PROFILE is defined
+#ifdef WAVLIB_PROFILE
+#define WAVLIB_JOIN_(a, b) a##b
+#define WAVLIB_JOIN(a, b) WAVLIB_JOIN_(a, b)
+#define WAVLIB_SCOPE(name) \
+    static const unsigned WAVLIB_JOIN(wavlib_stage_, __LINE__) = WAVLIB::PROFILE::stage(name); \
+    const WAVLIB::PROFILE::SCOPE WAVLIB_JOIN(wavlib_scope_, __LINE__)(WAVLIB_JOIN(wavlib_stage_, __LINE__))
+#define WAVLIB_COUNT(counter, n) WAVLIB::PROFILE::count(WAVLIB::PROFILE::counter, (n))
+#else
+#define WAVLIB_SCOPE(name) static_cast<void>(0)
+#define WAVLIB_COUNT(counter, n) static_cast<void>(0)
+#endif
+
+// Include guards
+#ifndef WAV_LIB_H
+#define WAV_LIB_H
+
+class WAVLIB {
+public:
+    template<typename T>
+    struct ALIGNED_ALLOCATOR {
+        /** Cache line aligned storage, so every buffer starts on a full SIMD lane **/
+        typedef T value_type;
+        static constexpr std::size_t alignment = 64;
+
+        ALIGNED_ALLOCATOR() = default;
+
+        template<typename U>
+        ALIGNED_ALLOCATOR(const ALIGNED_ALLOCATOR<U>&) {}
+
+        T* allocate(std::size_t n) {
+            WAVLIB_COUNT(ALLOCATIONS, 1);
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+        }
+
+        void deallocate(T* p, std::size_t) {
+            ::operator delete(p, std::align_val_t(alignment));
+        }
+
+        template<typename U>
+        struct rebind {
+            typedef ALIGNED_ALLOCATOR<U> other;
+        };
+
+        template<typename U>
+        bool operator==(const ALIGNED_ALLOCATOR<U>&) const {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const ALIGNED_ALLOCATOR<U>&) const {
+            return false;
+        }
+    };
+
+    typedef std::vector<float, ALIGNED_ALLOCATOR<float>> REAL_VEC;
+
+    struct FORMAT {
+        struct CHUNK {
+            std::string id;               // Four character code, eg. "fmt ", "LIST", "data"
+            uint64_t offset{};            // Start of the payload, counted from the start of the file
+            uint64_t size{};              // Payload size in bytes, without the pad byte
+        };
+
+        struct WAV {
+            unsigned short format{};      // Type of format (1 is PCM, 3 is IEEE float)
+            unsigned short channels{};    // Number of Channels
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned int data_rate{};     // (Sample Rate * BitsPerSample * Channels) / 8
+            unsigned short sample_size{}; // Bits per sample
+            uint64_t data_size{};         // Size of the data section, UINT64_MAX if a stream doesn't know it
+            std::vector<int> audio;       // Audio data
+            std::vector<CHUNK> chunks;    // Chunk index in file order
+
+            const CHUNK* chunk(const std::string& id) const {
+                for (const auto& entry : chunks) {
+                    if (entry.id == id) {
+                        return &entry;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        enum class SAMPLE { UNKNOWN, U8, S16, S24, S32, F32, F64 };
+
+        struct INT24 {
+            /** Tag type for packed little-endian 24-bit samples, read back as int32_t **/
+            unsigned char bytes[3];
+        };
+
+        template<typename T>
+        struct VIEW {
+            /** Non-owning strided view over little-endian samples of native type T **/
+            typedef typename std::conditional<std::is_same<T, INT24>::value, int32_t, T>::type value_type;
+
+            const char* data = nullptr;   // First sample of the view
+            uint64_t size = 0;            // Number of samples in the view
+            uint64_t stride = 0;          // Distance between two samples in bytes
+
+            value_type operator[](uint64_t i) const {
+                return integer::template load<T>(data + i * stride);
+            }
+
+            bool empty() const {
+                return size == 0;
+            }
+        };
+
+        template<typename T>
+        struct SPAN {
+            /** Non-owning contiguous view, anything with data() and size() converts to it **/
+            T* data = nullptr;
+            uint64_t size = 0;
+
+            SPAN() = default;
+
+            SPAN(T* data, const uint64_t size) : data(data), size(size) {}
+
+            template<typename VEC, typename = typename std::enable_if<std::is_convertible<decltype(std::declval<VEC&>().data()), T*>::value>::type>
+            SPAN(VEC& vec) : data(vec.data()), size(vec.size()) {}
+
+            template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+            SPAN(const SPAN<U>& other) : data(other.data), size(other.size) {}
+
+            T& operator[](uint64_t i) const {
+                return data[i];
+            }
+
+            T* begin() const {
+                return data;
+            }
+
+            T* end() const {
+                return data + size;
+            }
+
+            bool empty() const {
+                return size == 0;
+            }
+        };
+
+        struct PLANAR {
+            /** Float32 samples normalized to [-1, 1), one contiguous 64-byte aligned run per channel **/
+            unsigned short channels{};    // Number of Channels
+            unsigned int sample_rate{};   // Number of Samples per second
+            uint64_t frames{};            // Samples per channel
+            uint64_t stride{};            // Distance between two channels in samples
+            REAL_VEC audio;               // Channel c starts at audio.data() + c * stride
+
+            void resize(const unsigned short channel_count, const uint64_t frame_count) {
+                // Round every channel up to a whole cache line, so each one starts aligned
+                const uint64_t lane = ALIGNED_ALLOCATOR<float>::alignment / sizeof(float);
+                channels = channel_count;
+                frames = frame_count;
+                stride = (frame_count + lane - 1) / lane * lane;
+                audio.assign(stride * channels, 0.0f);
+            }
+
+            SPAN<float> channel(const unsigned short index) {
+                if (index >= channels) {
+                    return SPAN<float>();
+                }
+                return SPAN<float>(audio.data() + index * stride, frames);
+            }
+
+            SPAN<const float> channel(const unsigned short index) const {
+                if (index >= channels) {
+                    return SPAN<const float>();
+                }
+                return SPAN<const float>(audio.data() + index * stride, frames);
+            }
+        };
+
+        struct MAPPED_WAV {
+            unsigned short format{};      // Type of format (1 is PCM, 3 is IEEE float)
+            unsigned short channels{};    // Number of Channels
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned int data_rate{};     // (Sample Rate * BitsPerSample * Channels) / 8
+            unsigned short block_align{}; // Bytes per frame (all channels)
+            unsigned short sample_size{}; // Bits per sample
+            uint64_t data_size{};         // Size of the data section
+            uint64_t frames{};            // Number of frames in the data section
+            SAMPLE type{};                // Native sample type of the data section
+            const char* data = nullptr;   // Start of the data section inside the mapping
+            std::shared_ptr<const char> map; // Keeps the file mapping alive
+            std::vector<CHUNK> chunks;    // Chunk index in file order
+
+            SPAN<const char> chunk(const std::string& id) const {
+                /** Payload of the first chunk with this id, read straight from the mapping **/
+                for (const auto& entry : chunks) {
+                    if (entry.id == id && map) {
+                        return SPAN<const char>(map.get() + entry.offset, entry.size);
+                    }
+                }
+                return SPAN<const char>();
+            }
+
+            template<typename T>
+            VIEW<T> samples() const {
+                /** All samples, interleaved **/
+                VIEW<T> view;
+                if (data == nullptr || sample_type<T>() != type) {
+                    return view;
+                }
+                view.data = data;
+                view.size = frames * channels;
+                view.stride = sizeof(T);
+                return view;
+            }
+
+            template<typename T>
+            VIEW<T> channel(unsigned short index) const {
+                /** Samples of one channel, strided by block_align **/
+                VIEW<T> view;
+                if (data == nullptr || sample_type<T>() != type || index >= channels) {
+                    return view;
+                }
+                view.data = data + static_cast<uint64_t>(index) * sizeof(T);
+                view.size = frames;
+                view.stride = block_align;
+                return view;
+            }
+
+            template<typename T>
+            static SAMPLE sample_type() {
+                if (std::is_same<T, uint8_t>::value) return SAMPLE::U8;
+                if (std::is_same<T, int16_t>::value) return SAMPLE::S16;
+                if (std::is_same<T, INT24>::value) return SAMPLE::S24;
+                if (std::is_same<T, int32_t>::value) return SAMPLE::S32;
+                if (std::is_same<T, float>::value) return SAMPLE::F32;
+                if (std::is_same<T, double>::value) return SAMPLE::F64;
+                return SAMPLE::UNKNOWN;
+            }
+        };
+
+        struct FLAC {
+            /** STREAMINFO and seek table of a FLAC stream **/
+            struct SEEKPOINT {
+                uint64_t sample{};        // First sample of the target frame
+                uint64_t offset{};        // Bytes from the first frame header to the target frame
+                unsigned short samples{}; // Samples in the target frame
+            };
+
+            unsigned short min_block{};   // Smallest block size in samples
+            unsigned short max_block{};   // Largest block size in samples
+            unsigned int min_frame{};     // Smallest frame in bytes, 0 if unknown
+            unsigned int max_frame{};     // Largest frame in bytes, 0 if unknown
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned short channels{};    // Number of Channels
+            unsigned short sample_size{}; // Bits per sample, 4 to 32
+            uint64_t frames{};            // Samples per channel, 0 if unknown
+            unsigned char md5[16]{};      // MD5 of the decoded samples
+            uint64_t audio_offset{};      // First frame header, counted from the start of the file
+            std::vector<SEEKPOINT> seek;  // Seek table without placeholders
+        };
+
+        struct MP3 {
+            /** Layer III stream and its frame index **/
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned short channels{};    // Number of Channels
+            unsigned short frame_samples{}; // Samples per channel in a frame, 1152 or 576
+            unsigned int bitrate{};       // Average bits per second of the audio frames
+            uint64_t frames{};            // Samples per channel, without encoder delay and padding
+            uint64_t skip{};              // Decoded samples in front of the first one, the encoder delay plus 529 of the decoder
+            std::vector<uint64_t> index;  // Offset of every audio frame, plus the end of the last one
+        };
+
+        struct AAC {
+            /** AAC-LC stream of an ADTS or MP4/M4A file and its frame index **/
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned short channels{};    // Number of Channels
+            unsigned short frequency{};   // Row of the scalefactor band tables, the sampling frequency index
+            unsigned short layout{};      // Channel configuration, 1 to 7
+            unsigned int bitrate{};       // Average bits per second of the audio frames
+            uint64_t frames{};            // Samples per channel, without priming and padding
+            uint64_t skip{};              // Decoded samples in front of the first one, the priming an edit list asks to drop
+            std::vector<uint64_t> index;  // Offset of every raw data block
+            std::vector<uint32_t> sizes;  // Bytes of every raw data block
+        };
+
+        struct INFO {
+            /** What the headers of a file say, PROBE reads nothing else **/
+            std::string codec;            // "wav", "flac", "mp3" or "aac"
+            unsigned short format{};      // WAV format tag (1 is PCM, 3 is IEEE float), 0 for FLAC, MP3 and AAC
+            unsigned short channels{};    // Number of Channels
+            unsigned int sample_rate{};   // Number of Samples per second
+            unsigned short sample_size{}; // Bits per sample, 0 for MP3 and AAC
+            unsigned int bitrate{};       // Bits per second of the stored stream
+            uint64_t frames{};            // Samples per channel
+            double duration{};            // Seconds
+            bool exact{};                 // False if frames is an estimate, eg. an MP3 without a Xing header or an ADTS stream
+            uint64_t data_offset{};       // First byte of the audio, the WAV data chunk or the first FLAC, MP3 or AAC frame
+            uint64_t file_size{};         // Bytes
+        };
+
+        struct STATS {
+            /** Levels of a whole file from SCAN, over all channels on the [-1, 1) scale of PLANAR **/
+            INFO info;
+            float peak{};                 // Largest absolute sample
+            double rms{};                 // Root mean square
+            double dc{};                  // Mean, the DC offset
+            uint64_t clipped{};           // Samples at the largest value the format can hold
+            double silence{};             // Share of samples below -60 dBFS
+        };
+    };
+
+    typedef std::vector<std::complex<float>> COMPLEX_VEC;
+
+    static bool LOAD(const std::string& filename, FORMAT::WAV& audio) {
+        /** audio.audio is reused, loading into the same object again only allocates if the file is longer **/
+        return LOAD::FILE(filename, audio);
+    }
+
+#if _WIN32
+    static bool LOAD(const std::wstring& filename, FORMAT::WAV& audio) {
+        return LOAD(ONLY_WIN32::WStringToString(filename), audio);
+    }
+#endif
+
+    static bool LOAD(const std::string& filename, FORMAT::MAPPED_WAV& audio) {
+        uint64_t size = 0;
+        std::shared_ptr<const char> map = MEMORY::map(filename, size);
+        if (!map) {
+            return false;
+        }
+        return LOAD::MAPPED(map, size, audio);
+    }
+
+#if _WIN32
+    static bool LOAD(const std::wstring& filename, FORMAT::MAPPED_WAV& audio) {
+        return LOAD(ONLY_WIN32::WStringToString(filename), audio);
+    }
+#endif
+
+    static bool LOAD(const std::string& filename, FORMAT::PLANAR& audio) {
+        return LOAD::FILE(filename, audio);
+    }
+
+#if _WIN32
+    static bool LOAD(const std::wstring& filename, FORMAT::PLANAR& audio) {
+        return LOAD(ONLY_WIN32::WStringToString(filename), audio);
+    }
+#endif
+
+    static bool LOAD(const std::vector<std::string>& filenames, std::vector<FORMAT::WAV>& audio, std::vector<std::string>& errors, const unsigned threads = 0) {
+        /** Load many files at once, errors[i] is empty when filenames[i] loaded **/
+        /** Returns true only if every file loaded, failed files leave an empty entry behind **/
+        return LOAD::BATCH(filenames, audio, errors, threads);
+    }
+
+    static bool LOAD(const std::vector<std::string>& filenames, std::vector<FORMAT::PLANAR>& audio, std::vector<std::string>& errors, const unsigned threads = 0) {
+        return LOAD::BATCH(filenames, audio, errors, threads);
+    }
+
+    static bool PROBE(const std::string& filename, FORMAT::INFO& info) {
+        /** Format and length of a WAV, FLAC, MP3 or AAC/M4A file from its headers, the samples are never read **/
+        FILE_HANDLE file;
+        std::string error;
+        return file.open(filename) && LOAD::PROBE(file, info, error);
+    }
+
+    static bool PROBE(const std::vector<std::string>& filenames, std::vector<FORMAT::INFO>& info, std::vector<std::string>& errors, const unsigned threads = 0) {
+        /** PROBE many files at once, errors[i] is empty when filenames[i] was probed **/
+        info.assign(filenames.size(), FORMAT::INFO());
+        errors.assign(filenames.size(), std::string());
+        return LOAD::SCAN(filenames, false, threads, [&](const uint64_t i, const FORMAT::STATS& stats, const std::string& error) {
+            info[i] = stats.info;
+            errors[i] = error;
+        }) == 0;
+    }
+
+    static bool SCAN(const std::vector<std::string>& filenames, std::vector<FORMAT::STATS>& stats, std::vector<std::string>& errors, const unsigned threads = 0) {
+        /** Header fields plus peak, RMS, DC offset, clipping and silence of every file, in one fused pass over its samples **/
+        /** Files run in parallel on a pool sized for I/O, returns true only if every file could be read **/
+        stats.assign(filenames.size(), FORMAT::STATS());
+        errors.assign(filenames.size(), std::string());
+        return LOAD::SCAN(filenames, true, threads, [&](const uint64_t i, const FORMAT::STATS& result, const std::string& error) {
+            stats[i] = result;
+            errors[i] = error;
+        }) == 0;
+    }
+
+    static bool SCAN(const std::vector<std::string>& filenames, const std::string& report, const unsigned threads = 0) {
+        /** SCAN into a report file, JSON if its name ends in ".json" and CSV otherwise, failed files get a row with the error **/
+        /** Rows are written as files finish, in that order, so nothing piles up in memory however large the corpus **/
+        std::ofstream file(report, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        const bool json = report.size() >= 5 && report.compare(report.size() - 5, 5, ".json") == 0;
+        DUMP::REPORT writer(file, json);
+        std::mutex lock;
+        const uint64_t failed = LOAD::SCAN(filenames, true, threads, [&](const uint64_t i, const FORMAT::STATS& stats, const std::string& error) {
+            std::lock_guard<std::mutex> guard(lock);
+            writer.write(filenames[i], stats, error);
+        });
+        return writer.finish() && failed == 0;
+    }
+
+    static bool DUMP(const std::string& filename, FORMAT::WAV& audio) {
+#if _WIN32
+        std::ofstream file(filename, std::ios::binary);
+        bool result = DUMP::WAV(file, audio);
+        if (file.is_open()) {
+            file.close();
+        }
+        return result;
+#else
+        return DUMP::FILE(filename, audio);
+#endif
+    }
+
+#if _WIN32
+    static bool DUMP(const std::wstring& filename, FORMAT::WAV& audio) {
+        std::ofstream file(ONLY_WIN32::WStringToString(filename), std::ios::binary);
+        bool result = DUMP::WAV(file, audio);
+        if (file.is_open()) {
+            file.close();
+        }
+        return result;
+    }
+#endif
+
+    static bool DUMP(const std::string& filename, const FORMAT::WAV& audio, const unsigned level) {
+        /** FLAC at compression level 0 (fastest) to 8 (smallest), 5 is the usual choice **/
+        /** A name ending in .wav is refused rather than given a FLAC stream, use the plain DUMP for WAV **/
+        const bool wav = filename.size() >= 4 && std::equal(filename.end() - 4, filename.end(), ".wav", [](const char a, const char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+        if (wav) {
+            return false;
+        }
+        std::ofstream file(filename, std::ios::binary);
+        bool result = FLAC::encode(file, audio, level);
+        if (file.is_open()) {
+            file.close();
+        }
+        return result && !file.fail();
+    }
+
+#if _WIN32
+    static bool DUMP(const std::wstring& filename, const FORMAT::WAV& audio, const unsigned level) {
+        return DUMP(ONLY_WIN32::WStringToString(filename), audio, level);
+    }
+#endif
+
+    static bool print(const FORMAT::WAV& audio) {
+        return OUTPUT::audio_info(audio);
+    }
+
+    static bool print(const COMPLEX_VEC& vec) {
+        return OUTPUT::vector_info(vec);
+    }
+
+    template<typename T>
+    static bool print(T value) {
+        std::cout << value << std::endl;
+        return true;
+    }
+
+    struct F {
+        /** Time-scale modification, rate > 1 shortens and rate < 1 lengthens while keeping the pitch **/
+        /** Output holds round(frames / rate) frames in the input format, out may be in **/
+        static bool OLA(const FORMAT::WAV& in, FORMAT::WAV& out, const float rate, const int frame_size=1024, const int hop_length=512) {
+            FORMAT::WAV* target = &out;
+            return SIGNAL::WSOLA(in, &target, &rate, 1, frame_size, hop_length, 0);
+        }
+
+        static bool WSOLA(const FORMAT::WAV& in, FORMAT::WAV& out, const float rate, const int frame_size=1024, const int hop_length=512, const int tolerance=512) {
+            FORMAT::WAV* target = &out;
+            return SIGNAL::WSOLA(in, &target, &rate, 1, frame_size, hop_length, tolerance);
+        }
+
+        static bool PV(const FORMAT::WAV& in, FORMAT::WAV& out, const float rate, const int n_fft=2048, const int hop_length=512) {
+            FORMAT::WAV* target = &out;
+            return SIGNAL::PV(in, &target, &rate, 1, n_fft, hop_length);
+        }
+
+        /** Batched variants, out[i] is in stretched by rates[i], decoding and analysis are shared and variants run in parallel **/
+        static bool OLA(const FORMAT::WAV& in, std::vector<FORMAT::WAV>& out, const std::vector<float>& rates, const int frame_size=1024, const int hop_length=512) {
+            std::vector<FORMAT::WAV*> targets = variants(out, rates.size());
+            return SIGNAL::WSOLA(in, targets.data(), rates.data(), rates.size(), frame_size, hop_length, 0);
+        }
+
+        static bool WSOLA(const FORMAT::WAV& in, std::vector<FORMAT::WAV>& out, const std::vector<float>& rates, const int frame_size=1024, const int hop_length=512, const int tolerance=512) {
+            std::vector<FORMAT::WAV*> targets = variants(out, rates.size());
+            return SIGNAL::WSOLA(in, targets.data(), rates.data(), rates.size(), frame_size, hop_length, tolerance);
+        }
+
+        static bool PV(const FORMAT::WAV& in, std::vector<FORMAT::WAV>& out, const std::vector<float>& rates, const int n_fft=2048, const int hop_length=512) {
+            std::vector<FORMAT::WAV*> targets = variants(out, rates.size());
+            return SIGNAL::PV(in, targets.data(), rates.data(), rates.size(), n_fft, hop_length);
+        }
+
+    private:
+        static std::vector<FORMAT::WAV*> variants(std::vector<FORMAT::WAV>& out, const uint64_t count) {
+            out.resize(count);
+            std::vector<FORMAT::WAV*> targets(count);
+            for (uint64_t i = 0; i < count; i++) {
+                targets[i] = &out[i];
+            }
+            return targets;
+        }
+    };
+
+    struct W {
+        /** Window Functions **/
+        static bool Hann(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Hann(out, window_length, periodic);
+        }
+
+        static bool Hamming(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
+            return WINDOW::Hamming(out, window_length, periodic, alpha, beta);
+        }
+
+        static bool Kaiser(COMPLEX_VEC& out, const int window_length, const bool periodic=true, const float beta=12.0) {
+            return WINDOW::Kaiser(out, window_length, periodic, beta);
+        }
+
+        static bool Blackman(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Blackman(out, window_length, periodic);
+        }
+
+        static bool Bartlett(COMPLEX_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Bartlett(out, window_length, periodic);
+        }
+
+        static bool Hann(REAL_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Hann(out, window_length, periodic);
+        }
+
+        static bool Hamming(REAL_VEC& out, const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
+            return WINDOW::Hamming(out, window_length, periodic, alpha, beta);
+        }
+
+        static bool Kaiser(REAL_VEC& out, const int window_length, const bool periodic=true, const float beta=12.0) {
+            return WINDOW::Kaiser(out, window_length, periodic, beta);
+        }
+
+        static bool Blackman(REAL_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Blackman(out, window_length, periodic);
+        }
+
+        static bool Bartlett(REAL_VEC& out, const int window_length, const bool periodic=true) {
+            return WINDOW::Bartlett(out, window_length, periodic);
+        }
+
+        /** Cached windows, shared and read-only, generated once per (length, periodic, parameters) **/
+        static std::shared_ptr<const REAL_VEC> Hann(const int window_length, const bool periodic=true) {
+            return WINDOW::get(WINDOW::TYPE::HANN, window_length, periodic, 0, 0);
+        }
+
+        static std::shared_ptr<const REAL_VEC> Hamming(const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
+            return WINDOW::get(WINDOW::TYPE::HAMMING, window_length, periodic, alpha, beta);
+        }
+
+        static std::shared_ptr<const REAL_VEC> Kaiser(const int window_length, const bool periodic=true, const float beta=12.0) {
+            return WINDOW::get(WINDOW::TYPE::KAISER, window_length, periodic, 0, beta);
+        }
+
+        static std::shared_ptr<const REAL_VEC> Blackman(const int window_length, const bool periodic=true) {
+            return WINDOW::get(WINDOW::TYPE::BLACKMAN, window_length, periodic, 0, 0);
+        }
+
+        static std::shared_ptr<const REAL_VEC> Bartlett(const int window_length, const bool periodic=true) {
+            return WINDOW::get(WINDOW::TYPE::BARTLETT, window_length, periodic, 0, 0);
+        }
+    };
+
+    struct S {
+        /** Signal Processing **/
+        static bool DFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            return SIGNAL::DFT(in, out);
+        }
+
+        static bool FFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            return SIGNAL::FFT(in, out);
+        }
+
+        static bool IFFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            return SIGNAL::IFFT(in, out);
+        }
+
+        static bool RFFT(const std::vector<float>& in, COMPLEX_VEC& out) {
+            return SIGNAL::RFFT(in, out);
+        }
+
+        static bool IRFFT(const COMPLEX_VEC& in, std::vector<float>& out, const uint64_t n) {
+            return SIGNAL::IRFFT(in, out, n);
+        }
+
+        static bool STFT(COMPLEX_VEC& in,
+                         COMPLEX_VEC& out,
+                         const int frame_size,
+                         const int hop_length,
+                         COMPLEX_VEC& window,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const bool normalized = false,
+                         const bool onesided = false) {
+            return SIGNAL::STFT(in, out, frame_size, hop_length, window, center, pad_mode, normalized, onesided);
+        }
+
+        static bool ISTFT(COMPLEX_VEC& in,
+                          COMPLEX_VEC& out,
+                          const int frame_size,
+                          const int hop_length,
+                          COMPLEX_VEC& window,
+                          const bool center = true,
+                          const bool normalized = false,
+                          const bool onesided = false,
+                          const int64_t length = -1) {
+            return SIGNAL::ISTFT(in, out, frame_size, hop_length, window, center, normalized, onesided, length);
+        }
+
+        static bool STFT(const FORMAT::SPAN<const float> in,
+                         COMPLEX_VEC& out,
+                         const int frame_size,
+                         const int hop_length,
+                         const FORMAT::SPAN<const float> window,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const bool normalized = false,
+                         const bool onesided = true) {
+            return SIGNAL::STFT(in, out, frame_size, hop_length, window, center, pad_mode, normalized, onesided);
+        }
+
+        static bool ISTFT(const COMPLEX_VEC& in,
+                          REAL_VEC& out,
+                          const int frame_size,
+                          const int hop_length,
+                          const FORMAT::SPAN<const float> window,
+                          const bool center = true,
+                          const bool normalized = false,
+                          const bool onesided = true,
+                          const int64_t length = -1) {
+            return SIGNAL::ISTFT(in, out, frame_size, hop_length, window, center, normalized, onesided, length);
+        }
+
+        static bool RESAMPLE(const FORMAT::SPAN<const float> in, REAL_VEC& out, const unsigned int in_rate, const unsigned int out_rate) {
+            return SIGNAL::RESAMPLE(in, out, in_rate, out_rate);
+        }
+
+        static bool RESAMPLE(const FORMAT::PLANAR& in, FORMAT::PLANAR& out, const unsigned int sample_rate) {
+            return SIGNAL::RESAMPLE(in, out, sample_rate);
+        }
+
+        static bool RESAMPLE(const FORMAT::WAV& in, FORMAT::WAV& out, const unsigned int sample_rate) {
+            return SIGNAL::RESAMPLE(in, out, sample_rate);
+        }
+
+        static bool MEL(const COMPLEX_VEC& spectrum, REAL_VEC& out, const unsigned int sample_rate, const int n_fft, const int n_mels = 80, const std::string& log = "log10") {
+            return SIGNAL::MEL(spectrum, out, sample_rate, n_fft, n_mels, log);
+        }
+
+        static bool MEL(const FORMAT::SPAN<const float> in,
+                        REAL_VEC& out,
+                        const unsigned int sample_rate,
+                        const int n_fft = 400,
+                        const int hop_length = 160,
+                        const int n_mels = 80,
+                        const bool center = true,
+                        const std::string& pad_mode = "reflect",
+                        const std::string& log = "log10") {
+            return SIGNAL::MEL(in, out, sample_rate, n_fft, hop_length, n_mels, center, pad_mode, log);
+        }
+
+        static bool DCT(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int n, const int type = 2) {
+            return SIGNAL::DCT(in, out, n, type);
+        }
+
+        static bool CEPSTRUM(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int n_mels, const int n_mfcc = 13, const int lifter = 0) {
+            return SIGNAL::CEPSTRUM(in, out, n_mels, n_mfcc, lifter);
+        }
+
+        static bool MFCC(const COMPLEX_VEC& spectrum, REAL_VEC& out, const unsigned int sample_rate, const int n_fft, const int n_mfcc = 13, const int n_mels = 40, const int lifter = 0, const std::string& log = "db") {
+            return SIGNAL::MFCC(spectrum, out, sample_rate, n_fft, n_mfcc, n_mels, lifter, log);
+        }
+
+        static bool MFCC(const FORMAT::SPAN<const float> in,
+                         REAL_VEC& out,
+                         const unsigned int sample_rate,
+                         const int n_mfcc = 13,
+                         const int n_fft = 400,
+                         const int hop_length = 160,
+                         const int n_mels = 40,
+                         const int lifter = 0,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const std::string& log = "db") {
+            return SIGNAL::MFCC(in, out, sample_rate, n_mfcc, n_fft, hop_length, n_mels, lifter, center, pad_mode, log);
+        }
+
+        static bool DELTA(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int features, const int width = 9, const int order = 1) {
+            return SIGNAL::DELTA(in, out, features, width, order);
+        }
+
+        static bool DWT(const FORMAT::SPAN<const float> in, REAL_VEC& approx, REAL_VEC& detail, const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            return SIGNAL::DWT(in, approx, detail, wavelet, mode);
+        }
+
+        static bool IDWT(const FORMAT::SPAN<const float> approx, const FORMAT::SPAN<const float> detail, REAL_VEC& out,
+                         const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            return SIGNAL::IDWT(approx, detail, out, wavelet, mode);
+        }
+
+        static bool WAVEDEC(const FORMAT::SPAN<const float> in, std::vector<REAL_VEC>& out, const std::string& wavelet = "db4", const int level = 0,
+                            const std::string& mode = "symmetric") {
+            return SIGNAL::WAVEDEC(in, out, wavelet, level, mode);
+        }
+
+        static bool WAVEDEC(const FORMAT::PLANAR& in, std::vector<std::vector<REAL_VEC>>& out, const std::string& wavelet = "db4", const int level = 0,
+                            const std::string& mode = "symmetric") {
+            return SIGNAL::WAVEDEC(in, out, wavelet, level, mode);
+        }
+
+        static bool WAVEREC(const std::vector<REAL_VEC>& in, REAL_VEC& out, const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            return SIGNAL::WAVEREC(in, out, wavelet, mode);
+        }
+
+        static bool WAVEREC(const std::vector<std::vector<REAL_VEC>>& in, FORMAT::PLANAR& out, const unsigned int sample_rate,
+                            const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            return SIGNAL::WAVEREC(in, out, sample_rate, wavelet, mode);
+        }
+
+        static bool SWT(const FORMAT::SPAN<const float> in, std::vector<REAL_VEC>& out, const std::string& wavelet = "db4", const int level = 1) {
+            return SIGNAL::SWT(in, out, wavelet, level);
+        }
+
+        static bool ISWT(const std::vector<REAL_VEC>& in, REAL_VEC& out, const std::string& wavelet = "db4") {
+            return SIGNAL::ISWT(in, out, wavelet);
+        }
+
+        static bool CWT(const FORMAT::SPAN<const float> in, COMPLEX_VEC& out, const std::vector<float>& scales, const std::string& wavelet = "morlet") {
+            return SIGNAL::CWT(in, out, scales, wavelet);
+        }
+    };
+
+    class WORKSPACE {
+    public:
+        /** Bump arena for scratch buffers, memory outlives each SCOPE so a warm loop stops allocating **/
+        /** Not thread-safe, every thread gets its own from local() **/
+        class SCOPE {
+        public:
+            /** Everything allocated while a SCOPE is alive is handed back when it ends **/
+            explicit SCOPE(WORKSPACE& workspace) : workspace(workspace), block(workspace.block), offset(workspace.offset) {}
+            SCOPE(const SCOPE&) = delete;
+            SCOPE& operator=(const SCOPE&) = delete;
+
+            ~SCOPE() {
+                workspace.block = block;
+                workspace.offset = offset;
+            }
+
+        private:
+            WORKSPACE& workspace;
+            uint64_t block;
+            uint64_t offset;
+        };
+
+        WORKSPACE() = default;
+        WORKSPACE(const WORKSPACE&) = delete;
+        WORKSPACE& operator=(const WORKSPACE&) = delete;
+
+        static WORKSPACE& local() {
+            static thread_local WORKSPACE workspace;
+            return workspace;
+        }
+
+        template<typename T>
+        T* allocate(const uint64_t count) {
+            /** Uninitialized, 64-byte aligned room for count values of T **/
+            static_assert(std::is_trivially_destructible<T>::value, "WORKSPACE only holds plain values");
+            const uint64_t alignment = ALIGNED_ALLOCATOR<char>::alignment;
+            const uint64_t bytes = std::max<uint64_t>(1, (count * sizeof(T) + alignment - 1) / alignment * alignment);
+            // Later blocks are only ever bigger, so the first one with room is the one to use
+            for (; block < blocks.size(); block++, offset = 0) {
+                if (blocks[block].size() - offset >= bytes) {
+                    T* out = reinterpret_cast<T*>(blocks[block].data() + offset);
+                    offset += bytes;
+                    return out;
+                }
+            }
+            const uint64_t size = std::max<uint64_t>(bytes, blocks.empty() ? 1 << 20 : 2 * blocks.back().size());
+            blocks.emplace_back(size);
+            block = blocks.size() - 1;
+            offset = bytes;
+            return reinterpret_cast<T*>(blocks.back().data());
+        }
+
+        uint64_t capacity() const {
+            uint64_t total = 0;
+            for (const auto& b : blocks) {
+                total += b.size();
+            }
+            return total;
+        }
+
+        void release() {
+            /** Give all memory back, only while no SCOPE is alive **/
+            blocks.clear();
+            blocks.shrink_to_fit();
+            block = 0;
+            offset = 0;
+        }
+
+    private:
+        std::vector<std::vector<char, ALIGNED_ALLOCATOR<char>>> blocks;
+        uint64_t block = 0;
+        uint64_t offset = 0;
+    };
+
+    class FILE_HANDLE {
+    public:
+        /** Read-only file handle with positioned, thread-safe reads **/
+        FILE_HANDLE() = default;
+        FILE_HANDLE(const FILE_HANDLE&) = delete;
+        FILE_HANDLE& operator=(const FILE_HANDLE&) = delete;
+
+        ~FILE_HANDLE() {
+            close();
+        }
+
+        bool open(const std::string& filename, const bool sequential = false) {
+            /** sequential hints the OS to read ahead, otherwise reads are expected to jump around **/
+            close();
+#if _WIN32
+            // Names are UTF-8, the wide API keeps whatever the ANSI code page can't spell
+            handle = CreateFileW(ONLY_WIN32::StringToWString(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS), NULL);
+            if (handle == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(handle, &length)) {
+                close();
+                return false;
+            }
+            length_ = static_cast<uint64_t>(length.QuadPart);
+#else
+            fd = ::open(filename.c_str(), O_RDONLY);
+            WAVLIB_COUNT(SYSCALLS, 1);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat info{};
+            if (fstat(fd, &info) != 0) {
+                close();
+                return false;
+            }
+            length_ = static_cast<uint64_t>(info.st_size);
+#if defined(POSIX_FADV_RANDOM) && defined(POSIX_FADV_SEQUENTIAL)
+            posix_fadvise(fd, 0, 0, sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+#endif
+#endif
+            return true;
+        }
+
+        void close() {
+#if _WIN32
+            if (handle != INVALID_HANDLE_VALUE) {
+                CloseHandle(handle);
+                handle = INVALID_HANDLE_VALUE;
+            }
+#else
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+#endif
+            length_ = 0;
+        }
+
+        bool is_open() const {
+#if _WIN32
+            return handle != INVALID_HANDLE_VALUE;
+#else
+            return fd >= 0;
+#endif
+        }
+
+        uint64_t size() const {
+            return length_;
+        }
+
+        uint64_t read(char* out, const uint64_t bytes, const uint64_t offset) const {
+            /** Read bytes at offset without moving a shared file position, returns how many were read **/
+            uint64_t done = 0;
+            while (done < bytes) {
+#if _WIN32
+                OVERLAPPED position{};
+                position.Offset = static_cast<DWORD>(offset + done);
+                position.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+                DWORD count = 0;
+                const auto step = static_cast<DWORD>(std::min<uint64_t>(bytes - done, 1u << 30));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                if (!ReadFile(handle, out + done, step, &count, &position) || count == 0) {
+                    break;
+                }
+#else
+                const ssize_t count = ::pread(fd, out + done, static_cast<size_t>(std::min<uint64_t>(bytes - done, 1u << 30)), static_cast<off_t>(offset + done));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count <= 0) {
+                    break;
+                }
+#endif
+                done += static_cast<uint64_t>(count);
+            }
+            WAVLIB_COUNT(BYTES_READ, done);
+            return done;
+        }
+
+        struct SOURCE {
+            /** Chunk source for LOAD::scan **/
+            const FILE_HANDLE& file;
+            uint64_t position = 0;
+
+            bool read(char* out, const uint64_t count) {
+                const uint64_t done = file.read(out, count, position);
+                position += done;
+                return done == count;
+            }
+
+            bool skip(const uint64_t count) {
+                if (count > file.size() - std::min(position, file.size())) {
+                    position = file.size();
+                    return false;
+                }
+                position += count;
+                return true;
+            }
+        };
+
+    private:
+#if _WIN32
+        HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+        int fd = -1;
+#endif
+        uint64_t length_ = 0;
+    };
+
+    class READER {
+    public:
+        /** Pull-based WAV or FLAC reader, hands out blocks of interleaved frames **/
+        /** Memory stays constant no matter how long the stream is **/
+        FORMAT::WAV format;  // Header of the stream, audio stays empty, FLAC shows up as the PCM it decodes to
+
+        READER() = default;
+        READER(const READER&) = delete;
+        READER& operator=(const READER&) = delete;
+
+        bool open(const std::string& filename) {
+            close();
+            owned.open(filename, std::ios::binary);
+            if (!owned.is_open()) {
+                return false;
+            }
+            return attach(owned);
+        }
+
+        bool open(std::istream& input) {
+            /** Read from a stream owned by the caller, eg. a pipe on std::cin **/
+            close();
+            return attach(input);
+        }
+
+        uint64_t read(int* out, const uint64_t frames) {
+            /** Decode up to frames frames into out, returns the number of frames read, 0 at the end **/
+            if (stream == nullptr || frames == 0) {
+                return 0;
+            }
+            if (flac.channels != 0) {
+                return decode(out, frames);
+            }
+            const uint64_t block_align = static_cast<uint64_t>(format.channels) * (format.sample_size / 8);
+            const uint64_t bytes = std::min(frames * block_align, remaining);
+            if (raw.size() < bytes) {
+                raw.resize(bytes);
+            }
+            stream->read(raw.data(), static_cast<std::streamsize>(bytes));
+            WAVLIB_COUNT(SYSCALLS, 1);
+            WAVLIB_COUNT(BYTES_READ, stream->gcount());
+            const uint64_t count = static_cast<uint64_t>(stream->gcount()) / block_align;
+            if (remaining != UINT64_MAX) {
+                remaining -= count * block_align;
+            }
+            if (count * block_align < bytes) {
+                remaining = 0;
+            }
+            PCM::decode(raw.data(), count * format.channels, type, out);
+            return count;
+        }
+
+        uint64_t read(std::vector<int>& out, const uint64_t frames) {
+            /** out only grows, so a buffer reused across calls never reallocates **/
+            if (out.size() < frames * format.channels) {
+                out.resize(frames * format.channels);
+            }
+            return read(out.data(), frames);
+        }
+
+        bool eof() const {
+            return stream == nullptr || remaining == 0;
+        }
+
+        void close() {
+            if (owned.is_open()) {
+                owned.close();
+            }
+            owned.clear();
+            stream = nullptr;
+            remaining = 0;
+            flac.channels = 0;
+        }
+
+    private:
+        bool attach(std::istream& input) {
+            format = FORMAT::WAV();
+            flac.channels = 0;
+            const int first = input.peek();
+            if (first == 'f' || first == 'I') {
+                LOAD::STREAM source{input};
+                if (!FLAC::metadata(source, flac)) {
+                    flac.channels = 0;
+                    close();
+                    return false;
+                }
+                FLAC::assign(flac, format);
+                stream = &input;
+                planes.resize(static_cast<uint64_t>(flac.max_block) * flac.channels);
+                bound = FLAC::bound(flac);
+                raw.resize(2 * bound);
+                used = 0;
+                filled = 0;
+                offset = 0;
+                held = 0;
+                remaining = flac.frames == 0 ? UINT64_MAX : flac.frames;
+                return true;
+            }
+            if (!LOAD::header(input, format)) {
+                close();
+                return false;
+            }
+            stream = &input;
+            type = PCM::type(format.format, format.sample_size);
+            // A stream of unknown length is read until the end
+            remaining = format.data_size;
+            return true;
+        }
+
+        uint64_t decode(int32_t* out, const uint64_t frames) {
+            /** Hand out what is left of the current FLAC frame, decoding the next one when it runs out **/
+            uint64_t done = 0;
+            while (done < frames && remaining != 0) {
+                if (held == 0 && !advance()) {
+                    remaining = 0;
+                    break;
+                }
+                const uint64_t n = std::min(std::min(held, frames - done), remaining);
+                FLAC::interleave(planes.data() + offset, flac.max_block, flac.channels, n, flac.sample_size, out + done * flac.channels);
+                offset += n;
+                held -= n;
+                done += n;
+                if (remaining != UINT64_MAX) {
+                    remaining -= n;
+                }
+            }
+            return done;
+        }
+
+        bool advance() {
+            /** Decode the next valid frame into planes, damaged frames are skipped by syncing past them **/
+            WAVLIB_SCOPE("READER::FLAC");
+            const auto* data = reinterpret_cast<const unsigned char*>(raw.data());
+            FLAC::HEADER head;
+            while (true) {
+                // Keep at least one whole frame buffered unless the stream ends first
+                if (filled - used < bound && *stream) {
+                    std::memmove(raw.data(), raw.data() + used, filled - used);
+                    filled -= used;
+                    used = 0;
+                    stream->read(raw.data() + filled, static_cast<std::streamsize>(raw.size() - filled));
+                    WAVLIB_COUNT(SYSCALLS, 1);
+                    WAVLIB_COUNT(BYTES_READ, stream->gcount());
+                    filled += static_cast<uint64_t>(stream->gcount());
+                }
+                used = FLAC::sync(data, filled, used, filled);
+                if (used >= filled) {
+                    if (!*stream) {
+                        return false;
+                    }
+                    continue;
+                }
+                const uint64_t bytes = FLAC::frame(data + used, filled - used, flac, planes.data(), head);
+                if (bytes == 0) {
+                    // A frame cut short by the buffer gets another try once more bytes are in
+                    if (filled - used < bound && *stream) {
+                        continue;
+                    }
+                    used++;
+                    continue;
+                }
+                used += bytes;
+                offset = 0;
+                held = head.block;
+                return true;
+            }
+        }
+
+        std::ifstream owned;
+        std::istream* stream = nullptr;
+        FORMAT::SAMPLE type = FORMAT::SAMPLE::UNKNOWN;
+        uint64_t remaining = 0;
+        std::vector<char> raw;
+        FORMAT::FLAC flac;  // channels is 0 for WAV streams
+        std::vector<int32_t> planes;
+        uint64_t bound = 0;
+        uint64_t used = 0;
+        uint64_t filled = 0;
+        uint64_t offset = 0;
+        uint64_t held = 0;
+    };
+
+    class WRITER {
+    public:
+        /** Push-based WAV writer, the RIFF and data sizes are patched on close **/
+        /** A stream that grows past 4 GB is closed as RF64, in the room a JUNK chunk kept free ahead of fmt **/
+        FORMAT::WAV format;  // Header of the stream, audio is ignored
+
+        WRITER() = default;
+        WRITER(const WRITER&) = delete;
+        WRITER& operator=(const WRITER&) = delete;
+
+        ~WRITER() {
+            close();
+        }
+
+        bool open(const std::string& filename, const FORMAT::WAV& header) {
+            close();
+            owned.open(filename, std::ios::binary | std::ios::trunc);
+            if (!owned.is_open()) {
+                return false;
+            }
+            return attach(owned, header);
+        }
+
+        bool open(std::ostream& output, const FORMAT::WAV& header) {
+            /** Write to a stream owned by the caller, eg. a pipe on std::cout **/
+            close();
+            return attach(output, header);
+        }
+
+        bool write(const int* in, const uint64_t frames) {
+            /** Append frames interleaved frames **/
+            return append(in, frames);
+        }
+
+        bool write(const float* in, const uint64_t frames) {
+            /** Append frames interleaved frames on the [-1, 1) scale of PLANAR, integer formats are rounded and clipped **/
+            return append(in, frames);
+        }
+
+        bool write(const std::vector<int>& in) {
+            return write(in.data(), in.size() / format.channels);
+        }
+
+        bool write(const std::vector<float>& in) {
+            return write(in.data(), in.size() / format.channels);
+        }
+
+        bool close() {
+            if (stream == nullptr) {
+                return true;
+            }
+            // The data chunk is word aligned
+            if (written & 1) {
+                stream->put(0);
+            }
+            bool result = static_cast<bool>(*stream);
+
+            // Rewrite the header in place, streams that can't seek keep the placeholders
+            std::streampos end = stream->tellp();
+            if (start != std::streampos(-1) && end != std::streampos(-1)) {
+                // Past 4 GB the JUNK chunk from attach becomes ds64 and RIFF becomes RF64, the header keeps its length
+                format.data_size = written;
+                stream->seekp(start);
+                DUMP::header(*stream, format, true);
+                stream->seekp(end);
+                result = result && static_cast<bool>(*stream);
+            }
+            stream->flush();
+            if (owned.is_open()) {
+                owned.close();
+            }
+            stream = nullptr;
+            return result;
+        }
+
+    private:
+        template<typename T>
+        bool append(const T* in, const uint64_t frames) {
+            if (stream == nullptr) {
+                return false;
+            }
+            const uint64_t bytes = frames * block_align;
+            if (raw.size() < bytes) {
+                raw.resize(bytes);
+            }
+            PCM::encode(in, frames * format.channels, type, raw.data());
+            stream->write(raw.data(), static_cast<std::streamsize>(bytes));
+            WAVLIB_COUNT(SYSCALLS, 1);
+            WAVLIB_COUNT(BYTES_WRITTEN, bytes);
+            written += bytes;
+            return static_cast<bool>(*stream);
+        }
+
+        bool attach(std::ostream& output, const FORMAT::WAV& header) {
+            if (header.channels == 0 || PCM::type(header.format, header.sample_size) == FORMAT::SAMPLE::UNKNOWN) {
+                close();
+                return false;
+            }
+            format = header;
+            format.audio.clear();
+            type = PCM::type(format.format, format.sample_size);
+            block_align = static_cast<uint64_t>(format.channels) * (format.sample_size / 8);
+            format.data_rate = static_cast<unsigned int>(format.sample_rate * block_align);
+            // Placeholder for a stream of unknown length, with room for a ds64 chunk should it pass 4 GB
+            format.data_size = 0xFFFFFFFF;
+            stream = &output;
+            start = stream->tellp();
+            written = 0;
+            return DUMP::header(*stream, format, true);
+        }
+
+        std::ofstream owned;
+        std::ostream* stream = nullptr;
+        std::streampos start = -1;
+        FORMAT::SAMPLE type = FORMAT::SAMPLE::UNKNOWN;
+        uint64_t block_align = 0;
+        uint64_t written = 0;
+        std::vector<char> raw;
+    };
+
+    class RANGE_READER {
+    public:
+        /** Random access to the frames of one open WAV, FLAC, MP3 or AAC file, without loading the rest **/
+        /** read() is const and uses positioned reads, so any number of threads can share one reader **/
+        FORMAT::WAV format;  // Header and chunk index, audio stays empty, compressed files show up as the PCM they decode to
+
+        RANGE_READER() = default;
+        RANGE_READER(const RANGE_READER&) = delete;
+        RANGE_READER& operator=(const RANGE_READER&) = delete;
+
+        bool open(const std::string& filename, const bool sequential = false) {
+            /** sequential suits a reader that goes through the file once from the start **/
+            close();
+            if (!file.open(filename, sequential)) {
+                return false;
+            }
+            const LOAD::CODEC codec = LOAD::codec([&](char* out, const uint64_t n, const uint64_t offset) { return file.read(out, n, offset); });
+            if (codec != LOAD::CODEC::WAV) {
+                const bool found = codec == LOAD::CODEC::FLAC ? index() : codec == LOAD::CODEC::AAC ? catalog() : survey();
+                if (!found) {
+                    close();
+                    return false;
+                }
+                return true;
+            }
+            FILE_HANDLE::SOURCE source{file};
+            LOAD::RIFF riff;
+            if (!LOAD::scan(source, riff, true) || !LOAD::assign(riff, format)) {
+                close();
+                return false;
+            }
+            type = PCM::type(format.format, format.sample_size);
+            block_align = format.channels * PCM::bytes(type);
+            data_offset = riff.data_offset;
+            // Truncated files keep whatever is actually there
+            count = std::min(format.data_size, file.size() - data_offset) / block_align;
+            return true;
+        }
+
+        void close() {
+            file.close();
+            format = FORMAT::WAV();
+            flac.channels = 0;
+            mp3 = FORMAT::MP3();
+            aac = FORMAT::AAC();
+            count = 0;
+        }
+
+        uint64_t frames() const {
+            return count;
+        }
+
+        bool read(const uint64_t start, const uint64_t end, std::vector<int>& out, const std::vector<unsigned short>& channels = {}) const {
+            /** Frames [start, end) of the selected channels (all if empty), interleaved **/
+            const uint64_t width = channels.empty() ? format.channels : channels.size();
+            if (!valid(start, end, channels)) {
+                return false;
+            }
+            out.resize((end - start) * width);
+            return decode<int32_t>(start, end, channels, [&](const uint64_t frame, const unsigned short slot, const int32_t* samples, const uint64_t stride, const uint64_t n) {
+                int* target = out.data() + (frame - start) * width + slot;
+                for (uint64_t i = 0; i < n; i++) {
+                    target[i * width] = samples[i * stride];
+                }
+            });
+        }
+
+        bool read(const uint64_t start, const uint64_t end, FORMAT::PLANAR& out, const std::vector<unsigned short>& channels = {}) const {
+            /** Frames [start, end) of the selected channels (all if empty) as normalized float32 **/
+            const uint64_t width = channels.empty() ? format.channels : channels.size();
+            if (!valid(start, end, channels)) {
+                return false;
+            }
+            out.sample_rate = format.sample_rate;
+            out.resize(static_cast<unsigned short>(width), end - start);
+            return decode<float>(start, end, channels, [&](const uint64_t frame, const unsigned short slot, const float* samples, const uint64_t stride, const uint64_t n) {
+                float* target = out.channel(slot).data + (frame - start);
+                for (uint64_t i = 0; i < n; i++) {
+                    target[i] = samples[i * stride];
+                }
+            });
+        }
+
+        template<typename VISIT>
+        bool visit(const uint64_t start, const uint64_t end, VISIT&& visit) const {
+            /** Frames [start, end) of all channels as float32 in frame order, nothing as long as the range is allocated **/
+            /** visit(frame, channel, samples, stride, n) gets n samples of one channel that start at frame **/
+            if (!valid(start, end, {})) {
+                return false;
+            }
+            return decode<float>(start, end, {}, visit);
+        }
+
+    private:
+        bool valid(const uint64_t start, const uint64_t end, const std::vector<unsigned short>& channels) const {
+            if (!file.is_open() || start > end || end > count) {
+                return false;
+            }
+            for (const unsigned short channel : channels) {
+                if (channel >= format.channels) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool index() {
+            /** FLAC metadata, plus the last frame for the length when STREAMINFO doesn't know it or the file is cut short **/
+            FILE_HANDLE::SOURCE source{file};
+            if (!FLAC::metadata(source, flac)) {
+                return false;
+            }
+            FLAC::assign(flac, format);
+            bound = FLAC::bound(flac);
+            const uint64_t window = std::min<uint64_t>(file.size() - flac.audio_offset, 2 * bound);
+            std::vector<char> last(window);
+            if (file.read(last.data(), window, file.size() - window) != window) {
+                return false;
+            }
+            const uint64_t audio_offset = flac.audio_offset;
+            flac.audio_offset = 0;
+            FLAC::HEADER head;
+            const bool found = FLAC::tail(reinterpret_cast<const unsigned char*>(last.data()), window, flac, head);
+            flac.audio_offset = audio_offset;
+            count = found ? head.first + head.block : 0;
+            if (flac.frames != 0) {
+                count = std::min(count, flac.frames);
+            }
+            format.data_size = count * format.channels * (format.sample_size / 8);
+            return true;
+        }
+
+        bool survey() {
+            /** MP3 frame index of the whole stream, read through a window that moves along with it **/
+            std::vector<char> window(1 << 20);
+            uint64_t base = 0;
+            uint64_t filled = 0;
+            const bool found = MP3::index(
+                [&](const uint64_t offset, const uint64_t n) -> const unsigned char* {
+                    if (offset < base || offset + n > base + filled) {
+                        base = offset;
+                        filled = file.read(window.data(), window.size(), offset);
+                    }
+                    return offset + n <= base + filled ? reinterpret_cast<const unsigned char*>(window.data()) + (offset - base) : nullptr;
+                },
+                file.size(), mp3);
+            if (!found || mp3.channels == 0) {
+                return false;
+            }
+            MP3::assign(mp3, format);
+            count = mp3.frames;
+            return true;
+        }
+
+        bool catalog() {
+            /** AAC block index of an ADTS stream or the sample tables of an MP4, through the same kind of window **/
+            std::vector<char> window(1 << 20);
+            uint64_t base = 0;
+            uint64_t filled = 0;
+            const bool found = AAC::index(
+                [&](const uint64_t offset, const uint64_t n) -> const unsigned char* {
+                    if (offset < base || offset + n > base + filled) {
+                        base = offset;
+                        filled = file.read(window.data(), window.size(), offset);
+                    }
+                    return offset + n <= base + filled ? reinterpret_cast<const unsigned char*>(window.data()) + (offset - base) : nullptr;
+                },
+                file.size(), aac);
+            if (!found || aac.channels == 0) {
+                aac = FORMAT::AAC();
+                return false;
+            }
+            AAC::assign(aac, format);
+            count = aac.frames;
+            return true;
+        }
+
+        uint64_t locate(const uint64_t start, const bool bisect) const {
+            /** Byte offset of a frame at or before the one holding start **/
+            /** The seek table narrows it down, bisecting on frame headers does the rest **/
+            uint64_t low = flac.audio_offset;
+            uint64_t high = file.size();
+            for (const FORMAT::FLAC::SEEKPOINT& point : flac.seek) {
+                const uint64_t offset = flac.audio_offset + point.offset;
+                if (offset >= high) {
+                    break;
+                }
+                if (point.sample <= start) {
+                    low = std::max(low, offset);
+                } else {
+                    high = offset;
+                    break;
+                }
+            }
+            static thread_local std::vector<char> window;
+            window.resize(bound + 16);
+            const auto* data = reinterpret_cast<const unsigned char*>(window.data());
+            FLAC::HEADER head;
+            while (bisect && high - low > 2 * bound) {
+                const uint64_t middle = low + (high - low) / 2;
+                const uint64_t size = file.read(window.data(), window.size(), middle);
+                uint64_t p = FLAC::sync(data, size, 0, size);
+                while (p < size && !FLAC::header(data + p, size - p, flac, head)) {
+                    p = FLAC::sync(data, size, p + 1, size);
+                }
+                // No header past middle means the frame holding start begins before it
+                if (p < size && head.first <= start) {
+                    low = middle + p;
+                } else {
+                    high = middle;
+                }
+            }
+            return low;
+        }
+
+        template<typename T, typename STORE>
+        bool unpack(const uint64_t start, const uint64_t end, const std::vector<unsigned short>& channels, STORE&& store) const {
+            /** Walk the FLAC frames from the located one, every frame is checked by both CRCs **/
+            WAVLIB_SCOPE("RANGE_READER::FLAC");
+            static thread_local std::vector<char> raw;
+            static thread_local std::vector<int32_t> planes;
+            static thread_local std::vector<T> samples;
+            raw.resize(std::max<uint64_t>(1 << 20, 2 * bound));
+            planes.resize(static_cast<uint64_t>(flac.max_block) * flac.channels);
+            samples.resize(planes.size());
+            const auto* data = reinterpret_cast<const unsigned char*>(raw.data());
+            const uint64_t total = file.size();
+            bool bisect = true;
+            uint64_t base = locate(start, bisect);
+            uint64_t size = 0;
+            uint64_t used = 0;
+            uint64_t covered = start;
+            FLAC::HEADER head;
+            while (covered < end) {
+                // Only try a frame with a whole frame's worth of bytes behind it, or the rest of the file
+                if (size - used < bound && base + size < total) {
+                    base += used;
+                    size = file.read(raw.data(), raw.size(), base);
+                    used = 0;
+                }
+                used = FLAC::sync(data, size, used, size);
+                if (size - used < bound && base + size < total) {
+                    continue;
+                }
+                if (used >= size) {
+                    return false;
+                }
+                const uint64_t bytes = FLAC::frame(data + used, size - used, flac, planes.data(), head);
+                if (bytes == 0) {
+                    used++;
+                    continue;
+                }
+                used += bytes;
+                if (head.first + head.block <= covered) {
+                    continue;
+                }
+                if (head.first > covered) {
+                    // A false header hit can send the bisection past start, the seek table alone never does
+                    if (bisect && covered == start) {
+                        bisect = false;
+                        base = locate(start, bisect);
+                        size = 0;
+                        used = 0;
+                        continue;
+                    }
+                    // A damaged frame left a hole in the range
+                    return false;
+                }
+                const uint64_t skip = covered - head.first;
+                const uint64_t n = std::min<uint64_t>(head.first + head.block, end) - covered;
+                FLAC::interleave(planes.data() + skip, flac.max_block, flac.channels, n, flac.sample_size, samples.data());
+                if (channels.empty()) {
+                    for (unsigned short c = 0; c < format.channels; c++) {
+                        store(covered, c, samples.data() + c, format.channels, n);
+                    }
+                } else {
+                    for (uint64_t slot = 0; slot < channels.size(); slot++) {
+                        store(covered, static_cast<unsigned short>(slot), samples.data() + channels[slot], format.channels, n);
+                    }
+                }
+                covered += n;
+            }
+            return true;
+        }
+
+        template<typename T, typename STORE>
+        bool mpeg(const uint64_t start, const uint64_t end, const std::vector<unsigned short>& channels, STORE&& store) const {
+            /** Batches of frames from the index, each one starts early enough to come out the same as a whole decode **/
+            WAVLIB_SCOPE("RANGE_READER::MP3");
+            static thread_local std::vector<char> raw;
+            static thread_local std::vector<T> samples;
+            static thread_local std::unique_ptr<MP3::DECODER> decoder(new MP3::DECODER);
+            samples.resize(mp3.frame_samples);
+            const uint64_t spf = mp3.frame_samples;
+            const uint64_t last = mp3.index.size() - 1;
+            const uint64_t batch = 256 * spf;
+            for (uint64_t first = start; first < end; first += batch) {
+                const uint64_t to = std::min(end, first + batch);
+                const uint64_t from = mp3.index[MP3::lead(mp3, (mp3.skip + first) / spf)];
+                const uint64_t until = mp3.index[std::min(last, (mp3.skip + to + spf - 1) / spf)];
+                raw.resize(until - from);
+                if (file.read(raw.data(), raw.size(), from) != raw.size()) {
+                    return false;
+                }
+                MP3::render(reinterpret_cast<const unsigned char*>(raw.data()), from, mp3, first, to, *decoder,
+                            [&](const MP3::DECODER& state, const uint64_t offset, const uint64_t n, const uint64_t position) {
+                                const uint64_t width = channels.empty() ? format.channels : channels.size();
+                                for (uint64_t slot = 0; slot < width; slot++) {
+                                    const float* in = state.pcm[channels.empty() ? slot : channels[slot]] + offset;
+                                    for (uint64_t i = 0; i < n; i++) {
+                                        samples[i] = std::is_same<T, float>::value ? static_cast<T>(in[i]) : static_cast<T>(MP3::quantize(in[i]));
+                                    }
+                                    store(position, static_cast<unsigned short>(slot), samples.data(), 1, n);
+                                }
+                            });
+            }
+            return true;
+        }
+
+        template<typename T, typename STORE>
+        bool units(const uint64_t start, const uint64_t end, const std::vector<unsigned short>& channels, STORE&& store) const {
+            /** Batches of raw data blocks from the index, each one starting a block early to fill the overlap **/
+            WAVLIB_SCOPE("RANGE_READER::AAC");
+            static thread_local std::vector<char> raw;
+            static thread_local std::vector<T> samples;
+            static thread_local std::unique_ptr<AAC::DECODER> decoder(new AAC::DECODER);
+            samples.resize(1024);
+            const uint64_t last = aac.index.size();
+            const uint64_t batch = 256 * 1024;
+            for (uint64_t first = start; first < end; first += batch) {
+                const uint64_t to = std::min(end, first + batch);
+                // Blocks of an MP4 need not be in order or next to each other, the batch reads everything between them
+                const uint64_t a = std::min(AAC::lead(aac, (aac.skip + first) / 1024), last);
+                const uint64_t b = std::min(last, (aac.skip + to + 1023) / 1024);
+                uint64_t from = UINT64_MAX;
+                uint64_t until = 0;
+                for (uint64_t i = a; i < b; i++) {
+                    from = std::min(from, aac.index[i]);
+                    until = std::max(until, aac.index[i] + aac.sizes[i]);
+                }
+                from = std::min(from, until);
+                raw.resize(until - from);
+                if (file.read(raw.data(), raw.size(), from) != raw.size()) {
+                    return false;
+                }
+                AAC::render(reinterpret_cast<const unsigned char*>(raw.data()), from, aac, first, to, *decoder,
+                            [&](const AAC::DECODER& state, const uint64_t offset, const uint64_t n, const uint64_t position) {
+                                const uint64_t width = channels.empty() ? format.channels : channels.size();
+                                for (uint64_t slot = 0; slot < width; slot++) {
+                                    const float* in = state.pcm[channels.empty() ? slot : channels[slot]] + offset;
+                                    for (uint64_t i = 0; i < n; i++) {
+                                        samples[i] = std::is_same<T, float>::value ? static_cast<T>(in[i]) : static_cast<T>(MP3::quantize(in[i]));
+                                    }
+                                    store(position, static_cast<unsigned short>(slot), samples.data(), 1, n);
+                                }
+                            });
+            }
+            return true;
+        }
+
+        template<typename T, typename STORE>
+        bool decode(const uint64_t start, const uint64_t end, const std::vector<unsigned short>& channels, STORE&& store) const {
+            if (flac.channels != 0) {
+                return unpack<T>(start, end, channels, store);
+            }
+            if (mp3.channels != 0) {
+                return mpeg<T>(start, end, channels, store);
+            }
+            if (aac.channels != 0) {
+                return units<T>(start, end, channels, store);
+            }
+            // Blocks keep the per-thread buffers small however long the range is
+            const uint64_t block = std::max<uint64_t>(1, (1 << 20) / block_align);
+            static thread_local std::vector<char> raw;
+            static thread_local std::vector<T> samples;
+            for (uint64_t first = start; first < end; first += block) {
+                const uint64_t n = std::min(block, end - first);
+                raw.resize(n * block_align);
+                samples.resize(n * format.channels);
+                if (file.read(raw.data(), raw.size(), data_offset + first * block_align) != raw.size()) {
+                    return false;
+                }
+                PCM::decode(raw.data(), samples.size(), type, samples.data());
+                if (channels.empty()) {
+                    for (unsigned short c = 0; c < format.channels; c++) {
+                        store(first, c, samples.data() + c, format.channels, n);
+                    }
+                } else {
+                    for (uint64_t slot = 0; slot < channels.size(); slot++) {
+                        store(first, static_cast<unsigned short>(slot), samples.data() + channels[slot], format.channels, n);
+                    }
+                }
+            }
+            return true;
+        }
+
+        FILE_HANDLE file;
+        FORMAT::SAMPLE type = FORMAT::SAMPLE::UNKNOWN;
+        uint64_t block_align = 0;
+        uint64_t data_offset = 0;
+        uint64_t count = 0;
+        FORMAT::FLAC flac;  // channels is 0 for WAV files
+        FORMAT::MP3 mp3;    // channels is 0 unless it is an MP3 file
+        FORMAT::AAC aac;    // channels is 0 unless it is an AAC file
+        uint64_t bound = 0;
+    };
+
+    struct PLAN {
+        /** Precomputed transforms, immutable once built so one plan can be shared between threads **/
+
+        class FFT {
+        public:
+            /** Mixed-radix (4, 2, 3, 5, 7, 11, 13) Stockham FFT, Bluestein for other prime factors **/
+            typedef std::complex<float> cpx;
+
+            static std::shared_ptr<const FFT> get(const uint64_t n) {
+                /** Plans are cached per size, there is no plan for size 0 and nullptr comes back **/
+                if (n == 0) {
+                    return nullptr;
+                }
+                static std::mutex lock;
+                static std::unordered_map<uint64_t, std::shared_ptr<const FFT>> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(n);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                // Built outside the lock, Bluestein plans fetch their power of two sub plan from the cache
+                auto plan = std::make_shared<const FFT>(n);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(n, plan).first->second;
+            }
+
+            explicit FFT(const uint64_t n) : n(n) {
+                uint64_t rest = n;
+                std::vector<uint64_t> radices;
+                while (rest % 4 == 0 && rest > 4) {
+                    radices.push_back(4);
+                    rest /= 4;
+                }
+                for (uint64_t p : {4, 2, 3, 5, 7, 11, 13}) {
+                    // rest > 1 also ends the loop for n == 0, which every p divides
+                    while (rest > 1 && rest % p == 0) {
+                        radices.push_back(p);
+                        rest /= p;
+                    }
+                }
+                if (rest > 1) {
+                    bluestein();
+                    return;
+                }
+
+                uint64_t length = n;
+                uint64_t stride = 1;
+                for (uint64_t p : radices) {
+                    STAGE stage{p, length / p, stride, twiddles.size(), roots.size()};
+                    for (uint64_t j = 0; j < stage.m; j++) {
+                        for (uint64_t k = 1; k < p; k++) {
+                            twiddles.push_back(root(k * j, length));
+                        }
+                    }
+                    if (p > 5) {
+                        for (uint64_t k = 0; k < p; k++) {
+                            roots.push_back(root(k, p));
+                        }
+                    }
+                    stages.push_back(stage);
+                    length /= p;
+                    stride *= p;
+                }
+            }
+
+            uint64_t size() const {
+                return n;
+            }
+
+            uint64_t scratch_size() const {
+                return sub ? 2 * sub->size() : n;
+            }
+
+            void forward(const cpx* in, cpx* out, cpx* scratch) const {
+                /** out may alias in, scratch holds scratch_size() elements **/
+                if (sub) {
+                    convolve(in, out, scratch);
+                    return;
+                }
+                if (stages.empty()) {
+                    std::copy(in, in + n, out);
+                    return;
+                }
+                cpx* buffers[2] = {out, scratch};
+                // Pick the first destination so that the last stage lands in out
+                uint64_t target = stages.size() % 2 == 1 ? 0 : 1;
+                const cpx* source = in;
+                if (in == out) {
+                    std::copy(in, in + n, scratch);
+                    source = scratch;
+                    target = 0;
+                }
+                for (const STAGE& stage : stages) {
+                    run(stage, source, buffers[target]);
+                    source = buffers[target];
+                    target ^= 1;
+                }
+                if (source != out) {
+                    std::copy(source, source + n, out);
+                }
+            }
+
+            void inverse(const cpx* in, cpx* out, cpx* scratch) const {
+                /** Unnormalized, scale by 1 / size() to undo forward **/
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i] = std::conj(in[i]);
+                }
+                forward(out, out, scratch);
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i] = std::conj(out[i]);
+                }
+            }
+
+            void forward(const COMPLEX_VEC& in, COMPLEX_VEC& out) const {
+                out.resize(n);
+                forward(in.data(), out.data(), workspace(scratch_size()));
+            }
+
+            void inverse(const COMPLEX_VEC& in, COMPLEX_VEC& out) const {
+                out.resize(n);
+                inverse(in.data(), out.data(), workspace(scratch_size()));
+            }
+
+            static cpx* workspace(const uint64_t size) {
+                /** Per-thread scratch for the convenience overloads, grows once and is reused **/
+                static thread_local std::vector<cpx> buffer;
+                if (buffer.size() < size) {
+                    buffer.resize(size);
+                }
+                return buffer.data();
+            }
+
+        private:
+            struct STAGE {
+                uint64_t radix;    // Butterfly size
+                uint64_t m;        // Butterflies per column
+                uint64_t s;        // Columns, ie. product of the previous radices
+                uint64_t twiddle;  // Offset into twiddles
+                uint64_t root;     // Offset into roots (generic radices only)
+            };
+
+            static cpx root(const uint64_t k, const uint64_t length) {
+                const double angle = -2.0 * WAVLIB_PI * static_cast<double>(k % length) / static_cast<double>(length);
+                return {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+            }
+
+            void bluestein() {
+                /** X_k = c_k * sum_j (x_j c_j) conj(c_{k-j}), c_k = exp(-i pi k^2 / n), as a power of two convolution **/
+                uint64_t size = 1;
+                while (size < 2 * n - 1) {
+                    size *= 2;
+                }
+                sub = get(size);
+                chirp.resize(n);
+                for (uint64_t k = 0; k < n; k++) {
+                    const double angle = -WAVLIB_PI * static_cast<double>((k * k) % (2 * n)) / static_cast<double>(n);
+                    chirp[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+                }
+                std::vector<cpx> filter(size), work(sub->scratch_size());
+                filter[0] = std::conj(chirp[0]);
+                for (uint64_t k = 1; k < n; k++) {
+                    filter[k] = filter[size - k] = std::conj(chirp[k]);
+                }
+                sub->forward(filter.data(), filter.data(), work.data());
+                // Fold the normalization of the inverse transform into the kernel
+                kernel.resize(size);
+                for (uint64_t k = 0; k < size; k++) {
+                    kernel[k] = filter[k] / static_cast<float>(size);
+                }
+            }
+
+            void convolve(const cpx* in, cpx* out, cpx* scratch) const {
+                const uint64_t size = sub->size();
+                cpx* a = scratch;
+                for (uint64_t k = 0; k < n; k++) {
+                    a[k] = CPX::mul(in[k], chirp[k]);
+                }
+                std::fill(a + n, a + size, cpx(0, 0));
+                sub->forward(a, a, scratch + size);
+                for (uint64_t k = 0; k < size; k++) {
+                    a[k] = CPX::mul(a[k], kernel[k]);
+                }
+                sub->inverse(a, a, scratch + size);
+                for (uint64_t k = 0; k < n; k++) {
+                    out[k] = CPX::mul(a[k], chirp[k]);
+                }
+            }
+
+            void run(const STAGE& stage, const cpx* x, cpx* y) const {
+                /** One decimation in frequency pass, y[q + s (p j + k)] = w^(jk) sum_t x[q + s (j + t m)] e^(-2 pi i t k / p) **/
+                const uint64_t m = stage.m;
+                const uint64_t s = stage.s;
+                const cpx* tw = twiddles.data() + stage.twiddle;
+                switch (stage.radix) {
+                    case 2:
+                        for (uint64_t j = 0; j < m; j++) {
+                            const cpx w = tw[j];
+                            const cpx* a = x + s * j;
+                            cpx* b = y + s * 2 * j;
+                            uint64_t q = 0;
+#if WAVLIB_SSE2 || WAVLIB_NEON
+                            const CPX::TWIDDLE v = CPX::twiddle(w);
+                            for (; q + 2 <= s; q += 2) {
+                                CPX::PAIR a0 = CPX::load(a + q), a1 = CPX::load(a + q + s * m);
+                                CPX::store(b + q, CPX::add(a0, a1));
+                                CPX::store(b + q + s, CPX::mul(CPX::sub(a0, a1), v));
+                            }
+#endif
+                            for (; q < s; q++) {
+                                const cpx a0 = a[q], a1 = a[q + s * m];
+                                b[q] = a0 + a1;
+                                b[q + s] = CPX::mul(a0 - a1, w);
+                            }
+                        }
+                        break;
+                    case 4:
+                        for (uint64_t j = 0; j < m; j++) {
+                            const cpx w1 = tw[3 * j], w2 = tw[3 * j + 1], w3 = tw[3 * j + 2];
+                            const cpx* a = x + s * j;
+                            cpx* b = y + s * 4 * j;
+                            uint64_t q = 0;
+#if WAVLIB_SSE2 || WAVLIB_NEON
+                            const CPX::TWIDDLE v1 = CPX::twiddle(w1), v2 = CPX::twiddle(w2), v3 = CPX::twiddle(w3);
+                            for (; q + 2 <= s; q += 2) {
+                                CPX::PAIR a0 = CPX::load(a + q), a1 = CPX::load(a + q + s * m);
+                                CPX::PAIR a2 = CPX::load(a + q + 2 * s * m), a3 = CPX::load(a + q + 3 * s * m);
+                                CPX::PAIR t0 = CPX::add(a0, a2), t1 = CPX::sub(a0, a2);
+                                CPX::PAIR t2 = CPX::add(a1, a3), t3 = CPX::neg_i(CPX::sub(a1, a3));
+                                CPX::store(b + q, CPX::add(t0, t2));
+                                CPX::store(b + q + s, CPX::mul(CPX::add(t1, t3), v1));
+                                CPX::store(b + q + 2 * s, CPX::mul(CPX::sub(t0, t2), v2));
+                                CPX::store(b + q + 3 * s, CPX::mul(CPX::sub(t1, t3), v3));
+                            }
+#endif
+                            for (; q < s; q++) {
+                                const cpx a0 = a[q], a1 = a[q + s * m], a2 = a[q + 2 * s * m], a3 = a[q + 3 * s * m];
+                                const cpx t0 = a0 + a2, t1 = a0 - a2, t2 = a1 + a3, t3 = CPX::neg_i(a1 - a3);
+                                b[q] = t0 + t2;
+                                b[q + s] = CPX::mul(t1 + t3, w1);
+                                b[q + 2 * s] = CPX::mul(t0 - t2, w2);
+                                b[q + 3 * s] = CPX::mul(t1 - t3, w3);
+                            }
+                        }
+                        break;
+                    case 3: {
+                        const float sin60 = 0.86602540378443864676f;
+                        for (uint64_t j = 0; j < m; j++) {
+                            const cpx w1 = tw[2 * j], w2 = tw[2 * j + 1];
+                            const cpx* a = x + s * j;
+                            cpx* b = y + s * 3 * j;
+                            uint64_t q = 0;
+#if WAVLIB_SSE2 || WAVLIB_NEON
+                            const CPX::TWIDDLE v1 = CPX::twiddle(w1), v2 = CPX::twiddle(w2);
+                            for (; q + 2 <= s; q += 2) {
+                                CPX::PAIR a0 = CPX::load(a + q), a1 = CPX::load(a + q + s * m), a2 = CPX::load(a + q + 2 * s * m);
+                                CPX::PAIR t1 = CPX::add(a1, a2);
+                                CPX::PAIR t2 = CPX::sub(a0, CPX::scale(t1, 0.5f));
+                                CPX::PAIR t3 = CPX::scale(CPX::neg_i(CPX::sub(a1, a2)), sin60);
+                                CPX::store(b + q, CPX::add(a0, t1));
+                                CPX::store(b + q + s, CPX::mul(CPX::add(t2, t3), v1));
+                                CPX::store(b + q + 2 * s, CPX::mul(CPX::sub(t2, t3), v2));
+                            }
+#endif
+                            for (; q < s; q++) {
+                                const cpx a0 = a[q], a1 = a[q + s * m], a2 = a[q + 2 * s * m];
+                                const cpx t1 = a1 + a2;
+                                const cpx t2 = a0 - 0.5f * t1;
+                                const cpx t3 = CPX::neg_i(a1 - a2) * sin60;
+                                b[q] = a0 + t1;
+                                b[q + s] = CPX::mul(t2 + t3, w1);
+                                b[q + 2 * s] = CPX::mul(t2 - t3, w2);
+                            }
+                        }
+                        break;
+                    }
+                    case 5: {
+                        // cos and sin of 2 pi / 5 and 4 pi / 5, the generic path spends p^2 multiplies here
+                        const float c1 = 0.30901699437494742410f, c2 = -0.80901699437494742410f;
+                        const float s1 = 0.95105651629515357212f, s2 = 0.58778525229247312917f;
+                        for (uint64_t j = 0; j < m; j++) {
+                            const cpx w1 = tw[4 * j], w2 = tw[4 * j + 1], w3 = tw[4 * j + 2], w4 = tw[4 * j + 3];
+                            const cpx* a = x + s * j;
+                            cpx* b = y + s * 5 * j;
+                            uint64_t q = 0;
+#if WAVLIB_SSE2 || WAVLIB_NEON
+                            const CPX::TWIDDLE v1 = CPX::twiddle(w1), v2 = CPX::twiddle(w2);
+                            const CPX::TWIDDLE v3 = CPX::twiddle(w3), v4 = CPX::twiddle(w4);
+                            for (; q + 2 <= s; q += 2) {
+                                CPX::PAIR a0 = CPX::load(a + q), a1 = CPX::load(a + q + s * m);
+                                CPX::PAIR a2 = CPX::load(a + q + 2 * s * m), a3 = CPX::load(a + q + 3 * s * m);
+                                CPX::PAIR a4 = CPX::load(a + q + 4 * s * m);
+                                CPX::PAIR t1 = CPX::add(a1, a4), t2 = CPX::add(a2, a3);
+                                CPX::PAIR t3 = CPX::neg_i(CPX::sub(a1, a4)), t4 = CPX::neg_i(CPX::sub(a2, a3));
+                                CPX::PAIR b1 = CPX::add(a0, CPX::add(CPX::scale(t1, c1), CPX::scale(t2, c2)));
+                                CPX::PAIR b2 = CPX::add(a0, CPX::add(CPX::scale(t1, c2), CPX::scale(t2, c1)));
+                                CPX::PAIR d1 = CPX::add(CPX::scale(t3, s1), CPX::scale(t4, s2));
+                                CPX::PAIR d2 = CPX::sub(CPX::scale(t3, s2), CPX::scale(t4, s1));
+                                CPX::store(b + q, CPX::add(a0, CPX::add(t1, t2)));
+                                CPX::store(b + q + s, CPX::mul(CPX::add(b1, d1), v1));
+                                CPX::store(b + q + 2 * s, CPX::mul(CPX::add(b2, d2), v2));
+                                CPX::store(b + q + 3 * s, CPX::mul(CPX::sub(b2, d2), v3));
+                                CPX::store(b + q + 4 * s, CPX::mul(CPX::sub(b1, d1), v4));
+                            }
+#endif
+                            for (; q < s; q++) {
+                                const cpx a0 = a[q], a1 = a[q + s * m], a2 = a[q + 2 * s * m];
+                                const cpx a3 = a[q + 3 * s * m], a4 = a[q + 4 * s * m];
+                                const cpx t1 = a1 + a4, t2 = a2 + a3;
+                                const cpx t3 = CPX::neg_i(a1 - a4), t4 = CPX::neg_i(a2 - a3);
+                                const cpx b1 = a0 + c1 * t1 + c2 * t2, b2 = a0 + c2 * t1 + c1 * t2;
+                                const cpx d1 = s1 * t3 + s2 * t4, d2 = s2 * t3 - s1 * t4;
+                                b[q] = a0 + t1 + t2;
+                                b[q + s] = CPX::mul(b1 + d1, w1);
+                                b[q + 2 * s] = CPX::mul(b2 + d2, w2);
+                                b[q + 3 * s] = CPX::mul(b2 - d2, w3);
+                                b[q + 4 * s] = CPX::mul(b1 - d1, w4);
+                            }
+                        }
+                        break;
+                    }
+                    default: {
+                        const uint64_t p = stage.radix;
+                        const cpx* r = roots.data() + stage.root;
+                        cpx in[13], out[13];
+                        for (uint64_t j = 0; j < m; j++) {
+                            const cpx* a = x + s * j;
+                            cpx* b = y + s * p * j;
+                            for (uint64_t q = 0; q < s; q++) {
+                                for (uint64_t t = 0; t < p; t++) {
+                                    in[t] = a[q + t * s * m];
+                                }
+                                for (uint64_t k = 0; k < p; k++) {
+                                    cpx sum = in[0];
+                                    for (uint64_t t = 1; t < p; t++) {
+                                        sum += CPX::mul(in[t], r[(t * k) % p]);
+                                    }
+                                    out[k] = sum;
+                                }
+                                b[q] = out[0];
+                                for (uint64_t k = 1; k < p; k++) {
+                                    b[q + k * s] = CPX::mul(out[k], tw[(p - 1) * j + k - 1]);
+                                }
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+
+            uint64_t n;
+            std::vector<STAGE> stages;
+            std::vector<cpx> twiddles;
+            std::vector<cpx> roots;
+            std::shared_ptr<const FFT> sub;  // Bluestein only
+            std::vector<cpx> chirp;
+            std::vector<cpx> kernel;
+        };
+
+        class RFFT {
+        public:
+            /** Real input FFT, even sizes run a half size complex FFT **/
+            typedef std::complex<float> cpx;
+
+            static std::shared_ptr<const RFFT> get(const uint64_t n) {
+                /** Cached per size like FFT::get, nullptr for size 0 **/
+                if (n == 0) {
+                    return nullptr;
+                }
+                static std::mutex lock;
+                static std::unordered_map<uint64_t, std::shared_ptr<const RFFT>> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(n);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const RFFT>(n);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(n, plan).first->second;
+            }
+
+            explicit RFFT(const uint64_t n) : n(n) {
+                if (n % 2 == 0 && n > 0) {
+                    complex = FFT::get(n / 2);
+                    twiddles.resize(n / 2);
+                    for (uint64_t k = 0; k < n / 2; k++) {
+                        const double angle = -2.0 * WAVLIB_PI * static_cast<double>(k) / static_cast<double>(n);
+                        twiddles[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+                    }
+                } else {
+                    complex = FFT::get(n);
+                }
+            }
+
+            uint64_t size() const {
+                return n;
+            }
+
+            uint64_t bins() const {
+                return n / 2 + 1;
+            }
+
+            uint64_t scratch_size() const {
+                return (n % 2 == 0 ? n / 2 : n) + complex->scratch_size();
+            }
+
+            void forward(const float* in, cpx* out, cpx* scratch) const {
+                /** out holds bins() elements **/
+                if (n % 2 == 1) {
+                    for (uint64_t i = 0; i < n; i++) {
+                        scratch[i] = cpx(in[i], 0);
+                    }
+                    complex->forward(scratch, scratch, scratch + n);
+                    std::copy(scratch, scratch + bins(), out);
+                    return;
+                }
+                // Even samples in the real part, odd samples in the imaginary part
+                const uint64_t half = n / 2;
+                complex->forward(reinterpret_cast<const cpx*>(in), out, scratch);
+                const cpx z0 = out[0];
+                out[0] = cpx(z0.real() + z0.imag(), 0);
+                out[half] = cpx(z0.real() - z0.imag(), 0);
+                for (uint64_t k = 1; 2 * k <= half; k++) {
+                    const cpx zk = out[k];
+                    const cpx zm = std::conj(out[half - k]);
+                    const cpx even = 0.5f * (zk + zm);
+                    const cpx odd = 0.5f * CPX::neg_i(zk - zm);
+                    out[k] = even + CPX::mul(twiddles[k], odd);
+                    out[half - k] = std::conj(even) + CPX::mul(twiddles[half - k], std::conj(odd));
+                }
+            }
+
+            void inverse(const cpx* in, float* out, cpx* scratch) const {
+                /** Unnormalized, scale by 1 / size() to undo forward **/
+                if (n % 2 == 1) {
+                    scratch[0] = cpx(in[0].real(), 0);
+                    for (uint64_t k = 1; k < bins(); k++) {
+                        scratch[k] = in[k];
+                        scratch[n - k] = std::conj(in[k]);
+                    }
+                    complex->inverse(scratch, scratch, scratch + n);
+                    for (uint64_t i = 0; i < n; i++) {
+                        out[i] = scratch[i].real();
+                    }
+                    return;
+                }
+                const uint64_t half = n / 2;
+                cpx* z = scratch;
+                for (uint64_t k = 0; k < half; k++) {
+                    const cpx xm = std::conj(in[half - k]);
+                    z[k] = (in[k] + xm) + CPX::mul(cpx(twiddles[k].imag(), twiddles[k].real()), in[k] - xm);
+                }
+                complex->inverse(z, reinterpret_cast<cpx*>(out), scratch + half);
+            }
+
+            void forward(const float* in, COMPLEX_VEC& out) const {
+                out.resize(bins());
+                forward(in, out.data(), FFT::workspace(scratch_size()));
+            }
+
+            void inverse(const COMPLEX_VEC& in, float* out) const {
+                inverse(in.data(), out, FFT::workspace(scratch_size()));
+            }
+
+        private:
+            uint64_t n;
+            std::shared_ptr<const FFT> complex;
+            std::vector<cpx> twiddles;  // exp(-2 pi i k / n)
+        };
+
+        class POLYPHASE {
+        public:
+            /** Polyphase filter bank converting in_rate to out_rate, the ratio is reduced to up / down **/
+            /** Every phase is a Kaiser windowed sinc with zeros crossings on each side **/
+            struct KEY {
+                uint64_t up;
+                uint64_t down;
+                int zeros;
+                float beta;
+                float rolloff;
+
+                bool operator==(const KEY& other) const {
+                    return up == other.up && down == other.down && zeros == other.zeros && beta == other.beta && rolloff == other.rolloff;
+                }
+            };
+
+            struct HASH {
+                std::size_t operator()(const KEY& key) const {
+                    uint32_t beta = 0;
+                    uint32_t rolloff = 0;
+                    std::memcpy(&beta, &key.beta, sizeof(beta));
+                    std::memcpy(&rolloff, &key.rolloff, sizeof(rolloff));
+                    uint64_t h = key.up;
+                    for (const uint64_t value : {key.down, static_cast<uint64_t>(key.zeros), static_cast<uint64_t>(beta), static_cast<uint64_t>(rolloff)}) {
+                        h = h * 0x9E3779B97F4A7C15ull + value;
+                    }
+                    return static_cast<std::size_t>(h ^ (h >> 29));
+                }
+            };
+
+            static std::shared_ptr<const POLYPHASE> get(const unsigned int in_rate, const unsigned int out_rate, const int zeros = 32, const float beta = 8.6f, const float rolloff = 0.945f) {
+                if (in_rate == 0 || out_rate == 0 || zeros < 1 || rolloff <= 0.0f || rolloff > 1.0f) {
+                    return nullptr;
+                }
+                uint64_t a = in_rate;
+                uint64_t b = out_rate;
+                while (b != 0) {
+                    const uint64_t r = a % b;
+                    a = b;
+                    b = r;
+                }
+                const KEY key{out_rate / a, in_rate / a, zeros, beta, rolloff};
+                static std::mutex lock;
+                static std::unordered_map<KEY, std::shared_ptr<const POLYPHASE>, HASH> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(key);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const POLYPHASE>(key);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(key, plan).first->second;
+            }
+
+            explicit POLYPHASE(const KEY& key) : L(key.up), M(key.down), dot(FIR::dot()) {
+                // Cutoff in cycles per input sample, the filter reaches zeros crossings of the sinc on each side
+                const double cutoff = key.rolloff * std::min(1.0, static_cast<double>(L) / static_cast<double>(M));
+                H = static_cast<uint64_t>(std::ceil(key.zeros / cutoff));
+                T = 2 * H;
+                stride = (T + 7) / 8 * 8;
+
+                // One symmetric prototype at L times the input rate, phase p takes every L-th tap from L - p on
+                REAL_VEC window;
+                WINDOW::Kaiser(window, static_cast<int>(2 * L * H + 1), false, key.beta);
+                coefficients.assign(L * stride, 0.0f);
+                for (uint64_t p = 0; p < L; p++) {
+                    float* phase = coefficients.data() + p * stride;
+                    double sum = 0.0;
+                    for (uint64_t k = 0; k < T; k++) {
+                        const uint64_t m = L * (k + 1) - p;
+                        const double t = (static_cast<double>(m) - static_cast<double>(L * H)) / static_cast<double>(L);
+                        const double x = WAVLIB_PI * cutoff * t;
+                        const double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+                        phase[k] = static_cast<float>(cutoff * sinc * window[m]);
+                        sum += phase[k];
+                    }
+                    // Unity gain at DC for every phase
+                    for (uint64_t k = 0; k < T; k++) {
+                        phase[k] = static_cast<float>(phase[k] / sum);
+                    }
+                }
+            }
+
+            uint64_t up() const {
+                return L;
+            }
+
+            uint64_t down() const {
+                return M;
+            }
+
+            uint64_t taps() const {
+                return T;
+            }
+
+            uint64_t half() const {
+                /** Output n depends on input floor(n down / up) - half() + 1 up to floor(n down / up) + half() **/
+                return H;
+            }
+
+            uint64_t output_size(const uint64_t input) const {
+                return (input * L + M - 1) / M;
+            }
+
+            float evaluate(const float* x, const uint64_t p) const {
+                /** One output from taps() inputs starting at x, with the coefficients of phase p **/
+                return dot(x, coefficients.data() + p * stride, T);
+            }
+
+            void run(const float* x, const uint64_t size, const uint64_t first, const uint64_t count, float* out) const {
+                /** Outputs first .. first + count of the whole signal x, samples outside of it are zero **/
+                uint64_t i = first * M / L;
+                uint64_t p = first * M % L;
+                for (uint64_t n = 0; n < count; n++) {
+                    if (i + 1 >= H && i + H < size) {
+                        out[n] = evaluate(x + i + 1 - H, p);
+                    } else {
+                        const float* phase = coefficients.data() + p * stride;
+                        float sum = 0.0f;
+                        for (uint64_t k = 0; k < T; k++) {
+                            const int64_t at = static_cast<int64_t>(i + k + 1) - static_cast<int64_t>(H);
+                            if (at >= 0 && at < static_cast<int64_t>(size)) {
+                                sum += x[at] * phase[k];
+                            }
+                        }
+                        out[n] = sum;
+                    }
+                    p += M;
+                    i += p / L;
+                    p %= L;
+                }
+            }
+
+        private:
+            uint64_t L;
+            uint64_t M;
+            uint64_t H = 0;
+            uint64_t T = 0;
+            uint64_t stride = 0;
+            REAL_VEC coefficients;  // L phases of T taps, each phase starts on a cache line
+            float (*dot)(const float*, const float*, uint64_t);
+        };
+
+        class MEL {
+        public:
+            /** Triangular mel filters over the n_fft / 2 + 1 bins of a onesided spectrum, only the non-zero weights are kept **/
+            /** Slaney mel scale with area normalization by default (librosa, Whisper), htk scale without it for Kaldi style features **/
+            struct KEY {
+                unsigned int sample_rate;
+                uint64_t n_fft;
+                uint64_t n_mels;
+                float fmin;
+                float fmax;
+                bool htk;
+                bool normalize;
+
+                bool operator==(const KEY& other) const {
+                    return sample_rate == other.sample_rate && n_fft == other.n_fft && n_mels == other.n_mels && fmin == other.fmin && fmax == other.fmax && htk == other.htk && normalize == other.normalize;
+                }
+            };
+
+            struct HASH {
+                std::size_t operator()(const KEY& key) const {
+                    uint32_t fmin = 0;
+                    uint32_t fmax = 0;
+                    std::memcpy(&fmin, &key.fmin, sizeof(fmin));
+                    std::memcpy(&fmax, &key.fmax, sizeof(fmax));
+                    uint64_t h = key.sample_rate;
+                    for (const uint64_t value : {key.n_fft, key.n_mels, static_cast<uint64_t>(fmin), static_cast<uint64_t>(fmax), static_cast<uint64_t>(key.htk) << 1 | key.normalize}) {
+                        h = h * 0x9E3779B97F4A7C15ull + value;
+                    }
+                    return static_cast<std::size_t>(h ^ (h >> 29));
+                }
+            };
+
+            static std::shared_ptr<const MEL> get(const unsigned int sample_rate, const uint64_t n_fft, const uint64_t n_mels, const float fmin = 0.0f, const float fmax = 0.0f, const bool htk = false, const bool normalize = true) {
+                /** fmax <= 0 means the Nyquist frequency **/
+                const float nyquist = static_cast<float>(sample_rate) / 2.0f;
+                const float top = fmax > 0.0f ? fmax : nyquist;
+                if (sample_rate == 0 || n_fft < 2 || n_mels < 1 || fmin < 0.0f || fmin >= top || top > nyquist) {
+                    return nullptr;
+                }
+                const KEY key{sample_rate, n_fft, n_mels, fmin, top, htk, normalize};
+                static std::mutex lock;
+                static std::unordered_map<KEY, std::shared_ptr<const MEL>, HASH> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(key);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const MEL>(key);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(key, plan).first->second;
+            }
+
+            explicit MEL(const KEY& key) : n_bins(key.n_fft / 2 + 1), dot(FIR::dot()) {
+                // n_mels + 2 edges evenly spaced on the mel scale, filter m rises from edge m to m + 1 and falls to m + 2
+                const double low = mel(key.fmin, key.htk);
+                const double high = mel(key.fmax, key.htk);
+                std::vector<double> edges(key.n_mels + 2);
+                for (uint64_t i = 0; i < edges.size(); i++) {
+                    edges[i] = hz(low + (high - low) * static_cast<double>(i) / static_cast<double>(key.n_mels + 1), key.htk);
+                }
+                const double resolution = static_cast<double>(key.sample_rate) / static_cast<double>(key.n_fft);
+                filters.resize(key.n_mels);
+                for (uint64_t m = 0; m < key.n_mels; m++) {
+                    const double gain = key.normalize ? 2.0 / (edges[m + 2] - edges[m]) : 1.0;
+                    FILTER& filter = filters[m];
+                    filter.first = n_bins;
+                    filter.offset = weights.size();
+                    for (uint64_t k = 0; k < n_bins; k++) {
+                        const double f = static_cast<double>(k) * resolution;
+                        const double rise = (f - edges[m]) / (edges[m + 1] - edges[m]);
+                        const double fall = (edges[m + 2] - f) / (edges[m + 2] - edges[m + 1]);
+                        const double w = std::max(0.0, std::min(rise, fall));
+                        if (w > 0.0) {
+                            // Zeros between the first and last non-zero weight are kept, a triangle has none
+                            if (filter.first == n_bins) {
+                                filter.first = k;
+                            }
+                            weights.resize(filter.offset + k - filter.first + 1, 0.0f);
+                            weights.back() = static_cast<float>(w * gain);
+                        }
+                    }
+                    if (filter.first == n_bins) {
+                        filter.first = 0;
+                    }
+                    filter.length = weights.size() - filter.offset;
+                }
+            }
+
+            uint64_t bins() const {
+                return n_bins;
+            }
+
+            uint64_t mels() const {
+                return filters.size();
+            }
+
+            void apply(const float* power, float* out) const {
+                /** mels() filter outputs from bins() power values **/
+                for (uint64_t m = 0; m < filters.size(); m++) {
+                    const FILTER& filter = filters[m];
+                    out[m] = dot(power + filter.first, weights.data() + filter.offset, filter.length);
+                }
+            }
+
+            void dense(REAL_VEC& out) const {
+                /** The filterbank as a mels() x bins() row-major matrix, eg. to compare against librosa **/
+                out.assign(filters.size() * n_bins, 0.0f);
+                for (uint64_t m = 0; m < filters.size(); m++) {
+                    std::copy(weights.begin() + static_cast<int64_t>(filters[m].offset), weights.begin() + static_cast<int64_t>(filters[m].offset + filters[m].length), out.begin() + static_cast<int64_t>(m * n_bins + filters[m].first));
+                }
+            }
+
+            static double mel(const double f, const bool htk) {
+                if (htk) {
+                    return 2595.0 * std::log10(1.0 + f / 700.0);
+                }
+                // Slaney: linear below 1 kHz, logarithmic above
+                return f < 1000.0 ? 3.0 * f / 200.0 : 15.0 + std::log(f / 1000.0) * 27.0 / std::log(6.4);
+            }
+
+            static double hz(const double m, const bool htk) {
+                if (htk) {
+                    return 700.0 * (std::pow(10.0, m / 2595.0) - 1.0);
+                }
+                return m < 15.0 ? 200.0 * m / 3.0 : 1000.0 * std::exp((m - 15.0) * std::log(6.4) / 27.0);
+            }
+
+        private:
+            struct FILTER {
+                uint64_t first;   // First bin with a non-zero weight
+                uint64_t length;  // Number of weights
+                uint64_t offset;  // Into weights
+            };
+
+            uint64_t n_bins;
+            float (*dot)(const float*, const float*, uint64_t);
+            std::vector<FILTER> filters;
+            std::vector<float> weights;
+        };
+
+        class DCT {
+        public:
+            /** Orthonormal DCT-II and its inverse DCT-III (scipy norm="ortho"), O(n log n) through one real FFT of size n **/
+            /** Makhoul's reordering: even samples, then the odd ones reversed, so one spectrum and a twiddle give every output **/
+            typedef std::complex<float> cpx;
+
+            static std::shared_ptr<const DCT> get(const uint64_t n) {
+                static std::mutex lock;
+                static std::unordered_map<uint64_t, std::shared_ptr<const DCT>> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(n);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const DCT>(n);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(n, plan).first->second;
+            }
+
+            explicit DCT(const uint64_t n) : n(n), real(RFFT::get(n)) {
+                twiddles.resize(n);
+                for (uint64_t k = 0; k < n; k++) {
+                    const double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / static_cast<double>(n));
+                    const double angle = -WAVLIB_PI * static_cast<double>(k) / (2.0 * static_cast<double>(n));
+                    twiddles[k] = {static_cast<float>(scale * std::cos(angle)), static_cast<float>(scale * std::sin(angle))};
+                }
+                // Short transforms, eg. 13 cepstra of 40 mels, are cheaper as a matrix product across frames
+                if (n <= 256) {
+                    basis.resize(n * n);
+                    for (uint64_t k = 0; k < n; k++) {
+                        const double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / static_cast<double>(n));
+                        for (uint64_t j = 0; j < n; j++) {
+                            const double angle = WAVLIB_PI * static_cast<double>(k * (2 * j + 1)) / (2.0 * static_cast<double>(n));
+                            basis[k * n + j] = static_cast<float>(scale * std::cos(angle));
+                        }
+                    }
+                }
+            }
+
+            uint64_t size() const {
+                return n;
+            }
+
+            uint64_t scratch_size() const {
+                return (n + 1) / 2 + n / 2 + 1 + real->scratch_size();
+            }
+
+            void forward(const float* in, float* out, cpx* scratch) const {
+                /** DCT-II, out[k] = s_k sum(in[j] cos(pi k (2j + 1) / 2n)), s_0 = sqrt(1 / n), otherwise sqrt(2 / n) **/
+                auto* v = reinterpret_cast<float*>(scratch);
+                cpx* spectrum = scratch + (n + 1) / 2;
+                for (uint64_t j = 0; 2 * j < n; j++) {
+                    v[j] = in[2 * j];
+                }
+                for (uint64_t j = 0; 2 * j + 1 < n; j++) {
+                    v[n - 1 - j] = in[2 * j + 1];
+                }
+                real->forward(v, spectrum, spectrum + n / 2 + 1);
+                // Bins past n / 2 are the conjugates of the ones below
+                for (uint64_t k = 0; 2 * k <= n; k++) {
+                    out[k] = twiddles[k].real() * spectrum[k].real() - twiddles[k].imag() * spectrum[k].imag();
+                }
+                for (uint64_t k = n / 2 + 1; k < n; k++) {
+                    out[k] = twiddles[k].real() * spectrum[n - k].real() + twiddles[k].imag() * spectrum[n - k].imag();
+                }
+            }
+
+            void inverse(const float* in, float* out, cpx* scratch) const {
+                /** DCT-III, the transpose of forward and so its exact inverse **/
+                cpx* spectrum = scratch;
+                auto* v = reinterpret_cast<float*>(scratch + n / 2 + 1);
+                // V[k] = exp(i pi k / 2n) (X[k] - i X[n - k]) / s_k rebuilds the spectrum of the reordered samples, times n
+                spectrum[0] = cpx(twiddles[0].real() * in[0], 0.0f);
+                for (uint64_t k = 1; 2 * k <= n; k++) {
+                    spectrum[k] = 0.5f * CPX::mul(std::conj(twiddles[k]), cpx(in[k], -in[n - k]));
+                }
+                real->inverse(spectrum, v, scratch + n / 2 + 1 + (n + 1) / 2);
+                for (uint64_t j = 0; 2 * j < n; j++) {
+                    out[2 * j] = v[j];
+                }
+                for (uint64_t j = 0; 2 * j + 1 < n; j++) {
+                    out[2 * j + 1] = v[n - 1 - j];
+                }
+            }
+
+            void batch(const float* in, const uint64_t count, float* out, const uint64_t keep) const {
+                /** DCT-II of count frames of size() values, out is count x keep, the first keep coefficients of each **/
+                /** Short transforms run as a matrix product with vector lanes across BLOCK frames, longer ones frame by frame **/
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                // The matrix costs keep x size() per frame, past about 2 / 5 of the coefficients the FFT is cheaper
+                if (basis.empty() || 5 * keep > 2 * n + 64) {
+                    cpx* scratch = workspace.allocate<cpx>(scratch_size());
+                    float* full = workspace.allocate<float>(n);
+                    for (uint64_t t = 0; t < count; t++) {
+                        forward(in + t * n, full, scratch);
+                        std::copy(full, full + keep, out + t * keep);
+                    }
+                    return;
+                }
+                // Frames are transposed so lane f of a vector belongs to frame f of the block
+                float* columns = workspace.allocate<float>(n * BLOCK);
+                float* rows = workspace.allocate<float>(keep * BLOCK);
+                for (uint64_t first = 0; first < count; first += BLOCK) {
+                    const uint64_t frames = std::min<uint64_t>(BLOCK, count - first);
+                    if (frames < BLOCK) {
+                        std::fill(columns, columns + n * BLOCK, 0.0f);
+                    }
+                    for (uint64_t f = 0; f < frames; f++) {
+                        const float* x = in + (first + f) * n;
+                        for (uint64_t j = 0; j < n; j++) {
+                            columns[j * BLOCK + f] = x[j];
+                        }
+                    }
+                    product(columns, keep, rows);
+                    for (uint64_t f = 0; f < frames; f++) {
+                        float* y = out + (first + f) * keep;
+                        for (uint64_t k = 0; k < keep; k++) {
+                            y[k] = rows[k * BLOCK + f];
+                        }
+                    }
+                }
+            }
+
+            void forward(const FORMAT::SPAN<const float> in, REAL_VEC& out) const {
+                out.resize(n);
+                forward(in.data, out.data(), FFT::workspace(scratch_size()));
+            }
+
+            void inverse(const FORMAT::SPAN<const float> in, REAL_VEC& out) const {
+                out.resize(n);
+                inverse(in.data, out.data(), FFT::workspace(scratch_size()));
+            }
+
+        private:
+            static constexpr uint64_t BLOCK = 32;
+
+            void product(const float* columns, const uint64_t keep, float* rows) const {
+                /** rows[k][f] = sum(basis[k][j] columns[j][f]) for a block of frames **/
+#if WAVLIB_X86
+                if (CPU::avx2()) {
+                    for (uint64_t k = 0; k < keep; k++) {
+                        avx2_row(columns, basis.data() + k * n, n, rows + k * BLOCK, std::make_index_sequence<BLOCK / 8>());
+                    }
+                    return;
+                }
+#endif
+                for (uint64_t k = 0; k < keep; k++) {
+                    row(columns, basis.data() + k * n, n, rows + k * BLOCK, std::make_index_sequence<BLOCK / 4>());
+                }
+            }
+
+            template<size_t... G>
+            static void row(const float* columns, const float* weights, const uint64_t n, float* out, std::index_sequence<G...>) {
+                /** One output coefficient for every frame of the block, the folds keep every sum in a register **/
+#if WAVLIB_SSE2
+                __m128 sum[sizeof...(G)] = {((void)G, _mm_setzero_ps())...};
+                for (uint64_t j = 0; j < n; j++) {
+                    const __m128 v = _mm_set1_ps(weights[j]);
+                    const float* column = columns + j * BLOCK;
+                    ((sum[G] = _mm_add_ps(sum[G], _mm_mul_ps(v, _mm_loadu_ps(column + 4 * G)))), ...);
+                }
+                (_mm_storeu_ps(out + 4 * G, sum[G]), ...);
+#elif WAVLIB_NEON
+                float32x4_t sum[sizeof...(G)] = {((void)G, vdupq_n_f32(0.0f))...};
+                for (uint64_t j = 0; j < n; j++) {
+                    const float* column = columns + j * BLOCK;
+                    ((sum[G] = vmlaq_n_f32(sum[G], vld1q_f32(column + 4 * G), weights[j])), ...);
+                }
+                (vst1q_f32(out + 4 * G, sum[G]), ...);
+#else
+                std::fill(out, out + BLOCK, 0.0f);
+                for (uint64_t j = 0; j < n; j++) {
+                    const float* column = columns + j * BLOCK;
+                    for (uint64_t f = 0; f < BLOCK; f++) {
+                        out[f] += weights[j] * column[f];
+                    }
+                }
+#endif
+            }
+
+#if WAVLIB_X86
+            template<size_t... G>
+            WAVLIB_TARGET("avx2") static void avx2_row(const float* columns, const float* weights, const uint64_t n, float* out, std::index_sequence<G...>) {
+                __m256 sum[sizeof...(G)] = {((void)G, _mm256_setzero_ps())...};
+                for (uint64_t j = 0; j < n; j++) {
+                    const __m256 v = _mm256_broadcast_ss(weights + j);
+                    const float* column = columns + j * BLOCK;
+                    ((sum[G] = _mm256_add_ps(sum[G], _mm256_mul_ps(v, _mm256_loadu_ps(column + 8 * G)))), ...);
+                }
+                (_mm256_storeu_ps(out + 8 * G, sum[G]), ...);
+            }
+#endif
+
+            uint64_t n;
+            std::shared_ptr<const RFFT> real;
+            std::vector<cpx> twiddles;  // s_k exp(-i pi k / 2n)
+            REAL_VEC basis;             // size() x size() DCT-II matrix, short sizes only
+        };
+
+        class MDCT {
+        public:
+            /** Inverse MDCT of n / 2 coefficients to n samples through a complex FFT of n / 4 points **/
+            typedef std::complex<float> cpx;
+
+            static std::shared_ptr<const MDCT> get(const uint64_t n) {
+                static std::mutex lock;
+                static std::unordered_map<uint64_t, std::shared_ptr<const MDCT>> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(n);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const MDCT>(n);
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(n, plan).first->second;
+            }
+
+            explicit MDCT(const uint64_t n) : n(n), fft(FFT::get(n / 4)) {
+                twiddles.resize(n / 4);
+                for (uint64_t k = 0; k < n / 4; k++) {
+                    const double angle = 2.0 * WAVLIB_PI * (static_cast<double>(k) + 0.125) / static_cast<double>(n);
+                    twiddles[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+                }
+            }
+
+            uint64_t size() const {
+                return n;
+            }
+
+            uint64_t scratch_size() const {
+                return n / 4 + fft->scratch_size();
+            }
+
+            void inverse(const float* in, float* out, cpx* scratch) const {
+                /** out[j] = sum(in[k] cos(2 pi (j + 1 / 2 + n / 4) (k + 1 / 2) / n)), unscaled **/
+                const uint64_t half = n / 2;
+                const uint64_t quarter = n / 4;
+                cpx* z = scratch;
+                // Even coefficients from the front and odd ones from the back pair up into n / 4 complex values
+                for (uint64_t k = 0; k < quarter; k++) {
+                    z[k] = CPX::mul(cpx(in[half - 1 - 2 * k], in[2 * k]), twiddles[k]);
+                }
+                fft->inverse(z, z, scratch + quarter);
+                for (uint64_t k = 0; k < quarter; k++) {
+                    z[k] = CPX::mul(z[k], twiddles[k]);
+                }
+                float* middle = out + quarter;
+                for (uint64_t k = 0; k < quarter; k++) {
+                    middle[2 * k] = z[k].real();
+                    middle[2 * k + 1] = -z[quarter - 1 - k].imag();
+                }
+                // The first quarter mirrors the second with the sign flipped, the last one mirrors the third
+                for (uint64_t k = 0; k < quarter; k++) {
+                    out[k] = -out[half - 1 - k];
+                    out[n - 1 - k] = out[half + k];
+                }
+            }
+
+        private:
+            uint64_t n;
+            std::shared_ptr<const FFT> fft;
+            std::vector<cpx> twiddles;  // exp(i 2 pi (k + 1 / 8) / n)
+        };
+
+        class WAVELET {
+        public:
+            /** Orthogonal wavelet filter banks, "haar", "db1" to "db20" and "sym2" to "sym20", coefficients as in PyWavelets **/
+            /** Built by spectral factorization of the Daubechies polynomial, db keeps the zeros inside the unit circle **/
+            /** (minimum phase), sym picks the zeros whose phase stays closest to the line between its ends, oriented as **/
+            /** the PyWavelets tables are **/
+            static std::shared_ptr<const WAVELET> get(const std::string& name) {
+                /** nullptr for an unknown name **/
+                unsigned order = 0;
+                bool symlet = false;
+                if (name == "haar") {
+                    order = 1;
+                } else if (name.size() > 2 && name.compare(0, 2, "db") == 0) {
+                    order = number(name.substr(2));
+                } else if (name.size() > 3 && name.compare(0, 3, "sym") == 0) {
+                    order = number(name.substr(3));
+                    symlet = true;
+                }
+                if (order < (symlet ? 2u : 1u) || order > 20) {
+                    return nullptr;
+                }
+                static std::mutex lock;
+                static std::unordered_map<std::string, std::shared_ptr<const WAVELET>> cache;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto it = cache.find(name);
+                    if (it != cache.end()) {
+                        return it->second;
+                    }
+                }
+                auto plan = std::make_shared<const WAVELET>(daubechies(order, symlet));
+                std::lock_guard<std::mutex> guard(lock);
+                return cache.emplace(name, plan).first->second;
+            }
+
+            explicit WAVELET(const std::vector<double>& scaling) {
+                // rec_lo is the scaling filter, the others are its reverse and quadrature mirrors
+                const uint64_t F = scaling.size();
+                lowpass[0].resize(F);
+                highpass[0].resize(F);
+                lowpass[1].resize(F);
+                highpass[1].resize(F);
+                for (uint64_t k = 0; k < F; k++) {
+                    const double h = scaling[F - 1 - k];
+                    lowpass[0][k] = static_cast<float>(h);
+                    lowpass[1][k] = static_cast<float>(scaling[k]);
+                    highpass[1][k] = static_cast<float>(k % 2 == 0 ? h : -h);
+                }
+                for (uint64_t k = 0; k < F; k++) {
+                    highpass[0][k] = highpass[1][F - 1 - k];
+                }
+            }
+
+            uint64_t taps() const {
+                return lowpass[0].size();
+            }
+
+            const std::vector<float>& dec_lo() const {
+                return lowpass[0];
+            }
+
+            const std::vector<float>& dec_hi() const {
+                return highpass[0];
+            }
+
+            const std::vector<float>& rec_lo() const {
+                return lowpass[1];
+            }
+
+            const std::vector<float>& rec_hi() const {
+                return highpass[1];
+            }
+
+            static std::vector<double> daubechies(const unsigned order, const bool symlet) {
+                /** Scaling filter with order vanishing moments, 2 order taps summing to sqrt(2) **/
+                typedef std::complex<double> C;
+                // Roots of P(y) = sum(C(order - 1 + k, k) y^k), y = sin^2(w / 2)
+                std::vector<double> p(order);
+                for (unsigned k = 0; k < order; k++) {
+                    p[k] = k == 0 ? 1.0 : p[k - 1] * static_cast<double>(order - 1 + k) / static_cast<double>(k);
+                }
+                const std::vector<C> y = roots(p);
+
+                // Each real root, or conjugate pair, gives zeros z and 1 / z of which the filter takes one
+                std::vector<std::vector<C>> groups;
+                for (const C& r : y) {
+                    if (std::abs(r.imag()) < 1e-9 * std::max(1.0, std::abs(r))) {
+                        groups.push_back({inside(r.real())});
+                    } else if (r.imag() > 0.0) {
+                        groups.push_back({inside(r), std::conj(inside(r))});
+                    }
+                }
+                const uint64_t choices = symlet ? uint64_t(1) << groups.size() : 1;
+                // The lowest cost always comes as a pair of mirror images. The published symlet tables take the one whose
+                // dec_lo starts with the larger tap, except for these orders, where they take the other one
+                const uint32_t smaller = 1u << 2 | 1u << 3 | 1u << 4 | 1u << 7 | 1u << 8 | 1u << 11 | 1u << 13 | 1u << 19;
+                std::vector<double> best;
+                double cost = 0.0;
+                for (uint64_t mask = 0; mask < choices; mask++) {
+                    std::vector<C> q{1.0};
+                    for (uint64_t g = 0; g < groups.size(); g++) {
+                        const bool flip = (mask >> g & 1) != 0;
+                        for (const C& z : groups[g]) {
+                            q = multiply(q, {1.0, flip ? -1.0 / z : -z});
+                        }
+                    }
+                    // The (1 + z^-1)^order factor has linear phase, only q decides
+                    const double nonlinearity = symlet ? phase(q) : 0.0;
+                    const double tolerance = 1e-9 * std::max(1.0, cost);
+                    if (!best.empty() && nonlinearity > cost + tolerance) {
+                        continue;
+                    }
+                    for (unsigned k = 0; k < order; k++) {
+                        q = multiply(q, {1.0, 1.0});
+                    }
+                    double sum = 0.0;
+                    std::vector<double> h(q.size());
+                    for (uint64_t k = 0; k < q.size(); k++) {
+                        h[k] = q[k].real();
+                        sum += h[k];
+                    }
+                    for (double& tap : h) {
+                        tap *= std::sqrt(2.0) / sum;
+                    }
+                    // dec_lo is h reversed, so its first tap is h.back()
+                    if (!best.empty() && nonlinearity > cost - tolerance && (h.back() < best.back()) != ((smaller >> order & 1) != 0)) {
+                        continue;
+                    }
+                    cost = best.empty() ? nonlinearity : std::min(cost, nonlinearity);
+                    best.swap(h);
+                }
+                return best;
+            }
+
+        private:
+            static unsigned number(const std::string& digits) {
+                if (digits.empty() || digits.size() > 2 || digits.find_first_not_of("0123456789") != std::string::npos) {
+                    return 0;
+                }
+                return static_cast<unsigned>(std::stoul(digits));
+            }
+
+            static std::vector<std::complex<double>> roots(const std::vector<double>& p) {
+                /** All roots of p[0] + p[1] y + ..., Durand-Kerner then a few Newton steps on each **/
+                typedef std::complex<double> C;
+                const uint64_t degree = p.size() - 1;
+                std::vector<C> r(degree);
+                auto evaluate = [&](const C x, C& slope) {
+                    C value = 0.0;
+                    slope = 0.0;
+                    for (uint64_t k = p.size(); k-- > 0;) {
+                        slope = slope * x + value;
+                        value = value * x + p[k];
+                    }
+                    return value;
+                };
+                for (uint64_t i = 0; i < degree; i++) {
+                    r[i] = std::pow(C(0.4, 0.9), static_cast<double>(i));
+                }
+                for (int iteration = 0; iteration < 500; iteration++) {
+                    double step = 0.0;
+                    for (uint64_t i = 0; i < degree; i++) {
+                        C slope;
+                        C denominator = p[degree];
+                        for (uint64_t j = 0; j < degree; j++) {
+                            if (j != i) {
+                                denominator *= r[i] - r[j];
+                            }
+                        }
+                        const C delta = evaluate(r[i], slope) / denominator;
+                        r[i] -= delta;
+                        step = std::max(step, std::abs(delta) / std::max(1.0, std::abs(r[i])));
+                    }
+                    if (step < 1e-15) {
+                        break;
+                    }
+                }
+                for (C& x : r) {
+                    for (int iteration = 0; iteration < 3; iteration++) {
+                        C slope;
+                        const C value = evaluate(x, slope);
+                        if (std::abs(slope) > 0.0) {
+                            x -= value / slope;
+                        }
+                    }
+                }
+                return r;
+            }
+
+            static std::complex<double> inside(const std::complex<double> y) {
+                /** The zero of z^2 - 2 (1 - 2y) z + 1 inside the unit circle, the other one is its inverse **/
+                const std::complex<double> c = 1.0 - 2.0 * y;
+                const std::complex<double> s = std::sqrt(c * c - 1.0);
+                return std::abs(c + s) < 1.0 ? c + s : c - s;
+            }
+
+            static std::vector<std::complex<double>> multiply(const std::vector<std::complex<double>>& a, const std::vector<std::complex<double>>& b) {
+                std::vector<std::complex<double>> out(a.size() + b.size() - 1, 0.0);
+                for (uint64_t i = 0; i < a.size(); i++) {
+                    for (uint64_t j = 0; j < b.size(); j++) {
+                        out[i + j] += a[i] * b[j];
+                    }
+                }
+                return out;
+            }
+
+            static double phase(const std::vector<std::complex<double>>& q) {
+                /** Squared distance of the unwrapped phase of q over (0, pi) from the line through both of its ends **/
+                /** The costs of some orders lie close together, so the grid uses pi in double precision **/
+                const int M = 512;
+                const double pi = std::acos(-1.0);
+                std::complex<double> sum = 0.0;
+                for (const std::complex<double>& c : q) {
+                    sum += c;
+                }
+                std::vector<double> w(M - 1);
+                std::vector<double> angle(M - 1);
+                double previous = 0.0;
+                double turns = 0.0;
+                for (int m = 1; m < M; m++) {
+                    w[m - 1] = pi * m / M;
+                    // Scaled to unit gain at w = 0, so the phase starts at zero whatever the sign of q
+                    std::complex<double> H = 0.0;
+                    for (uint64_t k = q.size(); k-- > 0;) {
+                        H = H * std::polar(1.0, -w[m - 1]) + q[k] / sum;
+                    }
+                    const double a = std::arg(H);
+                    if (m > 1) {
+                        turns += std::round((previous - a) / (2.0 * pi));
+                    }
+                    previous = a;
+                    angle[m - 1] = a + 2.0 * pi * turns;
+                }
+                const double slope = angle[M - 2] / w[M - 2];
+                double cost = 0.0;
+                for (int m = 0; m < M - 1; m++) {
+                    const double e = angle[m] - slope * w[m];
+                    cost += e * e;
+                }
+                return cost;
+            }
+
+            std::vector<float> lowpass[2];   // Decomposition, reconstruction
+            std::vector<float> highpass[2];  // Decomposition, reconstruction
+        };
+    };
+
+    class RESAMPLER {
+    public:
+        /** Streaming sample rate converter for one channel, state is carried across push calls **/
+        /** Output n lines up with input time n * in_rate / out_rate, the filter delay is compensated **/
+        RESAMPLER(const unsigned int in_rate, const unsigned int out_rate, const int zeros = 32, const float beta = 8.6f, const float rolloff = 0.945f)
+            : plan(PLAN::POLYPHASE::get(in_rate, out_rate, zeros, beta, rolloff)) {
+            if (plan) {
+                reset();
+            }
+        }
+
+        bool valid() const {
+            return plan != nullptr;
+        }
+
+        uint64_t max_output(const uint64_t count) const {
+            /** Upper bound of what push(count) or flush() after it writes **/
+            return plan->output_size(consumed + count) - produced;
+        }
+
+        uint64_t push(const float* in, const uint64_t count, float* out) {
+            /** out needs room for max_output(count) samples, returns how many were written **/
+            buffer.insert(buffer.end(), in, in + count);
+            consumed += count;
+            return drain(out, plan->output_size(consumed));
+        }
+
+        uint64_t flush(float* out) {
+            /** Emit the tail, treating everything after the last input as silence **/
+            /** Call reset() before pushing a new stream **/
+            buffer.insert(buffer.end(), plan->half(), 0.0f);
+            return drain(out, plan->output_size(consumed));
+        }
+
+        void reset() {
+            // Everything before the first input is silence
+            buffer.assign(plan->half() - 1, 0.0f);
+            origin = 0;
+            consumed = 0;
+            produced = 0;
+            index = 0;
+            phase = 0;
+        }
+
+    private:
+        uint64_t drain(float* out, const uint64_t limit) {
+            // buffer[k] holds input origin + k - (half - 1)
+            const uint64_t H = plan->half();
+            uint64_t written = 0;
+            while (produced < limit && index + 2 * H - 1 < origin + buffer.size()) {
+                out[written++] = plan->evaluate(buffer.data() + (index - origin), phase);
+                produced++;
+                phase += plan->down();
+                index += phase / plan->up();
+                phase %= plan->up();
+            }
+            // Keep the history the next output still needs
+            const uint64_t drop = std::min<uint64_t>(index - origin, buffer.size());
+            buffer.erase(buffer.begin(), buffer.begin() + static_cast<int64_t>(drop));
+            origin += drop;
+            return written;
+        }
+
+        std::shared_ptr<const PLAN::POLYPHASE> plan;
+        std::vector<float> buffer;
+        uint64_t origin = 0;    // Input index of buffer[half - 1]
+        uint64_t consumed = 0;  // Inputs pushed so far
+        uint64_t produced = 0;  // Outputs written so far
+        uint64_t index = 0;     // floor(produced * down / up)
+        uint64_t phase = 0;     // produced * down % up
+    };
+
+    struct ONLINE {
+        /** Streaming transforms, fed with blocks of any size, no allocations after construction **/
+
+        class STFT {
+        public:
+            /** Real input STFT over a frame_size ring buffer, a frame is emitted every hop_length samples **/
+            /** The ring starts out zeroed, so the first frame arrives after one hop **/
+            /** A window longer than frame_size is cut to its centered frame_size samples, as in SIGNAL::STFT **/
+            STFT(const int frame_size, const int hop_length, const COMPLEX_VEC& window = COMPLEX_VEC(), const bool normalized = false)
+                : n(static_cast<uint64_t>(std::max(frame_size, 1))),
+                  hop(static_cast<uint64_t>(std::min(std::max(hop_length, 1), std::max(frame_size, 1)))),
+                  plan(PLAN::RFFT::get(n)) {
+                const float gain = normalized ? 1.0f / std::sqrt(static_cast<float>(n)) : 1.0f;
+                if (window.empty()) {
+                    taper = SIGNAL::analysis_window(FORMAT::SPAN<const float>(*W::Hann(static_cast<int>(n))), n, gain);
+                } else {
+                    taper = SIGNAL::analysis_window(window, n, gain);
+                }
+                ring.assign(n, 0.0f);
+                frame.assign(n, 0.0f);
+                spectrum.assign(plan->bins(), 0);
+                scratch.assign(plan->scratch_size(), 0);
+            }
+
+            uint64_t bins() const {
+                return plan->bins();
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, uint64_t count, EMIT&& emit) {
+                /** emit(const std::complex<float>* spectrum) is called with bins() values for every completed hop **/
+                uint64_t frames = 0;
+                while (count > 0) {
+                    const uint64_t take = std::min(count, hop - pending);
+                    const uint64_t first = std::min(take, n - head);
+                    std::copy(in, in + first, ring.begin() + static_cast<int64_t>(head));
+                    std::copy(in + first, in + take, ring.begin());
+                    head = (head + take) % n;
+                    pending += take;
+                    in += take;
+                    count -= take;
+                    if (pending == hop) {
+                        pending = 0;
+                        transform();
+                        emit(static_cast<const std::complex<float>*>(spectrum.data()));
+                        frames++;
+                    }
+                }
+                return frames;
+            }
+
+            void reset() {
+                std::fill(ring.begin(), ring.end(), 0.0f);
+                head = 0;
+                pending = 0;
+            }
+
+        private:
+            void transform() {
+                // head is the oldest sample of the ring
+                const uint64_t tail = n - head;
+                for (uint64_t i = 0; i < tail; i++) {
+                    frame[i] = ring[head + i] * taper[i];
+                }
+                for (uint64_t i = tail; i < n; i++) {
+                    frame[i] = ring[i - tail] * taper[i];
+                }
+                plan->forward(frame.data(), spectrum.data(), scratch.data());
+            }
+
+            uint64_t n;
+            uint64_t hop;
+            std::shared_ptr<const PLAN::RFFT> plan;
+            std::vector<float> taper;
+            std::vector<float> ring;
+            std::vector<float> frame;
+            COMPLEX_VEC spectrum;
+            COMPLEX_VEC scratch;
+            uint64_t head = 0;
+            uint64_t pending = 0;
+        };
+
+        class ISTFT {
+        public:
+            /** Online overlap-add, every frame completes hop_length output samples **/
+            /** Output lags the STFT input by frame_size - hop_length samples **/
+            /** A window longer than frame_size is cut to its centered frame_size samples, as in STFT and SIGNAL::STFT **/
+            ISTFT(const int frame_size, const int hop_length, const COMPLEX_VEC& window = COMPLEX_VEC(), const bool normalized = false)
+                : n(static_cast<uint64_t>(std::max(frame_size, 1))),
+                  hop(static_cast<uint64_t>(std::min(std::max(hop_length, 1), std::max(frame_size, 1)))),
+                  plan(PLAN::RFFT::get(n)) {
+                if (window.empty()) {
+                    taper = SIGNAL::analysis_window(FORMAT::SPAN<const float>(*W::Hann(static_cast<int>(n))), n, 1.0f);
+                } else {
+                    taper = SIGNAL::analysis_window(window, n, 1.0f);
+                }
+                scale = (normalized ? std::sqrt(static_cast<float>(n)) : 1.0f) / static_cast<float>(n);
+                // Once the overlap is in steady state, sample i of a hop has seen taper[i + k hop] for every k
+                inverse.assign(hop, 1.0f);
+                for (uint64_t i = 0; i < hop; i++) {
+                    float sum = 0.0f;
+                    for (uint64_t j = i; j < n; j += hop) {
+                        sum += taper[j] * taper[j];
+                    }
+                    inverse[i] = sum > 1e-11f ? 1.0f / sum : 1.0f;
+                }
+                accumulator.assign(n, 0.0f);
+                frame.assign(n, 0.0f);
+                scratch.assign(plan->scratch_size(), 0);
+            }
+
+            uint64_t hop_length() const {
+                return hop;
+            }
+
+            uint64_t push(const std::complex<float>* spectrum, float* out) {
+                /** Add one frame of bins() values and write the hop_length() samples it completes to out **/
+                plan->inverse(spectrum, frame.data(), scratch.data());
+                const uint64_t tail = n - head;
+                for (uint64_t i = 0; i < tail; i++) {
+                    accumulator[head + i] += frame[i] * taper[i] * scale;
+                }
+                for (uint64_t i = tail; i < n; i++) {
+                    accumulator[i - tail] += frame[i] * taper[i] * scale;
+                }
+                for (uint64_t i = 0; i < hop; i++) {
+                    const uint64_t at = (head + i) % n;
+                    out[i] = accumulator[at] * inverse[i];
+                    accumulator[at] = 0.0f;
+                }
+                head = (head + hop) % n;
+                return hop;
+            }
+
+            void reset() {
+                std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+                head = 0;
+            }
+
+        private:
+            uint64_t n;
+            uint64_t hop;
+            std::shared_ptr<const PLAN::RFFT> plan;
+            std::vector<float> taper;
+            std::vector<float> inverse;  // 1 / window-sum per position within a hop
+            float scale = 1.0f;
+            std::vector<float> accumulator;
+            std::vector<float> frame;
+            COMPLEX_VEC scratch;
+            uint64_t head = 0;
+        };
+
+        class MEL {
+        public:
+            /** Mel features of a stream, framed like ONLINE::STFT with a periodic Hann window **/
+            /** A frame of mels() values comes out every hop_length samples **/
+            MEL(const unsigned int sample_rate, const int n_fft = 400, const int hop_length = 160, const int n_mels = 80, const std::string& log = "log10")
+                : stft(n_fft, hop_length),
+                  plan(PLAN::MEL::get(sample_rate, static_cast<uint64_t>(std::max(n_fft, 2)), static_cast<uint64_t>(std::max(n_mels, 1)))) {
+                if (!FEATURE::compression(log, scale)) {
+                    plan = nullptr;
+                }
+                if (plan) {
+                    power.assign(plan->bins(), 0.0f);
+                    features.assign(plan->mels(), 0.0f);
+                }
+            }
+
+            bool valid() const {
+                return plan != nullptr;
+            }
+
+            uint64_t mels() const {
+                return plan ? plan->mels() : 0;
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, const uint64_t count, EMIT&& emit) {
+                /** emit(const float* features) is called with mels() values for every completed hop **/
+                if (!plan) {
+                    return 0;
+                }
+                return stft.push(in, count, [&](const std::complex<float>* spectrum) {
+                    SIGNAL::features(spectrum, *plan, power.data(), scale, features.data());
+                    emit(static_cast<const float*>(features.data()));
+                });
+            }
+
+            void reset() {
+                stft.reset();
+            }
+
+        private:
+            STFT stft;
+            std::shared_ptr<const PLAN::MEL> plan;
+            float scale = 0.0f;
+            std::vector<float> power;
+            std::vector<float> features;
+        };
+
+        class MFCC {
+        public:
+            /** MFCCs of a stream, a frame of coefficients() values comes out every hop_length samples, see SIGNAL::MFCC **/
+            MFCC(const unsigned int sample_rate, const int n_mfcc = 13, const int n_fft = 400, const int hop_length = 160, const int n_mels = 40, const int lifter = 0, const std::string& log = "db")
+                : mel(sample_rate, n_fft, hop_length, n_mels, log) {
+                if (mel.valid() && n_mfcc >= 1 && static_cast<uint64_t>(n_mfcc) <= mel.mels() && lifter >= 0) {
+                    plan = PLAN::DCT::get(mel.mels());
+                    weights = SIGNAL::liftering(static_cast<uint64_t>(n_mfcc), lifter);
+                    scratch.assign(plan->scratch_size(), 0);
+                    cepstrum.assign(plan->size(), 0.0f);
+                    keep = static_cast<uint64_t>(n_mfcc);
+                }
+            }
+
+            bool valid() const {
+                return plan != nullptr;
+            }
+
+            uint64_t coefficients() const {
+                return keep;
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, const uint64_t count, EMIT&& emit) {
+                /** emit(const float* coefficients) is called with coefficients() values for every completed hop **/
+                if (!plan) {
+                    return 0;
+                }
+                return mel.push(in, count, [&](const float* features) {
+                    plan->forward(features, cepstrum.data(), scratch.data());
+                    SIGNAL::lift(cepstrum.data(), 1, weights);
+                    emit(static_cast<const float*>(cepstrum.data()));
+                });
+            }
+
+            void reset() {
+                mel.reset();
+            }
+
+        private:
+            MEL mel;
+            std::shared_ptr<const PLAN::DCT> plan;
+            uint64_t keep = 0;
+            std::vector<float> weights;
+            std::vector<std::complex<float>> scratch;
+            std::vector<float> cepstrum;
+        };
+
+        class DWT {
+        public:
+            /** Multilevel wavelet decomposition of a stream, the bands of SIGNAL::WAVEDEC with mode "zero" over the whole stream **/
+            /** Each level keeps the last few samples it has seen and emits coefficients as soon as their filter is covered **/
+            DWT(const std::string& wavelet = "db4", const int levels = 1) : plan(PLAN::WAVELET::get(wavelet)) {
+                if (!plan || levels < 1 || levels > 30) {
+                    plan = nullptr;
+                    return;
+                }
+                const uint64_t taps = plan->taps();
+                stages.resize(static_cast<uint64_t>(levels));
+                for (STAGE& stage : stages) {
+                    stage.buffer.reserve(BLOCK + 2 * taps);
+                    stage.approx.resize(BLOCK / 2 + taps);
+                    stage.detail.resize(BLOCK / 2 + taps);
+                }
+                zeros.assign(taps - 1, 0.0f);
+                reset();
+            }
+
+            bool valid() const {
+                return plan != nullptr;
+            }
+
+            uint64_t levels() const {
+                return stages.size();
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, const uint64_t count, EMIT&& emit) {
+                /** emit(unsigned level, const float* approx, const float* detail, uint64_t n) gets n new coefficients of both **/
+                /** bands of a level, level 1 is the finest. Returns the number of level 1 coefficients **/
+                if (!plan) {
+                    return 0;
+                }
+                uint64_t emitted = 0;
+                for (uint64_t done = 0; done < count;) {
+                    const uint64_t n = std::min(BLOCK, count - done);
+                    emitted += feed(0, in + done, n, emit);
+                    done += n;
+                }
+                return emitted;
+            }
+
+            template<typename EMIT>
+            uint64_t flush(EMIT&& emit) {
+                /** Ends the stream, zeros past its end complete the last coefficients of every level, then the state is reset **/
+                if (!plan) {
+                    return 0;
+                }
+                uint64_t emitted = 0;
+                for (uint64_t level = 0; level < stages.size(); level++) {
+                    const uint64_t n = feed(level, zeros.data(), zeros.size(), emit);
+                    emitted = level == 0 ? n : emitted;
+                }
+                reset();
+                return emitted;
+            }
+
+            void reset() {
+                // The zero extension in front of the stream, the first filter starts taps - 2 samples early
+                for (STAGE& stage : stages) {
+                    stage.buffer.assign(plan->taps() - 2, 0.0f);
+                }
+            }
+
+        private:
+            static constexpr uint64_t BLOCK = 4096;
+
+            struct STAGE {
+                std::vector<float> buffer;  // Input from the first sample of the next coefficient's filter
+                std::vector<float> approx;
+                std::vector<float> detail;
+            };
+
+            template<typename EMIT>
+            uint64_t feed(const uint64_t level, const float* in, const uint64_t count, EMIT& emit) {
+                STAGE& stage = stages[level];
+                const uint64_t taps = plan->taps();
+                stage.buffer.insert(stage.buffer.end(), in, in + count);
+                const uint64_t size = stage.buffer.size();
+                const uint64_t n = size >= taps ? (size - taps) / 2 + 1 : 0;
+                if (n == 0) {
+                    return 0;
+                }
+                WAVELET::decimate(*plan, stage.buffer.data(), n, stage.approx.data(), stage.detail.data());
+                stage.buffer.erase(stage.buffer.begin(), stage.buffer.begin() + static_cast<int64_t>(2 * n));
+                emit(static_cast<unsigned>(level + 1), static_cast<const float*>(stage.approx.data()), static_cast<const float*>(stage.detail.data()), n);
+                if (level + 1 < stages.size()) {
+                    feed(level + 1, stage.approx.data(), n, emit);
+                }
+                return n;
+            }
+
+            std::shared_ptr<const PLAN::WAVELET> plan;
+            std::vector<STAGE> stages;
+            std::vector<float> zeros;
+        };
+
+        class VOCODER {
+        public:
+            /** Phase vocoder over a onesided STFT stream, rate > 1 shortens and rate < 1 lengthens **/
+            /** Output frame k sits at analysis time k * rate, its magnitudes are interpolated between the two neighbouring **/
+            /** frames. Spectral peaks advance by their measured phase difference and the bins around each peak keep **/
+            /** their analysed phase offset to it (identity phase locking), which avoids the phasiness of plain propagation **/
+            /** Analysis and synthesis share the hop of the surrounding STFT and ISTFT, phase steps are measured between **/
+            /** consecutive frames and carried as unit phasors, so the hop itself never enters and phases are never unwrapped **/
+            VOCODER(const int frame_size, const float rate)
+                : step(rate > 0.0f && std::isfinite(rate) ? rate : 1.0) {
+                const uint64_t bins = static_cast<uint64_t>(std::max(frame_size, 1)) / 2 + 1;
+                magnitude.assign(bins, 0.0f);
+                level.assign(bins, 0.0f);
+                gain.assign(bins, 0.0f);
+                previous.assign(bins, 0);
+                unit.assign(bins, 0);
+                rotation.assign(bins, 0);
+                pending.assign(bins, 0);
+                phasor.assign(bins, 0);
+                frame.assign(bins, 0);
+                peaks.reserve(bins);
+            }
+
+            uint64_t bins() const {
+                return magnitude.size();
+            }
+
+            template<typename EMIT>
+            uint64_t push(const std::complex<float>* spectrum, EMIT&& emit) {
+                /** emit(const std::complex<float>* frame) is called for every output frame this analysis frame completes **/
+                const uint64_t size = bins();
+                for (uint64_t k = 0; k < size; k++) {
+                    level[k] = std::sqrt(std::norm(spectrum[k]));
+                    unit[k] = level[k] > 0.0f ? spectrum[k] / level[k] : std::complex<float>(1.0f, 0.0f);
+                }
+                if (frames++ == 0) {
+                    std::swap(magnitude, level);
+                    std::swap(previous, unit);
+                    return 0;
+                }
+                // Output times in [frames - 2, frames - 1) lie between the previous frame and this one
+                const double last = static_cast<double>(frames - 1);
+                if (time < last) {
+                    for (uint64_t k = 0; k < size; k++) {
+                        rotation[k] = CPX::mul(unit[k], std::conj(previous[k]));
+                    }
+                }
+                uint64_t count = 0;
+                for (; time < last; time += step, count++) {
+                    const auto alpha = static_cast<float>(time - (last - 1.0));
+                    for (uint64_t k = 0; k < size; k++) {
+                        gain[k] = (1.0f - alpha) * magnitude[k] + alpha * level[k];
+                    }
+                    synthesize(alpha < 0.5f ? previous.data() : unit.data());
+                    for (uint64_t k = 0; k < size; k++) {
+                        frame[k] = phasor[k] * gain[k];
+                    }
+                    emit(static_cast<const std::complex<float>*>(frame.data()));
+                    // The step to the next output frame is measured around this one
+                    std::copy(rotation.begin(), rotation.end(), pending.begin());
+                }
+                std::swap(magnitude, level);
+                std::swap(previous, unit);
+                return count;
+            }
+
+            void reset() {
+                frames = 0;
+                outputs = 0;
+                time = 0.0;
+            }
+
+        private:
+            static std::complex<float> normalize(const std::complex<float> z) {
+                const float length = std::sqrt(std::norm(z));
+                return length > 0.0f ? z / length : std::complex<float>(1.0f, 0.0f);
+            }
+
+            void synthesize(const std::complex<float>* reference) {
+                /** Phasors of the next output frame, reference holds the analysed phasors nearest to it **/
+                const uint64_t size = bins();
+                if (outputs++ == 0) {
+                    std::copy(reference, reference + size, phasor.begin());
+                    return;
+                }
+                peaks.clear();
+                for (uint64_t k = 0; k < size; k++) {
+                    const float g = gain[k];
+                    if ((k == 0 || g > gain[k - 1]) && (k + 1 == size || g >= gain[k + 1]) &&
+                        (k < 2 || g >= gain[k - 2]) && (k + 2 >= size || g >= gain[k + 2])) {
+                        peaks.push_back(k);
+                    }
+                }
+                if (peaks.empty()) {
+                    for (uint64_t k = 0; k < size; k++) {
+                        phasor[k] = normalize(CPX::mul(phasor[k], pending[k]));
+                    }
+                    return;
+                }
+                // Every bin follows the nearest peak, regions split halfway between peaks
+                uint64_t k = 0;
+                for (uint64_t i = 0; i < peaks.size(); i++) {
+                    const uint64_t p = peaks[i];
+                    phasor[p] = normalize(CPX::mul(phasor[p], pending[p]));
+                    const std::complex<float> lock = CPX::mul(phasor[p], std::conj(reference[p]));
+                    const uint64_t end = i + 1 < peaks.size() ? (p + peaks[i + 1] + 1) / 2 : size;
+                    for (; k < end; k++) {
+                        if (k != p) {
+                            phasor[k] = CPX::mul(lock, reference[k]);
+                        }
+                    }
+                }
+            }
+
+            double step;                   // Analysis frames per output frame
+            std::vector<float> magnitude;  // Of the previous analysis frame
+            std::vector<float> level;      // Of the latest analysis frame
+            std::vector<float> gain;       // Of the next output frame
+            COMPLEX_VEC previous;          // Unit phasors of the previous analysis frame
+            COMPLEX_VEC unit;              // Unit phasors of the latest analysis frame
+            COMPLEX_VEC rotation;          // Phase step from the previous analysis frame to the latest
+            COMPLEX_VEC pending;           // rotation around the last output frame
+            COMPLEX_VEC phasor;            // Unit phasors of the last output frame
+            COMPLEX_VEC frame;
+            std::vector<uint64_t> peaks;
+            uint64_t frames = 0;           // Analysis frames seen
+            uint64_t outputs = 0;          // Output frames emitted
+            double time = 0.0;             // Analysis time of the next output frame
+        };
+
+        class PV {
+        public:
+            /** Phase vocoder time stretch of interleaved float audio, rate > 1 shortens, pitch is kept **/
+            /** Every channel runs STFT, VOCODER and ISTFT with a periodic Hann window, output is aligned with the input **/
+            PV(const unsigned short channels, const float rate, const int n_fft = 2048, const int hop_length = 512)
+                : step(rate > 0.0f && std::isfinite(rate) ? rate : 1.0f) {
+                const int n = std::max(n_fft, 2);
+                const int h = std::min(std::max(hop_length, 1), n);
+                hop = static_cast<uint64_t>(h);
+                for (unsigned short c = 0; c < channels; c++) {
+                    lanes.emplace_back(n, h, static_cast<float>(step));
+                }
+                skip = lead(static_cast<uint64_t>(n), hop, step);
+                // One analysis frame per hop of input yields at most ceil(1 / rate) output frames
+                const auto most = static_cast<uint64_t>(std::ceil(1.0 / step)) + 1;
+                for (auto& lane : lanes) {
+                    lane.output.assign(most * hop, 0.0f);
+                }
+                input.assign(hop, 0.0f);
+                zeros.assign(hop * channels, 0.0f);
+                block.assign(most * hop * std::max<uint64_t>(channels, 1), 0.0f);
+            }
+
+            static uint64_t lead(const uint64_t n, const uint64_t hop, const double rate) {
+                /** Output samples to drop so that output t lines up with input t * rate, STFT and ISTFT both lag **/
+                const double center = static_cast<double>(n) / 2.0 - static_cast<double>(hop);
+                return static_cast<uint64_t>(std::max(0.0, std::nearbyint(center / rate + static_cast<double>(n) / 2.0)));
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, uint64_t count, EMIT&& emit) {
+                /** emit(const float* samples, uint64_t frames) gets interleaved output as soon as it is complete **/
+                const uint64_t channels = lanes.size();
+                uint64_t produced = 0;
+                consumed += count;
+                while (count > 0 && channels > 0) {
+                    const uint64_t take = std::min(count, hop);
+                    uint64_t length = 0;
+                    for (uint64_t c = 0; c < channels; c++) {
+                        LANE& lane = lanes[c];
+                        for (uint64_t i = 0; i < take; i++) {
+                            input[i] = in[i * channels + c];
+                        }
+                        length = 0;
+                        lane.stft.push(input.data(), take, [&](const std::complex<float>* spectrum) {
+                            lane.vocoder.push(spectrum, [&](const std::complex<float>* frame) {
+                                length += lane.istft.push(frame, lane.output.data() + length);
+                            });
+                        });
+                    }
+                    for (uint64_t i = 0; i < length; i++) {
+                        for (uint64_t c = 0; c < channels; c++) {
+                            block[i * channels + c] = lanes[c].output[i];
+                        }
+                    }
+                    produced += deliver(block.data(), length, emit);
+                    in += take * channels;
+                    count -= take;
+                }
+                return produced;
+            }
+
+            template<typename EMIT>
+            uint64_t flush(EMIT&& emit) {
+                /** Drain the stream so that it holds round(input / rate) frames in total, then reset **/
+                limit = static_cast<uint64_t>(std::nearbyint(static_cast<double>(consumed) / step));
+                uint64_t produced = 0;
+                while (emitted < limit && !lanes.empty()) {
+                    produced += push(zeros.data(), hop, emit);
+                }
+                reset();
+                return produced;
+            }
+
+            void reset() {
+                for (auto& lane : lanes) {
+                    lane.stft.reset();
+                    lane.vocoder.reset();
+                    lane.istft.reset();
+                }
+                consumed = 0;
+                emitted = 0;
+                dropped = 0;
+                limit = UINT64_MAX;
+            }
+
+        private:
+            struct LANE {
+                LANE(const int n, const int hop, const float rate) : stft(n, hop), vocoder(n, rate), istft(n, hop) {}
+
+                STFT stft;
+                VOCODER vocoder;
+                ISTFT istft;
+                std::vector<float> output;
+            };
+
+            template<typename EMIT>
+            uint64_t deliver(const float* samples, uint64_t length, EMIT& emit) {
+                const uint64_t channels = lanes.size();
+                const uint64_t drop = std::min(length, skip - dropped);
+                dropped += drop;
+                samples += drop * channels;
+                length = std::min(length - drop, limit - emitted);
+                if (length > 0) {
+                    emit(samples, length);
+                    emitted += length;
+                }
+                return length;
+            }
+
+            double step;
+            uint64_t hop = 1;
+            std::vector<LANE> lanes;
+            std::vector<float> input;   // One channel of one hop
+            std::vector<float> block;   // Interleaved output of one hop
+            std::vector<float> zeros;
+            uint64_t skip = 0;
+            uint64_t dropped = 0;
+            uint64_t consumed = 0;
+            uint64_t emitted = 0;
+            uint64_t limit = UINT64_MAX;
+        };
+
+        class WSOLA {
+        public:
+            /** Waveform similarity overlap-add time stretch of interleaved float audio, rate > 1 shortens **/
+            /** Each frame is read within tolerance samples of its nominal position, wherever it best continues the **/
+            /** previous frame, found by FFT cross-correlation of the channel mix. tolerance 0 is plain OLA **/
+            WSOLA(const unsigned short channels, const float rate, const int frame_size = 1024, const int hop_length = 512, const int tolerance = 512)
+                : c(channels),
+                  n(static_cast<uint64_t>(std::max(frame_size, 2))),
+                  hop(static_cast<uint64_t>(std::min(std::max(hop_length, 1), std::max(frame_size, 2)))),
+                  range(static_cast<uint64_t>(std::max(tolerance, 0))),
+                  step(rate > 0.0f && std::isfinite(rate) ? rate : 1.0f),
+                  taper(W::Hann(static_cast<int>(n))) {
+                accumulator.assign(n * c, 0.0f);
+                weights.assign(n, 0.0f);
+                block.assign(hop * c, 0.0f);
+                // A frame reaches at most reach samples past the oldest input it still needs, compact() keeps less
+                // than twice that and push() adds at most one hop before the next frame is taken
+                const auto reach = n + 2 * range + hop + static_cast<uint64_t>(std::ceil(static_cast<double>(hop) * step)) + 2;
+                input.reserve((2 * reach + hop) * c);
+                mix.reserve(2 * reach + hop);
+                if (range > 0) {
+                    uint64_t size = 1;
+                    while (size < n + 2 * range) {
+                        size *= 2;
+                    }
+                    plan = PLAN::RFFT::get(size);
+                    pattern.assign(size, 0.0f);
+                    region.assign(size, 0.0f);
+                    left.assign(plan->bins(), 0);
+                    right.assign(plan->bins(), 0);
+                    scratch.assign(plan->scratch_size(), 0);
+                }
+                reset();
+            }
+
+            template<typename EMIT>
+            uint64_t push(const float* in, const uint64_t count, EMIT&& emit) {
+                /** emit(const float* samples, uint64_t frames) gets interleaved output as soon as it is complete **/
+                if (c == 0) {
+                    return 0;
+                }
+                consumed += count;
+                uint64_t produced = 0;
+                // One hop at a time, so the buffers never outgrow what the constructor reserved
+                for (uint64_t first = 0; first < count; first += hop) {
+                    const uint64_t take = std::min(hop, count - first);
+                    const float* chunk = in + first * c;
+                    const uint64_t start = mix.size();
+                    input.insert(input.end(), chunk, chunk + take * c);
+                    mix.resize(start + take);
+                    for (uint64_t i = 0; i < take; i++) {
+                        float sum = 0.0f;
+                        for (uint64_t k = 0; k < c; k++) {
+                            sum += chunk[i * c + k];
+                        }
+                        mix[start + i] = sum;
+                    }
+                    produced += process(emit);
+                }
+                return produced;
+            }
+
+            template<typename EMIT>
+            uint64_t flush(EMIT&& emit) {
+                /** Drain the stream so that it holds round(input / rate) frames in total, then reset **/
+                limit = static_cast<uint64_t>(std::nearbyint(static_cast<double>(consumed) / step));
+                uint64_t produced = 0;
+                while (emitted < limit && c > 0) {
+                    input.resize(input.size() + hop * c, 0.0f);
+                    mix.resize(mix.size() + hop, 0.0f);
+                    produced += process(emit);
+                }
+                reset();
+                return produced;
+            }
+
+            void reset() {
+                // Half a frame of silence in front centers the first frame on sample 0
+                input.assign(n / 2 * c, 0.0f);
+                mix.assign(n / 2, 0.0f);
+                std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+                std::fill(weights.begin(), weights.end(), 0.0f);
+                base = 0;
+                nominal = 0.0;
+                previous = -1;
+                head = 0;
+                dropped = 0;
+                consumed = 0;
+                emitted = 0;
+                limit = UINT64_MAX;
+            }
+
+        private:
+            template<typename EMIT>
+            uint64_t process(EMIT& emit) {
+                /** Overlap-add every frame whose search range is buffered, positions are absolute input indices **/
+                uint64_t produced = 0;
+                const auto span = static_cast<int64_t>(range);
+                while (true) {
+                    const auto target = static_cast<int64_t>(std::nearbyint(nominal));
+                    int64_t need = target + span + static_cast<int64_t>(n);
+                    if (previous >= 0) {
+                        need = std::max(need, previous + static_cast<int64_t>(hop + n));
+                    }
+                    if (need > base + static_cast<int64_t>(mix.size())) {
+                        break;
+                    }
+                    const int64_t position = previous < 0 || range == 0 ? target : search(target);
+                    const float* frame = input.data() + (position - base) * c;
+                    const float* w = taper->data();
+                    for (uint64_t i = 0; i < n; i++) {
+                        const uint64_t at = (head + i) % n;
+                        for (uint64_t k = 0; k < c; k++) {
+                            accumulator[at * c + k] += frame[i * c + k] * w[i];
+                        }
+                        weights[at] += w[i];
+                    }
+                    for (uint64_t i = 0; i < hop; i++) {
+                        const uint64_t at = (head + i) % n;
+                        const float inverse = weights[at] > 1e-3f ? 1.0f / weights[at] : 1.0f;
+                        for (uint64_t k = 0; k < c; k++) {
+                            block[i * c + k] = accumulator[at * c + k] * inverse;
+                            accumulator[at * c + k] = 0.0f;
+                        }
+                        weights[at] = 0.0f;
+                    }
+                    head = (head + hop) % n;
+                    produced += deliver(emit);
+                    previous = position;
+                    nominal += static_cast<double>(hop) * step;
+                    compact();
+                }
+                return produced;
+            }
+
+            int64_t search(const int64_t target) {
+                /** Offset within target +- tolerance whose frame correlates best with the natural continuation **/
+                const int64_t low = std::max<int64_t>(target - static_cast<int64_t>(range), base);
+                const auto candidates = static_cast<uint64_t>(target + static_cast<int64_t>(range) - low + 1);
+                const float* natural = mix.data() + (previous + static_cast<int64_t>(hop) - base);
+                const float* source = mix.data() + (low - base);
+                const float* w = taper->data();
+                for (uint64_t i = 0; i < n; i++) {
+                    pattern[i] = natural[i] * w[i];
+                }
+                std::fill(pattern.begin() + static_cast<int64_t>(n), pattern.end(), 0.0f);
+                const uint64_t length = candidates - 1 + n;
+                std::copy(source, source + length, region.begin());
+                std::fill(region.begin() + static_cast<int64_t>(length), region.end(), 0.0f);
+                plan->forward(pattern.data(), left.data(), scratch.data());
+                plan->forward(region.data(), right.data(), scratch.data());
+                for (uint64_t k = 0; k < left.size(); k++) {
+                    right[k] = CPX::mul(std::conj(left[k]), right[k]);
+                }
+                plan->inverse(right.data(), region.data(), scratch.data());
+                // region[d] = sum_i pattern[i] source[i + d]
+                uint64_t best = 0;
+                for (uint64_t d = 1; d < candidates; d++) {
+                    if (region[d] > region[best]) {
+                        best = d;
+                    }
+                }
+                return low + static_cast<int64_t>(best);
+            }
+
+            template<typename EMIT>
+            uint64_t deliver(EMIT& emit) {
+                // The first half frame of output belongs to the padding in front
+                const uint64_t drop = std::min(hop, n / 2 - dropped);
+                dropped += drop;
+                const uint64_t length = std::min(hop - drop, limit - emitted);
+                if (length > 0) {
+                    emit(static_cast<const float*>(block.data() + drop * c), length);
+                    emitted += length;
+                }
+                return length;
+            }
+
+            void compact() {
+                /** Drop input that no future frame or search can reach, without giving back capacity **/
+                int64_t keep = static_cast<int64_t>(std::nearbyint(nominal)) - static_cast<int64_t>(range);
+                keep = std::max(std::min(keep, previous + static_cast<int64_t>(hop)), base);
+                const auto dead = static_cast<uint64_t>(keep - base);
+                if (dead == 0 || dead * 2 < mix.size()) {
+                    return;
+                }
+                input.erase(input.begin(), input.begin() + static_cast<int64_t>(dead * c));
+                mix.erase(mix.begin(), mix.begin() + static_cast<int64_t>(dead));
+                base = keep;
+            }
+
+            uint64_t c;
+            uint64_t n;
+            uint64_t hop;
+            uint64_t range;
+            double step;
+            std::shared_ptr<const REAL_VEC> taper;
+            std::shared_ptr<const PLAN::RFFT> plan;
+            std::vector<float> input;        // Interleaved input from base on
+            std::vector<float> mix;          // Channel sum from base on
+            std::vector<float> accumulator;  // Interleaved overlap-add ring of one frame
+            std::vector<float> weights;      // Window sum of the ring
+            std::vector<float> block;        // Interleaved output of one hop
+            std::vector<float> pattern;
+            std::vector<float> region;
+            COMPLEX_VEC left;
+            COMPLEX_VEC right;
+            COMPLEX_VEC scratch;
+            int64_t base = 0;                // Input index of input[0]
+            double nominal = 0.0;            // Nominal input index of the next frame
+            int64_t previous = -1;           // Input index of the last frame
+            uint64_t head = 0;
+            uint64_t dropped = 0;
+            uint64_t consumed = 0;
+            uint64_t emitted = 0;
+            uint64_t limit = UINT64_MAX;
+        };
+    };
+
+    struct PROFILE {
+        /** Per-stage timers and I/O counters, compiled in only with -DWAVLIB_PROFILE **/
+        /** Every thread aggregates into its own block, snapshot() sums them up **/
+        enum COUNTER {
+            BYTES_READ,
+            BYTES_WRITTEN,
+            SAMPLES_DECODED,
+            SAMPLES_ENCODED,
+            ALLOCATIONS,
+            SYSCALLS,
+            COUNTERS
+        };
+
+#ifdef WAVLIB_PROFILE
+        static constexpr bool enabled = true;
+#else
+        static constexpr bool enabled = false;
+#endif
+        static constexpr unsigned max_stages = 128;
+        static constexpr uint64_t max_events = 1 << 20;  // Trace events kept per thread
+
+        struct STAGE {
+            std::string name;
+            uint64_t calls = 0;
+            uint64_t nanoseconds = 0;  // Inclusive of nested stages
+        };
+
+        struct SNAPSHOT {
+            std::array<uint64_t, COUNTERS> counters{};
+            std::vector<STAGE> stages;  // Only stages that ran
+
+            uint64_t operator[](const COUNTER counter) const {
+                return counters[counter];
+            }
+
+            const STAGE* stage(const std::string& name) const {
+                for (const STAGE& s : stages) {
+                    if (s.name == name) {
+                        return &s;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        class SCOPE {
+        public:
+            /** Times its own lifetime, see WAVLIB_SCOPE **/
+            explicit SCOPE(const unsigned id) : id(id), start(now()) {}
+            SCOPE(const SCOPE&) = delete;
+            SCOPE& operator=(const SCOPE&) = delete;
+
+            ~SCOPE() {
+                finish(id, start, now());
+            }
+
+        private:
+            unsigned id;
+            uint64_t start;
+        };
+
+        static unsigned stage(const char* name) {
+            /** Id of a named stage, each WAVLIB_SCOPE call site asks once **/
+            REGISTRY& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (unsigned i = 0; i < r.names.size(); i++) {
+                if (r.names[i] == name) {
+                    return i;
+                }
+            }
+            r.names.emplace_back(name);
+            return static_cast<unsigned>(r.names.size() - 1);
+        }
+
+        static void count(const COUNTER counter, const uint64_t n) {
+            // Only this thread writes its block, so a plain load and store is enough
+            std::atomic<uint64_t>& value = local().counters[counter];
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        static SNAPSHOT snapshot() {
+            /** Totals over every thread that has run an instrumented stage so far **/
+            SNAPSHOT out;
+            REGISTRY& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            std::vector<STAGE> stages(r.names.size());
+            for (const auto& block : r.threads) {
+                for (unsigned c = 0; c < COUNTERS; c++) {
+                    out.counters[c] += block->counters[c].load(std::memory_order_relaxed);
+                }
+                for (unsigned i = 0; i < stages.size() && i < max_stages; i++) {
+                    stages[i].calls += block->calls[i].load(std::memory_order_relaxed);
+                    stages[i].nanoseconds += block->nanoseconds[i].load(std::memory_order_relaxed);
+                }
+            }
+            for (unsigned i = 0; i < stages.size(); i++) {
+                if (stages[i].calls != 0) {
+                    stages[i].name = r.names[i];
+                    out.stages.push_back(std::move(stages[i]));
+                }
+            }
+            return out;
+        }
+
+        static void reset() {
+            /** Zero all counters and drop recorded events, call it while no stage is running **/
+            REGISTRY& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (const auto& block : r.threads) {
+                for (auto& value : block->counters) {
+                    value.store(0, std::memory_order_relaxed);
+                }
+                for (unsigned i = 0; i < max_stages; i++) {
+                    block->calls[i].store(0, std::memory_order_relaxed);
+                    block->nanoseconds[i].store(0, std::memory_order_relaxed);
+                }
+                std::lock_guard<std::mutex> events(block->mutex);
+                block->events.clear();
+            }
+            r.origin = now();
+        }
+
+        static void record(const bool on) {
+            /** Keep every stage as a trace event for trace(), off by default **/
+            registry().tracing.store(on, std::memory_order_relaxed);
+        }
+
+        static bool trace(const std::string& filename) {
+            /** Recorded events as Chrome trace JSON, opens in chrome://tracing and Perfetto **/
+            std::ofstream file(filename, std::ios::binary);
+            if (!file.is_open()) {
+                return false;
+            }
+            trace(file);
+            return static_cast<bool>(file);
+        }
+
+        static void trace(std::ostream& out) {
+            REGISTRY& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            auto micros = [&r](const uint64_t t) {
+                return static_cast<double>(t > r.origin ? t - r.origin : 0) / 1000.0;
+            };
+            char number[32];
+            uint64_t last = r.origin;
+            out << "{\"traceEvents\":[";
+            const char* separator = "\n";
+            for (const auto& block : r.threads) {
+                out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << block->thread
+                    << ",\"args\":{\"name\":\"wavlib " << block->thread << "\"}}";
+                separator = ",\n";
+                std::lock_guard<std::mutex> events(block->mutex);
+                for (const EVENT& event : block->events) {
+                    out << separator << "{\"name\":";
+                    quote(out, r.names[event.id]);
+                    std::snprintf(number, sizeof(number), "%.3f", micros(event.start));
+                    out << ",\"cat\":\"wavlib\",\"ph\":\"X\",\"pid\":1,\"tid\":" << block->thread << ",\"ts\":" << number;
+                    std::snprintf(number, sizeof(number), "%.3f", static_cast<double>(event.end - event.start) / 1000.0);
+                    out << ",\"dur\":" << number << "}";
+                    last = std::max(last, event.end);
+                }
+            }
+            // Totals as one counter sample at the end of the trace
+            std::array<uint64_t, COUNTERS> totals{};
+            for (const auto& block : r.threads) {
+                for (unsigned c = 0; c < COUNTERS; c++) {
+                    totals[c] += block->counters[c].load(std::memory_order_relaxed);
+                }
+            }
+            std::snprintf(number, sizeof(number), "%.3f", micros(last));
+            out << separator << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << number << ",\"args\":{";
+            for (unsigned c = 0; c < COUNTERS; c++) {
+                out << (c ? "," : "") << "\"" << name(static_cast<COUNTER>(c)) << "\":" << totals[c];
+            }
+            out << "}}\n],\"displayTimeUnit\":\"ns\"}\n";
+        }
+
+        static const char* name(const COUNTER counter) {
+            switch (counter) {
+                case BYTES_READ: return "bytes_read";
+                case BYTES_WRITTEN: return "bytes_written";
+                case SAMPLES_DECODED: return "samples_decoded";
+                case SAMPLES_ENCODED: return "samples_encoded";
+                case ALLOCATIONS: return "allocations";
+                case SYSCALLS: return "syscalls";
+                default: return "unknown";
+            }
+        }
+
+    private:
+        struct EVENT {
+            unsigned id;
+            uint64_t start;
+            uint64_t end;
+        };
+
+        struct LOCAL {
+            unsigned thread = 0;
+            std::array<std::atomic<uint64_t>, COUNTERS> counters{};
+            std::array<std::atomic<uint64_t>, max_stages> calls{};
+            std::array<std::atomic<uint64_t>, max_stages> nanoseconds{};
+            std::mutex mutex;  // Guards events, only contended while trace() runs
+            std::vector<EVENT> events;
+        };
+
+        struct REGISTRY {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<LOCAL>> threads;  // Kept after a thread exits, its numbers still count
+            std::vector<std::string> names;
+            std::atomic<bool> tracing{false};
+            uint64_t origin = now();
+        };
+
+        static REGISTRY& registry() {
+            static REGISTRY r;
+            return r;
+        }
+
+        static LOCAL& local() {
+            static thread_local std::shared_ptr<LOCAL> block = [] {
+                auto created = std::make_shared<LOCAL>();
+                REGISTRY& r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                created->thread = static_cast<unsigned>(r.threads.size());
+                r.threads.push_back(created);
+                return created;
+            }();
+            return *block;
+        }
+
+        static uint64_t now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        static void finish(const unsigned id, const uint64_t start, const uint64_t end) {
+            if (id >= max_stages) {
+                return;
+            }
+            LOCAL& block = local();
+            block.calls[id].store(block.calls[id].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            block.nanoseconds[id].store(block.nanoseconds[id].load(std::memory_order_relaxed) + (end - start), std::memory_order_relaxed);
+            if (registry().tracing.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(block.mutex);
+                if (block.events.size() < max_events) {
+                    block.events.push_back(EVENT{id, start, end});
+                }
+            }
+        }
+
+        static void quote(std::ostream& out, const std::string& text) {
+            out << '"';
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+            out << '"';
+        }
+    };
+
+private:
+    struct endian {
+        static void flipEndianness(char* data, unsigned int length) {
+            std::reverse(data, data + length);
+        }
+
+        static bool LittleEndian() {
+            union one {
+                int value;
+                char byte[sizeof(int)];
+            };
+
+            one tester{};
+            tester.value = 1;
+            return tester.byte[0] == 1;
+        }
+
+        static bool isLittleEndian() {
+            static bool system = LittleEndian();
+            return system;
+        }
+    };
+
+    struct integer {
+        static int16_t char_2_int16(const char* data, const uint64_t length = 2, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (needSwap || length < 2) {
+                char buffer[2] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (2 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (2 - length), buffer + 2);
+                }
+                return *reinterpret_cast<const int16_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const int16_t*>(data);
+        }
+
+        static uint16_t char_2_uint16(const char* data, const uint64_t length = 2, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (needSwap || length < 2) {
+                char buffer[2] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (2 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (2 - length), buffer + 2);
+                }
+                return *reinterpret_cast<const uint16_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const uint16_t*>(data);
+        }
+
+        static int32_t char_2_int32(const char* data, const uint64_t length = 4, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (length == 2) {
+                return static_cast<int32_t>(char_2_int16(data, 2, LittleEndian));
+            }
+
+            if (needSwap || length < 4) {
+                char buffer[4] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (4 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (4 - length), buffer + 4);
+                }
+                return *reinterpret_cast<const int32_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const int32_t*>(data);
+        }
+
+        static uint32_t char_2_uint32(const char* data, const uint64_t length = 4, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (length == 2) {
+                return static_cast<uint32_t>(char_2_uint16(data, 2, LittleEndian));
+            }
+
+            if (needSwap || length < 4) {
+                char buffer[4] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (4 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (4 - length), buffer + 4);
+                }
+                return *reinterpret_cast<const uint32_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const uint32_t*>(data);
+        }
+
+        static int64_t char_2_int64(const char* data, const uint64_t length = 8, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (length == 2) {
+                return static_cast<int64_t>(char_2_int16(data, 2, LittleEndian));
+            } else if (length == 4) {
+                return static_cast<int64_t>(char_2_int32(data, 4, LittleEndian));
+            }
+
+            if (needSwap || length < 8) {
+                char buffer[8] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (8 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (8 - length), buffer + 8);
+                }
+                return *reinterpret_cast<const int64_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const int64_t*>(data);
+        }
+
+        static uint64_t char_2_uint64(const char* data, const uint64_t length = 8, const bool LittleEndian = true) {
+            bool needSwap = endian::isLittleEndian() != LittleEndian;
+
+            if (length == 2) {
+                return static_cast<uint64_t>(char_2_uint16(data, 2, LittleEndian));
+            } else if (length == 4) {
+                return static_cast<uint64_t>(char_2_uint32(data, 4, LittleEndian));
+            }
+
+            if (needSwap || length < 8) {
+                char buffer[8] = {0};
+                std::copy(data, data + length, LittleEndian ? buffer : buffer + (8 - length));
+                if (needSwap && length > 1) {
+                    LittleEndian ? std::reverse(buffer, buffer + length) : std::reverse(buffer + (8 - length), buffer + 8);
+                }
+                return *reinterpret_cast<const uint64_t*>(buffer);
+            }
+
+            return *reinterpret_cast<const uint64_t*>(data);
+        }
+
+        template<typename T>
+        static typename FORMAT::VIEW<T>::value_type load(const char* data) {
+            /** Read one little-endian sample of native type T, without alignment requirements **/
+            const auto* p = reinterpret_cast<const unsigned char*>(data);
+            if constexpr (std::is_same<T, uint8_t>::value) {
+                return p[0];
+            } else if constexpr (std::is_same<T, int16_t>::value) {
+                return static_cast<int16_t>(static_cast<uint16_t>(p[0] | (p[1] << 8)));
+            } else if constexpr (std::is_same<T, FORMAT::INT24>::value) {
+                return static_cast<int32_t>(static_cast<uint32_t>(p[0] << 8 | p[1] << 16 | static_cast<uint32_t>(p[2]) << 24)) >> 8;
+            } else if constexpr (std::is_same<T, int32_t>::value) {
+                return static_cast<int32_t>(p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24);
+            } else if constexpr (std::is_same<T, float>::value) {
+                uint32_t bits = p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            } else {
+                static_assert(std::is_same<T, double>::value, "Unsupported sample type");
+                uint64_t bits = static_cast<uint32_t>(p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24) |
+                                static_cast<uint64_t>(p[4] | p[5] << 8 | p[6] << 16 | static_cast<uint32_t>(p[7]) << 24) << 32;
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return value;
+            }
+        }
+    };
+
+    struct character {
+        /*Convert integer to char array*/
+        template<typename integer>
+        static void int2Char(const integer& data, char* out, const bool LittleEndian = true) {
+            const char* p = reinterpret_cast<const char*>(&data);
+            std::copy(p, p + sizeof(decltype(data)), out);
+            if (endian::isLittleEndian() != LittleEndian) {
+                endian::flipEndianness(out, sizeof(decltype(data)));
+            }
+        }
+    };
+
+    struct CPU {
+        /** Runtime instruction set detection, evaluated once **/
+#if WAVLIB_X86
+        static bool avx2() {
+            static const bool supported = [] {
+#if defined(_MSC_VER) && !defined(__clang__)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7) {
+                    return false;
+                }
+                __cpuid(info, 1);
+                if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+                    return false;
+                }
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                return __builtin_cpu_supports("avx2") != 0;
+#endif
+            }();
+            return supported;
+        }
+
+        static bool ssse3() {
+            static const bool supported = [] {
+#if defined(_MSC_VER) && !defined(__clang__)
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 9)) != 0;
+#else
+                return __builtin_cpu_supports("ssse3") != 0;
+#endif
+            }();
+            return supported;
+        }
+#else
+        static bool avx2() {
+            return false;
+        }
+
+        static bool ssse3() {
+            return false;
+        }
+#endif
+    };
+
+    struct PCM {
+        static_assert(std::is_same<int, int32_t>::value, "FORMAT::WAV::audio is decoded as int32_t");
+
+        /** Bulk conversion between packed little-endian PCM and int32/float32 **/
+        /** int32 keeps the native range of the format: 8-bit stays unsigned, float is scaled to the 32-bit range **/
+        /** float32 is normalized to [-1, 1) **/
+
+        static FORMAT::SAMPLE type(const unsigned short format, const unsigned short sample_size) {
+            /** Sample type of a format tag, UNKNOWN for anything but PCM (1) and IEEE float (3), e.g. mu-law or ADPCM **/
+            if (format == 3) {
+                return sample_size == 32 ? FORMAT::SAMPLE::F32 : sample_size == 64 ? FORMAT::SAMPLE::F64 : FORMAT::SAMPLE::UNKNOWN;
+            }
+            if (format != 1) {
+                return FORMAT::SAMPLE::UNKNOWN;
+            }
+            switch (sample_size) {
+                case 8: return FORMAT::SAMPLE::U8;
+                case 16: return FORMAT::SAMPLE::S16;
+                case 24: return FORMAT::SAMPLE::S24;
+                case 32: return FORMAT::SAMPLE::S32;
+                default: return FORMAT::SAMPLE::UNKNOWN;
+            }
+        }
+
+        static uint64_t bytes(const FORMAT::SAMPLE type) {
+            switch (type) {
+                case FORMAT::SAMPLE::U8: return 1;
+                case FORMAT::SAMPLE::S16: return 2;
+                case FORMAT::SAMPLE::S24: return 3;
+                case FORMAT::SAMPLE::S32: return 4;
+                case FORMAT::SAMPLE::F32: return 4;
+                case FORMAT::SAMPLE::F64: return 8;
+                default: return 0;
+            }
+        }
+
+        static float scale(const FORMAT::SAMPLE type) {
+            /** Integer full scale, float32 = (int32 - offset) * scale **/
+            switch (type) {
+                case FORMAT::SAMPLE::U8: return 1.0f / 128.0f;
+                case FORMAT::SAMPLE::S16: return 1.0f / 32768.0f;
+                case FORMAT::SAMPLE::S24: return 1.0f / 8388608.0f;
+                case FORMAT::SAMPLE::S32: return 1.0f / 2147483648.0f;
+                default: return 1.0f;
+            }
+        }
+
+        static void decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, int32_t* out) {
+            WAVLIB_SCOPE("PCM::decode");
+            WAVLIB_COUNT(SAMPLES_DECODED, count);
+            if (type == FORMAT::SAMPLE::S32 && endian::isLittleEndian()) {
+                std::memcpy(out, in, count * 4);
+                return;
+            }
+            uint64_t i = 0;
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                i = avx2_decode(in, count, type, out);
+            } else if (CPU::ssse3()) {
+                i = ssse3_decode(in, count, type, out);
+            }
+#elif WAVLIB_NEON
+            i = neon_decode(in, count, type, out);
+#endif
+            scalar_decode(in + i * bytes(type), count - i, type, out + i);
+        }
+
+        static void decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, float* out) {
+            WAVLIB_SCOPE("PCM::decode");
+            WAVLIB_COUNT(SAMPLES_DECODED, count);
+            if (type == FORMAT::SAMPLE::F32 && endian::isLittleEndian()) {
+                std::memcpy(out, in, count * 4);
+                return;
+            }
+            uint64_t i = 0;
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                i = avx2_decode(in, count, type, out);
+            } else if (CPU::ssse3()) {
+                i = ssse3_decode(in, count, type, out);
+            }
+#elif WAVLIB_NEON
+            i = neon_decode(in, count, type, out);
+#endif
+            scalar_decode(in + i * bytes(type), count - i, type, out + i);
+        }
+
+        static void encode(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            /** Integer formats keep the low bytes of each sample **/
+            WAVLIB_SCOPE("PCM::encode");
+            WAVLIB_COUNT(SAMPLES_ENCODED, count);
+            pack(in, count, type, out);
+        }
+
+        static void encode(const float* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            /** Integer formats are rounded and clipped to their full scale **/
+            WAVLIB_SCOPE("PCM::encode");
+            WAVLIB_COUNT(SAMPLES_ENCODED, count);
+            if (type == FORMAT::SAMPLE::F32 && endian::isLittleEndian()) {
+                std::memcpy(out, in, count * 4);
+                return;
+            }
+            if (type == FORMAT::SAMPLE::F64) {
+                for (uint64_t i = 0; i < count; i++) {
+                    store(static_cast<double>(in[i]), out + i * 8);
+                }
+                return;
+            }
+            // Quantize into a cache-resident block, then pack like int32
+            int32_t block[1024];
+            const uint64_t width = bytes(type);
+            for (uint64_t i = 0; i < count; i += 1024) {
+                const uint64_t n = std::min(static_cast<uint64_t>(1024), count - i);
+                quantize(in + i, n, type, block);
+                pack(block, n, type, out + i * width);
+            }
+        }
+
+    private:
+        static void pack(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            /** The int32 encode without its scope, so the float encode isn't timed twice **/
+            if (type == FORMAT::SAMPLE::S32 && endian::isLittleEndian()) {
+                std::memcpy(out, in, count * 4);
+                return;
+            }
+            uint64_t i = 0;
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                i = avx2_encode(in, count, type, out);
+            } else if (CPU::ssse3()) {
+                i = ssse3_encode(in, count, type, out);
+            }
+#elif WAVLIB_NEON
+            i = neon_encode(in, count, type, out);
+#endif
+            scalar_encode(in + i, count - i, type, out + i * bytes(type));
+        }
+
+        static int32_t saturate(double value) {
+            if (value >= 2147483647.0) {
+                return INT32_MAX;
+            }
+            if (value <= -2147483648.0) {
+                return INT32_MIN;
+            }
+            return static_cast<int32_t>(std::lrint(value));
+        }
+
+        template<typename T>
+        static void store(T value, char* out) {
+            /** Write one little-endian value regardless of the host byte order **/
+            typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type bits;
+            std::memcpy(&bits, &value, sizeof(T));
+            for (uint64_t k = 0; k < sizeof(T); k++) {
+                out[k] = static_cast<char>((bits >> (8 * k)) & 0xFF);
+            }
+        }
+
+        static void quantize(const float* in, const uint64_t count, const FORMAT::SAMPLE type, int32_t* out) {
+            const double full = 1.0 / scale(type);
+            const double low = type == FORMAT::SAMPLE::U8 ? -128.0 : -full;
+            const double high = type == FORMAT::SAMPLE::U8 ? 127.0 : full - 1.0;
+            const int32_t offset = type == FORMAT::SAMPLE::U8 ? 128 : 0;
+            uint64_t i = 0;
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                i = avx2_quantize(in, count, static_cast<float>(full), static_cast<float>(low), static_cast<float>(high), offset, out);
+            }
+#endif
+            for (; i < count; i++) {
+                out[i] = saturate(std::min(std::max(static_cast<double>(in[i]) * full, low), high)) + offset;
+            }
+        }
+
+        template<typename OUT>
+        static void scalar_decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, OUT* out) {
+            const bool to_float = std::is_same<OUT, float>::value;
+            const float factor = scale(type);
+            switch (type) {
+                case FORMAT::SAMPLE::U8:
+                    for (uint64_t i = 0; i < count; i++) {
+                        int32_t value = integer::load<uint8_t>(in + i);
+                        out[i] = to_float ? static_cast<OUT>(static_cast<float>(value - 128) * factor) : static_cast<OUT>(value);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S16:
+                    for (uint64_t i = 0; i < count; i++) {
+                        out[i] = static_cast<OUT>(integer::load<int16_t>(in + i * 2) * (to_float ? factor : 1.0f));
+                    }
+                    break;
+                case FORMAT::SAMPLE::S24:
+                    for (uint64_t i = 0; i < count; i++) {
+                        int32_t value = integer::load<FORMAT::INT24>(in + i * 3);
+                        out[i] = to_float ? static_cast<OUT>(static_cast<float>(value) * factor) : static_cast<OUT>(value);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S32:
+                    for (uint64_t i = 0; i < count; i++) {
+                        int32_t value = integer::load<int32_t>(in + i * 4);
+                        out[i] = to_float ? static_cast<OUT>(static_cast<float>(value) * factor) : static_cast<OUT>(value);
+                    }
+                    break;
+                case FORMAT::SAMPLE::F32:
+                    for (uint64_t i = 0; i < count; i++) {
+                        float value = integer::load<float>(in + i * 4);
+                        out[i] = to_float ? static_cast<OUT>(value) : static_cast<OUT>(saturate(value * 2147483648.0));
+                    }
+                    break;
+                case FORMAT::SAMPLE::F64:
+                    for (uint64_t i = 0; i < count; i++) {
+                        double value = integer::load<double>(in + i * 8);
+                        out[i] = to_float ? static_cast<OUT>(value) : static_cast<OUT>(saturate(value * 2147483648.0));
+                    }
+                    break;
+                default:
+                    std::fill(out, out + count, static_cast<OUT>(0));
+                    break;
+            }
+        }
+
+        static void scalar_encode(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            const uint64_t width = bytes(type);
+            switch (type) {
+                case FORMAT::SAMPLE::F32:
+                    for (uint64_t i = 0; i < count; i++) {
+                        store(static_cast<float>(in[i] / 2147483648.0), out + i * 4);
+                    }
+                    break;
+                case FORMAT::SAMPLE::F64:
+                    for (uint64_t i = 0; i < count; i++) {
+                        store(in[i] / 2147483648.0, out + i * 8);
+                    }
+                    break;
+                default:
+                    for (uint64_t i = 0; i < count; i++) {
+                        const auto value = static_cast<uint32_t>(in[i]);
+                        for (uint64_t k = 0; k < width; k++) {
+                            out[i * width + k] = static_cast<char>((value >> (8 * k)) & 0xFF);
+                        }
+                    }
+                    break;
+            }
+        }
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static void avx2_store(const __m256i value, const __m256, int32_t* out) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), value);
+        }
+
+        WAVLIB_TARGET("avx2") static void avx2_store(const __m256i value, const __m256 factor, float* out) {
+            _mm256_storeu_ps(out, _mm256_mul_ps(_mm256_cvtepi32_ps(value), factor));
+        }
+
+        template<typename OUT>
+        WAVLIB_TARGET("avx2") static uint64_t avx2_decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, OUT* out) {
+            const bool to_float = std::is_same<OUT, float>::value;
+            const __m256 factor = _mm256_set1_ps(scale(type));
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8: {
+                    const __m256i bias = _mm256_set1_epi32(to_float ? 128 : 0);
+                    for (; i + 8 <= count; i += 8) {
+                        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+                        avx2_store(_mm256_sub_epi32(v, bias), factor, out + i);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S16:
+                    for (; i + 8 <= count; i += 8) {
+                        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2)));
+                        avx2_store(v, factor, out + i);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S24: {
+                    // Move bytes 12..27 into the upper lane, then place each sample in the top 3 bytes of a lane
+                    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+                    const __m256i shuffle = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                                                             -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+                    // Each load reads 32 bytes for 24 bytes of samples
+                    for (; i + 11 <= count; i += 8) {
+                        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 3));
+                        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, lanes), shuffle);
+                        avx2_store(_mm256_srai_epi32(v, 8), factor, out + i);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S32:
+                    for (; i + 8 <= count; i += 8) {
+                        avx2_store(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 4)), factor, out + i);
+                    }
+                    break;
+                case FORMAT::SAMPLE::F32:
+                    if (!to_float) {
+                        // Overflow converts to INT32_MIN, flipping those lanes gives INT32_MAX
+                        const __m256 full = _mm256_set1_ps(2147483648.0f);
+                        for (; i + 8 <= count; i += 8) {
+                            __m256 v = _mm256_mul_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(in + i * 4)), full);
+                            __m256i overflow = _mm256_castps_si256(_mm256_cmp_ps(v, full, _CMP_GE_OQ));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(_mm256_cvtps_epi32(v), overflow));
+                        }
+                    }
+                    break;
+                case FORMAT::SAMPLE::F64:
+                    if (to_float) {
+                        for (; i + 4 <= count; i += 4) {
+                            _mm_storeu_ps(reinterpret_cast<float*>(out + i), _mm256_cvtpd_ps(_mm256_loadu_pd(reinterpret_cast<const double*>(in + i * 8))));
+                        }
+                    } else {
+                        const __m256d full = _mm256_set1_pd(2147483648.0);
+                        const __m256d high = _mm256_set1_pd(2147483647.0);
+                        for (; i + 4 <= count; i += 4) {
+                            __m256d v = _mm256_min_pd(_mm256_mul_pd(_mm256_loadu_pd(reinterpret_cast<const double*>(in + i * 8)), full), high);
+                            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtpd_epi32(v));
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return i;
+        }
+
+        WAVLIB_TARGET("avx2") static uint64_t avx2_encode(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8: {
+                    const __m256i shuffle = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                             0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+                    const __m256i lanes = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+                    for (; i + 8 <= count; i += 8) {
+                        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), shuffle);
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, lanes)));
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S16: {
+                    const __m256i shuffle = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                             0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+                    for (; i + 8 <= count; i += 8) {
+                        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), shuffle);
+                        v = _mm256_permute4x64_epi64(v, 0x08);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm256_castsi256_si128(v));
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S24: {
+                    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+                    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+                    // Each store writes 32 bytes for 24 bytes of samples, the next store overwrites the rest
+                    for (; i + 11 <= count; i += 8) {
+                        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), shuffle);
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 3), _mm256_permutevar8x32_epi32(v, lanes));
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::F32: {
+                    const __m256 factor = _mm256_set1_ps(1.0f / 2147483648.0f);
+                    for (; i + 8 <= count; i += 8) {
+                        __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i))), factor);
+                        _mm256_storeu_ps(reinterpret_cast<float*>(out + i * 4), v);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            return i;
+        }
+
+        WAVLIB_TARGET("avx2") static uint64_t avx2_quantize(const float* in, const uint64_t count, const float full, const float low, const float high, const int32_t offset, int32_t* out) {
+            const __m256 factor = _mm256_set1_ps(full);
+            const __m256 lower = _mm256_set1_ps(low);
+            const __m256 upper = _mm256_set1_ps(high);
+            const __m256i bias = _mm256_set1_epi32(offset);
+            const __m256 overflow = _mm256_set1_ps(2147483648.0f);
+            uint64_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_mul_ps(_mm256_loadu_ps(in + i), factor);
+                v = _mm256_min_ps(_mm256_max_ps(v, lower), upper);
+                __m256i value = _mm256_xor_si256(_mm256_cvtps_epi32(v), _mm256_castps_si256(_mm256_cmp_ps(v, overflow, _CMP_GE_OQ)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(value, bias));
+            }
+            return i;
+        }
+
+        WAVLIB_TARGET("ssse3") static void ssse3_store(const __m128i value, const __m128, int32_t* out) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), value);
+        }
+
+        WAVLIB_TARGET("ssse3") static void ssse3_store(const __m128i value, const __m128 factor, float* out) {
+            _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(value), factor));
+        }
+
+        template<typename OUT>
+        WAVLIB_TARGET("ssse3") static uint64_t ssse3_decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, OUT* out) {
+            const bool to_float = std::is_same<OUT, float>::value;
+            const __m128 factor = _mm_set1_ps(scale(type));
+            const __m128i zero = _mm_setzero_si128();
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8: {
+                    const __m128i bias = _mm_set1_epi32(to_float ? 128 : 0);
+                    for (; i + 16 <= count; i += 16) {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                        __m128i low = _mm_unpacklo_epi8(v, zero);
+                        __m128i high = _mm_unpackhi_epi8(v, zero);
+                        ssse3_store(_mm_sub_epi32(_mm_unpacklo_epi16(low, zero), bias), factor, out + i);
+                        ssse3_store(_mm_sub_epi32(_mm_unpackhi_epi16(low, zero), bias), factor, out + i + 4);
+                        ssse3_store(_mm_sub_epi32(_mm_unpacklo_epi16(high, zero), bias), factor, out + i + 8);
+                        ssse3_store(_mm_sub_epi32(_mm_unpackhi_epi16(high, zero), bias), factor, out + i + 12);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S16:
+                    for (; i + 8 <= count; i += 8) {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+                        ssse3_store(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), factor, out + i);
+                        ssse3_store(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), factor, out + i + 4);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S24: {
+                    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+                    // Each load reads 16 bytes for 12 bytes of samples
+                    for (; i + 6 <= count; i += 4) {
+                        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 3));
+                        ssse3_store(_mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8), factor, out + i);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S32:
+                    for (; i + 4 <= count; i += 4) {
+                        ssse3_store(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4)), factor, out + i);
+                    }
+                    break;
+                case FORMAT::SAMPLE::F32:
+                    if (!to_float) {
+                        const __m128 full = _mm_set1_ps(2147483648.0f);
+                        for (; i + 4 <= count; i += 4) {
+                            __m128 v = _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float*>(in + i * 4)), full);
+                            __m128i overflow = _mm_castps_si128(_mm_cmpge_ps(v, full));
+                            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(_mm_cvtps_epi32(v), overflow));
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return i;
+        }
+
+        WAVLIB_TARGET("ssse3") static uint64_t ssse3_encode(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8: {
+                    const __m128i shuffle = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+                    for (; i + 4 <= count; i += 4) {
+                        int32_t packed = _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), shuffle));
+                        std::memcpy(out + i, &packed, 4);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S16: {
+                    const __m128i shuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+                    for (; i + 4 <= count; i += 4) {
+                        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), shuffle);
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * 2), v);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S24: {
+                    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+                    // Each store writes 16 bytes for 12 bytes of samples, the next store overwrites the rest
+                    for (; i + 6 <= count; i += 4) {
+                        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), shuffle);
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), v);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::F32: {
+                    const __m128 factor = _mm_set1_ps(1.0f / 2147483648.0f);
+                    for (; i + 4 <= count; i += 4) {
+                        __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))), factor);
+                        _mm_storeu_ps(reinterpret_cast<float*>(out + i * 4), v);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            return i;
+        }
+#elif WAVLIB_NEON
+        static void neon_store(const int32x4_t value, const float32x4_t, int32_t* out) {
+            vst1q_s32(out, value);
+        }
+
+        static void neon_store(const int32x4_t value, const float32x4_t factor, float* out) {
+            vst1q_f32(out, vmulq_f32(vcvtq_f32_s32(value), factor));
+        }
+
+        template<typename OUT>
+        static uint64_t neon_decode(const char* in, const uint64_t count, const FORMAT::SAMPLE type, OUT* out) {
+            const bool to_float = std::is_same<OUT, float>::value;
+            const float32x4_t factor = vdupq_n_f32(scale(type));
+            const auto* p = reinterpret_cast<const uint8_t*>(in);
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8: {
+                    const int32x4_t bias = vdupq_n_s32(to_float ? 128 : 0);
+                    for (; i + 8 <= count; i += 8) {
+                        uint16x8_t v = vmovl_u8(vld1_u8(p + i));
+                        neon_store(vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))), bias), factor, out + i);
+                        neon_store(vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))), bias), factor, out + i + 4);
+                    }
+                    break;
+                }
+                case FORMAT::SAMPLE::S16:
+                    for (; i + 8 <= count; i += 8) {
+                        int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(p + i * 2));
+                        neon_store(vmovl_s16(vget_low_s16(v)), factor, out + i);
+                        neon_store(vmovl_s16(vget_high_s16(v)), factor, out + i + 4);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S24:
+                    // vld3 splits 16 samples into their low, middle and high bytes
+                    for (; i + 16 <= count; i += 16) {
+                        uint8x16x3_t v = vld3q_u8(p + i * 3);
+                        uint16x8_t low[2] = {vorrq_u16(vmovl_u8(vget_low_u8(v.val[0])), vshll_n_u8(vget_low_u8(v.val[1]), 8)),
+                                             vorrq_u16(vmovl_u8(vget_high_u8(v.val[0])), vshll_n_u8(vget_high_u8(v.val[1]), 8))};
+                        int16x8_t high[2] = {vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(v.val[2]))),
+                                             vmovl_s8(vget_high_s8(vreinterpretq_s8_u8(v.val[2])))};
+                        for (int k = 0; k < 2; k++) {
+                            int32x4_t a = vorrq_s32(vshll_n_s16(vget_low_s16(high[k]), 16), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low[k]))));
+                            int32x4_t b = vorrq_s32(vshll_n_s16(vget_high_s16(high[k]), 16), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low[k]))));
+                            neon_store(a, factor, out + i + 8 * k);
+                            neon_store(b, factor, out + i + 8 * k + 4);
+                        }
+                    }
+                    break;
+                case FORMAT::SAMPLE::S32:
+                    for (; i + 4 <= count; i += 4) {
+                        neon_store(vreinterpretq_s32_u8(vld1q_u8(p + i * 4)), factor, out + i);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return i;
+        }
+
+        static uint64_t neon_encode(const int32_t* in, const uint64_t count, const FORMAT::SAMPLE type, char* out) {
+            // vld4 splits 16 int32 samples into byte planes, the low planes are stored interleaved
+            const auto* p = reinterpret_cast<const uint8_t*>(in);
+            auto* q = reinterpret_cast<uint8_t*>(out);
+            uint64_t i = 0;
+            switch (type) {
+                case FORMAT::SAMPLE::U8:
+                    for (; i + 16 <= count; i += 16) {
+                        vst1q_u8(q + i, vld4q_u8(p + i * 4).val[0]);
+                    }
+                    break;
+                case FORMAT::SAMPLE::S16:
+                    for (; i + 16 <= count; i += 16) {
+                        uint8x16x4_t v = vld4q_u8(p + i * 4);
+                        vst2q_u8(q + i * 2, uint8x16x2_t{{v.val[0], v.val[1]}});
+                    }
+                    break;
+                case FORMAT::SAMPLE::S24:
+                    for (; i + 16 <= count; i += 16) {
+                        uint8x16x4_t v = vld4q_u8(p + i * 4);
+                        vst3q_u8(q + i * 3, uint8x16x3_t{{v.val[0], v.val[1], v.val[2]}});
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return i;
+        }
+#endif
+    };
+
+    struct FLAC {
+        /** Native FLAC decoding, frames only depend on STREAMINFO so a file decodes in independent byte ranges **/
+
+        struct HEADER {
+            uint64_t first{};             // Sample number of the first sample in the frame
+            uint32_t block{};             // Samples per channel
+            unsigned assignment{};        // 0-7 independent channels, 8 left/side, 9 right/side, 10 mid/side
+            unsigned channels{};          // Number of Channels
+            unsigned bits{};              // Bits per sample
+            uint64_t size{};              // Bytes of the header, CRC-8 included
+        };
+
+        class BITS {
+        public:
+            /** MSB first bit reader, the cache holds the next count bits left aligned **/
+            /** Reading past the end yields zeros, overrun() tells afterwards **/
+            BITS(const unsigned char* data, const uint64_t size) : data(data), size(size) {}
+
+            uint32_t read(const unsigned n) {
+                /** n <= 32 **/
+                if (count < n) {
+                    refill();
+                }
+                const auto value = static_cast<uint32_t>(cache >> 1 >> (63 - n));
+                cache <<= n;
+                count -= n;
+                return value;
+            }
+
+            int32_t read_signed(const unsigned n) {
+                if (n == 0) {
+                    return 0;
+                }
+                if (count < n) {
+                    refill();
+                }
+                const auto value = static_cast<int32_t>(static_cast<int64_t>(cache) >> (64 - n));
+                cache <<= n;
+                count -= n;
+                return value;
+            }
+
+            uint32_t unary() {
+                /** Zeros up to the next one bit, the one bit is consumed too **/
+                uint32_t zeros = 0;
+                while (true) {
+                    const unsigned z = cache == 0 ? 64 : clz(cache);
+                    if (z < count) {
+                        cache = cache << z << 1;
+                        count -= z + 1;
+                        return zeros + z;
+                    }
+                    zeros += count;
+                    cache = 0;
+                    count = 0;
+                    if (position > size) {
+                        return zeros;
+                    }
+                    refill();
+                }
+            }
+
+            void rice(int32_t* out, const uint64_t n, const unsigned k) {
+                /** n Rice coded values with parameter k < 31, zigzag folded back to signed **/
+                // Locals, the stores to out could alias the members and keep them out of registers
+                uint64_t bits = cache;
+                unsigned valid = count;
+                for (uint64_t i = 0; i < n; i++) {
+                    if (valid < 32) {
+                        if (position + 8 <= size) {
+                            bits |= big(data + position) >> valid;
+                            const unsigned bytes = (63 - valid) >> 3;
+                            position += bytes;
+                            valid += bytes << 3;
+                        } else {
+                            cache = bits;
+                            count = valid;
+                            refill();
+                            bits = cache;
+                            valid = count;
+                        }
+                    }
+                    // The cache never holds all 64 bits, so an empty one falls through to unary()
+                    const unsigned z = clz(bits | 1);
+                    const unsigned used = z + 1 + k;
+                    uint32_t value;
+                    if (used <= valid) {
+                        // Quotient, stop bit and remainder are all in the cache, the stop bit doubles as 1 << k
+                        value = static_cast<uint32_t>(bits >> (64 - used)) + (static_cast<uint32_t>(z - 1) << k);
+                        bits <<= used;
+                        valid -= used;
+                    } else {
+                        cache = bits;
+                        count = valid;
+                        value = unary() << k;
+                        value |= read(k);
+                        bits = cache;
+                        valid = count;
+                    }
+                    out[i] = static_cast<int32_t>(value >> 1 ^ (0u - (value & 1)));
+                }
+                cache = bits;
+                count = valid;
+            }
+
+            uint32_t huffman(const uint32_t* lookup, uint32_t link) {
+                /** One symbol through multilevel lookup tables, leaves are value | bits << 16 **/
+                /** links are 1 << 31 | offset << 5 | width, with at most 24 bits to a code **/
+                if (count < 24) {
+                    refill();
+                }
+                unsigned used = 0;
+                while (link >> 31) {
+                    const unsigned width = link & 31;
+                    link = lookup[(link >> 5 & 0x3FFFFFF) + static_cast<uint32_t>(cache << used >> (64 - width))];
+                    used += width;
+                    if (!(link >> 31)) {
+                        used -= width - (link >> 16 & 31);
+                    }
+                }
+                cache <<= used;
+                count -= used;
+                return link & 0xFFFF;
+            }
+
+            void align() {
+                /** Skip to the next byte boundary **/
+                read(count & 7);
+            }
+
+            uint64_t tell() const {
+                /** Bits consumed so far **/
+                return position * 8 - count;
+            }
+
+            bool overrun() const {
+                return tell() > size * 8;
+            }
+
+        private:
+            void refill() {
+                if (position + 8 <= size) {
+                    // The bits below count that get overwritten are the same ones again
+                    cache |= big(data + position) >> count;
+                    const unsigned bytes = (63 - count) >> 3;
+                    position += bytes;
+                    count += bytes << 3;
+                    return;
+                }
+                while (count < 56) {
+                    cache |= static_cast<uint64_t>(position < size ? data[position] : 0) << (56 - count);
+                    position++;
+                    count += 8;
+                }
+            }
+
+            const unsigned char* data;
+            uint64_t size;
+            uint64_t position = 0;        // Next byte to go into the cache
+            uint64_t cache = 0;
+            unsigned count = 0;
+        };
+
+        static uint64_t big(const unsigned char* p) {
+            /** Big-endian load, compilers turn this into a single load and byte swap **/
+            return static_cast<uint64_t>(p[0]) << 56 | static_cast<uint64_t>(p[1]) << 48 | static_cast<uint64_t>(p[2]) << 40 | static_cast<uint64_t>(p[3]) << 32 |
+                   static_cast<uint64_t>(p[4]) << 24 | static_cast<uint64_t>(p[5]) << 16 | static_cast<uint64_t>(p[6]) << 8 | static_cast<uint64_t>(p[7]);
+        }
+
+        static unsigned clz(const uint64_t x) {
+            /** Leading zeros of a non-zero value **/
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_ARM64))
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return 63 - static_cast<unsigned>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_clzll(x));
+#else
+            unsigned n = 0;
+            for (uint64_t bit = uint64_t(1) << 63; (x & bit) == 0; bit >>= 1) {
+                n++;
+            }
+            return n;
+#endif
+        }
+
+        struct CRC {
+            /** CRC-8 (x^8 + x^2 + x + 1) of the frame header, CRC-16 (x^16 + x^15 + x^2 + 1) of the whole frame **/
+            uint8_t eight[256];
+            uint16_t sixteen[8][256];     // Slicing by 8, sixteen[k] is a byte followed by k zero bytes
+
+            CRC() {
+                for (unsigned v = 0; v < 256; v++) {
+                    unsigned c8 = v;
+                    unsigned c16 = v << 8;
+                    for (int bit = 0; bit < 8; bit++) {
+                        c8 = (c8 & 0x80 ? c8 << 1 ^ 0x07 : c8 << 1) & 0xFF;
+                        c16 = (c16 & 0x8000 ? c16 << 1 ^ 0x8005 : c16 << 1) & 0xFFFF;
+                    }
+                    eight[v] = static_cast<uint8_t>(c8);
+                    sixteen[0][v] = static_cast<uint16_t>(c16);
+                }
+                for (unsigned k = 1; k < 8; k++) {
+                    for (unsigned v = 0; v < 256; v++) {
+                        const unsigned c = sixteen[k - 1][v];
+                        sixteen[k][v] = static_cast<uint16_t>((c << 8 & 0xFFFF) ^ sixteen[0][c >> 8]);
+                    }
+                }
+            }
+
+            static const CRC& table() {
+                static const CRC crc;
+                return crc;
+            }
+        };
+
+        static uint8_t crc8(const unsigned char* data, const uint64_t size) {
+            const CRC& crc = CRC::table();
+            unsigned c = 0;
+            for (uint64_t i = 0; i < size; i++) {
+                c = crc.eight[c ^ data[i]];
+            }
+            return static_cast<uint8_t>(c);
+        }
+
+        static uint16_t crc16(const unsigned char* data, const uint64_t size) {
+            const auto& t = CRC::table().sixteen;
+            unsigned c = 0;
+            uint64_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                c = t[7][data[i] ^ c >> 8] ^ t[6][data[i + 1] ^ (c & 0xFF)] ^ t[5][data[i + 2]] ^ t[4][data[i + 3]] ^
+                    t[3][data[i + 4]] ^ t[2][data[i + 5]] ^ t[1][data[i + 6]] ^ t[0][data[i + 7]];
+            }
+            for (; i < size; i++) {
+                c = (c << 8 & 0xFFFF) ^ t[0][c >> 8 ^ data[i]];
+            }
+            return static_cast<uint16_t>(c);
+        }
+
+        template<typename SOURCE>
+        static bool metadata(SOURCE& source, FORMAT::FLAC& info) {
+            /** Walk the metadata blocks and stop at the first frame header **/
+            WAVLIB_SCOPE("FLAC::metadata");
+            char field[34];
+            const auto* u = reinterpret_cast<const unsigned char*>(field);
+            if (!source.read(field, 4)) {
+                return false;
+            }
+            if (std::memcmp(field, "ID3", 3) == 0) {
+                // ID3v2 size is syncsafe, 7 bits per byte, plus a footer if the flags say so
+                if (!source.read(field + 4, 6)) {
+                    return false;
+                }
+                const uint64_t tag = (u[6] & 0x7F) << 21 | (u[7] & 0x7F) << 14 | (u[8] & 0x7F) << 7 | (u[9] & 0x7F);
+                if (!source.skip(tag + (u[5] & 0x10 ? 10 : 0)) || !source.read(field, 4)) {
+                    return false;
+                }
+            }
+            if (std::memcmp(field, "fLaC", 4) != 0) {
+                return false;
+            }
+
+            std::vector<FORMAT::FLAC::SEEKPOINT> seek;
+            seek.swap(info.seek);
+            seek.clear();
+            info = FORMAT::FLAC();
+            info.seek.swap(seek);
+            bool streaminfo = false;
+            bool last = false;
+            while (!last) {
+                if (!source.read(field, 4)) {
+                    return false;
+                }
+                last = (u[0] & 0x80) != 0;
+                const unsigned type = u[0] & 0x7F;
+                const uint64_t length = u[1] << 16 | u[2] << 8 | u[3];
+                uint64_t consumed = 0;
+                if (type == 0 && length >= 34) {
+                    consumed = 34;
+                    if (!source.read(field, consumed)) {
+                        return false;
+                    }
+                    // 20 bits sample rate, 3 bits channels - 1, 5 bits bits per sample - 1, 36 bits total samples
+                    const uint64_t packed = big(u + 10);
+                    info.min_block = static_cast<unsigned short>(u[0] << 8 | u[1]);
+                    info.max_block = static_cast<unsigned short>(u[2] << 8 | u[3]);
+                    info.min_frame = u[4] << 16 | u[5] << 8 | u[6];
+                    info.max_frame = u[7] << 16 | u[8] << 8 | u[9];
+                    info.sample_rate = static_cast<unsigned int>(packed >> 44);
+                    info.channels = static_cast<unsigned short>((packed >> 41 & 7) + 1);
+                    info.sample_size = static_cast<unsigned short>((packed >> 36 & 31) + 1);
+                    info.frames = packed & 0xFFFFFFFFF;
+                    std::memcpy(info.md5, u + 18, 16);
+                    streaminfo = true;
+                } else if (type == 3) {
+                    for (; consumed + 18 <= length; consumed += 18) {
+                        if (!source.read(field, 18)) {
+                            return false;
+                        }
+                        // Placeholders hold a sample number of all ones
+                        FORMAT::FLAC::SEEKPOINT point;
+                        point.sample = big(u);
+                        point.offset = big(u + 8);
+                        point.samples = static_cast<unsigned short>(u[16] << 8 | u[17]);
+                        if (point.sample != UINT64_MAX) {
+                            info.seek.push_back(point);
+                        }
+                    }
+                } else if (type == 127) {
+                    return false;
+                }
+                if (!source.skip(length - consumed)) {
+                    return false;
+                }
+            }
+            info.audio_offset = source.position;
+            return streaminfo && info.max_block != 0 && info.sample_rate != 0 && info.sample_size >= 4;
+        }
+
+        static bool header(const unsigned char* data, const uint64_t size, const FORMAT::FLAC& info, HEADER& head) {
+            /** Parse a frame header, which also has to agree with STREAMINFO so false syncs get rejected **/
+            static const unsigned rates[12] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+            static const unsigned sizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+            if (size < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8 || (data[3] & 1) != 0) {
+                return false;
+            }
+            const unsigned block_code = data[2] >> 4;
+            const unsigned rate_code = data[2] & 15;
+            const unsigned size_code = data[3] >> 1 & 7;
+            head.assignment = data[3] >> 4;
+            if (block_code == 0 || rate_code == 15 || head.assignment > 10 || size_code == 3) {
+                return false;
+            }
+
+            // Frame number for fixed block sizes, sample number otherwise, coded like UTF-8
+            uint64_t p = 4;
+            uint64_t number = data[p++];
+            unsigned extra = 0;
+            if (number >= 0x80) {
+                if (number < 0xC0 || number == 0xFF) {
+                    return false;
+                }
+                unsigned mask = 0x40;
+                for (; number & mask; mask >>= 1) {
+                    extra++;
+                }
+                number &= mask - 1;
+            }
+            const bool variable = (data[1] & 1) != 0;
+            if ((!variable && extra > 5) || p + extra + 5 > size) {
+                return false;
+            }
+            for (unsigned i = 0; i < extra; i++, p++) {
+                if ((data[p] & 0xC0) != 0x80) {
+                    return false;
+                }
+                number = number << 6 | (data[p] & 0x3F);
+            }
+
+            if (block_code == 6) {
+                head.block = data[p++] + 1u;
+            } else if (block_code == 7) {
+                head.block = (data[p] << 8 | data[p + 1]) + 1u;
+                p += 2;
+            } else {
+                head.block = block_code == 1 ? 192 : block_code <= 5 ? 576u << (block_code - 2) : 256u << (block_code - 8);
+            }
+            unsigned rate = rate_code < 12 ? rates[rate_code] : 0;
+            if (rate_code == 12) {
+                rate = data[p++] * 1000u;
+            } else if (rate_code >= 13) {
+                rate = (data[p] << 8 | data[p + 1]) * (rate_code == 14 ? 10u : 1u);
+                p += 2;
+            }
+            if (crc8(data, p) != data[p]) {
+                return false;
+            }
+            head.size = p + 1;
+            head.channels = head.assignment < 8 ? head.assignment + 1 : 2;
+            head.bits = size_code == 0 ? info.sample_size : sizes[size_code];
+            head.first = variable ? number : number * info.max_block;
+            if ((rate_code != 0 && rate != info.sample_rate) || head.channels != info.channels || head.bits != info.sample_size || head.block > info.max_block) {
+                return false;
+            }
+            return info.frames == 0 || head.first + head.block <= info.frames;
+        }
+
+        static uint64_t frame(const unsigned char* data, const uint64_t size, const FORMAT::FLAC& info, int32_t* planes, HEADER& head) {
+            /** Decode the frame at data, channel c lands at planes + c * info.max_block **/
+            /** Returns the size of the frame, 0 if data doesn't start with a valid one **/
+            if (!header(data, size, info, head)) {
+                return 0;
+            }
+            BITS bits(data + head.size, size - head.size);
+            for (unsigned c = 0; c < head.channels; c++) {
+                // The side channel needs one bit more
+                const bool side = (c == 1 && (head.assignment == 8 || head.assignment == 10)) || (c == 0 && head.assignment == 9);
+                if (!subframe(bits, planes + c * info.max_block, head.block, head.bits + side)) {
+                    return 0;
+                }
+            }
+            bits.align();
+            const uint64_t end = head.size + bits.tell() / 8 + 2;
+            if (bits.overrun() || end > size || crc16(data, end - 2) != (data[end - 2] << 8 | data[end - 1])) {
+                return 0;
+            }
+            if (head.assignment >= 8) {
+                decorrelate(planes, planes + info.max_block, head.block, head.assignment, head.bits);
+            }
+            WAVLIB_COUNT(SAMPLES_DECODED, static_cast<uint64_t>(head.block) * head.channels);
+            return end;
+        }
+
+        static bool subframe(BITS& bits, int32_t* out, const uint32_t block, unsigned width) {
+            /** One channel of a frame, width is the sample size of this channel **/
+            if (bits.read(1) != 0) {
+                return false;
+            }
+            const uint32_t type = bits.read(6);
+            unsigned wasted = 0;
+            if (bits.read(1) != 0) {
+                wasted = bits.unary() + 1;
+                if (wasted >= width) {
+                    return false;
+                }
+                width -= wasted;
+            }
+            if (width > 32) {
+                return false;
+            }
+
+            if (type == 0) {
+                std::fill(out, out + block, bits.read_signed(width));
+            } else if (type == 1) {
+                for (uint32_t i = 0; i < block; i++) {
+                    out[i] = bits.read_signed(width);
+                }
+            } else if (type >= 8 && type <= 12) {
+                const unsigned order = type - 8;
+                if (order > block) {
+                    return false;
+                }
+                for (unsigned i = 0; i < order; i++) {
+                    out[i] = bits.read_signed(width);
+                }
+                if (!residual(bits, out, block, order)) {
+                    return false;
+                }
+                fixed(out, block, order);
+            } else if (type >= 32) {
+                const unsigned order = type - 31;
+                if (order > block) {
+                    return false;
+                }
+                for (unsigned i = 0; i < order; i++) {
+                    out[i] = bits.read_signed(width);
+                }
+                const unsigned precision = bits.read(4) + 1;
+                const int shift = bits.read_signed(5);
+                if (precision == 16 || shift < 0) {
+                    return false;
+                }
+                int32_t coefficients[32];
+                for (unsigned i = 0; i < order; i++) {
+                    coefficients[i] = bits.read_signed(precision);
+                }
+                if (!residual(bits, out, block, order)) {
+                    return false;
+                }
+                // Same bound libFLAC uses to pick a 32-bit sum
+                unsigned log2 = 0;
+                while ((2u << log2) <= order) {
+                    log2++;
+                }
+                lpc(out, block, coefficients, order, shift, width + precision + log2 <= 32);
+            } else {
+                return false;
+            }
+
+            if (wasted != 0) {
+                for (uint32_t i = 0; i < block; i++) {
+                    out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+                }
+            }
+            return !bits.overrun();
+        }
+
+        static bool residual(BITS& bits, int32_t* out, const uint32_t block, const unsigned order) {
+            /** Rice coded partitions after the warm-up samples, a parameter of all ones escapes to plain binary **/
+            const uint32_t method = bits.read(2);
+            if (method > 1) {
+                return false;
+            }
+            const unsigned width = method == 0 ? 4 : 5;
+            const uint32_t escape = method == 0 ? 15 : 31;
+            const unsigned partition_order = bits.read(4);
+            const uint32_t length = block >> partition_order;
+            if (length << partition_order != block || length < order) {
+                return false;
+            }
+            uint32_t i = order;
+            for (uint32_t partition = 0; partition < (1u << partition_order); partition++) {
+                const uint32_t n = partition == 0 ? length - order : length;
+                const uint32_t k = bits.read(width);
+                if (k == escape) {
+                    const unsigned raw = bits.read(5);
+                    for (uint32_t j = 0; j < n; j++) {
+                        out[i + j] = bits.read_signed(raw);
+                    }
+                } else {
+                    bits.rice(out + i, n, k);
+                }
+                i += n;
+                if (bits.overrun()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static void fixed(int32_t* x, const uint32_t block, const unsigned order) {
+            /** Fixed polynomial predictors, wrapping arithmetic is exact whenever the result fits, which it does in a valid stream **/
+            /** History lives in registers, the chain never waits on a store **/
+            auto* u = reinterpret_cast<uint32_t*>(x);
+            if (order == 0 || order > 4 || block <= order) {
+                return;
+            }
+            uint32_t a = u[order - 1];
+            uint32_t b = order >= 2 ? u[order - 2] : 0;
+            uint32_t c = order >= 3 ? u[order - 3] : 0;
+            uint32_t d = order >= 4 ? u[order - 4] : 0;
+            for (uint32_t i = order; i < block; i++) {
+                uint32_t next = u[i];
+                switch (order) {
+                    case 1: next += a; break;
+                    case 2: next += 2 * a - b; break;
+                    case 3: next += 3 * (a - b) + c; break;
+                    default: next += 4 * (a + c) - 6 * b - d; break;
+                }
+                d = c;
+                c = b;
+                b = a;
+                a = next;
+                u[i] = next;
+            }
+        }
+
+        template<unsigned ORDER, size_t... J>
+        static void lpc_narrow(int32_t* x, const uint32_t block, const int32_t* c, const int shift, std::index_sequence<J...>) {
+            /** The fold unrolls every tap, the newest sample stays in a register instead of a store and reload **/
+            auto* u = reinterpret_cast<uint32_t*>(x);
+            const uint32_t k[ORDER] = {static_cast<uint32_t>(c[J])...};
+            uint32_t last = u[ORDER - 1];
+            for (uint32_t i = ORDER; i < block; i++) {
+                const uint32_t* h = u + i - 1;
+                const uint32_t sum = k[0] * last + ((J == 0 ? 0 : k[J] * h[-static_cast<int64_t>(J)]) + ...);
+                last = u[i] + static_cast<uint32_t>(static_cast<int32_t>(sum) >> shift);
+                u[i] = last;
+            }
+        }
+
+        template<unsigned ORDER, size_t... J>
+        static void lpc_wide(int32_t* x, const uint32_t block, const int32_t* c, const int shift, std::index_sequence<J...>) {
+            const int64_t k[ORDER] = {c[J]...};
+            int64_t last = x[ORDER - 1];
+            for (uint32_t i = ORDER; i < block; i++) {
+                const int32_t* h = x + i - 1;
+                const int64_t sum = k[0] * last + ((J == 0 ? 0 : k[J] * h[-static_cast<int64_t>(J)]) + ...);
+                last = static_cast<int32_t>(static_cast<uint32_t>(x[i]) + static_cast<uint32_t>(sum >> shift));
+                x[i] = static_cast<int32_t>(last);
+            }
+        }
+
+        template<unsigned ORDER>
+        static void lpc(int32_t* x, const uint32_t block, const int32_t* c, const int shift, const bool narrow) {
+            if (narrow) {
+                lpc_narrow<ORDER>(x, block, c, shift, std::make_index_sequence<ORDER>());
+            } else {
+                lpc_wide<ORDER>(x, block, c, shift, std::make_index_sequence<ORDER>());
+            }
+        }
+
+        static void lpc(int32_t* x, const uint32_t block, const int32_t* c, const unsigned order, const int shift, const bool narrow) {
+            /** x[i] += sum(c[j] * x[i - 1 - j]) >> shift, narrow when the sum provably fits in 32 bits **/
+            switch (order) {
+                case 1: return lpc<1>(x, block, c, shift, narrow);
+                case 2: return lpc<2>(x, block, c, shift, narrow);
+                case 3: return lpc<3>(x, block, c, shift, narrow);
+                case 4: return lpc<4>(x, block, c, shift, narrow);
+                case 5: return lpc<5>(x, block, c, shift, narrow);
+                case 6: return lpc<6>(x, block, c, shift, narrow);
+                case 7: return lpc<7>(x, block, c, shift, narrow);
+                case 8: return lpc<8>(x, block, c, shift, narrow);
+                case 9: return lpc<9>(x, block, c, shift, narrow);
+                case 10: return lpc<10>(x, block, c, shift, narrow);
+                case 11: return lpc<11>(x, block, c, shift, narrow);
+                case 12: return lpc<12>(x, block, c, shift, narrow);
+                default: break;
+            }
+            // Orders past 12 are outside the streamable subset and rare
+            auto* u = reinterpret_cast<uint32_t*>(x);
+            for (uint32_t i = order; i < block; i++) {
+                int64_t sum = 0;
+                for (unsigned j = 0; j < order; j++) {
+                    sum += static_cast<int64_t>(c[j]) * x[i - 1 - j];
+                }
+                u[i] += static_cast<uint32_t>(sum >> shift);
+            }
+        }
+
+        static void decorrelate(int32_t* a, int32_t* b, const uint32_t block, const unsigned assignment, const unsigned bits) {
+            /** Stereo channel pairs back to left and right **/
+            auto* ua = reinterpret_cast<uint32_t*>(a);
+            auto* ub = reinterpret_cast<uint32_t*>(b);
+            uint32_t i = 0;
+            if (assignment == 8) {
+#if WAVLIB_SSE2
+                for (; i + 4 <= block; i += 4) {
+                    const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(b + i), _mm_sub_epi32(left, _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+                }
+#elif WAVLIB_NEON
+                for (; i + 4 <= block; i += 4) {
+                    vst1q_s32(b + i, vsubq_s32(vld1q_s32(a + i), vld1q_s32(b + i)));
+                }
+#endif
+                for (; i < block; i++) {
+                    ub[i] = ua[i] - ub[i];
+                }
+            } else if (assignment == 9) {
+#if WAVLIB_SSE2
+                for (; i + 4 <= block; i += 4) {
+                    const __m128i side = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm_add_epi32(side, _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+                }
+#elif WAVLIB_NEON
+                for (; i + 4 <= block; i += 4) {
+                    vst1q_s32(a + i, vaddq_s32(vld1q_s32(a + i), vld1q_s32(b + i)));
+                }
+#endif
+                for (; i < block; i++) {
+                    ua[i] += ub[i];
+                }
+            } else if (bits <= 30) {
+                // mid + side takes bits + 2 bits, which still fits
+#if WAVLIB_SSE2
+                const __m128i one = _mm_set1_epi32(1);
+                for (; i + 4 <= block; i += 4) {
+                    const __m128i side = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                    const __m128i mid = _mm_or_si128(_mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), 1), _mm_and_si128(side, one));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm_srai_epi32(_mm_add_epi32(mid, side), 1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(b + i), _mm_srai_epi32(_mm_sub_epi32(mid, side), 1));
+                }
+#elif WAVLIB_NEON
+                const int32x4_t one = vdupq_n_s32(1);
+                for (; i + 4 <= block; i += 4) {
+                    const int32x4_t side = vld1q_s32(b + i);
+                    const int32x4_t mid = vorrq_s32(vshlq_n_s32(vld1q_s32(a + i), 1), vandq_s32(side, one));
+                    vst1q_s32(a + i, vshrq_n_s32(vaddq_s32(mid, side), 1));
+                    vst1q_s32(b + i, vshrq_n_s32(vsubq_s32(mid, side), 1));
+                }
+#endif
+                for (; i < block; i++) {
+                    const int32_t side = b[i];
+                    const int32_t mid = static_cast<int32_t>(ua[i] << 1 | (ub[i] & 1));
+                    a[i] = (mid + side) >> 1;
+                    b[i] = (mid - side) >> 1;
+                }
+            } else {
+                for (; i < block; i++) {
+                    const int64_t side = b[i];
+                    const int64_t mid = static_cast<int64_t>(a[i]) * 2 + (side & 1);
+                    a[i] = static_cast<int32_t>((mid + side) >> 1);
+                    b[i] = static_cast<int32_t>((mid - side) >> 1);
+                }
+            }
+        }
+
+        static uint64_t sync(const unsigned char* data, const uint64_t size, uint64_t from, const uint64_t to) {
+            /** Next byte in [from, to) that looks like the start of a frame header, to if there is none **/
+            while (from < to) {
+                const auto* hit = static_cast<const unsigned char*>(std::memchr(data + from, 0xFF, to - from));
+                if (hit == nullptr) {
+                    return to;
+                }
+                from = static_cast<uint64_t>(hit - data);
+                if (from + 1 < size && (data[from + 1] & 0xFE) == 0xF8) {
+                    return from;
+                }
+                from++;
+            }
+            return to;
+        }
+
+        static uint64_t next(const unsigned char* data, const uint64_t size, const FORMAT::FLAC& info, uint64_t from, HEADER& head) {
+            /** First position at or after from that holds a whole valid frame, size if there is none **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            int32_t* planes = workspace.allocate<int32_t>(static_cast<uint64_t>(info.max_block) * info.channels);
+            for (from = sync(data, size, from, size); from < size; from = sync(data, size, from + 1, size)) {
+                if (frame(data + from, size - from, info, planes, head) != 0) {
+                    return from;
+                }
+            }
+            return size;
+        }
+
+        static bool tail(const unsigned char* data, const uint64_t size, const FORMAT::FLAC& info, HEADER& head) {
+            /** The last valid frame, found walking back from the end **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            int32_t* planes = workspace.allocate<int32_t>(static_cast<uint64_t>(info.max_block) * info.channels);
+            for (uint64_t p = size - 1; p > info.audio_offset; p--) {
+                if (data[p - 1] == 0xFF && (data[p] & 0xFE) == 0xF8 && frame(data + p - 1, size - p + 1, info, planes, head) != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static unsigned container(const unsigned bits) {
+            /** Bits of the whole-byte sample a WAV file would store **/
+            return (bits + 7) / 8 * 8;
+        }
+
+        static void assign(const FORMAT::FLAC& info, FORMAT::WAV& audio) {
+            /** Header of the PCM file this stream decodes to **/
+            audio.format = 1;
+            audio.channels = info.channels;
+            audio.sample_rate = info.sample_rate;
+            audio.sample_size = static_cast<unsigned short>(container(info.sample_size));
+            audio.data_rate = info.sample_rate * info.channels * (audio.sample_size / 8);
+            audio.data_size = info.frames == 0 ? UINT64_MAX : info.frames * info.channels * (audio.sample_size / 8);
+            audio.chunks.clear();
+        }
+
+        static void interleave(const int32_t* planes, const uint64_t stride, const unsigned channels, const uint64_t n, const unsigned bits, int32_t* out) {
+            /** Channel planes to interleaved samples in the WAV container, 8-bit is unsigned there **/
+            const unsigned shift = container(bits) - bits;
+            const uint32_t offset = bits <= 8 ? 128 : 0;
+            uint64_t i = 0;
+#if WAVLIB_SSE2
+            if (channels == 2) {
+                const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+                const __m128i bias = _mm_set1_epi32(static_cast<int>(offset));
+                for (; i + 4 <= n; i += 4) {
+                    const __m128i left = _mm_add_epi32(_mm_sll_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + i)), count), bias);
+                    const __m128i right = _mm_add_epi32(_mm_sll_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + stride + i)), count), bias);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi32(left, right));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 4), _mm_unpackhi_epi32(left, right));
+                }
+            }
+#elif WAVLIB_NEON
+            if (channels == 2) {
+                const int32x4_t count = vdupq_n_s32(static_cast<int32_t>(shift));
+                const int32x4_t bias = vdupq_n_s32(static_cast<int32_t>(offset));
+                for (; i + 4 <= n; i += 4) {
+                    int32x4x2_t pair;
+                    pair.val[0] = vaddq_s32(vshlq_s32(vld1q_s32(planes + i), count), bias);
+                    pair.val[1] = vaddq_s32(vshlq_s32(vld1q_s32(planes + stride + i), count), bias);
+                    vst2q_s32(out + 2 * i, pair);
+                }
+            }
+#endif
+            for (unsigned c = 0; c < channels; c++) {
+                const int32_t* plane = planes + c * stride;
+                for (uint64_t j = i; j < n; j++) {
+                    out[j * channels + c] = static_cast<int32_t>((static_cast<uint32_t>(plane[j]) << shift) + offset);
+                }
+            }
+        }
+
+        static void interleave(const int32_t* planes, const uint64_t stride, const unsigned channels, const uint64_t n, const unsigned bits, float* out) {
+            /** Channel planes to interleaved normalized float32 **/
+            const float scale = std::ldexp(1.0f, 1 - static_cast<int>(bits));
+            for (unsigned c = 0; c < channels; c++) {
+                const int32_t* plane = planes + c * stride;
+                for (uint64_t j = 0; j < n; j++) {
+                    out[j * channels + c] = static_cast<float>(plane[j]) * scale;
+                }
+            }
+        }
+
+        static uint64_t bound(const FORMAT::FLAC& info) {
+            /** Bytes that always hold a whole frame, verbatim subframes plus headers and padding are the worst case **/
+            const uint64_t verbatim = (static_cast<uint64_t>(info.max_block) * (info.sample_size + 1) + 7) / 8 + 8;
+            return std::max<uint64_t>(info.max_frame, 18 + info.channels * verbatim);
+        }
+
+        static void prepare(const FORMAT::FLAC& info, const uint64_t frames, FORMAT::WAV& audio) {
+            assign(info, audio);
+            audio.data_size = frames * info.channels * (audio.sample_size / 8);
+            audio.audio.resize(frames * info.channels);
+        }
+
+        static void prepare(const FORMAT::FLAC& info, const uint64_t frames, FORMAT::PLANAR& audio) {
+            audio.sample_rate = info.sample_rate;
+            audio.resize(info.channels, frames);
+        }
+
+        static void store(const int32_t* planes, const uint64_t stride, const HEADER& head, FORMAT::WAV& audio) {
+            interleave(planes, stride, head.channels, head.block, head.bits, audio.audio.data() + head.first * head.channels);
+        }
+
+        static void store(const int32_t* planes, const uint64_t stride, const HEADER& head, FORMAT::PLANAR& audio) {
+            const float scale = std::ldexp(1.0f, 1 - static_cast<int>(head.bits));
+            for (unsigned c = 0; c < head.channels; c++) {
+                const int32_t* plane = planes + c * stride;
+                float* out = audio.audio.data() + c * audio.stride + head.first;
+                uint32_t i = 0;
+#if WAVLIB_SSE2
+                const __m128 factor = _mm_set1_ps(scale);
+                for (; i + 4 <= head.block; i += 4) {
+                    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + i))), factor));
+                }
+#elif WAVLIB_NEON
+                for (; i + 4 <= head.block; i += 4) {
+                    vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(plane + i)), scale));
+                }
+#endif
+                for (; i < head.block; i++) {
+                    out[i] = static_cast<float>(plane[i]) * scale;
+                }
+            }
+        }
+
+        static void trim(const uint64_t frames, FORMAT::WAV& audio) {
+            audio.audio.resize(frames * audio.channels);
+            audio.data_size = audio.audio.size() * (audio.sample_size / 8);
+        }
+
+        static void trim(const uint64_t frames, FORMAT::PLANAR& audio) {
+            audio.frames = frames;
+        }
+
+        template<typename AUDIO>
+        static bool decode(const char* bytes, const uint64_t size, AUDIO& audio) {
+            /** A whole file in memory to samples, byte ranges of the audio decode in parallel on the shared pool **/
+            /** Every range after the first starts decoding at its first frame that passes both CRCs **/
+            WAVLIB_SCOPE("FLAC::decode");
+            const auto* data = reinterpret_cast<const unsigned char*>(bytes);
+            LOAD::BUFFER source{bytes, size};
+            static thread_local FORMAT::FLAC info;
+            if (!metadata(source, info)) {
+                return false;
+            }
+            if (info.frames == 0) {
+                // Written by an encoder that didn't know the length up front, the last frame tells
+                HEADER last;
+                info.frames = tail(data, size, info, last) ? last.first + last.block : 0;
+            }
+            // The count is only a claim, the payload can't hold more frames than it has room for minimal ones
+            const uint64_t room = size > info.audio_offset ? size - info.audio_offset : 0;
+            info.frames = std::min<uint64_t>(info.frames, (room / (6 + info.channels + 2) + 1) * info.max_block);
+            prepare(info, info.frames, audio);
+            if (info.frames == 0) {
+                return true;
+            }
+
+            const uint64_t begin = info.audio_offset;
+            const uint64_t span = size - begin;
+            POOL& pool = POOL::shared();
+            const uint64_t tasks = std::max<uint64_t>(1, std::min<uint64_t>(pool.size() * 4, span >> 18));
+            std::atomic<uint64_t> decoded{0};
+            std::atomic<uint64_t> reach{0};
+            std::atomic<bool> failed{false};
+            pool.run(tasks, [&](const uint64_t task) {
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                int32_t* planes = workspace.allocate<int32_t>(static_cast<uint64_t>(info.max_block) * info.channels);
+                const uint64_t to = begin + span * (task + 1) / tasks;
+                uint64_t position = begin + span * task / tasks;
+                bool locked = task == 0;
+                uint64_t count = 0;
+                uint64_t end = 0;
+                HEADER head;
+                while (position < to && !failed) {
+                    if (!locked && (position = sync(data, size, position, to)) >= to) {
+                        break;
+                    }
+                    const uint64_t bytes = frame(data + position, size - position, info, planes, head);
+                    if (bytes == 0) {
+                        if (!locked) {
+                            position++;
+                            continue;
+                        }
+                        // A bad frame with good ones after it is damage, otherwise it is where a truncated file ends
+                        HEADER later;
+                        if (next(data, size, info, position + 1, later) < size) {
+                            failed = true;
+                        }
+                        break;
+                    }
+                    locked = true;
+                    store(planes, info.max_block, head, audio);
+                    count += head.block;
+                    end = std::max<uint64_t>(end, head.first + head.block);
+                    position += bytes;
+                }
+                decoded += count;
+                uint64_t seen = reach.load();
+                while (end > seen && !reach.compare_exchange_weak(seen, end)) {
+                }
+            });
+            // Every sample up to the furthest frame has to come from exactly one frame
+            if (failed || decoded != reach) {
+                return false;
+            }
+            if (decoded < info.frames) {
+                trim(decoded, audio);
+            }
+            return true;
+        }
+
+        struct LEVEL {
+            uint32_t block;      // Samples per channel in a frame
+            unsigned order;      // Highest LPC order, 0 keeps to the fixed predictors
+            unsigned partition;  // Highest Rice partition order
+            bool stereo;         // Try the stereo decorrelations
+            bool loose;          // Pick the stereo mode from an estimate instead of coding all four
+            bool exhaustive;     // Code every LPC order instead of the estimated best one
+        };
+
+        static LEVEL level(const unsigned n) {
+            /** The presets of the reference encoder, 0 is the fastest and 8 the smallest **/
+            static const LEVEL levels[9] = {
+                {1152, 0, 3, false, false, false},
+                {1152, 0, 3, true, true, false},
+                {1152, 0, 3, true, false, false},
+                {4096, 6, 4, false, false, false},
+                {4096, 8, 4, true, true, false},
+                {4096, 8, 5, true, false, false},
+                {4096, 8, 6, true, false, false},
+                {4096, 12, 6, true, false, false},
+                {4096, 12, 6, true, false, true},
+            };
+            return levels[std::min(n, 8u)];
+        }
+
+        class PACK {
+        public:
+            /** MSB-first bit writer, the caller makes sure the buffer holds the whole frame **/
+            explicit PACK(unsigned char* data) : data(data) {}
+
+            void put(const uint32_t value, const unsigned n) {
+                // value has to fit in n <= 32 bits
+                cache = cache << n | value;
+                count += n;
+                if (count >= 32) {
+                    count -= 32;
+                    const auto word = static_cast<uint32_t>(cache >> count);
+                    data[position] = static_cast<unsigned char>(word >> 24);
+                    data[position + 1] = static_cast<unsigned char>(word >> 16);
+                    data[position + 2] = static_cast<unsigned char>(word >> 8);
+                    data[position + 3] = static_cast<unsigned char>(word);
+                    position += 4;
+                }
+            }
+
+            void put_signed(const int32_t value, const unsigned n) {
+                put(n == 32 ? static_cast<uint32_t>(value) : static_cast<uint32_t>(value) & ((1u << n) - 1), n);
+            }
+
+            void zeros(uint64_t n) {
+                for (; n > 32; n -= 32) {
+                    put(0, 32);
+                }
+                put(0, static_cast<unsigned>(n));
+            }
+
+            void rice(const int32_t* residual, const uint32_t n, const unsigned k) {
+                /** Zigzag, then the quotient in unary and the low k bits, usually as one put **/
+                const uint32_t mask = (1u << k) - 1;
+                for (uint32_t i = 0; i < n; i++) {
+                    const uint32_t value = static_cast<uint32_t>(residual[i]) << 1 ^ static_cast<uint32_t>(residual[i] >> 31);
+                    const uint32_t quotient = value >> k;
+                    if (quotient + k < 32) {
+                        put(1u << k | (value & mask), quotient + k + 1);
+                    } else {
+                        zeros(quotient);
+                        put(1u << k | (value & mask), k + 1);
+                    }
+                }
+            }
+
+            uint64_t finish() {
+                /** Pad to a whole byte and flush, returns the bytes written **/
+                put(0, (8 - count % 8) % 8);
+                while (count >= 8) {
+                    count -= 8;
+                    data[position++] = static_cast<unsigned char>(cache >> count);
+                }
+                return position;
+            }
+
+            uint64_t tell() const {
+                return position * 8 + count;
+            }
+
+        private:
+            unsigned char* data;
+            uint64_t position = 0;
+            uint64_t cache = 0;
+            unsigned count = 0;
+        };
+
+        class MD5 {
+        public:
+            /** RFC 1321, STREAMINFO signs the samples as little-endian signed integers **/
+            void update(const unsigned char* in, uint64_t size) {
+                const uint64_t used = length % 64;
+                length += size;
+                if (used != 0) {
+                    const uint64_t step = std::min<uint64_t>(64 - used, size);
+                    std::memcpy(pending + used, in, step);
+                    in += step;
+                    size -= step;
+                    if (used + step < 64) {
+                        return;
+                    }
+                    block(pending);
+                }
+                for (; size >= 64; in += 64, size -= 64) {
+                    block(in);
+                }
+                std::memcpy(pending, in, size);
+            }
+
+            void finish(unsigned char* out) {
+                const uint64_t bits = length * 8;
+                unsigned char tail[72] = {0x80};
+                const uint64_t pad = (length % 64 < 56 ? 56 : 120) - length % 64;
+                for (int i = 0; i < 8; i++) {
+                    tail[pad + i] = static_cast<unsigned char>(bits >> (8 * i));
+                }
+                update(tail, pad + 8);
+                for (int i = 0; i < 16; i++) {
+                    out[i] = static_cast<unsigned char>(state[i / 4] >> (8 * (i % 4)));
+                }
+            }
+
+        private:
+            void block(const unsigned char* p) {
+                static const uint32_t K[64] = {
+                    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+                    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+                    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+                    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+                    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+                    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+                    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+                    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+                static const unsigned R[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+                uint32_t m[16];
+                for (int i = 0; i < 16; i++) {
+                    m[i] = static_cast<uint32_t>(p[4 * i]) | p[4 * i + 1] << 8 | p[4 * i + 2] << 16 | static_cast<uint32_t>(p[4 * i + 3]) << 24;
+                }
+                uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+                for (unsigned i = 0; i < 64; i++) {
+                    uint32_t f;
+                    unsigned g;
+                    if (i < 16) {
+                        f = (b & c) | (~b & d);
+                        g = i;
+                    } else if (i < 32) {
+                        f = (d & b) | (~d & c);
+                        g = (5 * i + 1) % 16;
+                    } else if (i < 48) {
+                        f = b ^ c ^ d;
+                        g = (3 * i + 5) % 16;
+                    } else {
+                        f = c ^ (b | ~d);
+                        g = 7 * i % 16;
+                    }
+                    f += a + K[i] + m[g];
+                    a = d;
+                    d = c;
+                    c = b;
+                    const unsigned r = R[i / 16 * 4 + i % 4];
+                    b += f << r | f >> (32 - r);
+                }
+                state[0] += a;
+                state[1] += b;
+                state[2] += c;
+                state[3] += d;
+            }
+
+            uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+            unsigned char pending[64]{};
+            uint64_t length = 0;
+        };
+
+        struct SUBFRAME {
+            /** How one channel of a frame gets coded, settled before anything is written **/
+            unsigned type = 1;                 // 0 constant, 1 verbatim, 8 fixed, 32 LPC
+            unsigned order = 0;
+            unsigned width = 0;                // Bits per sample once the wasted bits are gone
+            unsigned wasted = 0;
+            unsigned precision = 0;
+            int shift = 0;
+            int32_t coefficients[32]{};
+            unsigned partition = 0;
+            unsigned char parameters[64]{};    // Rice parameter of every partition
+            uint64_t bits = 0;                 // Exact size in bits
+            const int32_t* samples = nullptr;  // Input with the wasted bits shifted out
+            const int32_t* residual = nullptr;
+        };
+
+        static uint32_t zigzag(const int32_t value) {
+            return static_cast<uint32_t>(value) << 1 ^ static_cast<uint32_t>(value >> 31);
+        }
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static uint64_t avx2_widen(const __m256i sum) {
+            /** Sum of eight unsigned 32-bit lanes **/
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(sum)), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sum, 1))));
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+
+        WAVLIB_TARGET("avx2") static uint64_t avx2_magnitude(const int32_t* residual, uint32_t from, const uint32_t to) {
+            __m256i sum = _mm256_setzero_si256();
+            for (; from + 8 <= to; from += 8) {
+                const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(residual + from));
+                const __m256i u = _mm256_xor_si256(_mm256_slli_epi32(r, 1), _mm256_srai_epi32(r, 31));
+                sum = _mm256_add_epi64(sum, _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(u)), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(u, 1))));
+            }
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+            uint64_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            for (; from < to; from++) {
+                total += zigzag(residual[from]);
+            }
+            return total;
+        }
+#endif
+
+        static uint64_t magnitude(const int32_t* residual, const uint32_t from, const uint32_t to) {
+            /** Sum of the zigzagged residuals in [from, to) **/
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                return avx2_magnitude(residual, from, to);
+            }
+#endif
+            uint64_t total = 0;
+            for (uint32_t i = from; i < to; i++) {
+                total += zigzag(residual[i]);
+            }
+            return total;
+        }
+
+        static uint64_t rice(const int32_t* residual, const uint32_t block, const unsigned order, unsigned limit, SUBFRAME& sub) {
+            /** Pick the partition order and Rice parameters, returns the size of the residual section **/
+            /** The size is n * (k + 1) + (sum >> k) per partition, never below what write() produces **/
+            while (limit > 0 && ((block & ((1u << limit) - 1)) != 0 || (block >> limit) < order)) {
+                limit--;
+            }
+            uint64_t sums[64];
+            const uint32_t length = block >> limit;
+            for (uint32_t p = 0; p < (1u << limit); p++) {
+                sums[p] = magnitude(residual, p == 0 ? order : p * length, (p + 1) * length);
+            }
+
+            // Finest partitions first, each coarser order sums up pairs of the one before
+            uint64_t best = UINT64_MAX;
+            unsigned char parameters[64];
+            for (unsigned partition = limit + 1; partition-- > 0;) {
+                const uint32_t count = 1u << partition;
+                if (partition < limit) {
+                    for (uint32_t p = 0; p < count; p++) {
+                        sums[p] = sums[2 * p] + sums[2 * p + 1];
+                    }
+                }
+                uint64_t bits = 0;
+                bool wide = false;
+                for (uint32_t p = 0; p < count; p++) {
+                    const uint64_t n = (block >> partition) - (p == 0 ? order : 0);
+                    unsigned k = 0;
+                    while (k < 30 && (n << k) < sums[p]) {
+                        k++;
+                    }
+                    // Flooring takes half a bit off each quotient on average, which decides between k - 1 and k
+                    if (k > 0 && n * k + (sums[p] >> (k - 1)) - (k > 1 ? n / 2 : 0) <= n * (k + 1) + (sums[p] >> k) - n / 2) {
+                        k--;
+                    }
+                    parameters[p] = static_cast<unsigned char>(k);
+                    bits += n * (k + 1) + (sums[p] >> k);
+                    wide = wide || k > 14;
+                }
+                bits += static_cast<uint64_t>(wide ? 5 : 4) << partition;
+                if (bits < best) {
+                    best = bits;
+                    sub.partition = partition;
+                    std::memcpy(sub.parameters, parameters, count);
+                }
+            }
+            return best + 6;
+        }
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static void avx2_fixed_error(const int32_t* x, const uint32_t block, const unsigned width, uint64_t* total) {
+            /** Eight samples at a time from differences of shifted loads, 32-bit sums get widened before they can overflow **/
+            const uint32_t chunk = 1u << (width < 28 ? 28 - width : 0);
+            for (unsigned o = 0; o < 5; o++) {
+                total[o] = 0;
+            }
+            uint32_t i = 4;
+            while (i + 8 <= block) {
+                __m256i s0 = _mm256_setzero_si256();
+                __m256i s1 = _mm256_setzero_si256();
+                __m256i s2 = _mm256_setzero_si256();
+                __m256i s3 = _mm256_setzero_si256();
+                __m256i s4 = _mm256_setzero_si256();
+                for (uint32_t n = 0; n < chunk && i + 8 <= block; n++, i += 8) {
+                    const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                    const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 1));
+                    const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 2));
+                    const __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 3));
+                    const __m256i v4 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 4));
+                    const __m256i a1 = _mm256_sub_epi32(v0, v1);
+                    const __m256i b1 = _mm256_sub_epi32(v1, v2);
+                    const __m256i c1 = _mm256_sub_epi32(v2, v3);
+                    const __m256i d1 = _mm256_sub_epi32(v3, v4);
+                    const __m256i a2 = _mm256_sub_epi32(a1, b1);
+                    const __m256i b2 = _mm256_sub_epi32(b1, c1);
+                    const __m256i c2 = _mm256_sub_epi32(c1, d1);
+                    const __m256i a3 = _mm256_sub_epi32(a2, b2);
+                    const __m256i a4 = _mm256_sub_epi32(a3, _mm256_sub_epi32(b2, c2));
+                    s0 = _mm256_add_epi32(s0, _mm256_abs_epi32(v0));
+                    s1 = _mm256_add_epi32(s1, _mm256_abs_epi32(a1));
+                    s2 = _mm256_add_epi32(s2, _mm256_abs_epi32(a2));
+                    s3 = _mm256_add_epi32(s3, _mm256_abs_epi32(a3));
+                    s4 = _mm256_add_epi32(s4, _mm256_abs_epi32(a4));
+                }
+                total[0] += avx2_widen(s0);
+                total[1] += avx2_widen(s1);
+                total[2] += avx2_widen(s2);
+                total[3] += avx2_widen(s3);
+                total[4] += avx2_widen(s4);
+            }
+            for (; i < block; i++) {
+                const int64_t e1 = static_cast<int64_t>(x[i]) - x[i - 1];
+                const int64_t e2 = e1 - (static_cast<int64_t>(x[i - 1]) - x[i - 2]);
+                const int64_t e3 = e2 - (static_cast<int64_t>(x[i - 1]) - 2 * static_cast<int64_t>(x[i - 2]) + x[i - 3]);
+                const int64_t e4 = e3 - (static_cast<int64_t>(x[i - 1]) - 3 * static_cast<int64_t>(x[i - 2]) + 3 * static_cast<int64_t>(x[i - 3]) - x[i - 4]);
+                total[0] += static_cast<uint64_t>(std::llabs(x[i]));
+                total[1] += static_cast<uint64_t>(std::llabs(e1));
+                total[2] += static_cast<uint64_t>(std::llabs(e2));
+                total[3] += static_cast<uint64_t>(std::llabs(e3));
+                total[4] += static_cast<uint64_t>(std::llabs(e4));
+            }
+        }
+
+        WAVLIB_TARGET("avx2") static void avx2_window(const int32_t* x, const double* window, const uint32_t block, double* out) {
+            uint32_t i = 0;
+            for (; i + 4 <= block; i += 4) {
+                const __m256d value = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(value, _mm256_loadu_pd(window + i)));
+            }
+            for (; i < block; i++) {
+                out[i] = x[i] * window[i];
+            }
+        }
+#endif
+
+        static void fixed_error(const int32_t* x, const uint32_t block, const unsigned width, uint64_t* total) {
+            /** Sum of absolute residuals of the fixed predictors 0 to 4, skipping the first four samples **/
+#if WAVLIB_X86
+            // Up to 27 bits every difference fits in 32
+            if (width <= 27 && CPU::avx2()) {
+                return avx2_fixed_error(x, block, width, total);
+            }
+#else
+            static_cast<void>(width);
+#endif
+            int64_t a = x[3];
+            int64_t b = a - x[2];
+            int64_t c = b - (static_cast<int64_t>(x[2]) - x[1]);
+            int64_t d = c - (static_cast<int64_t>(x[2]) - 2 * static_cast<int64_t>(x[1]) + x[0]);
+            uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0;
+            for (uint32_t i = 4; i < block; i++) {
+                const int64_t e0 = x[i];
+                const int64_t e1 = e0 - a;
+                const int64_t e2 = e1 - b;
+                const int64_t e3 = e2 - c;
+                const int64_t e4 = e3 - d;
+                t0 += static_cast<uint64_t>(e0 < 0 ? -e0 : e0);
+                t1 += static_cast<uint64_t>(e1 < 0 ? -e1 : e1);
+                t2 += static_cast<uint64_t>(e2 < 0 ? -e2 : e2);
+                t3 += static_cast<uint64_t>(e3 < 0 ? -e3 : e3);
+                t4 += static_cast<uint64_t>(e4 < 0 ? -e4 : e4);
+                a = e0;
+                b = e1;
+                c = e2;
+                d = e3;
+            }
+            total[0] = t0;
+            total[1] = t1;
+            total[2] = t2;
+            total[3] = t3;
+            total[4] = t4;
+        }
+
+        static void fixed_residual(const int32_t* x, const uint32_t block, const unsigned order, int32_t* r) {
+            /** Inverse of fixed(), wraps the same way so the decoder gets x back **/
+            const auto* u = reinterpret_cast<const uint32_t*>(x);
+            auto* out = reinterpret_cast<uint32_t*>(r);
+            switch (order) {
+                case 0:
+                    std::memcpy(out, u, block * sizeof(uint32_t));
+                    break;
+                case 1:
+                    for (uint32_t i = 1; i < block; i++) {
+                        out[i] = u[i] - u[i - 1];
+                    }
+                    break;
+                case 2:
+                    for (uint32_t i = 2; i < block; i++) {
+                        out[i] = u[i] - 2 * u[i - 1] + u[i - 2];
+                    }
+                    break;
+                case 3:
+                    for (uint32_t i = 3; i < block; i++) {
+                        out[i] = u[i] - 3 * u[i - 1] + 3 * u[i - 2] - u[i - 3];
+                    }
+                    break;
+                default:
+                    for (uint32_t i = 4; i < block; i++) {
+                        out[i] = u[i] - 4 * u[i - 1] + 6 * u[i - 2] - 4 * u[i - 3] + u[i - 4];
+                    }
+                    break;
+            }
+        }
+
+        static const double* tukey(const uint32_t block) {
+            /** Tukey window with half of it tapered, cached per thread for the current block size **/
+            static thread_local std::vector<double> window;
+            if (window.size() != block) {
+                window.assign(block, 1.0);
+                const auto taper = static_cast<int64_t>(0.25 * block) - 1;
+                for (int64_t n = 0; taper > 0 && n <= taper; n++) {
+                    window[n] = 0.5 - 0.5 * std::cos(WAVLIB_PI * static_cast<double>(n) / static_cast<double>(taper));
+                    window[block - taper - 1 + n] = 0.5 - 0.5 * std::cos(WAVLIB_PI * static_cast<double>(n + taper) / static_cast<double>(taper));
+                }
+            }
+            return window.data();
+        }
+
+        template<size_t... G>
+        static void autocorrelation(const double* x, const uint32_t block, double* out, std::index_sequence<G...>) {
+            /** out[lag] = sum(x[i] * x[i + lag]), vector lanes run over the lags so no horizontal sums are needed **/
+            /** x needs zeros past block for the highest lag, the folds keep every sum in a register **/
+#if WAVLIB_SSE2
+            __m128d sum[sizeof...(G)] = {((void)G, _mm_setzero_pd())...};
+            for (uint32_t i = 0; i < block; i++) {
+                const __m128d v = _mm_set1_pd(x[i]);
+                ((sum[G] = _mm_add_pd(sum[G], _mm_mul_pd(v, _mm_loadu_pd(x + i + 2 * G)))), ...);
+            }
+            (_mm_storeu_pd(out + 2 * G, sum[G]), ...);
+#elif WAVLIB_NEON && defined(__aarch64__)
+            float64x2_t sum[sizeof...(G)] = {((void)G, vdupq_n_f64(0.0))...};
+            for (uint32_t i = 0; i < block; i++) {
+                ((sum[G] = vfmaq_n_f64(sum[G], vld1q_f64(x + i + 2 * G), x[i])), ...);
+            }
+            (vst1q_f64(out + 2 * G, sum[G]), ...);
+#else
+            for (unsigned lag = 0; lag < 2 * sizeof...(G); lag++) {
+                double sum = 0.0;
+                for (uint32_t i = 0; i < block; i++) {
+                    sum += x[i] * x[i + lag];
+                }
+                out[lag] = sum;
+            }
+#endif
+        }
+
+#if WAVLIB_X86
+        template<size_t... G>
+        WAVLIB_TARGET("avx2") static void avx2_autocorrelation(const double* x, const uint32_t block, double* out, std::index_sequence<G...>) {
+            // Two sets of sums, even and odd samples, so the adds don't wait on each other
+            __m256d sum[sizeof...(G)] = {((void)G, _mm256_setzero_pd())...};
+            __m256d odd[sizeof...(G)] = {((void)G, _mm256_setzero_pd())...};
+            uint32_t i = 0;
+            for (; i + 2 <= block; i += 2) {
+                const __m256d v = _mm256_broadcast_sd(x + i);
+                const __m256d w = _mm256_broadcast_sd(x + i + 1);
+                ((sum[G] = _mm256_add_pd(sum[G], _mm256_mul_pd(v, _mm256_loadu_pd(x + i + 4 * G)))), ...);
+                ((odd[G] = _mm256_add_pd(odd[G], _mm256_mul_pd(w, _mm256_loadu_pd(x + i + 1 + 4 * G)))), ...);
+            }
+            for (; i < block; i++) {
+                const __m256d v = _mm256_broadcast_sd(x + i);
+                ((sum[G] = _mm256_add_pd(sum[G], _mm256_mul_pd(v, _mm256_loadu_pd(x + i + 4 * G)))), ...);
+            }
+            (_mm256_storeu_pd(out + 4 * G, _mm256_add_pd(sum[G], odd[G])), ...);
+        }
+#endif
+
+        static void autocorrelation(const double* x, const uint32_t block, const unsigned lags, double* out) {
+            /** lags up to 16, out needs room for lags rounded up to 4 **/
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                switch ((lags + 3) / 4) {
+                    case 1: return avx2_autocorrelation(x, block, out, std::make_index_sequence<1>());
+                    case 2: return avx2_autocorrelation(x, block, out, std::make_index_sequence<2>());
+                    case 3: return avx2_autocorrelation(x, block, out, std::make_index_sequence<3>());
+                    default: return avx2_autocorrelation(x, block, out, std::make_index_sequence<4>());
+                }
+            }
+#endif
+            switch ((lags + 1) / 2) {
+                case 1: return autocorrelation(x, block, out, std::make_index_sequence<1>());
+                case 2: return autocorrelation(x, block, out, std::make_index_sequence<2>());
+                case 3: return autocorrelation(x, block, out, std::make_index_sequence<3>());
+                case 4: return autocorrelation(x, block, out, std::make_index_sequence<4>());
+                case 5: return autocorrelation(x, block, out, std::make_index_sequence<5>());
+                case 6: return autocorrelation(x, block, out, std::make_index_sequence<6>());
+                case 7: return autocorrelation(x, block, out, std::make_index_sequence<7>());
+                default: return autocorrelation(x, block, out, std::make_index_sequence<8>());
+            }
+        }
+
+        static unsigned levinson(const double* autoc, const unsigned order, double (*lp)[32], double* error) {
+            /** Levinson-Durbin, lp[i] predicts with order i + 1, returns how many orders came out usable **/
+            double a[32];
+            double err = autoc[0];
+            for (unsigned i = 0; i < order; i++) {
+                double r = -autoc[i + 1];
+                for (unsigned j = 0; j < i; j++) {
+                    r -= a[j] * autoc[i - j];
+                }
+                r /= err;
+                a[i] = r;
+                unsigned j = 0;
+                for (; j < (i >> 1); j++) {
+                    const double t = a[j];
+                    a[j] += r * a[i - 1 - j];
+                    a[i - 1 - j] += r * t;
+                }
+                if (i & 1) {
+                    a[j] += a[j] * r;
+                }
+                err *= 1.0 - r * r;
+                for (j = 0; j <= i; j++) {
+                    lp[i][j] = -a[j];
+                }
+                error[i] = err;
+                if (!(err > 0.0)) {
+                    return i + 1;
+                }
+            }
+            return order;
+        }
+
+        static bool quantize(const double* lp, const unsigned order, unsigned precision, int32_t* q, int& shift) {
+            /** Coefficients to precision-bit integers, the rounding error carries over to the next one **/
+            double top = 0.0;
+            for (unsigned i = 0; i < order; i++) {
+                top = std::max(top, std::fabs(lp[i]));
+            }
+            if (!(top > 0.0)) {
+                return false;
+            }
+            int log2;
+            std::frexp(top, &log2);
+            precision--;
+            shift = static_cast<int>(precision) - log2;
+            if (shift > 15) {
+                shift = 15;
+            } else if (shift < 0) {
+                return false;
+            }
+            const int64_t high = (int64_t(1) << precision) - 1;
+            const int64_t low = -(int64_t(1) << precision);
+            double error = 0.0;
+            for (unsigned i = 0; i < order; i++) {
+                error += lp[i] * static_cast<double>(1 << shift);
+                const int64_t value = std::min(high, std::max(low, static_cast<int64_t>(std::lround(error))));
+                error -= static_cast<double>(value);
+                q[i] = static_cast<int32_t>(value);
+            }
+            return true;
+        }
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static uint32_t avx2_lpc_residual(const int32_t* x, const uint32_t block, const int32_t* q, const unsigned order, const int shift, int32_t* r) {
+            /** Eight predictions at a time, unlike the decoder nothing depends on the previous output **/
+            __m256i c[32];
+            for (unsigned j = 0; j < order; j++) {
+                c[j] = _mm256_set1_epi32(q[j]);
+            }
+            const __m128i count = _mm_cvtsi32_si128(shift);
+            uint32_t i = order;
+            for (; i + 8 <= block; i += 8) {
+                __m256i sum = _mm256_setzero_si256();
+                for (unsigned j = 0; j < order; j++) {
+                    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(c[j], _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i - 1 - j))));
+                }
+                const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_sub_epi32(value, _mm256_sra_epi32(sum, count)));
+            }
+            return i;
+        }
+#endif
+
+        static bool lpc_residual(const int32_t* x, const uint32_t block, const int32_t* q, const unsigned order, const int shift, const bool narrow, int32_t* r) {
+            /** Inverse of lpc(), false if a residual doesn't fit in 32 bits **/
+            if (narrow) {
+                uint32_t i = order;
+#if WAVLIB_X86
+                if (CPU::avx2()) {
+                    i = avx2_lpc_residual(x, block, q, order, shift, r);
+                }
+#endif
+                const auto* u = reinterpret_cast<const uint32_t*>(x);
+                for (; i < block; i++) {
+                    uint32_t sum = 0;
+                    for (unsigned j = 0; j < order; j++) {
+                        sum += static_cast<uint32_t>(q[j]) * u[i - 1 - j];
+                    }
+                    r[i] = static_cast<int32_t>(u[i] - static_cast<uint32_t>(static_cast<int32_t>(sum) >> shift));
+                }
+                return true;
+            }
+            for (uint32_t i = order; i < block; i++) {
+                int64_t sum = 0;
+                for (unsigned j = 0; j < order; j++) {
+                    sum += static_cast<int64_t>(q[j]) * x[i - 1 - j];
+                }
+                const int64_t value = x[i] - (sum >> shift);
+                if (value < INT32_MIN || value > INT32_MAX) {
+                    return false;
+                }
+                r[i] = static_cast<int32_t>(value);
+            }
+            return true;
+        }
+
+        static unsigned precision(const unsigned bits, const uint32_t block) {
+            /** Coefficient precision of the reference encoder, finer for longer blocks **/
+            if (bits < 16) {
+                return std::max(5u, 2 + bits / 2);
+            }
+            if (bits == 16) {
+                return block <= 192 ? 7 : block <= 384 ? 8 : block <= 576 ? 9 : block <= 1152 ? 10 : block <= 2304 ? 11 : block <= 4608 ? 12 : 13;
+            }
+            return block <= 384 ? 13 : 14;
+        }
+
+        static uint64_t guess(const int32_t* x, const uint32_t block, const unsigned width) {
+            /** Cheap size estimate for picking a stereo mode, the smallest fixed predictor error **/
+            if (block <= 4) {
+                return 0;
+            }
+            uint64_t total[5];
+            fixed_error(x, block, width, total);
+            return *std::min_element(total, total + 5);
+        }
+
+        static void plan(const int32_t* x, const uint32_t block, const unsigned bits, const LEVEL& level, WORKSPACE& workspace, SUBFRAME& sub) {
+            /** Settle on the smallest of constant, verbatim, fixed and LPC for one channel **/
+            sub = SUBFRAME();
+            uint32_t any = 0;
+            uint32_t differ = 0;
+            for (uint32_t i = 0; i < block; i++) {
+                any |= static_cast<uint32_t>(x[i]);
+                differ |= static_cast<uint32_t>(x[i] ^ x[0]);
+            }
+            sub.samples = x;
+            sub.width = bits;
+            if (differ == 0) {
+                sub.type = 0;
+                sub.bits = 8 + bits;
+                return;
+            }
+
+            // Trailing zero bits shared by every sample are coded once
+            unsigned wasted = 0;
+            while (((any >> wasted) & 1) == 0) {
+                wasted++;
+            }
+            if (wasted != 0) {
+                int32_t* shifted = workspace.allocate<int32_t>(block);
+                for (uint32_t i = 0; i < block; i++) {
+                    shifted[i] = x[i] >> wasted;
+                }
+                sub.samples = shifted;
+                sub.wasted = wasted;
+                sub.width = bits - wasted;
+            }
+            const int32_t* s = sub.samples;
+            const unsigned width = sub.width;
+            const uint64_t head = 8 + wasted;
+            sub.bits = head + static_cast<uint64_t>(block) * width;
+
+            int32_t* best = workspace.allocate<int32_t>(block);
+            int32_t* trial = workspace.allocate<int32_t>(block);
+            SUBFRAME candidate = sub;
+            auto keep = [&]() {
+                if (candidate.bits < sub.bits) {
+                    candidate.residual = trial;
+                    sub = candidate;
+                    std::swap(best, trial);
+                }
+            };
+
+            // Fixed predictors, as long as the residual provably fits in 32 bits
+            const unsigned most = std::min(4u, 32 - width);
+            if (block > 4) {
+                uint64_t total[5];
+                fixed_error(s, block, width, total);
+                unsigned order = 0;
+                for (unsigned o = 1; o <= most; o++) {
+                    if (total[o] < total[order]) {
+                        order = o;
+                    }
+                }
+                fixed_residual(s, block, order, trial);
+                candidate.type = 8;
+                candidate.order = order;
+                candidate.bits = head + order * width + rice(trial, block, order, level.partition, candidate);
+                keep();
+            }
+
+            if (level.order == 0 || block <= level.order) {
+                return;
+            }
+            double* windowed = workspace.allocate<double>(block + 16);
+            const double* window = tukey(block);
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                avx2_window(s, window, block, windowed);
+            } else
+#endif
+            for (uint32_t i = 0; i < block; i++) {
+                windowed[i] = s[i] * window[i];
+            }
+            std::fill(windowed + block, windowed + block + 16, 0.0);
+            double autoc[16];
+            autocorrelation(windowed, block, level.order + 1, autoc);
+            if (!(autoc[0] > 0.0)) {
+                return;
+            }
+            double lp[32][32];
+            double error[32];
+            const unsigned orders = levinson(autoc, level.order, lp, error);
+            unsigned resolution = precision(bits, block);
+
+            // Orders from the expected residual size, the way the reference encoder guesses
+            unsigned first = 1;
+            unsigned last = orders;
+            if (!level.exhaustive) {
+                const double scale = 0.5 / block;
+                double lowest = 0.0;
+                for (unsigned o = 1; o <= orders; o++) {
+                    const double per = error[o - 1] > 0.0 ? std::max(0.0, 0.5 * std::log2(scale * error[o - 1])) : error[o - 1] < 0.0 ? 1e32 : 0.0;
+                    const double estimate = per * (block - o) + static_cast<double>(o * (resolution + width));
+                    if (o == 1 || estimate < lowest) {
+                        lowest = estimate;
+                        first = o;
+                    }
+                }
+                last = first;
+            }
+            for (unsigned order = first; order <= last; order++) {
+                unsigned log2 = 0;
+                while ((2u << log2) <= order) {
+                    log2++;
+                }
+                // Short samples keep the sum in 32 bits, so both sides can use the narrow path
+                unsigned p = resolution;
+                if (width <= 17 && width + p + log2 > 32) {
+                    p = 32 - width - log2;
+                }
+                candidate.type = 32;
+                candidate.order = order;
+                candidate.precision = p;
+                if (!quantize(lp[order - 1], order, p, candidate.coefficients, candidate.shift)) {
+                    continue;
+                }
+                if (!lpc_residual(s, block, candidate.coefficients, order, candidate.shift, width + p + log2 <= 32, trial)) {
+                    continue;
+                }
+                candidate.bits = head + order * width + 9 + order * p + rice(trial, block, order, level.partition, candidate);
+                keep();
+            }
+        }
+
+        static void write(PACK& pack, const SUBFRAME& sub, const uint32_t block) {
+            /** Mirror of subframe() **/
+            const unsigned code = sub.type == 8 ? 8 + sub.order : sub.type == 32 ? 31 + sub.order : sub.type;
+            pack.put(code << 1 | (sub.wasted != 0), 8);
+            if (sub.wasted != 0) {
+                pack.put(1, sub.wasted);
+            }
+            if (sub.type == 0) {
+                pack.put_signed(sub.samples[0], sub.width);
+                return;
+            }
+            const uint32_t warmup = sub.type == 1 ? block : sub.order;
+            for (uint32_t i = 0; i < warmup; i++) {
+                pack.put_signed(sub.samples[i], sub.width);
+            }
+            if (sub.type == 1) {
+                return;
+            }
+            if (sub.type == 32) {
+                pack.put(sub.precision - 1, 4);
+                pack.put_signed(sub.shift, 5);
+                for (unsigned i = 0; i < sub.order; i++) {
+                    pack.put_signed(sub.coefficients[i], sub.precision);
+                }
+            }
+            const uint32_t count = 1u << sub.partition;
+            bool wide = false;
+            for (uint32_t p = 0; p < count; p++) {
+                wide = wide || sub.parameters[p] > 14;
+            }
+            pack.put(wide, 2);
+            pack.put(sub.partition, 4);
+            const uint32_t length = block >> sub.partition;
+            for (uint32_t p = 0; p < count; p++) {
+                const uint32_t from = p == 0 ? sub.order : p * length;
+                pack.put(sub.parameters[p], wide ? 5 : 4);
+                pack.rice(sub.residual + from, (p + 1) * length - from, sub.parameters[p]);
+            }
+        }
+
+        static void split(const int32_t* in, const unsigned channels, const uint32_t n, const unsigned bits, int32_t* planes, const uint64_t stride) {
+            /** Interleaved samples from the WAV container to channel planes, the inverse of interleave() **/
+            const int32_t offset = bits <= 8 ? 128 : 0;
+            uint32_t i = 0;
+#if WAVLIB_SSE2
+            if (channels == 2) {
+                const __m128i bias = _mm_set1_epi32(offset);
+                for (; i + 4 <= n; i += 4) {
+                    // L0 R0 L1 R1 and L2 R2 L3 R3 to L0 L1 R0 R1 and L2 L3 R2 R3
+                    const __m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), 0xD8);
+                    const __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 4)), 0xD8);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(planes + i), _mm_sub_epi32(_mm_unpacklo_epi64(a, b), bias));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(planes + stride + i), _mm_sub_epi32(_mm_unpackhi_epi64(a, b), bias));
+                }
+            }
+#elif WAVLIB_NEON
+            if (channels == 2) {
+                const int32x4_t bias = vdupq_n_s32(offset);
+                for (; i + 4 <= n; i += 4) {
+                    const int32x4x2_t pair = vld2q_s32(in + 2 * i);
+                    vst1q_s32(planes + i, vsubq_s32(pair.val[0], bias));
+                    vst1q_s32(planes + stride + i, vsubq_s32(pair.val[1], bias));
+                }
+            }
+#endif
+            for (unsigned c = 0; c < channels; c++) {
+                int32_t* plane = planes + c * stride;
+                for (uint32_t j = i; j < n; j++) {
+                    plane[j] = in[j * channels + c] - offset;
+                }
+            }
+        }
+
+        static uint64_t compress(const int32_t* planes, const uint64_t stride, const FORMAT::FLAC& info, const uint32_t block, const uint64_t number, const LEVEL& level, unsigned char* out) {
+            /** Code one frame of block samples per channel into out, which holds bound(info) bytes, returns its size **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const unsigned channels = info.channels;
+            const unsigned bits = info.sample_size;
+            SUBFRAME sub[8];
+            const SUBFRAME* order[8];
+            unsigned assignment = channels - 1;
+            if (channels == 2 && level.stereo && bits <= 30) {
+                const int32_t* left = planes;
+                const int32_t* right = planes + stride;
+                int32_t* mid = workspace.allocate<int32_t>(block);
+                int32_t* side = workspace.allocate<int32_t>(block);
+                for (uint32_t i = 0; i < block; i++) {
+                    side[i] = left[i] - right[i];
+                    mid[i] = (left[i] + right[i]) >> 1;
+                }
+                const int32_t* source[4] = {left, right, mid, side};
+                const unsigned width[4] = {bits, bits, bits, bits + 1};
+                // Independent, left/side, side/right and mid/side, as pairs of the four channels
+                static const unsigned pairs[4][2] = {{0, 1}, {0, 3}, {3, 1}, {2, 3}};
+                uint64_t cost[4];
+                unsigned mode = 0;
+                if (level.loose) {
+                    for (unsigned c = 0; c < 4; c++) {
+                        cost[c] = guess(source[c], block, width[c]);
+                    }
+                } else {
+                    for (unsigned c = 0; c < 4; c++) {
+                        plan(source[c], block, width[c], level, workspace, sub[c]);
+                        cost[c] = sub[c].bits;
+                    }
+                }
+                for (unsigned m = 1; m < 4; m++) {
+                    if (cost[pairs[m][0]] + cost[pairs[m][1]] < cost[pairs[mode][0]] + cost[pairs[mode][1]]) {
+                        mode = m;
+                    }
+                }
+                for (unsigned c = 0; c < 2; c++) {
+                    const unsigned pick = pairs[mode][c];
+                    if (level.loose) {
+                        plan(source[pick], block, width[pick], level, workspace, sub[4 + c]);
+                        order[c] = &sub[4 + c];
+                    } else {
+                        order[c] = &sub[pick];
+                    }
+                }
+                assignment = mode == 0 ? 1 : 7 + mode;
+            } else {
+                for (unsigned c = 0; c < channels; c++) {
+                    plan(planes + c * stride, block, bits, level, workspace, sub[c]);
+                    order[c] = &sub[c];
+                }
+            }
+
+            // Frame header, fixed block size so the number counts frames
+            static const unsigned rates[12] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+            static const unsigned sizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+            unsigned block_code = block <= 256 ? 6 : 7;
+            if (block == 192) {
+                block_code = 1;
+            }
+            for (unsigned k = 0; k < 4; k++) {
+                block_code = block == 576u << k ? 2 + k : block_code;
+            }
+            for (unsigned k = 0; k < 8; k++) {
+                block_code = block == 256u << k ? 8 + k : block_code;
+            }
+            const unsigned rate = info.sample_rate;
+            unsigned rate_code = rate % 1000 == 0 && rate / 1000 <= 255 ? 12 : rate <= 65535 ? 13 : rate % 10 == 0 && rate / 10 <= 65535 ? 14 : 0;
+            for (unsigned k = 1; k < 12; k++) {
+                rate_code = rate == rates[k] ? k : rate_code;
+            }
+            unsigned size_code = 0;
+            for (unsigned k = 1; k < 8; k++) {
+                size_code = bits == sizes[k] ? k : size_code;
+            }
+            uint64_t p = 0;
+            out[p++] = 0xFF;
+            out[p++] = 0xF8;
+            out[p++] = static_cast<unsigned char>(block_code << 4 | rate_code);
+            out[p++] = static_cast<unsigned char>(assignment << 4 | size_code << 1);
+            if (number < 0x80) {
+                out[p++] = static_cast<unsigned char>(number);
+            } else {
+                unsigned extra = 1;
+                while (extra < 6 && number >= uint64_t(1) << (6 * extra + 6 - extra)) {
+                    extra++;
+                }
+                out[p++] = static_cast<unsigned char>((0xFF00 >> (extra + 1)) | number >> (6 * extra));
+                for (unsigned k = extra; k-- > 0;) {
+                    out[p++] = static_cast<unsigned char>(0x80 | (number >> (6 * k) & 0x3F));
+                }
+            }
+            if (block_code == 6) {
+                out[p++] = static_cast<unsigned char>(block - 1);
+            } else if (block_code == 7) {
+                out[p++] = static_cast<unsigned char>((block - 1) >> 8);
+                out[p++] = static_cast<unsigned char>(block - 1);
+            }
+            if (rate_code == 12) {
+                out[p++] = static_cast<unsigned char>(rate / 1000);
+            } else if (rate_code == 13 || rate_code == 14) {
+                const unsigned value = rate_code == 13 ? rate : rate / 10;
+                out[p++] = static_cast<unsigned char>(value >> 8);
+                out[p++] = static_cast<unsigned char>(value);
+            }
+            out[p] = crc8(out, p);
+            p++;
+
+            PACK pack(out + p);
+            for (unsigned c = 0; c < channels; c++) {
+                write(pack, *order[c], block);
+            }
+            p += pack.finish();
+            const uint16_t crc = crc16(out, p);
+            out[p++] = static_cast<unsigned char>(crc >> 8);
+            out[p++] = static_cast<unsigned char>(crc);
+            return p;
+        }
+
+        static std::string preamble(const FORMAT::FLAC& info) {
+            /** fLaC, STREAMINFO and the seek table, which is left out when it has no points **/
+            std::string out("fLaC", 4);
+            auto put = [&out](const uint64_t value, const unsigned bytes) {
+                for (unsigned k = bytes; k-- > 0;) {
+                    out.push_back(static_cast<char>(value >> (8 * k)));
+                }
+            };
+            put((info.seek.empty() ? 0x80u : 0u) << 24 | 34, 4);
+            put(info.min_block, 2);
+            put(info.max_block, 2);
+            put(info.min_frame, 3);
+            put(info.max_frame, 3);
+            const uint64_t frames = info.frames >> 36 ? 0 : info.frames;
+            put(static_cast<uint64_t>(info.sample_rate) << 44 | static_cast<uint64_t>(info.channels - 1) << 41 | static_cast<uint64_t>(info.sample_size - 1) << 36 | frames, 8);
+            out.append(reinterpret_cast<const char*>(info.md5), 16);
+            if (!info.seek.empty()) {
+                put(0x83u << 24 | static_cast<uint32_t>(info.seek.size() * 18), 4);
+                for (const FORMAT::FLAC::SEEKPOINT& point : info.seek) {
+                    put(point.sample, 8);
+                    put(point.offset, 8);
+                    put(point.samples, 2);
+                }
+            }
+            return out;
+        }
+
+        static bool encode(std::ostream& file, const FORMAT::WAV& audio, const unsigned preset) {
+            /** Frames are coded in parallel on the shared pool, whichever thread finishes the next group in line writes it **/
+            /** so the stream goes out in order without waiting for the whole file **/
+            WAVLIB_SCOPE("FLAC::encode");
+            const FORMAT::SAMPLE type = PCM::type(audio.format, audio.sample_size);
+            if (!file || audio.channels == 0 || audio.channels > 8 || audio.sample_rate == 0 || audio.sample_rate >= 1 << 20 ||
+                (type != FORMAT::SAMPLE::U8 && type != FORMAT::SAMPLE::S16 && type != FORMAT::SAMPLE::S24 && type != FORMAT::SAMPLE::S32)) {
+                return false;
+            }
+            const LEVEL level = FLAC::level(preset);
+            FORMAT::FLAC info;
+            info.min_block = static_cast<unsigned short>(level.block);
+            info.max_block = static_cast<unsigned short>(level.block);
+            info.sample_rate = audio.sample_rate;
+            info.channels = audio.channels;
+            info.sample_size = audio.sample_size;
+            info.frames = audio.audio.size() / audio.channels;
+            const uint64_t frames = (info.frames + level.block - 1) / level.block;
+
+            // A seek point every 10 seconds, filled in as the frames go out
+            const uint64_t interval = std::max<uint64_t>(1, 10ull * audio.sample_rate / level.block);
+            for (uint64_t f = 0; f < frames; f += interval) {
+                info.seek.push_back({UINT64_MAX, 0, 0});
+            }
+            const std::streampos start = file.tellp();
+            const std::string head = preamble(info);
+            file.write(head.data(), static_cast<std::streamsize>(head.size()));
+
+            struct GROUP {
+                std::vector<unsigned char> data;
+                std::vector<uint32_t> sizes;
+                bool ready = false;
+            };
+            const uint64_t span = std::max<uint64_t>(1, (1 << 16) / level.block);
+            const uint64_t tasks = (frames + span - 1) / span;
+            std::vector<GROUP> groups(tasks);
+            const uint64_t bound = FLAC::bound(info);
+            const unsigned width = static_cast<unsigned>(PCM::bytes(type));
+            std::mutex lock;
+            uint64_t next = 0;
+            bool writing = false;
+            uint64_t offset = 0;
+            uint32_t smallest = UINT32_MAX;
+            uint32_t largest = 0;
+            MD5 md5;
+            std::vector<unsigned char> raw;
+            std::atomic<bool> failed{false};
+
+            auto flush = [&](const uint64_t g) {
+                // Only ever one thread in here, groups arrive in order
+                GROUP& group = groups[g];
+                file.write(reinterpret_cast<const char*>(group.data.data()), static_cast<std::streamsize>(group.data.size()));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                WAVLIB_COUNT(BYTES_WRITTEN, group.data.size());
+                if (!file) {
+                    failed = true;
+                }
+                for (uint64_t k = 0; k < group.sizes.size(); k++) {
+                    const uint64_t f = g * span + k;
+                    if (f % interval == 0) {
+                        const uint64_t sample = f * level.block;
+                        info.seek[f / interval] = {sample, offset, static_cast<unsigned short>(std::min<uint64_t>(level.block, info.frames - sample))};
+                    }
+                    offset += group.sizes[k];
+                    // The last frame is allowed to be short, it doesn't count towards the smallest
+                    if (f + 1 < frames || frames == 1) {
+                        smallest = std::min(smallest, group.sizes[k]);
+                    }
+                    largest = std::max(largest, group.sizes[k]);
+                }
+                const uint64_t first = g * span * level.block * audio.channels;
+                const uint64_t count = std::min<uint64_t>(span * level.block * audio.channels, audio.audio.size() - first);
+                raw.resize(count * width);
+                PCM::encode(audio.audio.data() + first, count, type, reinterpret_cast<char*>(raw.data()));
+                if (type == FORMAT::SAMPLE::U8) {
+                    for (unsigned char& byte : raw) {
+                        byte ^= 0x80;
+                    }
+                }
+                md5.update(raw.data(), raw.size());
+                std::vector<unsigned char>().swap(group.data);
+            };
+
+            POOL::shared().run(tasks, [&](const uint64_t g) {
+                if (failed) {
+                    return;
+                }
+                GROUP& group = groups[g];
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                int32_t* planes = workspace.allocate<int32_t>(static_cast<uint64_t>(level.block) * audio.channels);
+                const uint64_t end = std::min(frames, (g + 1) * span);
+                group.data.resize((end - g * span) * bound);
+                uint64_t used = 0;
+                for (uint64_t f = g * span; f < end; f++) {
+                    const uint64_t sample = f * level.block;
+                    const auto block = static_cast<uint32_t>(std::min<uint64_t>(level.block, info.frames - sample));
+                    split(audio.audio.data() + sample * audio.channels, audio.channels, block, info.sample_size, planes, level.block);
+                    const uint64_t size = compress(planes, level.block, info, block, f, level, group.data.data() + used);
+                    group.sizes.push_back(static_cast<uint32_t>(size));
+                    used += size;
+                }
+                group.data.resize(used);
+
+                std::unique_lock<std::mutex> guard(lock);
+                group.ready = true;
+                if (writing) {
+                    return;
+                }
+                writing = true;
+                while (next < tasks && groups[next].ready) {
+                    const uint64_t current = next;
+                    guard.unlock();
+                    flush(current);
+                    guard.lock();
+                    next++;
+                }
+                writing = false;
+            });
+            if (failed || next != tasks) {
+                return false;
+            }
+
+            // Sizes, signature and seek points go back into the header when the stream can seek
+            info.min_frame = frames == 0 ? 0 : smallest;
+            info.max_frame = largest;
+            md5.finish(info.md5);
+            const std::streampos end = file.tellp();
+            if (start != std::streampos(-1) && end != std::streampos(-1)) {
+                const std::string done = preamble(info);
+                file.seekp(start);
+                file.write(done.data(), static_cast<std::streamsize>(done.size()));
+                file.seekp(end);
+            }
+            file.flush();
+            return static_cast<bool>(file);
+        }
+    };
+
+    struct MP3 {
+        /** MPEG-1, 2 and 2.5 Layer III decoding **/
+        /** Frames share the bit reservoir and the filterbank state, but both settle within two granules, so any run **/
+        /** of frames decodes on its own, and exactly as in one pass, once it starts that early with a primed reservoir **/
+
+        struct HEADER {
+            bool lsf{};                   // MPEG-2 or 2.5, one granule per frame and another scalefactor coding
+            unsigned table{};             // Row of the scalefactor band tables, 0-2 MPEG-1, 3-5 MPEG-2, 6-8 MPEG-2.5
+            unsigned sample_rate{};       // Number of Samples per second
+            unsigned bitrate{};           // Bits per second
+            unsigned channels{};          // Number of Channels
+            unsigned extension{};         // Joint stereo tools, 2 is mid/side and 1 intensity
+            unsigned granules{};          // 576 samples per channel each
+            unsigned side{};              // Bytes of header, CRC and side info
+            uint64_t size{};              // Bytes of the whole frame
+        };
+
+        struct GRANULE {
+            unsigned length{};            // Bits of scalefactors and Huffman data
+            unsigned big{};               // Lines in the big value region
+            int gain{};                   // Global gain
+            unsigned compress{};          // Scalefactor compression
+            unsigned block{};             // 0 long, 1 start, 2 short, 3 stop
+            bool mixed{};                 // Short blocks with the two lowest subbands long
+            unsigned tables[3]{};         // Huffman table of each big value region
+            int subgain[3]{};             // Gain offset of each short window
+            unsigned region[2]{};         // First line of the second and the third region
+            bool preflag{};               // Long scalefactors get the pretab added
+            unsigned scale{};             // Scalefactor step, 0 is sqrt(2) and 1 is 2
+            unsigned quads{};             // Count1 table, 0 is A and 1 is B
+        };
+
+        struct SIDE {
+            unsigned begin{};             // Bytes of main data that sit in earlier frames
+            unsigned scfsi[2]{};          // Band groups the second granule takes from the first, MPEG-1 only
+            GRANULE granule[2][2];
+        };
+
+        struct SCALE {
+            int wide[22]{};               // Long block scalefactors
+            int narrow[13][3]{};          // Short block scalefactors of each window
+            int illegal[22]{};            // Intensity position that means no intensity, per long band
+            int illegal_short[13]{};      // The same per short band
+        };
+
+        static bool header(const unsigned char* p, HEADER& head) {
+            /** Layer III frame header, free format streams are not supported **/
+            if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+                return false;
+            }
+            const unsigned version = p[1] >> 3 & 3;  // 0 MPEG-2.5, 2 MPEG-2, 3 MPEG-1
+            const unsigned rate = p[2] >> 4;
+            const unsigned frequency = p[2] >> 2 & 3;
+            if (version == 1 || (p[1] >> 1 & 3) != 1 || rate == 0 || rate == 15 || frequency == 3) {
+                return false;
+            }
+            static const unsigned short kbps[2][15] = {{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+                                                       {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}};
+            static const unsigned hz[3] = {44100, 48000, 32000};
+            const unsigned shift = version == 3 ? 0 : version == 2 ? 1 : 2;
+            const unsigned mode = p[3] >> 6;
+            head.lsf = version != 3;
+            head.table = shift * 3 + frequency;
+            head.sample_rate = hz[frequency] >> shift;
+            head.bitrate = kbps[head.lsf][rate] * 1000u;
+            head.extension = mode == 1 ? p[3] >> 4 & 3 : 0;
+            head.channels = mode == 3 ? 1 : 2;
+            head.granules = head.lsf ? 1 : 2;
+            head.side = 4 + (p[1] & 1 ? 0 : 2) + (head.lsf ? (head.channels == 1 ? 9 : 17) : (head.channels == 1 ? 17 : 32));
+            head.size = (head.lsf ? 72 : 144) * static_cast<uint64_t>(head.bitrate) / head.sample_rate + (p[2] >> 1 & 1);
+            return true;
+        }
+
+        static bool same(const unsigned char* a, const unsigned char* b) {
+            /** Version, layer, sample rate and mono or not, what stays the same from frame to frame **/
+            return (a[1] & 0xFE) == (b[1] & 0xFE) && (a[2] & 0x0C) == (b[2] & 0x0C) && ((a[3] & 0xC0) == 0xC0) == ((b[3] & 0xC0) == 0xC0);
+        }
+
+        static uint64_t tag(const char* data, const uint64_t size) {
+            /** Bytes of the ID3v2 tag in front of the stream, 0 if there is none **/
+            const auto* u = reinterpret_cast<const unsigned char*>(data);
+            if (size < 10 || std::memcmp(data, "ID3", 3) != 0) {
+                return 0;
+            }
+            // The size is syncsafe, 7 bits per byte, plus a footer if the flags say so
+            return 10 + ((u[6] & 0x7F) << 21 | (u[7] & 0x7F) << 14 | (u[8] & 0x7F) << 7 | (u[9] & 0x7F)) + (u[5] & 0x10 ? 10 : 0);
+        }
+
+        static const uint16_t* long_bands(const unsigned table) {
+            /** First line of each long block scalefactor band, plus 576 **/
+            static const uint16_t bands[9][23] = {
+                {0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576},
+                {0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576},
+                {0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576},
+                {0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576},
+                {0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 114, 136, 162, 194, 232, 278, 332, 394, 464, 540, 576},
+                {0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576},
+                {0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576},
+                {0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96, 116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576},
+                {0, 12, 24, 36, 48, 60, 72, 88, 108, 132, 160, 192, 232, 280, 336, 400, 476, 566, 568, 570, 572, 574, 576},
+            };
+            return bands[table];
+        }
+
+        static const uint16_t* short_bands(const unsigned table) {
+            /** First line of each short block scalefactor band within one window, plus 192 **/
+            static const uint16_t bands[9][14] = {
+                {0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192},
+                {0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192},
+                {0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192},
+                {0, 4, 8, 12, 18, 24, 32, 42, 56, 74, 100, 132, 174, 192},
+                {0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 136, 180, 192},
+                {0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192},
+                {0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192},
+                {0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192},
+                {0, 8, 16, 24, 36, 52, 72, 96, 124, 160, 162, 164, 166, 192},
+            };
+            return bands[table];
+        }
+
+        struct TABLES {
+            std::vector<uint32_t> huffman;  // Leaves are value | bits << 16, links are 1 << 31 | offset << 5 | width
+            uint32_t books[34]{};           // Link to the first level of each table, the count1 tables at 32 and 33
+            float power[8207]{};            // |x| ^ (4 / 3)
+            float imdct[4][18 * 36]{};      // IMDCT times the window of each block type, short blocks as one 18x36 product
+            float dct[32 * 32]{};           // Matrixing of the synthesis filterbank, one row per subband
+            float window[512]{};            // Synthesis window
+        };
+
+        static uint32_t book(std::vector<uint32_t>& lookup, const std::vector<uint64_t>& codes, const unsigned consumed) {
+            /** Lookup tables of at most 8 bits per level for the codes left after consumed bits, returns the link **/
+            // codes are value << 32 | code << 5 | length
+            unsigned longest = 0;
+            for (const uint64_t code : codes) {
+                longest = std::max(longest, static_cast<unsigned>(code & 31) - consumed);
+            }
+            const unsigned width = std::min(longest, 8u);
+            const auto offset = static_cast<uint32_t>(lookup.size());
+            lookup.resize(offset + (1u << width));
+            std::vector<std::vector<uint64_t>> deeper(1u << width);
+            for (const uint64_t code : codes) {
+                const unsigned rest = static_cast<unsigned>(code & 31) - consumed;
+                const auto bits = static_cast<uint32_t>(code >> 5 & 0x7FFFFF) & ((1u << rest) - 1);
+                if (rest <= width) {
+                    const uint32_t first = bits << (width - rest);
+                    for (uint32_t i = 0; i < 1u << (width - rest); i++) {
+                        lookup[offset + first + i] = static_cast<uint32_t>(code >> 32) | rest << 16;
+                    }
+                } else {
+                    deeper[bits >> (rest - width)].push_back(code);
+                }
+            }
+            for (uint32_t i = 0; i < deeper.size(); i++) {
+                if (!deeper[i].empty()) {
+                    const uint32_t link = book(lookup, deeper[i], consumed + width);
+                    lookup[offset + i] = link;
+                }
+            }
+            return 1u << 31 | offset << 5 | width;
+        }
+
+        static TABLES build() {
+            TABLES t;
+            // Code << 5 | length of every pair (x * size + y) or quadruple (vwxy), ISO/IEC 11172-3 table B.7
+            static const uint32_t codes[] = {
+                // table 1
+                0x21, 0x23, 0x22, 0x3,
+                // table 2
+                0x21, 0x43, 0x26, 0x63, 0x23, 0x25, 0x65, 0x45, 0x6,
+                // table 3
+                0x62, 0x42, 0x26, 0x23, 0x22, 0x25, 0x65, 0x45, 0x6,
+                // table 5
+                0x21, 0x43, 0xc6, 0xa7, 0x63, 0x23, 0x86, 0x87, 0xe6, 0xa6, 0xe7, 0x28, 0xc7, 0x26, 0x27, 0x8,
+                // table 6
+                0xe3, 0x63, 0xa5, 0x27, 0xc3, 0x42, 0x64, 0x45, 0xa4, 0x84, 0x85, 0x26, 0x66, 0x65, 0x46, 0x7,
+                // table 7
+                0x21, 0x43, 0x146, 0x268, 0x208, 0x149, 0x63, 0x64, 0xe6, 0x147, 0xa7, 0x68, 0x166, 0x85, 0x1a7, 0x228, 0x108, 0x89, 0x187, 0x167,
+                0x248, 0x1e9, 0x169, 0x49, 0xe7, 0xc7, 0x128, 0x1c9, 0x69, 0x2a, 0xc8, 0x88, 0xa9, 0x6a, 0x4a, 0xa,
+                // table 8
+                0x62, 0x83, 0xc6, 0x248, 0x188, 0xa9, 0xa3, 0x22, 0x44, 0x208, 0x128, 0x68, 0xe6, 0x64, 0xa6, 0x1c8, 0xe8, 0x69, 0x268, 0x228, 0x1e8,
+                0x1a9, 0x149, 0x8a, 0x1a8, 0xa7, 0x108, 0x169, 0xaa, 0x2a, 0x189, 0x88, 0x89, 0x29, 0x2b, 0xb,
+                // table 9
+                0xe3, 0xa3, 0x125, 0x1c6, 0x1e8, 0xe9, 0xc3, 0x83, 0xa4, 0xa5, 0xc6, 0xe8, 0xe4, 0xc4, 0x105, 0x106, 0x107, 0xa8, 0x1e6, 0xc5, 0x126,
+                0x147, 0xa7, 0x28, 0x167, 0xe6, 0x127, 0xc7, 0x88, 0x29, 0x1c8, 0x87, 0xc8, 0x48, 0xc9, 0x9,
+                // table 10
+                0x21, 0x43, 0x146, 0x2e8, 0x469, 0x3c9, 0x189, 0x22a, 0x63, 0x64, 0x106, 0x187, 0x248, 0x2a9, 0x188, 0xe8, 0x166, 0x126, 0x1e7,
+                0x2a8, 0x409, 0x50a, 0x269, 0xc9, 0x1c7, 0x1a7, 0x2c8, 0x449, 0x5ca, 0x2ea, 0x249, 0xea, 0x288, 0x268, 0x429, 0x5ea, 0x36a, 0x2ca,
+                0x12a, 0x6a, 0x3e9, 0x2c9, 0x52a, 0x34a, 0x2ab, 0x28b, 0xaa, 0x6b, 0x1c8, 0x1a8, 0x149, 0x16a, 0x20a, 0xca, 0xab, 0x2b, 0x129, 0x108,
+                0xe9, 0x10a, 0x8a, 0x8b, 0x4b, 0xb,
+                // table 11
+                0x62, 0x83, 0x145, 0x307, 0x448, 0x429, 0x2a8, 0x1e9, 0xa3, 0x63, 0x84, 0x146, 0x408, 0x228, 0x167, 0x148, 0x165, 0xe5, 0x1a6, 0x247,
+                0x3c8, 0x3e9, 0x288, 0xa8, 0x327, 0x166, 0x267, 0x769, 0x368, 0x24a, 0x188, 0xa9, 0x468, 0x428, 0x3e8, 0x749, 0x3c9, 0x20a, 0xe9,
+                0xaa, 0x388, 0x348, 0x409, 0x26a, 0x22a, 0x1eb, 0x10a, 0x1cb, 0x1c8, 0x187, 0x127, 0x1a8, 0x1c9, 0x12a, 0x8a, 0x2a, 0x168, 0x87,
+                0xc8, 0xc9, 0xca, 0x6a, 0x4a, 0xa,
+                // table 12
+                0x124, 0xc3, 0x205, 0x427, 0x528, 0x4e9, 0x4c9, 0x349, 0xe3, 0xa3, 0xc4, 0x125, 0x2e7, 0x207, 0x348, 0x168, 0x225, 0xe4, 0x165,
+                0x1c6, 0x2a7, 0x3c8, 0x147, 0xe8, 0x226, 0x145, 0x1e6, 0x186, 0x247, 0x388, 0x1c8, 0xa8, 0x407, 0x1a6, 0x2c7, 0x267, 0x248, 0x208,
+                0x128, 0xa9, 0x508, 0x227, 0x3e8, 0x3a8, 0x228, 0x1a9, 0x88, 0x49, 0x368, 0x187, 0x167, 0x1e8, 0x148, 0xe9, 0x89, 0x2a, 0x369, 0x188,
+                0x108, 0x189, 0xc9, 0x69, 0x29, 0xa,
+                // table 13
+                0x21, 0xa4, 0x1c6, 0x2a7, 0x448, 0x669, 0x5c9, 0x8ea, 0x549, 0x68a, 0x88b, 0x68b, 0x86c, 0x58c, 0x56d, 0x26d, 0x63, 0x84, 0x186,
+                0x267, 0x3e8, 0x348, 0x589, 0x429, 0x3e9, 0x309, 0x40a, 0x30a, 0x3eb, 0x46c, 0x2cc, 0x1cc, 0x1e6, 0x1a6, 0x2e7, 0x488, 0x769, 0x629,
+                0x9aa, 0x82a, 0x3a9, 0x50a, 0x3ca, 0x50b, 0x36b, 0x42c, 0x54d, 0x20d, 0x2c7, 0x287, 0x4a8, 0x7a9, 0x709, 0x9ea, 0x92a, 0x80a, 0x56a,
+                0x98b, 0x70b, 0x4ab, 0x34b, 0x3ec, 0x32d, 0x1cd, 0x468, 0x207, 0x789, 0x729, 0xc2a, 0x96a, 0xe4b, 0xb6b, 0x6ca, 0x92b, 0x6eb, 0x52c,
+                0x60c, 0x6ad, 0x2ed, 0x30e, 0x749, 0x368, 0x649, 0xc0a, 0x98a, 0x8ca, 0xbab, 0xa8b, 0x9ab, 0x74b, 0x9ec, 0x3ab, 0x94d, 0x62d, 0x52e,
+                0x22e, 0x5e9, 0x5a9, 0x9ca, 0x94a, 0xe6b, 0xbcb, 0xb4b, 0x9eb, 0x8ab, 0xa6c, 0x8ec, 0x64c, 0x76d, 0x4cd, 0x48e, 0x1ee, 0x90a, 0x449,
+                0x70a, 0xbeb, 0xb8b, 0xaab, 0xb6c, 0xb4c, 0xacc, 0x92c, 0x9ad, 0x82d, 0x66d, 0x58e, 0x570, 0x550, 0x569, 0x288, 0x3c9, 0x58a, 0x6ea,
+                0x9cb, 0x90b, 0xaec, 0x9cc, 0x7ac, 0x5cc, 0x6cd, 0x4ad, 0x3ce, 0x28f, 0x20f, 0x6aa, 0x329, 0x52a, 0x4aa, 0x58b, 0x76b, 0x6cb, 0xa2d,
+                0x84c, 0x98d, 0x72d, 0x6ce, 0x4ae, 0x24e, 0x4f0, 0x16f, 0x46a, 0x42a, 0x3ea, 0x72b, 0x54b, 0xa4c, 0x90c, 0xa0d, 0x5ec, 0x74d, 0x6ee,
+                0x2ad, 0x2ce, 0x34f, 0x4d0, 0x2d1, 0x6ab, 0x32a, 0x2ea, 0x4cb, 0x8cc, 0x78c, 0x66c, 0x48c, 0x6ed, 0x34d, 0x44d, 0x2ee, 0x36f, 0x1cf,
+                0x12f, 0xf0, 0x44b, 0x40b, 0x38b, 0x4ec, 0x62c, 0x96d, 0x3cc, 0x68d, 0x60e, 0x50e, 0x68f, 0x38f, 0x24f, 0x230, 0x130, 0xb0, 0x5ac,
+                0x2ab, 0x44c, 0x80d, 0x70d, 0x64d, 0x62e, 0x5ae, 0x3ee, 0x26e, 0x18e, 0x1ef, 0x150, 0xef, 0xd0, 0x70, 0x60d, 0x2ec, 0x28c, 0x4ed,
+                0x48d, 0x46d, 0x6af, 0x2ae, 0x20e, 0x2f1, 0x1af, 0x14f, 0xcf, 0x31, 0x90, 0x50, 0x20c, 0x1ec, 0x22d, 0x36e, 0x32e, 0x28e, 0x3af,
+                0x16e, 0x22f, 0x18f, 0x210, 0x110, 0x33, 0x32, 0x13, 0x30,
+                // table 15
+                0xe3, 0x184, 0x245, 0x6a7, 0x5e7, 0x988, 0xf89, 0xd89, 0xb29, 0xf6a, 0xd8a, 0xeeb, 0xd6b, 0xa2b, 0xf4c, 0x7ed, 0x1a4, 0xa3, 0x205,
+                0x366, 0x5c7, 0x487, 0x7a8, 0x668, 0x548, 0x8c9, 0x689, 0xa6a, 0x82a, 0x52a, 0x76b, 0x48b, 0x265, 0x225, 0x1e5, 0x306, 0x527, 0x447,
+                0x768, 0x608, 0x508, 0x809, 0x649, 0x9ca, 0x7ca, 0xa0b, 0x70b, 0x42b, 0x3a6, 0x386, 0x326, 0x567, 0x4e7, 0x7e8, 0x6e8, 0xba9, 0x989,
+                0x769, 0xbaa, 0x90a, 0x6ca, 0x96b, 0x64b, 0x3ab, 0x687, 0x2c6, 0x547, 0x507, 0x868, 0x728, 0xbe9, 0x9e9, 0x909, 0x729, 0xb2a, 0x8aa,
+                0x62a, 0x84b, 0x5cb, 0x36b, 0x9a8, 0x4a7, 0x467, 0x848, 0x748, 0x688, 0xb69, 0x949, 0x7c9, 0x609, 0x9ea, 0x7ea, 0xb4b, 0x7cb, 0x50b,
+                0x4cc, 0xfa9, 0x407, 0x788, 0x708, 0x648, 0xb89, 0x9c9, 0x829, 0x6e9, 0xaea, 0x8ea, 0x66a, 0x92b, 0x66b, 0x8cc, 0x3cc, 0xda9, 0x6a8,
+                0x628, 0xbc9, 0xb09, 0x969, 0x849, 0xf4a, 0xb6a, 0x92a, 0x70a, 0x54a, 0x80b, 0x58b, 0x2ab, 0x32c, 0xb49, 0x568, 0x528, 0x9a9, 0x929,
+                0x7e9, 0x709, 0xb8a, 0x9aa, 0x84a, 0x5ea, 0x86b, 0x60b, 0x6ac, 0x48c, 0x28c, 0x8e9, 0x448, 0x869, 0x789, 0x749, 0x629, 0xb0a, 0x98a,
+                0x86a, 0xd4b, 0x8eb, 0x6cb, 0x4cb, 0x4ec, 0x2ec, 0x1ec, 0xdaa, 0x6a9, 0x669, 0x5e9, 0xb4a, 0xa4a, 0x74a, 0x72a, 0x60a, 0x90b, 0x72b,
+                0x52b, 0x2eb, 0x36c, 0x7cd, 0x12c, 0xaca, 0x549, 0x509, 0x4a9, 0x8ca, 0x80a, 0x68a, 0x56a, 0x8cb, 0x6eb, 0x54b, 0x32b, 0x3ac, 0x24c,
+                0x16c, 0x16d, 0xecb, 0x88a, 0x3c9, 0x6ea, 0x64a, 0x5ca, 0x94b, 0x82b, 0x62b, 0x4eb, 0x30b, 0x20b, 0x2cc, 0x1ac, 0x1cd, 0xed, 0xb6b,
+                0x58a, 0x4ea, 0x4ca, 0x44a, 0x7eb, 0x68b, 0x5ab, 0x3eb, 0x68c, 0x38c, 0x26c, 0x1cc, 0x10c, 0x12d, 0x6d, 0xf6c, 0x78b, 0x74b, 0x6ab,
+                0x5eb, 0x56b, 0x40b, 0x2cb, 0x4ac, 0x30c, 0x22c, 0x18c, 0x1ed, 0x14d, 0x4c, 0x2d, 0x8ec, 0x4ab, 0x44b, 0x3cb, 0x38b, 0x28b, 0x22b,
+                0x34c, 0x2ac, 0x20c, 0x14c, 0xcc, 0x10d, 0xcd, 0x4d, 0xd,
+                // table 16
+                0x21, 0xa4, 0x1c6, 0x588, 0x949, 0x7e9, 0xdca, 0xbaa, 0x158b, 0x12ab, 0x114b, 0x1e4c, 0x1c2c, 0x186c, 0x2f0d, 0x229, 0x63, 0x84,
+                0x186, 0x287, 0x468, 0x7c9, 0x6a9, 0x5e9, 0xa6a, 0x96a, 0x88a, 0xeeb, 0x192c, 0xd6b, 0x19ec, 0x128, 0x1e6, 0x1a6, 0x2e7, 0x4c8,
+                0x869, 0x749, 0xcea, 0xb4a, 0x142b, 0x90a, 0xfeb, 0xeab, 0xdcb, 0x1a2c, 0x19cc, 0x209, 0x5a8, 0x2a7, 0x4e8, 0x8a9, 0x809, 0xe4a,
+                0xc6a, 0xaea, 0x13cb, 0x118b, 0x1f8c, 0x1a8c, 0x18ec, 0x306d, 0x2dad, 0x34a, 0x969, 0x488, 0x889, 0x829, 0xe6a, 0xcaa, 0x166b,
+                0x148b, 0x136b, 0x210c, 0x1ecc, 0x1c4c, 0x316d, 0x2fcd, 0x2d4d, 0x129, 0x849, 0x3c8, 0x769, 0x709, 0xcca, 0x172b, 0x15ab, 0x212c,
+                0x11cb, 0x1fac, 0x1d0c, 0x320d, 0x308d, 0x2f4d, 0x37ae, 0x20a, 0xdea, 0x6c9, 0x689, 0xc8a, 0x170b, 0x164b, 0x140b, 0x10ab, 0x202c,
+                0x1e8c, 0x1c8c, 0x1b2c, 0x302d, 0x2dcd, 0x596e, 0x14a, 0xc4a, 0x609, 0xb6a, 0xb0a, 0x14ab, 0x13ab, 0x128b, 0x20ac, 0x1f0c, 0x32ed,
+                0x31ad, 0x2e8d, 0x2f8d, 0x6f2f, 0x6e8f, 0x10a, 0xaaa, 0xa8a, 0xa2a, 0x13eb, 0x138b, 0x11eb, 0x208c, 0x1f2c, 0x356d, 0x322d, 0x310d,
+                0x2fed, 0x5aee, 0x592e, 0x588e, 0xea, 0x134b, 0x98a, 0x92a, 0x11ab, 0x106b, 0x200c, 0x1eac, 0x354d, 0x32cd, 0x314d, 0x300d, 0x5bee,
+                0x2ced, 0x58ce, 0x2c0d, 0x16b, 0x116b, 0x102b, 0x86a, 0xfab, 0x1eec, 0x1d2c, 0x1cac, 0x1b6c, 0x312d, 0x5cee, 0x5c2e, 0x5a0e, 0x6eaf,
+                0x6e4f, 0x36ee, 0x8a, 0x1e6c, 0xf0b, 0xecb, 0xe6b, 0x1c6c, 0x1bec, 0x318d, 0x5d4e, 0x5cce, 0x5c0e, 0x5a2e, 0x590e, 0x584e, 0x1bed,
+                0x368e, 0xcb, 0x194c, 0x1c0c, 0x1bcc, 0x1b4c, 0x1b0c, 0x30ad, 0x304d, 0x2fad, 0x2d8d, 0x6f0f, 0x376e, 0x586e, 0x370e, 0x36ae, 0xd810,
+                0x8b, 0x5d6e, 0x1a6c, 0x1a4c, 0x1a0c, 0x2e4d, 0x2f6d, 0x5bce, 0x5a6e, 0x594e, 0xd8f0, 0x6e6f, 0x6daf, 0x6d8f, 0x1b071, 0x6c2f, 0x4b,
+                0x2f2d, 0x2e2d, 0xccb, 0x176c, 0x5ace, 0x5a4e, 0x2ccd, 0x58ee, 0x58ae, 0x6c4f, 0xd8d0, 0x6cef, 0x1b051, 0x6ccf, 0x364e, 0xb, 0x189,
+                0x148, 0xe8, 0x169, 0x149, 0x22a, 0x16a, 0x12a, 0x1ab, 0x18b, 0x14b, 0xeb, 0xab, 0x6b, 0x2b, 0x68,
+                // table 24
+                0x1e4, 0x1a4, 0x5c6, 0xa07, 0x1248, 0x20c9, 0x1f09, 0x364a, 0x354a, 0x53ab, 0x51ab, 0x512b, 0x4dab, 0x40ab, 0x810c, 0xb09, 0x1c4,
+                0x184, 0x2a5, 0x4c6, 0x8e7, 0x1048, 0xf48, 0x1b09, 0x1a29, 0x18c9, 0x28ea, 0x2b2a, 0x27ea, 0x252a, 0x22ea, 0x548, 0x5e6, 0x2c5,
+                0x526, 0x947, 0x887, 0x1008, 0xf08, 0x1ba9, 0x19e9, 0x1849, 0x16c9, 0x2a8a, 0x276a, 0x24ea, 0x43ab, 0x247, 0xa27, 0x4e6, 0x967,
+                0x8c7, 0x10c8, 0xfa8, 0xe88, 0x1b89, 0x1989, 0x17c9, 0x1649, 0x28aa, 0x26ea, 0x24aa, 0x21ea, 0x207, 0x1268, 0x907, 0x8a7, 0x10e8,
+                0xfe8, 0xec8, 0xe08, 0x1a49, 0x1909, 0x1789, 0x2c0a, 0x286a, 0x264a, 0x23aa, 0x438b, 0x1c7, 0x20e9, 0x847, 0x1028, 0xfc8, 0xee8,
+                0xe48, 0x1ac9, 0x1949, 0x1809, 0x1689, 0x2aaa, 0x27aa, 0x25aa, 0x232a, 0x20ca, 0x187, 0x1f29, 0xf68, 0xf28, 0xea8, 0xe28, 0x1ae9,
+                0x19c9, 0x1869, 0x1729, 0x2b6a, 0x294a, 0x268a, 0x246a, 0x220a, 0x410b, 0x147, 0x366a, 0xe68, 0xde8, 0xda8, 0x1a69, 0x1969, 0x1889,
+                0x1769, 0x2c2a, 0x298a, 0x272a, 0x254a, 0x236a, 0x426b, 0x2fab, 0x228, 0x356a, 0x1a89, 0x1a09, 0x19a9, 0x1929, 0x1829, 0x1749,
+                0x1629, 0x1529, 0x280a, 0x25ea, 0x23ca, 0x218a, 0x404b, 0x2f2b, 0x208, 0x29ea, 0x18e9, 0x18a9, 0x17e9, 0x17a9, 0x16a9, 0x15c9,
+                0x29aa, 0x282a, 0x262a, 0x242a, 0x226a, 0x412b, 0x2f6b, 0x2e6b, 0x168, 0x538b, 0x1709, 0x16e9, 0x1669, 0x15e9, 0x2b0a, 0x296a,
+                0x274a, 0x260a, 0x244a, 0x22aa, 0x424b, 0x2feb, 0x2eab, 0x2dcb, 0x148, 0x518b, 0x2b4a, 0x1569, 0x1509, 0x1489, 0x27ca, 0x26aa,
+                0x256a, 0x23ea, 0x228a, 0x20ea, 0x402b, 0x2eeb, 0x2e0b, 0x2d4b, 0xc8, 0x510b, 0x284a, 0x278a, 0x270a, 0x266a, 0x25ca, 0x248a, 0x238a,
+                0x21aa, 0x20aa, 0x400b, 0x2f0b, 0x2e4b, 0x2d8b, 0x2ceb, 0x88, 0x4d8b, 0x258a, 0x250a, 0x24ca, 0x240a, 0x234a, 0x222a, 0x214a, 0x406b,
+                0x2f8b, 0x2ecb, 0x2e2b, 0x2dab, 0x2d2b, 0x2cab, 0x48, 0x812c, 0x230a, 0x22ca, 0x224a, 0x216a, 0x210a, 0x206a, 0x2fcb, 0x2f4b, 0x2e8b,
+                0x2deb, 0x2d6b, 0x2d0b, 0x2ccb, 0x2c8b, 0x8, 0x568, 0x287, 0x267, 0x227, 0x1e7, 0x1a7, 0x167, 0x127, 0xe7, 0xc7, 0x87, 0xe8, 0xa8,
+                0x68, 0x28, 0x64,
+                // count1 table A
+                0x21, 0xa4, 0x84, 0xa5, 0xc4, 0xa6, 0x85, 0x86, 0xe4, 0x65, 0xc5, 0x6, 0xe5, 0x46, 0x66, 0x26,
+                // count1 table B
+                0x1e4, 0x1c4, 0x1a4, 0x184, 0x164, 0x144, 0x124, 0x104, 0xe4, 0xc4, 0xa4, 0x84, 0x64, 0x44, 0x24, 0x4
+            };
+            static const unsigned numbers[17] = {1, 2, 3, 5, 6, 7, 8, 9, 10, 11, 12, 13, 15, 16, 24, 32, 33};
+            static const unsigned sizes[17] = {2, 3, 3, 4, 4, 6, 6, 6, 8, 8, 8, 16, 16, 16, 16, 4, 4};
+            const uint32_t* next = codes;
+            for (unsigned b = 0; b < 17; b++) {
+                const unsigned count = sizes[b] * sizes[b];
+                std::vector<uint64_t> list(count);
+                for (unsigned i = 0; i < count; i++) {
+                    // Pairs keep x and y in a nibble each, quadruples their four bits
+                    const uint64_t value = b < 15 ? (i / sizes[b]) << 4 | i % sizes[b] : i;
+                    list[i] = value << 32 | next[i];
+                }
+                next += count;
+                t.books[numbers[b]] = book(t.huffman, list, 0);
+            }
+            for (unsigned n = 17; n < 24; n++) {
+                t.books[n] = t.books[16];
+            }
+            for (unsigned n = 25; n < 32; n++) {
+                t.books[n] = t.books[24];
+            }
+
+            for (unsigned i = 0; i < 8207; i++) {
+                t.power[i] = static_cast<float>(std::pow(static_cast<double>(i), 4.0 / 3.0));
+            }
+
+            // Windows of the long block types, short windows are folded into the short transform
+            double window[4][36];
+            for (unsigned n = 0; n < 36; n++) {
+                window[0][n] = std::sin(WAVLIB_PI / 36 * (n + 0.5));
+                window[1][n] = n < 18 ? window[0][n] : n < 24 ? 1.0 : n < 30 ? std::sin(WAVLIB_PI / 12 * (n - 18 + 0.5)) : 0.0;
+                window[3][n] = n < 6 ? 0.0 : n < 12 ? std::sin(WAVLIB_PI / 12 * (n - 6 + 0.5)) : n < 18 ? 1.0 : window[0][n];
+            }
+            for (const unsigned type : {0u, 1u, 3u}) {
+                for (unsigned k = 0; k < 18; k++) {
+                    for (unsigned n = 0; n < 36; n++) {
+                        t.imdct[type][k * 36 + n] = static_cast<float>(window[type][n] * std::cos(WAVLIB_PI / 72 * (2 * n + 19) * (2 * k + 1)));
+                    }
+                }
+            }
+            // Three 12 point transforms, window w goes to lines 6 + 6w to 17 + 6w
+            for (unsigned w = 0; w < 3; w++) {
+                for (unsigned k = 0; k < 6; k++) {
+                    for (unsigned n = 0; n < 12; n++) {
+                        const double value = std::sin(WAVLIB_PI / 12 * (n + 0.5)) * std::cos(WAVLIB_PI / 24 * (2 * n + 7) * (2 * k + 1));
+                        t.imdct[2][(3 * k + w) * 36 + 6 + 6 * w + n] = static_cast<float>(value);
+                    }
+                }
+            }
+
+            for (unsigned k = 0; k < 32; k++) {
+                for (unsigned j = 0; j < 32; j++) {
+                    t.dct[k * 32 + j] = static_cast<float>(std::cos(WAVLIB_PI / 64 * j * (2 * k + 1)));
+                }
+            }
+
+            // ISO/IEC 11172-3 table B.3 times 65536, symmetric about 256 once the sign of every other 64 is taken out
+            static const int32_t half[257] = {
+                0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3, -3, -4, -4, -5, -5, -6, -7, -7, -8, -9, -10, -11, -13, -14, -16, -17, -19, -21, -24,
+                -26, -29, -31, -35, -38, -41, -45, -49, -53, -58, -63, -68, -73, -79, -85, -91, -97, -104, -111, -117, -125, -132, -139, -147, -154,
+                -161, -169, -176, -183, -190, -196, -202, -208, -213, -218, -222, -225, -227, -228, -228, -227, -224, -221, -215, -208, -200, -189,
+                -177, -163, -146, -127, -106, -83, -57, -29, 2, 36, 72, 111, 153, 197, 244, 294, 347, 401, 459, 519, 581, 645, 711, 779, 848, 919,
+                991, 1064, 1137, 1210, 1283, 1356, 1428, 1498, 1567, 1634, 1698, 1759, 1817, 1870, 1919, 1962, 2001, 2032, 2057, 2075, 2085, 2087,
+                2080, 2063, 2037, 2000, 1952, 1893, 1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605, 402, 185, -45, -288, -545, -814, -1095,
+                -1388, -1692, -2006, -2330, -2663, -3004, -3351, -3705, -4063, -4425, -4788, -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597,
+                -7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959, -9966, -9935, -9863, -9750, -9592, -9389, -9139,
+                -8840, -8492, -8092, -7640, -7134, -6574, -5959, -5288, -4561, -3776, -2935, -2037, -1082, -70, 998, 2122, 3300, 4533, 5818, 7154,
+                8540, 9975, 11455, 12980, 14548, 16155, 17799, 19478, 21189, 22929, 24694, 26482, 28289, 30112, 31947, 33791, 35640, 37489, 39336,
+                41176, 43006, 44821, 46617, 48390, 50137, 51853, 53534, 55178, 56778, 58333, 59838, 61289, 62684, 64019, 65290, 66494, 67629, 68692,
+                69679, 70590, 71420, 72169, 72835, 73415, 73908, 74313, 74630, 74856, 74992, 75038
+            };
+            for (unsigned i = 0; i < 512; i++) {
+                const int32_t value = half[i <= 256 ? i : 512 - i];
+                t.window[i] = static_cast<float>((i / 64 & 1 ? -value : value) / 65536.0);
+            }
+            return t;
+        }
+
+        static const TABLES& tables() {
+            static const TABLES t = build();
+            return t;
+        }
+
+        static bool side(const unsigned char* frame, const HEADER& head, SIDE& info) {
+            /** Side info of every granule and channel, false if it asks for something the format doesn't have **/
+            const unsigned bytes = head.lsf ? (head.channels == 1 ? 9 : 17) : (head.channels == 1 ? 17 : 32);
+            FLAC::BITS bits(frame + head.side - bytes, bytes);
+            const uint16_t* wide = long_bands(head.table);
+            const uint16_t* narrow = short_bands(head.table);
+            info.begin = bits.read(head.lsf ? 8 : 9);
+            bits.read(head.lsf ? head.channels : head.channels == 1 ? 5 : 3);
+            for (unsigned c = 0; c < head.channels; c++) {
+                info.scfsi[c] = head.lsf ? 0 : bits.read(4);
+            }
+            for (unsigned g = 0; g < head.granules; g++) {
+                for (unsigned c = 0; c < head.channels; c++) {
+                    GRANULE& gr = info.granule[g][c];
+                    gr.length = bits.read(12);
+                    gr.big = bits.read(9) * 2;
+                    gr.gain = static_cast<int>(bits.read(8));
+                    gr.compress = bits.read(head.lsf ? 9 : 4);
+                    if (bits.read(1)) {
+                        gr.block = bits.read(2);
+                        gr.mixed = bits.read(1) != 0 && gr.block == 2;
+                        gr.tables[0] = bits.read(5);
+                        gr.tables[1] = bits.read(5);
+                        gr.tables[2] = 0;
+                        for (int& gain : gr.subgain) {
+                            gain = static_cast<int>(bits.read(3)) * 8;
+                        }
+                        if (gr.block == 0) {
+                            return false;
+                        }
+                        // The regions are implicit, the second one takes everything above the first
+                        gr.region[0] = gr.block == 2 && !gr.mixed ? 3 * narrow[3] : wide[8];
+                        gr.region[1] = 576;
+                    } else {
+                        gr.block = 0;
+                        gr.mixed = false;
+                        for (unsigned& table : gr.tables) {
+                            table = bits.read(5);
+                        }
+                        for (int& gain : gr.subgain) {
+                            gain = 0;
+                        }
+                        const unsigned first = bits.read(4);
+                        const unsigned second = bits.read(3);
+                        gr.region[0] = wide[std::min(first + 1, 22u)];
+                        gr.region[1] = wide[std::min(first + second + 2, 22u)];
+                    }
+                    gr.preflag = !head.lsf && bits.read(1) != 0;
+                    gr.scale = bits.read(1);
+                    gr.quads = bits.read(1);
+                    if (gr.big > 576 || gr.tables[0] == 4 || gr.tables[0] == 14 || gr.tables[1] == 4 || gr.tables[1] == 14 || gr.tables[2] == 4 ||
+                        gr.tables[2] == 14) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        static void scalefactors(FLAC::BITS& bits, const GRANULE& gr, const unsigned scfsi, const unsigned g, SCALE& sf) {
+            /** MPEG-1 scalefactors, the band groups flagged in scfsi keep the values of the first granule **/
+            static const unsigned char lengths[2][16] = {{0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4}, {0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3, 2, 3}};
+            const unsigned low = lengths[0][gr.compress];
+            const unsigned high = lengths[1][gr.compress];
+            if (gr.block == 2) {
+                unsigned first = 0;
+                if (gr.mixed) {
+                    for (unsigned sfb = 0; sfb < 8; sfb++) {
+                        sf.wide[sfb] = static_cast<int>(bits.read(low));
+                    }
+                    first = 3;
+                }
+                for (unsigned sfb = first; sfb < 12; sfb++) {
+                    for (unsigned w = 0; w < 3; w++) {
+                        sf.narrow[sfb][w] = static_cast<int>(bits.read(sfb < 6 ? low : high));
+                    }
+                }
+                sf.narrow[12][0] = sf.narrow[12][1] = sf.narrow[12][2] = 0;
+            } else {
+                static const unsigned groups[5] = {0, 6, 11, 16, 21};
+                for (unsigned group = 0; group < 4; group++) {
+                    if (g == 1 && (scfsi >> (3 - group) & 1)) {
+                        continue;
+                    }
+                    for (unsigned sfb = groups[group]; sfb < groups[group + 1]; sfb++) {
+                        sf.wide[sfb] = static_cast<int>(bits.read(group < 2 ? low : high));
+                    }
+                }
+                sf.wide[21] = 0;
+            }
+            std::fill(sf.illegal, sf.illegal + 22, 7);
+            std::fill(sf.illegal_short, sf.illegal_short + 13, 7);
+        }
+
+        static void scalefactors(FLAC::BITS& bits, GRANULE& gr, const bool intensity, SCALE& sf) {
+            /** MPEG-2 scalefactors, the right channel of an intensity stereo frame has its own coding **/
+            static const unsigned char counts[6][3][4] = {
+                {{6, 5, 5, 5}, {9, 9, 9, 9}, {6, 9, 9, 9}},
+                {{6, 5, 7, 3}, {9, 9, 12, 6}, {6, 9, 12, 6}},
+                {{11, 10, 0, 0}, {18, 18, 0, 0}, {15, 18, 0, 0}},
+                {{7, 7, 7, 0}, {12, 12, 12, 0}, {6, 15, 12, 0}},
+                {{6, 6, 6, 3}, {12, 9, 9, 6}, {6, 12, 9, 6}},
+                {{8, 8, 5, 0}, {15, 12, 9, 0}, {6, 18, 9, 0}},
+            };
+            unsigned c = gr.compress;
+            unsigned slen[4];
+            unsigned set;
+            if (!intensity) {
+                if (c < 400) {
+                    slen[0] = (c >> 4) / 5, slen[1] = (c >> 4) % 5, slen[2] = (c & 15) >> 2, slen[3] = c & 3, set = 0;
+                } else if (c < 500) {
+                    c -= 400;
+                    slen[0] = (c >> 2) / 5, slen[1] = (c >> 2) % 5, slen[2] = c & 3, slen[3] = 0, set = 1;
+                } else {
+                    c -= 500;
+                    slen[0] = c / 3, slen[1] = c % 3, slen[2] = 0, slen[3] = 0, set = 2;
+                    gr.preflag = true;
+                }
+            } else {
+                c >>= 1;
+                if (c < 180) {
+                    slen[0] = c / 36, slen[1] = c % 36 / 6, slen[2] = c % 36 % 6, slen[3] = 0, set = 3;
+                } else if (c < 244) {
+                    c -= 180;
+                    slen[0] = (c & 63) >> 4, slen[1] = (c & 15) >> 2, slen[2] = c & 3, slen[3] = 0, set = 4;
+                } else {
+                    c -= 244;
+                    slen[0] = c / 3, slen[1] = c % 3, slen[2] = 0, slen[3] = 0, set = 5;
+                }
+            }
+            const unsigned kind = gr.block == 2 ? (gr.mixed ? 2 : 1) : 0;
+            int values[39];
+            int illegal[39];
+            unsigned n = 0;
+            for (unsigned i = 0; i < 4; i++) {
+                for (unsigned j = 0; j < counts[set][kind][i]; j++, n++) {
+                    values[n] = static_cast<int>(bits.read(slen[i]));
+                    illegal[n] = (1 << slen[i]) - 1;
+                }
+            }
+            unsigned k = 0;
+            if (gr.block == 2) {
+                unsigned first = 0;
+                if (gr.mixed) {
+                    for (unsigned sfb = 0; sfb < 6; sfb++, k++) {
+                        sf.wide[sfb] = values[k];
+                        sf.illegal[sfb] = illegal[k];
+                    }
+                    first = 3;
+                }
+                for (unsigned sfb = first; sfb < 12; sfb++) {
+                    for (unsigned w = 0; w < 3; w++, k++) {
+                        sf.narrow[sfb][w] = values[k];
+                    }
+                    sf.illegal_short[sfb] = illegal[k - 1];
+                }
+                sf.narrow[12][0] = sf.narrow[12][1] = sf.narrow[12][2] = 0;
+                sf.illegal_short[12] = sf.illegal_short[11];
+            } else {
+                for (unsigned sfb = 0; sfb < 21; sfb++, k++) {
+                    sf.wide[sfb] = values[k];
+                    sf.illegal[sfb] = illegal[k];
+                }
+                sf.wide[21] = 0;
+                sf.illegal[21] = sf.illegal[20];
+            }
+        }
+
+        static unsigned spectrum(FLAC::BITS& bits, const uint64_t end, const GRANULE& gr, int32_t* lines) {
+            /** Huffman decoded quantized lines, returns how many lines may be nonzero **/
+            static const unsigned char linbits[32] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13};
+            const TABLES& t = tables();
+            const uint32_t* lookup = t.huffman.data();
+            unsigned i = 0;
+            const unsigned stops[3] = {std::min(gr.region[0], gr.big), std::min(gr.region[1], gr.big), gr.big};
+            for (unsigned r = 0; r < 3; r++) {
+                const unsigned table = gr.tables[r];
+                if (table == 0) {
+                    for (; i < stops[r]; i++) {
+                        lines[i] = 0;
+                    }
+                    continue;
+                }
+                const uint32_t root = t.books[table];
+                const unsigned extra = linbits[table];
+                for (; i < stops[r]; i += 2) {
+                    const uint32_t value = bits.huffman(lookup, root);
+                    int32_t x = static_cast<int32_t>(value >> 4);
+                    int32_t y = static_cast<int32_t>(value & 15);
+                    if (x == 15 && extra != 0) {
+                        x += static_cast<int32_t>(bits.read(extra));
+                    }
+                    if (x != 0 && bits.read(1)) {
+                        x = -x;
+                    }
+                    if (y == 15 && extra != 0) {
+                        y += static_cast<int32_t>(bits.read(extra));
+                    }
+                    if (y != 0 && bits.read(1)) {
+                        y = -y;
+                    }
+                    lines[i] = x;
+                    lines[i + 1] = y;
+                }
+            }
+            const uint32_t root = t.books[32 + gr.quads];
+            while (i + 4 <= 576 && bits.tell() < end) {
+                const uint32_t value = bits.huffman(lookup, root);
+                int32_t quad[4];
+                for (unsigned k = 0; k < 4; k++) {
+                    quad[k] = static_cast<int32_t>(value >> (3 - k) & 1);
+                    if (quad[k] != 0 && bits.read(1)) {
+                        quad[k] = -1;
+                    }
+                }
+                // The last quadruple may run past the end of the granule, then it was stuffing
+                if (bits.tell() > end) {
+                    break;
+                }
+                std::memcpy(lines + i, quad, sizeof(quad));
+                i += 4;
+            }
+            std::fill(lines + i, lines + 576, 0);
+            return i;
+        }
+
+        static void requantize(const int32_t* lines, const unsigned count, const HEADER& head, const GRANULE& gr, const SCALE& sf, float* xr) {
+            /** Quantized lines to spectral values, short bands are still in window order **/
+            static const int pretab[22] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0};
+            static const float quarter[4] = {1.0f, 1.18920712f, 1.41421356f, 1.68179283f};
+            const float* power = tables().power;
+            const uint16_t* wide = long_bands(head.table);
+            const uint16_t* narrow = short_bands(head.table);
+            const unsigned shift = 1 + gr.scale;
+            auto band = [&](const unsigned from, const unsigned to, const int exponent) {
+                // 2 ^ (exponent / 4)
+                const float factor = std::ldexp(quarter[exponent & 3], exponent >> 2);
+                for (unsigned i = from; i < to; i++) {
+                    const int32_t v = lines[i];
+                    const float magnitude = power[std::min(v < 0 ? -v : v, 8206)] * factor;
+                    xr[i] = v < 0 ? -magnitude : magnitude;
+                }
+            };
+            std::fill(xr, xr + 576, 0.0f);
+            if (gr.block != 2 || gr.mixed) {
+                // Mixed blocks keep the long bands of the two lowest subbands
+                const unsigned limit = gr.block == 2 ? 36 : 576;
+                for (unsigned sfb = 0; sfb < 22 && wide[sfb] < std::min(limit, count); sfb++) {
+                    const int exponent = gr.gain - 210 - ((sf.wide[sfb] + (gr.preflag ? pretab[sfb] : 0)) << shift);
+                    band(wide[sfb], std::min<unsigned>(wide[sfb + 1], limit), exponent);
+                }
+            }
+            if (gr.block == 2) {
+                for (unsigned sfb = gr.mixed ? 3 : 0; sfb < 13 && 3 * narrow[sfb] < count; sfb++) {
+                    const unsigned width = narrow[sfb + 1] - narrow[sfb];
+                    for (unsigned w = 0; w < 3; w++) {
+                        const unsigned from = 3 * narrow[sfb] + w * width;
+                        band(from, from + width, gr.gain - 210 - gr.subgain[w] - (sf.narrow[sfb][w] << shift));
+                    }
+                }
+            }
+        }
+
+        static unsigned last(const float* xr, unsigned from, const unsigned to) {
+            /** One past the last nonzero line in [from, to), from if there is none **/
+            unsigned end = to;
+            while (end > from && xr[end - 1] == 0.0f) {
+                end--;
+            }
+            return std::max(end, from);
+        }
+
+        static void intensity(float* left, float* right, const unsigned from, const unsigned to, const int position, const HEADER& head, const GRANULE& gr,
+                              const bool ms) {
+            /** Lines [from, to) of the right channel rebuilt from the left one **/
+            double kl;
+            double kr;
+            if (!head.lsf) {
+                const double angle = position * WAVLIB_PI / 12;
+                kl = std::sin(angle) / (std::sin(angle) + std::cos(angle));
+                kr = std::cos(angle) / (std::sin(angle) + std::cos(angle));
+            } else {
+                const double base = gr.compress & 1 ? 0.70710678118654752 : 0.84089641525371454;
+                kl = position & 1 ? std::pow(base, (position + 1) / 2) : 1.0;
+                kr = position & 1 ? 1.0 : std::pow(base, position / 2);
+            }
+            // Mid/side already scaled the left channel, which carries the whole signal here
+            const auto l = static_cast<float>(ms ? kl * 1.41421356237309505 : kl);
+            const auto r = static_cast<float>(ms ? kr * 1.41421356237309505 : kr);
+            for (unsigned i = from; i < to; i++) {
+                const float v = left[i];
+                left[i] = v * l;
+                right[i] = v * r;
+            }
+        }
+
+        static void stereo(float* left, float* right, const HEADER& head, const GRANULE& gr, const SCALE& sf) {
+            /** Mid/side and intensity stereo, short bands are still in window order **/
+            const bool ms = (head.extension & 2) != 0;
+            if (ms) {
+                const float half = 0.70710678118654752f;
+                for (unsigned i = 0; i < 576; i++) {
+                    const float m = left[i];
+                    const float s = right[i];
+                    left[i] = (m + s) * half;
+                    right[i] = (m - s) * half;
+                }
+            }
+            if (!(head.extension & 1)) {
+                return;
+            }
+            // Mid/side puts half the left channel into the right one, the zeros of the coded right channel are what counts
+            const float* coded = right;
+            float copy[576];
+            if (ms) {
+                for (unsigned i = 0; i < 576; i++) {
+                    copy[i] = left[i] - right[i];
+                }
+                coded = copy;
+            }
+            const uint16_t* wide = long_bands(head.table);
+            const uint16_t* narrow = short_bands(head.table);
+            bool windows = false;
+            if (gr.block == 2) {
+                for (unsigned w = 0; w < 3; w++) {
+                    // The band after the last one with anything in this window is the first intensity band
+                    unsigned first = gr.mixed ? 3 : 0;
+                    for (unsigned sfb = 12; sfb + 1 > first; sfb--) {
+                        const unsigned width = narrow[sfb + 1] - narrow[sfb];
+                        const unsigned from = 3 * narrow[sfb] + w * width;
+                        if (last(coded, from, from + width) != from) {
+                            first = sfb + 1;
+                            windows = true;
+                            break;
+                        }
+                    }
+                    for (unsigned sfb = first; sfb < 13; sfb++) {
+                        const unsigned band = std::min(sfb, 11u);
+                        const int position = sf.narrow[band][w];
+                        if (position >= sf.illegal_short[band]) {
+                            continue;
+                        }
+                        const unsigned width = narrow[sfb + 1] - narrow[sfb];
+                        const unsigned from = 3 * narrow[sfb] + w * width;
+                        intensity(left, right, from, from + width, position, head, gr, ms);
+                    }
+                }
+                if (!gr.mixed || windows) {
+                    return;
+                }
+            }
+            // Long bands, or the long part of a mixed block whose short part is all intensity
+            const unsigned limit = gr.block == 2 ? 36 : 576;
+            const unsigned end = last(coded, 0, limit);
+            unsigned first = 0;
+            while (first < 22 && wide[first] < end) {
+                first++;
+            }
+            for (unsigned sfb = first; sfb < 22 && wide[sfb] < limit; sfb++) {
+                const unsigned band = std::min(sfb, 20u);
+                const int position = sf.wide[band];
+                if (position >= sf.illegal[band]) {
+                    continue;
+                }
+                intensity(left, right, wide[sfb], std::min<unsigned>(wide[sfb + 1], limit), position, head, gr, ms);
+            }
+        }
+
+        template<size_t... G>
+        static void product(const float* in, const unsigned rows, const float* matrix, float* out, std::index_sequence<G...>) {
+            /** out = in times a row major matrix 4 * sizeof...(G) wide, the folds keep every sum in a register **/
+            constexpr unsigned width = 4 * sizeof...(G);
+#if WAVLIB_SSE2
+            __m128 sum[sizeof...(G)] = {((void)G, _mm_setzero_ps())...};
+            for (unsigned k = 0; k < rows; k++) {
+                // Most of the spectrum is zero above the bandwidth of the encoder
+                if (in[k] != 0.0f) {
+                    const __m128 v = _mm_set1_ps(in[k]);
+                    const float* row = matrix + k * width;
+                    ((sum[G] = _mm_add_ps(sum[G], _mm_mul_ps(v, _mm_loadu_ps(row + 4 * G)))), ...);
+                }
+            }
+            (_mm_storeu_ps(out + 4 * G, sum[G]), ...);
+#elif WAVLIB_NEON
+            float32x4_t sum[sizeof...(G)] = {((void)G, vdupq_n_f32(0.0f))...};
+            for (unsigned k = 0; k < rows; k++) {
+                if (in[k] != 0.0f) {
+                    const float* row = matrix + k * width;
+                    ((sum[G] = vmlaq_n_f32(sum[G], vld1q_f32(row + 4 * G), in[k])), ...);
+                }
+            }
+            (vst1q_f32(out + 4 * G, sum[G]), ...);
+#else
+            std::fill(out, out + width, 0.0f);
+            for (unsigned k = 0; k < rows; k++) {
+                if (in[k] != 0.0f) {
+                    const float* row = matrix + k * width;
+                    for (unsigned j = 0; j < width; j++) {
+                        out[j] += in[k] * row[j];
+                    }
+                }
+            }
+#endif
+        }
+
+        template<size_t... G>
+        static void window(const float* fifo, const unsigned position, const float* coefficients, float* out, std::index_sequence<G...>) {
+            /** One slot of output, 16 rows of the window against every other half of the last 16 vectors **/
+#if WAVLIB_SSE2
+            __m128 sum[sizeof...(G)] = {((void)G, _mm_setzero_ps())...};
+            for (unsigned r = 0; r < 16; r++) {
+                const float* d = coefficients + 32 * r;
+                const float* v = fifo + 64 * ((position + r) & 15) + (r & 1) * 32;
+                ((sum[G] = _mm_add_ps(sum[G], _mm_mul_ps(_mm_loadu_ps(d + 4 * G), _mm_loadu_ps(v + 4 * G)))), ...);
+            }
+            (_mm_storeu_ps(out + 4 * G, sum[G]), ...);
+#elif WAVLIB_NEON
+            float32x4_t sum[sizeof...(G)] = {((void)G, vdupq_n_f32(0.0f))...};
+            for (unsigned r = 0; r < 16; r++) {
+                const float* d = coefficients + 32 * r;
+                const float* v = fifo + 64 * ((position + r) & 15) + (r & 1) * 32;
+                ((sum[G] = vmlaq_f32(sum[G], vld1q_f32(d + 4 * G), vld1q_f32(v + 4 * G))), ...);
+            }
+            (vst1q_f32(out + 4 * G, sum[G]), ...);
+#else
+            std::fill(out, out + 32, 0.0f);
+            for (unsigned r = 0; r < 16; r++) {
+                const float* d = coefficients + 32 * r;
+                const float* v = fifo + 64 * ((position + r) & 15) + (r & 1) * 32;
+                for (unsigned j = 0; j < 32; j++) {
+                    out[j] += d[j] * v[j];
+                }
+            }
+#endif
+        }
+
+        static void hybrid(float* xr, const unsigned count, const HEADER& head, const GRANULE& gr, float* overlap, float* time) {
+            /** Reorder, alias reduction and IMDCT of one granule, time holds 18 slots of 32 subband samples **/
+            /** count is one past the last line that may be nonzero, subbands above it only release their overlap **/
+            const TABLES& t = tables();
+            unsigned limit = count;
+            if (gr.block == 2) {
+                // Window order to frequency order, each line followed by the same line of the other two windows
+                const uint16_t* narrow = short_bands(head.table);
+                float copy[576];
+                std::memcpy(copy, xr, sizeof(copy));
+                unsigned sfb = gr.mixed ? 3 : 0;
+                for (; sfb < 13 && 3 * narrow[sfb] < count; sfb++) {
+                    const unsigned width = narrow[sfb + 1] - narrow[sfb];
+                    const unsigned base = 3 * narrow[sfb];
+                    for (unsigned w = 0; w < 3; w++) {
+                        for (unsigned i = 0; i < width; i++) {
+                            xr[base + 3 * i + w] = copy[base + w * width + i];
+                        }
+                    }
+                }
+                limit = std::max(limit, 3u * narrow[sfb]);
+            }
+            unsigned active = std::min(32u, (limit + 17) / 18);
+            if (gr.block != 2 || gr.mixed) {
+                static const float cs[8] = {0.857492926f, 0.881741997f, 0.949628649f, 0.983314592f, 0.995517816f, 0.999160558f, 0.999899195f, 0.999993155f};
+                static const float ca[8] = {-0.514495755f, -0.471731969f, -0.313377454f, -0.181913200f, -0.094574193f, -0.040965583f, -0.014198569f, -0.003699975f};
+                const unsigned boundaries = gr.block == 2 ? 2 : std::min(32u, active + 1);
+                for (unsigned sb = 1; sb < boundaries; sb++) {
+                    float* p = xr + 18 * sb;
+                    for (unsigned i = 0; i < 8; i++) {
+                        const float lower = p[-1 - static_cast<int>(i)];
+                        const float upper = p[i];
+                        p[-1 - static_cast<int>(i)] = lower * cs[i] - upper * ca[i];
+                        p[i] = upper * cs[i] + lower * ca[i];
+                    }
+                }
+                active = std::max(active, std::min(32u, boundaries));
+            }
+            for (unsigned sb = 0; sb < 32; sb++) {
+                float* carry = overlap + 18 * sb;
+                float out[36];
+                if (sb < active) {
+                    product(xr + 18 * sb, 18, t.imdct[gr.mixed && sb < 2 ? 0 : gr.block], out, std::make_index_sequence<9>());
+                } else {
+                    std::fill(out, out + 36, 0.0f);
+                }
+                // Odd subbands come out of the polyphase filterbank mirrored, every other sample flips sign
+                const float sign = sb & 1 ? -1.0f : 1.0f;
+                for (unsigned n = 0; n < 18; n++) {
+                    const float v = out[n] + carry[n];
+                    time[32 * n + sb] = n & 1 ? v * sign : v;
+                    carry[n] = out[18 + n];
+                }
+            }
+        }
+
+        static void synthesis(const float* time, float* fifo, unsigned& position, float* out) {
+            /** Polyphase synthesis of 18 slots, fifo keeps the last 16 matrixed vectors of 64 **/
+            const TABLES& t = tables();
+            for (unsigned slot = 0; slot < 18; slot++) {
+                float x[32];
+                product(time + 32 * slot, 32, t.dct, x, std::make_index_sequence<8>());
+                position = (position + 15) & 15;
+                float* v = fifo + 64 * position;
+                // The 64 point matrixing is symmetric enough to come out of the 32 point one
+                v[16] = 0.0f;
+                for (unsigned j = 0; j < 16; j++) {
+                    v[j] = x[16 + j];
+                    v[32 + j] = -x[16 - j];
+                    v[48 + j] = -x[j];
+                }
+                for (unsigned j = 1; j < 16; j++) {
+                    v[16 + j] = -x[32 - j];
+                }
+                window(fifo, position, t.window, out + 32 * slot, std::make_index_sequence<8>());
+            }
+        }
+
+        class DECODER {
+        public:
+            /** Bit reservoir and filterbank state of one stream, about 40 KB **/
+            float pcm[2][1152]{};  // Output of the last decoded frame, one plane per channel
+
+            void reset() {
+                stored = 0;
+                std::fill(&overlap[0][0], &overlap[0][0] + 2 * 576, 0.0f);
+                std::fill(&fifo[0][0], &fifo[0][0] + 2 * 1024, 0.0f);
+                position[0] = position[1] = 0;
+            }
+
+            void prime(const unsigned char* frame, const HEADER& head) {
+                /** Keep the main data of a frame for the ones after it without decoding it **/
+                append(frame + head.side, head.size - head.side);
+            }
+
+            void decode(const unsigned char* frame, const HEADER& head) {
+                /** One frame into pcm, a frame that can't be read decodes as silence and keeps the stream going **/
+                /** No frame at all flushes what the filterbank still holds **/
+                SIDE info;
+                const bool parsed = frame != nullptr && side(frame, head, info);
+                unsigned available = stored;
+                if (frame != nullptr) {
+                    // Appending may drop the part of the reservoir no frame can reach anymore
+                    append(frame + head.side, head.size - head.side);
+                    available = stored - static_cast<unsigned>(head.size - head.side);
+                }
+                // The reservoir is missing the start of the main data after a seek or a damaged frame
+                const bool readable = parsed && info.begin <= available;
+                const unsigned char* main = reservoir + (available - (readable ? info.begin : 0));
+                const uint64_t bytes = stored - (main - reservoir);
+                uint64_t offset = 0;
+                for (unsigned g = 0; g < head.granules; g++) {
+                    unsigned counts[2] = {0, 0};
+                    for (unsigned c = 0; c < head.channels; c++) {
+                        GRANULE& gr = info.granule[g][c];
+                        if (!readable || (offset + gr.length + 7) / 8 > bytes) {
+                            std::fill(xr[c], xr[c] + 576, 0.0f);
+                            offset += readable ? gr.length : 0;
+                            continue;
+                        }
+                        FLAC::BITS bits(main + offset / 8, bytes - offset / 8);
+                        bits.read(offset % 8);
+                        const uint64_t end = offset % 8 + gr.length;
+                        if (head.lsf) {
+                            scalefactors(bits, gr, (head.extension & 1) && c == 1, scale[c]);
+                        } else {
+                            scalefactors(bits, gr, info.scfsi[c], g, scale[c]);
+                        }
+                        if (bits.tell() > end) {
+                            std::fill(xr[c], xr[c] + 576, 0.0f);
+                        } else {
+                            counts[c] = spectrum(bits, end, gr, lines);
+                            requantize(lines, counts[c], head, gr, scale[c], xr[c]);
+                        }
+                        offset += gr.length;
+                    }
+                    if (head.channels == 2 && head.extension != 0) {
+                        stereo(xr[0], xr[1], head, info.granule[g][1], scale[1]);
+                        // Intensity fills the right channel from the left one
+                        counts[0] = counts[1] = head.extension & 1 ? 576 : std::max(counts[0], counts[1]);
+                    }
+                    for (unsigned c = 0; c < head.channels; c++) {
+                        hybrid(xr[c], counts[c], head, info.granule[g][c], overlap[c], time);
+                        synthesis(time, fifo[c], position[c], pcm[c] + 576 * g);
+                    }
+                }
+            }
+
+        private:
+            void append(const unsigned char* data, const uint64_t size) {
+                // Main data can reach 511 bytes back, anything older is never needed again
+                if (stored + size > sizeof(reservoir)) {
+                    const unsigned keep = std::min(stored, 511u);
+                    std::memmove(reservoir, reservoir + stored - keep, keep);
+                    stored = keep;
+                }
+                const auto n = static_cast<unsigned>(std::min<uint64_t>(size, sizeof(reservoir) - stored));
+                std::memcpy(reservoir + stored, data, n);
+                stored += n;
+            }
+
+            unsigned char reservoir[4096]{};
+            unsigned stored = 0;
+            float overlap[2][576]{};
+            float fifo[2][1024]{};
+            unsigned position[2]{};
+            SCALE scale[2];
+            int32_t lines[576]{};
+            float xr[2][576]{};
+            float time[576]{};
+        };
+
+        template<typename AT>
+        static bool index(AT&& at, const uint64_t size, FORMAT::MP3& info) {
+            /** Every audio frame of the stream, plus the encoder delay and padding from a LAME tag **/
+            /** at(offset, n) points at n bytes of the file, or is null past the end **/
+            WAVLIB_SCOPE("MP3::index");
+            info = FORMAT::MP3();
+            uint64_t position = 0;
+            while (const unsigned char* p = at(position, 10)) {
+                const uint64_t skip = tag(reinterpret_cast<const char*>(p), 10);
+                if (skip == 0) {
+                    break;
+                }
+                position += skip;
+            }
+
+            // A frame counts once the one after it is there too, or it ends the file
+            unsigned char reference[4];
+            HEADER head;
+            auto confirmed = [&](const uint64_t offset, const bool compare) {
+                const unsigned char* p = at(offset, 4);
+                if (p == nullptr || !header(p, head) || (compare && !same(p, reference)) || offset + head.size > size) {
+                    return false;
+                }
+                unsigned char bytes[4];
+                std::memcpy(bytes, p, 4);
+                HEADER next;
+                const unsigned char* q = at(offset + head.size, 4);
+                return offset + head.size == size || (q != nullptr && header(q, next) && same(q, bytes));
+            };
+            while (position < size && !confirmed(position, false)) {
+                position++;
+            }
+            if (position >= size) {
+                return false;
+            }
+            std::memcpy(reference, at(position, 4), 4);
+            info.sample_rate = head.sample_rate;
+            info.channels = static_cast<unsigned short>(head.channels);
+            info.frame_samples = static_cast<unsigned short>(head.lsf ? 576 : 1152);
+
+            // The first frame may be a Xing, Info or VBRI frame, which decodes to silence and isn't part of the audio
+            VBR vbr;
+            if (const unsigned char* p = at(position, head.size)) {
+                if (vbr.parse(p, head)) {
+                    position += head.size;
+                }
+            }
+
+            uint64_t bytes = 0;
+            uint64_t end = position;
+            bool lost = false;
+            while (position + 4 <= size) {
+                const unsigned char* p = at(position, 4);
+                if (p != nullptr && (lost ? confirmed(position, true) : header(p, head) && same(p, reference))) {
+                    if (position + head.size > size) {
+                        // A truncated last frame
+                        break;
+                    }
+                    info.index.push_back(position);
+                    bytes += head.size;
+                    position += head.size;
+                    end = position;
+                    lost = false;
+                    continue;
+                }
+                // Junk or a damaged header, look for the next pair of frames
+                lost = true;
+                position++;
+            }
+            const uint64_t frames = info.index.size();
+            info.index.push_back(end);
+
+            const uint64_t total = frames * info.frame_samples;
+            vbr.trim(total, info);
+            info.bitrate = total == 0 ? 0 : static_cast<unsigned>((bytes * 8 * info.sample_rate + total / 2) / total);
+            return true;
+        }
+
+        template<typename AT>
+        static bool probe(AT&& at, const uint64_t size, FORMAT::MP3& info, bool& exact) {
+            /** Stream parameters from the first frames and the Xing, Info or VBRI header, index only holds the first audio frame **/
+            /** Without a frame count in those headers the length is estimated from the bitrate and exact is false **/
+            WAVLIB_SCOPE("MP3::probe");
+            info = FORMAT::MP3();
+            exact = false;
+            uint64_t position = 0;
+            while (const unsigned char* p = at(position, 10)) {
+                const uint64_t skip = tag(reinterpret_cast<const char*>(p), 10);
+                if (skip == 0) {
+                    break;
+                }
+                position += skip;
+            }
+
+            // Same sync rule as index(), but only over the first 64 KiB of the stream
+            HEADER head;
+            auto confirmed = [&](const uint64_t offset) {
+                const unsigned char* p = at(offset, 4);
+                if (p == nullptr || !header(p, head) || offset + head.size > size) {
+                    return false;
+                }
+                unsigned char bytes[4];
+                std::memcpy(bytes, p, 4);
+                HEADER next;
+                const unsigned char* q = at(offset + head.size, 4);
+                return offset + head.size == size || (q != nullptr && header(q, next) && same(q, bytes));
+            };
+            const uint64_t limit = std::min(size, position + 65536);
+            while (position < limit && !confirmed(position)) {
+                position++;
+            }
+            if (position >= limit) {
+                return false;
+            }
+            info.sample_rate = head.sample_rate;
+            info.channels = static_cast<unsigned short>(head.channels);
+            info.frame_samples = static_cast<unsigned short>(head.lsf ? 576 : 1152);
+
+            VBR vbr;
+            if (const unsigned char* p = at(position, head.size)) {
+                if (vbr.parse(p, head)) {
+                    position += head.size;
+                }
+            }
+            info.index.push_back(position);
+            // An ID3v1 tag takes the last 128 bytes
+            uint64_t end = size;
+            if (size >= position + 128) {
+                const unsigned char* p = at(size - 128, 3);
+                if (p != nullptr && std::memcmp(p, "TAG", 3) == 0) {
+                    end -= 128;
+                }
+            }
+            const uint64_t bytes = end - position;
+            exact = vbr.counted;
+            // A constant bitrate stream averages bitrate / 8 * frame_samples / sample_rate bytes per frame
+            const uint64_t frames = exact ? vbr.frames : (bytes * 8 * head.sample_rate + head.bitrate * info.frame_samples / 2) / (static_cast<uint64_t>(head.bitrate) * info.frame_samples);
+            const uint64_t total = frames * info.frame_samples;
+            vbr.trim(total, info);
+            info.bitrate = exact ? (total == 0 ? 0 : static_cast<unsigned>((bytes * 8 * info.sample_rate + total / 2) / total)) : head.bitrate;
+            return true;
+        }
+
+        struct VBR {
+            /** What a Xing, Info or VBRI frame in front of the audio says **/
+            bool counted = false;         // frames is known
+            uint64_t frames = 0;          // Audio frames after this one
+            bool gapless = false;         // A LAME tag gave the encoder delay and padding
+            uint64_t delay = 0;
+            uint64_t padding = 0;
+
+            bool parse(const unsigned char* p, const HEADER& head) {
+                /** True if p is such a frame, which decodes to silence and isn't part of the audio **/
+                const unsigned char* xing = p + head.side;
+                if (head.side + 8 <= head.size && (std::memcmp(xing, "Xing", 4) == 0 || std::memcmp(xing, "Info", 4) == 0)) {
+                    const unsigned flags = xing[7];
+                    if (flags & 1 && head.side + 12 <= head.size) {
+                        counted = true;
+                        frames = word(xing + 8);
+                    }
+                    const uint64_t lame = 8 + (flags & 1 ? 4 : 0) + (flags & 2 ? 4 : 0) + (flags & 4 ? 100 : 0) + (flags & 8 ? 4 : 0);
+                    const unsigned char* l = xing + lame;
+                    if (head.side + lame + 24 <= head.size &&
+                        (std::memcmp(l, "LAME", 4) == 0 || std::memcmp(l, "Lavf", 4) == 0 || std::memcmp(l, "Lavc", 4) == 0)) {
+                        gapless = true;
+                        delay = static_cast<uint64_t>(l[21]) << 4 | l[22] >> 4;
+                        padding = static_cast<uint64_t>(l[22] & 15) << 8 | l[23];
+                    }
+                    return true;
+                }
+                if (head.size >= 36 + 26 && std::memcmp(p + 36, "VBRI", 4) == 0) {
+                    counted = true;
+                    frames = word(p + 36 + 14);
+                    return true;
+                }
+                return false;
+            }
+
+            static uint64_t word(const unsigned char* p) {
+                return static_cast<uint64_t>(p[0]) << 24 | static_cast<uint64_t>(p[1]) << 16 | static_cast<uint64_t>(p[2]) << 8 | p[3];
+            }
+
+            void trim(const uint64_t total, FORMAT::MP3& info) const {
+                /** Samples per channel and decoder skip for total decoded samples **/
+                info.skip = gapless ? delay + 529 : 0;
+                info.frames = gapless ? (total > delay + padding ? total - delay - padding : 0) : total;
+            }
+        };
+
+        static void assign(const FORMAT::MP3& info, FORMAT::WAV& audio) {
+            /** Header of the 32-bit float file this stream decodes to **/
+            audio.format = 3;
+            audio.channels = info.channels;
+            audio.sample_rate = info.sample_rate;
+            audio.sample_size = 32;
+            audio.data_rate = info.sample_rate * info.channels * 4;
+            audio.data_size = info.frames * info.channels * 4;
+            audio.chunks.clear();
+        }
+
+        static uint64_t lead(const FORMAT::MP3& info, const uint64_t frame) {
+            /** First frame to read for correct output from frame on **/
+            // The filterbank settles after two granules, and the frames before those have to refill the reservoir
+            const uint64_t count = info.index.size() - 1;
+            uint64_t first = std::min(frame - std::min<uint64_t>(frame, info.frame_samples == 576 ? 2 : 1), count);
+            uint64_t bytes = 0;
+            while (first > 0 && bytes < 511) {
+                first--;
+                // Less the largest side info, so the guess never comes up short
+                const uint64_t size = info.index[first + 1] - info.index[first];
+                bytes += size > 38 ? size - 38 : 0;
+            }
+            return first;
+        }
+
+        template<typename EMIT>
+        static void render(const unsigned char* data, const uint64_t base, const FORMAT::MP3& info, const uint64_t from, const uint64_t to, DECODER& decoder,
+                           EMIT&& emit) {
+            /** Samples [from, to) of the trimmed stream, data holds the file from base on and at least the frames lead() asks for **/
+            /** emit(decoder, offset in the frame, samples, position in the stream) **/
+            const uint64_t count = info.index.size() - 1;
+            const uint64_t spf = info.frame_samples;
+            const uint64_t begin = info.skip + from;
+            const uint64_t finish = info.skip + to;
+            const uint64_t first = begin / spf;
+            const uint64_t warm = first - std::min<uint64_t>(first, spf == 576 ? 2 : 1);
+            // Past the last frame the filterbank still has the tail of the stream in it
+            HEADER silence;
+            silence.lsf = spf == 576;
+            silence.channels = info.channels;
+            silence.granules = silence.lsf ? 1 : 2;
+            decoder.reset();
+            for (uint64_t f = lead(info, first), end = (finish + spf - 1) / spf; f < end; f++) {
+                if (f < count) {
+                    const unsigned char* frame = data + (info.index[f] - base);
+                    HEADER head;
+                    header(frame, head);
+                    if (f < warm) {
+                        decoder.prime(frame, head);
+                        continue;
+                    }
+                    decoder.decode(frame, head);
+                } else {
+                    decoder.decode(nullptr, silence);
+                }
+                if (f < first) {
+                    continue;
+                }
+                const uint64_t a = std::max(begin, f * spf);
+                const uint64_t b = std::min(finish, (f + 1) * spf);
+                emit(decoder, a - f * spf, b - a, a - info.skip);
+            }
+            WAVLIB_COUNT(SAMPLES_DECODED, (to - from) * info.channels);
+        }
+
+        static int32_t quantize(const float v) {
+            // Float WAV data is kept as 32-bit integers scaled by 2^31
+            return static_cast<int32_t>(std::lrint(std::min(std::max(static_cast<double>(v) * 2147483648.0, -2147483648.0), 2147483647.0)));
+        }
+
+        static void prepare(const FORMAT::MP3& info, FORMAT::WAV& audio) {
+            assign(info, audio);
+            audio.audio.resize(info.frames * info.channels);
+        }
+
+        static void prepare(const FORMAT::MP3& info, FORMAT::PLANAR& audio) {
+            audio.sample_rate = info.sample_rate;
+            audio.resize(info.channels, info.frames);
+        }
+
+        static void store(const DECODER& decoder, const uint64_t offset, const uint64_t n, const uint64_t position, FORMAT::WAV& audio) {
+            const unsigned channels = audio.channels;
+            int32_t* out = audio.audio.data() + position * channels;
+            for (unsigned c = 0; c < channels; c++) {
+                const float* in = decoder.pcm[c] + offset;
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i * channels + c] = quantize(in[i]);
+                }
+            }
+        }
+
+        static void store(const DECODER& decoder, const uint64_t offset, const uint64_t n, const uint64_t position, FORMAT::PLANAR& audio) {
+            for (unsigned c = 0; c < audio.channels; c++) {
+                std::memcpy(audio.audio.data() + c * audio.stride + position, decoder.pcm[c] + offset, n * sizeof(float));
+            }
+        }
+
+        template<typename AUDIO>
+        static bool decode(const char* bytes, const uint64_t size, AUDIO& audio) {
+            /** A whole file in memory to samples, runs of frames decode in parallel on the shared pool **/
+            WAVLIB_SCOPE("MP3::decode");
+            const auto* data = reinterpret_cast<const unsigned char*>(bytes);
+            static thread_local FORMAT::MP3 info;
+            const bool found = index([&](const uint64_t offset, const uint64_t n) { return offset + n <= size ? data + offset : nullptr; }, size, info);
+            if (!found) {
+                return false;
+            }
+            prepare(info, audio);
+            if (info.frames == 0) {
+                return true;
+            }
+            POOL& pool = POOL::shared();
+            const uint64_t tasks = std::max<uint64_t>(1, std::min<uint64_t>(pool.size() * 4, (info.index.size() - 1) / 64));
+            pool.run(tasks, [&](const uint64_t task) {
+                static thread_local std::unique_ptr<DECODER> decoder(new DECODER);
+                render(data, 0, info, info.frames * task / tasks, info.frames * (task + 1) / tasks, *decoder,
+                       [&](const DECODER& state, const uint64_t offset, const uint64_t n, const uint64_t position) { store(state, offset, n, position, audio); });
+            });
+            return true;
+        }
+    };
+
+    struct AAC {
+        /** AAC-LC decoding of ADTS streams and MP4/M4A files **/
+        /** Frames share nothing but the second half of the filterbank window, so any run of frames decodes on its own, **/
+        /** and exactly as in one pass, once it starts a frame early. SBR and PS data is skipped, HE-AAC comes out as its **/
+        /** AAC-LC core at half the sample rate **/
+
+        enum : unsigned { ONLY_LONG = 0, LONG_START = 1, EIGHT_SHORT = 2, LONG_STOP = 3 };
+        enum : unsigned { ZERO = 0, ESCAPE = 11, NOISE = 13, INTENSITY_OUT = 14, INTENSITY = 15 };
+
+        struct HEADER {
+            /** ADTS frame header **/
+            unsigned object{};            // Audio object type, 2 is LC
+            unsigned frequency{};         // Sampling frequency index
+            unsigned layout{};            // Channel configuration, 0 means a program config element in the stream
+            unsigned header{};            // Bytes of header and CRC
+            unsigned blocks{};            // Raw data blocks in the frame
+            uint64_t size{};              // Bytes of the whole frame
+        };
+
+        struct TNS {
+            /** Temporal noise shaping filters of each window **/
+            unsigned filters[8]{};        // Filters in the window
+            unsigned length[8][3]{};      // Bands each filter covers, counted down from the one above
+            unsigned order[8][3]{};
+            bool down[8][3]{};            // Runs from high to low frequencies
+            float lpc[8][3][13]{};        // Direct form coefficients, lpc[0] is 1
+        };
+
+        struct ICS {
+            /** Side info of one channel of a raw data block **/
+            unsigned sequence{};          // Window sequence
+            unsigned shape{};             // Window shape, 0 sine and 1 Kaiser-Bessel derived
+            unsigned max_sfb{};           // Bands with data, per window
+            unsigned windows{};           // 1 or 8
+            unsigned groups{};            // Groups of short windows that share scalefactors
+            unsigned length[8]{};         // Windows in each group
+            unsigned bands{};             // Scalefactor bands of the window
+            const uint16_t* offsets{};    // First line of each band within the window, plus its length
+            unsigned char types[8][64]{}; // Codebook of each band in each group
+            int scale[8][64]{};           // Scalefactor, intensity position or noise energy of each band
+            unsigned pulses{};            // Pulses added to the quantized lines, long windows only
+            unsigned pulse_line[4]{};
+            int pulse_amplitude[4]{};
+            bool shaped{};                // tns holds filters
+            TNS tns;
+        };
+
+        static unsigned rate(const unsigned frequency) {
+            static const unsigned hz[13] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+            return frequency < 13 ? hz[frequency] : 0;
+        }
+
+        static unsigned frequency(const unsigned hz) {
+            /** Table row of a sample rate that is not one of the 13, the nearest standard rate **/
+            static const unsigned above[12] = {92017, 75132, 55426, 46009, 37566, 27713, 23004, 18783, 13856, 11502, 9391, 0};
+            unsigned index = 0;
+            while (hz < above[index]) {
+                index++;
+            }
+            return index;
+        }
+
+        static unsigned count(const unsigned layout) {
+            /** Channels of a channel configuration **/
+            static const unsigned char channels[8] = {0, 1, 2, 3, 4, 5, 6, 8};
+            return layout < 8 ? channels[layout] : 0;
+        }
+
+        static const unsigned char* order(const unsigned layout) {
+            /** WAV position of each channel in the order the elements carry them, the center comes first in AAC **/
+            static const unsigned char orders[8][8] = {{0}, {0}, {0, 1}, {2, 0, 1}, {2, 0, 1, 3}, {2, 0, 1, 3, 4}, {2, 0, 1, 4, 5, 3}, {2, 0, 1, 6, 7, 4, 5, 3}};
+            return orders[layout];
+        }
+
+        static const uint16_t* long_bands(const unsigned frequency, unsigned& bands) {
+            /** First line of each scalefactor band of a long window, plus 1024 **/
+            static const uint16_t b96[42] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 64, 72, 80, 88, 96, 108, 120, 132, 144, 156, 172, 188, 212,
+                                             240, 276, 320, 384, 448, 512, 576, 640, 704, 768, 832, 896, 960, 1024};
+            static const uint16_t b64[48] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 64, 72, 80, 88, 100, 112, 124, 140, 156, 172, 192, 216, 240,
+                                             268, 304, 344, 384, 424, 464, 504, 544, 584, 624, 664, 704, 744, 784, 824, 864, 904, 944, 984, 1024};
+            static const uint16_t b48[50] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 48, 56, 64, 72, 80, 88, 96, 108, 120, 132, 144, 160, 176, 196, 216, 240,
+                                             264, 292, 320, 352, 384, 416, 448, 480, 512, 544, 576, 608, 640, 672, 704, 736, 768, 800, 832, 864, 896, 928, 1024};
+            static const uint16_t b32[52] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 48, 56, 64, 72, 80, 88, 96, 108, 120, 132, 144, 160, 176, 196, 216, 240,
+                                             264, 292, 320, 352, 384, 416, 448, 480, 512, 544, 576, 608, 640, 672, 704, 736, 768, 800, 832, 864, 896, 928, 960,
+                                             992, 1024};
+            static const uint16_t b24[48] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 52, 60, 68, 76, 84, 92, 100, 108, 116, 124, 136, 148, 160, 172, 188,
+                                             204, 220, 240, 260, 284, 308, 336, 364, 396, 432, 468, 508, 552, 600, 652, 704, 768, 832, 896, 960, 1024};
+            static const uint16_t b16[44] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 100, 112, 124, 136, 148, 160, 172, 184, 196, 212, 228, 244, 260, 280,
+                                             300, 320, 344, 368, 396, 424, 456, 492, 532, 572, 616, 664, 716, 772, 832, 896, 960, 1024};
+            static const uint16_t b8[41] = {0, 12, 24, 36, 48, 60, 72, 84, 96, 108, 120, 132, 144, 156, 172, 188, 204, 220, 236, 252, 268, 288, 308, 328, 348, 372,
+                                            396, 420, 448, 476, 508, 544, 580, 620, 664, 712, 764, 820, 880, 944, 1024};
+            static const uint16_t* tables[13] = {b96, b96, b64, b48, b48, b32, b24, b24, b16, b16, b16, b8, b8};
+            static const unsigned char counts[13] = {41, 41, 47, 49, 49, 51, 47, 47, 43, 43, 43, 40, 40};
+            bands = counts[frequency];
+            return tables[frequency];
+        }
+
+        static const uint16_t* short_bands(const unsigned frequency, unsigned& bands) {
+            /** First line of each scalefactor band of a short window, plus 128 **/
+            static const uint16_t b96[13] = {0, 4, 8, 12, 16, 20, 24, 32, 40, 48, 64, 92, 128};
+            static const uint16_t b48[15] = {0, 4, 8, 12, 16, 20, 28, 36, 44, 56, 68, 80, 96, 112, 128};
+            static const uint16_t b24[16] = {0, 4, 8, 12, 16, 20, 24, 28, 36, 44, 52, 64, 76, 92, 108, 128};
+            static const uint16_t b16[16] = {0, 4, 8, 12, 16, 20, 24, 28, 32, 40, 48, 60, 72, 88, 108, 128};
+            static const uint16_t b8[16] = {0, 4, 8, 12, 16, 20, 24, 28, 36, 44, 52, 60, 72, 88, 108, 128};
+            static const uint16_t* tables[13] = {b96, b96, b96, b48, b48, b48, b24, b24, b16, b16, b16, b8, b8};
+            static const unsigned char counts[13] = {12, 12, 12, 14, 14, 14, 15, 15, 15, 15, 15, 15, 15};
+            bands = counts[frequency];
+            return tables[frequency];
+        }
+
+        struct TABLES {
+            std::vector<uint32_t> huffman;  // Leaves are the index of the codeword, laid out as in MP3::TABLES
+            uint32_t books[12]{};           // Link to the first level of the scalefactor table at 0 and of each spectral codebook
+            float power[8192]{};            // |x| ^ (4 / 3)
+            float rise[2][1024]{};          // Rising half of the long sine and Kaiser-Bessel derived windows
+            float fall[2][1024]{};          // Falling half, the rising one reversed
+            float rise_short[2][128]{};
+            float fall_short[2][128]{};
+        };
+
+        static TABLES build() {
+            TABLES t;
+            // Code << 5 | length of each codeword index, ISO/IEC 14496-3 tables 4.A.1 to 4.A.12
+            static const uint32_t codes[] = {
+                // scalefactors
+                0x7ffd12, 0x7ffcd2, 0x7ffcf2, 0x7ffcb2, 0xfffeb3, 0xfffe33, 0xfffdb3, 0xfffed3, 0xfffdd3, 0xfffdf3, 0xfffe13, 0xffff93, 0xffffb3,
+                0xfffff3, 0xffffd3, 0xfffef3, 0xffff13, 0xffff73, 0xffff33, 0x7ffc92, 0xffff53, 0x7ffc72, 0x3ffdf1, 0x3ffe11, 0x1ffeb0, 0x3ffdd1,
+                0x1ffe50, 0x1ffe70, 0x1ffe90, 0x1ffe30, 0xffecf, 0xffeef, 0x7ff2e, 0x7feae, 0x7feee, 0x7fe6e, 0x7fece, 0x7fe4e, 0x3feed, 0x3fead,
+                0x1ff2c, 0x1feec, 0x1fecc, 0xff2b, 0x1fe8c, 0xff0b, 0x7f2a, 0x7eea, 0x7eaa, 0x3f09, 0x3ee9, 0x1f48, 0x1f08, 0x1ec8, 0xf27, 0x746,
+                0x706, 0x345, 0x164, 0x83, 0x1, 0x144, 0x184, 0x365, 0x726, 0x766, 0xf07, 0xf47, 0x1ee8, 0x1f28, 0x3ec9, 0x3f29, 0x7e8a, 0x7eca,
+                0x7f0a, 0xfeab, 0xfe8b, 0xfecb, 0xfeeb, 0x1feac, 0x1ff0c, 0x3fe8d, 0x3fecd, 0x3ff0d, 0x7ff0e, 0x7fe8e, 0x1ffe10, 0xffe8f, 0x1ffed0,
+                0xffeaf, 0x7ffc52, 0xfffb33, 0xfffb53, 0xfffb73, 0xfffb93, 0xfffbb3, 0xfffbd3, 0xfffb13, 0xfffa53, 0xfffa73, 0xfffa93, 0xfffab3,
+                0xfffad3, 0xfffe53, 0xfffbf3, 0xfffcf3, 0xfffd13, 0xfffd33, 0xfffd53, 0xfffd73, 0xfffcd3, 0xfffc13, 0xfffc33, 0xfffc53, 0xfffc73,
+                0xfffc93, 0xfffcb3, 0xfffaf3, 0xfffd93, 0xfffe93, 0xfffe73,
+                // codebook 1
+                0xff0b, 0x3e29, 0xffab, 0x7eaa, 0xd07, 0x7e0a, 0xfeeb, 0x3d89, 0xfeab, 0x7e2a, 0xe47, 0x7e8a, 0xe87, 0x225, 0xec7, 0x3d69, 0xd87,
+                0x7eca, 0xff8b, 0x3c29, 0xfe2b, 0x3e09, 0xc27, 0x3ec9, 0xfe4b, 0x3d49, 0xff6b, 0x3e49, 0xd27, 0x3da9, 0xee7, 0x2e5, 0xde7, 0x3cc9,
+                0xc87, 0x3ca9, 0xce7, 0x2a5, 0xc47, 0x245, 0x1, 0x285, 0xca7, 0x2c5, 0xda7, 0x3d29, 0xc67, 0x3c89, 0xd67, 0x265, 0xe27, 0x3c69,
+                0xe07, 0x3e69, 0xffcb, 0x3ce9, 0xfe6b, 0x3de9, 0xc07, 0x3dc9, 0xfe0b, 0x3c49, 0xff4b, 0x7e6a, 0xd47, 0x3d09, 0xea7, 0x205, 0xe67,
+                0x3e89, 0xdc7, 0x7eea, 0xfecb, 0x3c09, 0xff2b, 0x7e4a, 0xcc7, 0x3ea9, 0xffeb, 0x3ee9, 0xfe8b,
+                // codebook 2
+                0x3e69, 0xde7, 0x3fa9, 0x1d68, 0x466, 0x1d48, 0x3ee9, 0x1d08, 0x3f49, 0x1e48, 0x5a6, 0xe07, 0x406, 0xc5, 0x566, 0xdc7, 0x506, 0x1d28,
+                0x3f29, 0xcc7, 0x1f08, 0x1ce8, 0x366, 0x1e28, 0x3e89, 0xd67, 0x3ea9, 0x1d88, 0x546, 0xd87, 0x586, 0x145, 0x4e6, 0xce7, 0x346, 0x1ea8,
+                0x486, 0x105, 0x3e6, 0x125, 0x3, 0xe5, 0x3a6, 0x165, 0x606, 0x1de8, 0x386, 0xc87, 0x3c6, 0x185, 0x526, 0x1e68, 0x5e6, 0x1e08, 0x3f89,
+                0xe27, 0x3e49, 0x1e88, 0x426, 0x1cc8, 0x1ee8, 0xd07, 0x3f09, 0x1dc8, 0x446, 0xca7, 0x626, 0x44, 0x4c6, 0x1da8, 0x4a6, 0xd47, 0x3f69,
+                0xe47, 0x3fc9, 0xd27, 0x5c6, 0x1ec8, 0x3fe9, 0xda7, 0x3ec9,
+                // codebook 3
+                0x1, 0x124, 0x1de8, 0x164, 0x325, 0x1e08, 0x3d69, 0x3cc9, 0x7e4a, 0x144, 0x6a6, 0x3de9, 0x686, 0x6e6, 0x3d29, 0x3da9, 0x3ce9, 0x7e6a,
+                0x3dc9, 0x7daa, 0x3ff4d, 0x3d89, 0x3e49, 0xff2b, 0xff0b, 0x7f0a, 0x1ff0c, 0x104, 0x706, 0x7eca, 0x6c6, 0xea7, 0x7e2a, 0x7d6a, 0x7d8a,
+                0x1fe8c, 0x305, 0xec7, 0xfe8b, 0x726, 0xe87, 0x7dea, 0x3e69, 0x3e89, 0xfecb, 0x3d09, 0x7d4a, 0x3ff8d, 0x1e48, 0x3e29, 0x1ff6c,
+                0x7eaa, 0xfe6b, 0x1ff8c, 0x1dc8, 0x7eea, 0xfffcf, 0x3e09, 0xfeab, 0xfffaf, 0x3ff6d, 0x7ff4e, 0x1ffff0, 0x1e28, 0x7e0a, 0x7ff8e,
+                0x3d49, 0x7dca, 0x7ff6e, 0x1fecc, 0x1ff4c, 0xfff8f, 0xfe4b, 0x1feac, 0x1fffd0, 0x7e8a, 0xfeeb, 0xfff6f, 0x1feec, 0x1ff2c, 0xfff4f,
+                // codebook 4
+                0xe4, 0x2c5, 0x1ec8, 0x305, 0x104, 0x1de8, 0x3de9, 0x1e68, 0xff0b, 0x325, 0x2e5, 0x1da8, 0x2a5, 0x24, 0x1c48, 0x1e08, 0xe07, 0x7e0a,
+                0x3dc9, 0x1e28, 0xff4b, 0x1dc8, 0x1c88, 0x7e4a, 0xfecb, 0x7dea, 0xffab, 0xa4, 0x285, 0x1e48, 0x124, 0x84, 0x1ca8, 0x1e88, 0x1d08,
+                0x7e8a, 0xc4, 0x44, 0x1ce8, 0x64, 0x4, 0xd67, 0x1c68, 0xd27, 0x3e69, 0x1d68, 0x1cc8, 0x7eca, 0xdc7, 0xd47, 0x3e89, 0x7d8a, 0x3e09,
+                0x7f2a, 0x1ea8, 0x1d88, 0xff6b, 0x1d48, 0xde7, 0x7eea, 0xff2b, 0x7e6a, 0x1ffec, 0x1d28, 0xda7, 0x7f0a, 0xd87, 0xd07, 0x3ea9, 0x7dca,
+                0x3e49, 0xfe8b, 0xfeeb, 0x7e2a, 0x1ffcc, 0x7daa, 0x3e29, 0xfeab, 0xffcb, 0x7eaa, 0xff8b,
+                // codebook 5
+                0x3ffed, 0x1feec, 0xfe8b, 0xfd0b, 0x7e2a, 0xfdcb, 0xff2b, 0x1ff0c, 0x3ffad, 0x1ffac, 0xfe2b, 0x7d0a, 0x3d09, 0x1e08, 0x3d89, 0x7dca,
+                0xfe4b, 0x1ff4c, 0x1fe8c, 0x7dea, 0x3e49, 0x1d08, 0xe07, 0x1d88, 0x3e09, 0x7d4a, 0xfe6b, 0xfd6b, 0x3d69, 0x1d48, 0x345, 0x104, 0x325,
+                0x1dc8, 0x3de9, 0xfdab, 0x7e0a, 0x1e48, 0xe67, 0x164, 0x1, 0x144, 0xe27, 0x1e68, 0xfd2b, 0xfdeb, 0x3dc9, 0x1de8, 0x305, 0x124, 0x365,
+                0x1d68, 0x3d29, 0xfd8b, 0xfecb, 0x7d6a, 0x3e69, 0x1da8, 0xe47, 0x1d28, 0x3e29, 0x7daa, 0xfeeb, 0x1fecc, 0xfe0b, 0x7d2a, 0x3da9,
+                0x1e28, 0x3d49, 0x7d8a, 0xff0b, 0x1ff2c, 0x3ff8d, 0x1ff8c, 0x1feac, 0xfd4b, 0x7e6a, 0x7e4a, 0xfeab, 0x1ff6c, 0x3ffcd,
+                // codebook 6
+                0xffcb, 0x7faa, 0x3e29, 0x3d69, 0x3e89, 0x3d49, 0x3e09, 0x7f8a, 0xffab, 0x7eca, 0x3ca9, 0x1d48, 0xd87, 0xe27, 0xd07, 0x1e08, 0x3cc9,
+                0x7eea, 0x3e69, 0x1de8, 0x646, 0x4e6, 0x506, 0x4c6, 0x626, 0x1d68, 0x3ee9, 0x3d09, 0xde7, 0x5c6, 0x104, 0x84, 0xc4, 0x526, 0xd67,
+                0x3dc9, 0x3de9, 0xe47, 0x5a6, 0x44, 0x4, 0x64, 0x5e6, 0xe67, 0x3f49, 0x3ce9, 0xdc7, 0x566, 0xe4, 0x24, 0xa4, 0x586, 0xda7, 0x3d89,
+                0x3f29, 0x1dc8, 0x606, 0x486, 0x546, 0x4a6, 0x666, 0x1d88, 0x3e49, 0x7f0a, 0x3c89, 0x1da8, 0xd47, 0xe07, 0xd27, 0xe87, 0x1e28,
+                0x7f4a, 0xffeb, 0x7f2a, 0x3ec9, 0x3da9, 0x3f09, 0x3d29, 0x3ea9, 0x7f6a, 0xff8b,
+                // codebook 7
+                0x1, 0xa3, 0x6e6, 0xe87, 0x1e48, 0x3d69, 0x7daa, 0xfeeb, 0x83, 0x184, 0x6a6, 0xe27, 0x1d88, 0x1dc8, 0x3dc9, 0x3ea9, 0x6c6, 0x686,
+                0xe47, 0x1d48, 0x1e28, 0x3d29, 0x3e69, 0x7eaa, 0xe67, 0xe07, 0x1d68, 0x1e08, 0x3e29, 0x3e09, 0x7d8a, 0x7f4a, 0x1e68, 0x1da8, 0x3d09,
+                0x3de9, 0x7dea, 0x7e2a, 0x7f2a, 0xff6b, 0x3da9, 0x1de8, 0x3d49, 0x3e49, 0x7e6a, 0x7f0a, 0xff2b, 0xff8b, 0x7dca, 0x3d89, 0x3e89,
+                0x7e8a, 0x7eea, 0xff0b, 0x1ffac, 0x1ffcc, 0xfecb, 0x7e0a, 0x7e4a, 0x7eca, 0xff4b, 0xffab, 0x1ff8c, 0x1ffec,
+                // codebook 8
+                0x1c5, 0xa4, 0x205, 0x606, 0xde7, 0x1e28, 0x3f49, 0x7fca, 0x64, 0x3, 0x84, 0x245, 0x586, 0xd47, 0xea7, 0x1f08, 0x1e5, 0x44, 0xc4,
+                0x285, 0x5c6, 0xd27, 0xe47, 0x1ea8, 0x5e6, 0x225, 0x265, 0x546, 0x646, 0xd87, 0x1d88, 0x1f48, 0xe27, 0x566, 0x5a6, 0x626, 0xda7,
+                0xe07, 0x1e48, 0x3f29, 0x1de8, 0xd07, 0x666, 0xd67, 0xdc7, 0x1dc8, 0x1f28, 0x7f8a, 0x3f09, 0xe87, 0xe67, 0x1da8, 0x1e08, 0x1ec8,
+                0x3ec9, 0x3fa9, 0x7faa, 0x1e68, 0x1e88, 0x1ee8, 0x3ee9, 0x3f69, 0x3f89, 0x7fea,
+                // codebook 9
+                0x1, 0xa3, 0x6e6, 0x1ce8, 0x3bc9, 0x79ca, 0x7b2a, 0xf90b, 0xf9ab, 0x1f90c, 0x1fbac, 0x3fc8d, 0x3fd8d, 0x83, 0x184, 0x6a6, 0xe47,
+                0x1d48, 0x1da8, 0x3c49, 0x7a2a, 0x7a6a, 0x7c0a, 0xfb0b, 0x1f9ec, 0x1faac, 0x6c6, 0x686, 0xe27, 0x1d08, 0x1d88, 0x3c29, 0x79ea,
+                0x7baa, 0x7b6a, 0xfa0b, 0x1f8ec, 0x1fa8c, 0x1fc8c, 0x1cc8, 0xe07, 0x1d28, 0x3ba9, 0x3c69, 0x7a4a, 0x7b8a, 0xf98b, 0xf94b, 0xfbcb,
+                0x1fb0c, 0x1fd4c, 0x3fb6d, 0x3be9, 0x1d68, 0x3b89, 0x3cc9, 0x7aaa, 0x7bca, 0xf96b, 0xfbab, 0xfb8b, 0x1f9ac, 0x1fc4c, 0x1fcec,
+                0x3fc2d, 0x7a0a, 0x3c09, 0x3c89, 0x7aca, 0xf8ab, 0xfa2b, 0xfb6b, 0x1fa4c, 0xfc0b, 0x1fb2c, 0x1fd6c, 0x3fc6d, 0x3fd2d, 0xf88b, 0x3ca9,
+                0x7aea, 0xf8cb, 0xf9eb, 0xfb4b, 0x1f96c, 0x1fb4c, 0x1fc6c, 0x1fd2c, 0x3fccd, 0x3fe6d, 0x3feed, 0xfa6b, 0x7b0a, 0x7c2a, 0xfa8b,
+                0xfb2b, 0x1fa6c, 0x1fbcc, 0x3fbad, 0x3fb2d, 0x3fc4d, 0x3fd4d, 0x3fe2d, 0x3fecd, 0xfa4b, 0x7a8a, 0x7b4a, 0xf8eb, 0xfaeb, 0xfc4b,
+                0x1f9cc, 0x1fb6c, 0x3fb0d, 0x3fdcd, 0x7fe0e, 0x3fe8d, 0x7fe4e, 0xfc2b, 0x7bea, 0xf92b, 0xfacb, 0x1f94c, 0x1fa0c, 0x1fcac, 0x1fccc,
+                0x3fd6d, 0x3fded, 0x7fe6e, 0x7fe8e, 0x7feae, 0x1fc0c, 0xf9cb, 0xfaab, 0x1f8cc, 0x1fa2c, 0x1fc2c, 0x3fc0d, 0x3fd0d, 0x3fe0d, 0x7fe2e,
+                0x7ff0e, 0x7fece, 0xfff8f, 0x1fd0c, 0xfbeb, 0x1f92c, 0x1faec, 0x1fb8c, 0x3fb8d, 0x3fbed, 0x3fdad, 0x3fead, 0x7ff2e, 0x7ff6e, 0xfffaf,
+                0xfffcf, 0x3fced, 0x1f98c, 0x1facc, 0x1fbec, 0x3fbcd, 0x3fb4d, 0x3fcad, 0x3fe4d, 0x7ff4e, 0x7feee, 0x7ff8e, 0x7ffae, 0xfffef,
+                // codebook 10
+                0x446, 0x105, 0x3a6, 0x4c6, 0xbe7, 0x1a68, 0x39e9, 0x7a0a, 0x7aea, 0x7daa, 0xfe0b, 0xfecb, 0x1ffac, 0xe5, 0x4, 0x24, 0x125, 0x406,
+                0xa87, 0xc07, 0x1aa8, 0x1b88, 0x3a89, 0x79aa, 0x7bca, 0xfceb, 0x386, 0x44, 0xc5, 0x185, 0x3c6, 0x506, 0xb67, 0x19a8, 0x1b28, 0x39c9,
+                0x3b89, 0x7b2a, 0x7e2a, 0x4a6, 0x165, 0x145, 0x1a5, 0x486, 0xae7, 0xc27, 0x1988, 0x1ba8, 0x3989, 0x3bc9, 0x7a6a, 0x7cea, 0xba7,
+                0x426, 0x3e6, 0x466, 0x4e6, 0xb27, 0xc87, 0x1b08, 0x1be8, 0x3a49, 0x3c49, 0x7baa, 0x7dca, 0x1a28, 0xaa7, 0x526, 0xac7, 0xb07, 0xc47,
+                0x19c8, 0x1c08, 0x1c48, 0x3b49, 0x7a8a, 0x7c6a, 0xfd6b, 0x3929, 0xbc7, 0xb47, 0xb87, 0xc67, 0x1948, 0x1b48, 0x38e9, 0x3949, 0x3c09,
+                0x7b6a, 0x7d0a, 0xfd8b, 0x3c69, 0x1a48, 0x1968, 0x1a08, 0x1ae8, 0x1b68, 0x38c9, 0x3aa9, 0x3b09, 0x794a, 0x7b4a, 0xfd4b, 0xfe2b,
+                0x3c29, 0x1a88, 0x19e8, 0x1ac8, 0x1bc8, 0x1c28, 0x3a09, 0x3ac9, 0x7a2a, 0x7aaa, 0x7e4a, 0xfdcb, 0xff6b, 0x7d2a, 0x39a9, 0x3909,
+                0x3969, 0x3a29, 0x3ae9, 0x3be9, 0x79ea, 0x7c0a, 0x7dea, 0xfccb, 0xff0b, 0x1ff4c, 0x7d6a, 0x3ba9, 0x3a69, 0x3b29, 0x3b69, 0x7a4a,
+                0x798a, 0x7b8a, 0x7d4a, 0xfdab, 0xfe6b, 0xff2b, 0x1ff2c, 0xfe4b, 0x79ca, 0x3c89, 0x796a, 0x7b0a, 0x7aca, 0x7c4a, 0x7caa, 0xfd0b,
+                0xfe8b, 0xfeab, 0xfeeb, 0x1ff6c, 0xff4b, 0x7d8a, 0x7bea, 0x7c2a, 0x7c8a, 0x7cca, 0x7e0a, 0xfd2b, 0xfdeb, 0x1ff0c, 0x1ffcc, 0x1ff8c,
+                0x1ffec,
+                // codebook 11
+                0x4, 0xc5, 0x326, 0x7a7, 0x1388, 0x18c8, 0x34e9, 0x720a, 0x784a, 0x7bea, 0xfccb, 0xfe6b, 0x1ff6c, 0xfd8b, 0x1ff4c, 0x1ffcc, 0x71ca,
+                0xa5, 0x24, 0x105, 0x286, 0x6e7, 0x847, 0x1248, 0x15e8, 0x3229, 0x34a9, 0x36a9, 0x73ca, 0x780a, 0x744a, 0x79aa, 0xfacb, 0x15c8,
+                0x2e6, 0xe5, 0x125, 0x306, 0x727, 0x807, 0x11c8, 0x1468, 0x1708, 0x3329, 0x3589, 0x3829, 0x762a, 0x72ca, 0x77ca, 0x794a, 0x13a8,
+                0x787, 0x2a6, 0x2c6, 0x346, 0x767, 0x887, 0x1228, 0x14a8, 0x17c8, 0x32c9, 0x35c9, 0x3729, 0x742a, 0x722a, 0x74aa, 0x7aaa, 0x1288,
+                0x1348, 0x6c7, 0x707, 0x747, 0x827, 0x1188, 0x1368, 0x1608, 0x1868, 0x33c9, 0x3569, 0x3789, 0x73ea, 0x71ea, 0x752a, 0x79ea, 0x1268,
+                0x17e8, 0x7c7, 0x7e7, 0x867, 0x8a7, 0x13c8, 0x14e8, 0x1728, 0x3289, 0x3449, 0x3749, 0x3869, 0x74ca, 0x74ea, 0x776a, 0x7a8a, 0x13e8,
+                0x3409, 0x11e8, 0x11a8, 0x1208, 0x1308, 0x14c8, 0x16c8, 0x1888, 0x33e9, 0x35e9, 0x37e9, 0x732a, 0x77ea, 0x768a, 0x792a, 0x7cea,
+                0x1508, 0x36c9, 0x1568, 0x1488, 0x1548, 0x1648, 0x1848, 0x18a8, 0x3309, 0x3489, 0x3709, 0x718a, 0x748a, 0x788a, 0x78ca, 0x7baa,
+                0x7d0a, 0x15a8, 0x75ea, 0x3249, 0x17a8, 0x1788, 0x31c9, 0x32e9, 0x3349, 0x3469, 0x3629, 0x71aa, 0x730a, 0x76ea, 0x7a6a, 0x7a2a,
+                0x7b6a, 0xfbab, 0x1688, 0x7bca, 0x3529, 0x3369, 0x3389, 0x3429, 0x3549, 0x35a9, 0x3669, 0x716a, 0x764a, 0x770a, 0x79ca, 0x7c2a,
+                0x7c0a, 0xfa4b, 0xfcab, 0x16e8, 0xfc6b, 0x3769, 0x3509, 0x34c9, 0x3609, 0x3649, 0x36e9, 0x736a, 0x734a, 0x774a, 0x76aa, 0x7aca,
+                0xfaeb, 0x7c8a, 0xfb0b, 0xfd4b, 0x1748, 0xfd0b, 0x740a, 0x37a9, 0x3689, 0x714a, 0x3889, 0x724a, 0x754a, 0x760a, 0x778a, 0x7aea,
+                0xfa8b, 0xfb8b, 0xfb6b, 0xfaab, 0xfe0b, 0x1828, 0xff6b, 0x790a, 0x746a, 0x72aa, 0x73aa, 0x758a, 0x75ca, 0x78aa, 0x7b0a, 0x7c4a,
+                0x7cca, 0xfc8b, 0xfceb, 0xfc0b, 0xfd2b, 0xfeeb, 0x3209, 0xfe4b, 0x726a, 0x37c9, 0x3809, 0x728a, 0x72ea, 0x75aa, 0x786a, 0x782a,
+                0x7a4a, 0xfb4b, 0xfb2b, 0xfbeb, 0xfd6b, 0xfe8b, 0xff4b, 0x32a9, 0xff0b, 0x77aa, 0x738a, 0x756a, 0x750a, 0x766a, 0x772a, 0x7a0a,
+                0x7c6a, 0x7caa, 0xfc4b, 0xfbcb, 0xfdab, 0xfe2b, 0xff2b, 0xff8b, 0x3269, 0x1ffac, 0x7b8a, 0x76ca, 0x78ea, 0x798a, 0x796a, 0x7b2a,
+                0x7b4a, 0xfa6b, 0xfc2b, 0xfdcb, 0xfdeb, 0xfeab, 0xfecb, 0x1ff8c, 0x1ffec, 0x33a9, 0x3849, 0x16a8, 0x1428, 0x12c8, 0x12e8, 0x12a8,
+                0x1328, 0x1408, 0x1448, 0x1588, 0x1528, 0x1628, 0x1668, 0x1768, 0x1808, 0x31e9, 0x85
+            };
+            static const unsigned sizes[12] = {121, 81, 81, 81, 81, 81, 81, 64, 64, 169, 169, 289};
+            const uint32_t* next = codes;
+            for (unsigned b = 0; b < 12; b++) {
+                std::vector<uint64_t> list(sizes[b]);
+                for (unsigned i = 0; i < sizes[b]; i++) {
+                    list[i] = static_cast<uint64_t>(i) << 32 | next[i];
+                }
+                next += sizes[b];
+                t.books[b] = MP3::book(t.huffman, list, 0);
+            }
+
+            for (unsigned i = 0; i < 8192; i++) {
+                t.power[i] = static_cast<float>(std::pow(static_cast<double>(i), 4.0 / 3.0));
+            }
+
+            // Kaiser-Bessel derived windows, the running sum of a Kaiser window of half + 1 points, alpha 4 long and 6 short
+            auto derived = [](float* out, const unsigned half, const double alpha) {
+                std::vector<double> kernel(half + 1);
+                double total = 0.0;
+                for (unsigned n = 0; n <= half; n++) {
+                    const double x = 2.0 * n / half - 1.0;
+                    kernel[n] = std::cyl_bessel_i(0.0, WAVLIB_PI * alpha * std::sqrt(std::max(0.0, 1.0 - x * x)));
+                    total += kernel[n];
+                }
+                double sum = 0.0;
+                for (unsigned n = 0; n < half; n++) {
+                    sum += kernel[n];
+                    out[n] = static_cast<float>(std::sqrt(sum / total));
+                }
+            };
+            for (unsigned n = 0; n < 1024; n++) {
+                t.rise[0][n] = static_cast<float>(std::sin(WAVLIB_PI / 2048 * (n + 0.5)));
+            }
+            for (unsigned n = 0; n < 128; n++) {
+                t.rise_short[0][n] = static_cast<float>(std::sin(WAVLIB_PI / 256 * (n + 0.5)));
+            }
+            derived(t.rise[1], 1024, 4.0);
+            derived(t.rise_short[1], 128, 6.0);
+            for (unsigned s = 0; s < 2; s++) {
+                std::reverse_copy(t.rise[s], t.rise[s] + 1024, t.fall[s]);
+                std::reverse_copy(t.rise_short[s], t.rise_short[s] + 128, t.fall_short[s]);
+            }
+            return t;
+        }
+
+        static const TABLES& tables() {
+            static const TABLES t = build();
+            return t;
+        }
+
+        static bool header(const unsigned char* p, HEADER& head) {
+            /** ADTS header, false unless it could start a frame **/
+            if (p[0] != 0xFF || (p[1] & 0xF6) != 0xF0) {
+                return false;
+            }
+            head.object = (p[2] >> 6) + 1;
+            head.frequency = p[2] >> 2 & 15;
+            head.layout = (p[2] & 1) << 2 | p[3] >> 6;
+            head.header = p[1] & 1 ? 7 : 9;
+            head.blocks = (p[6] & 3) + 1;
+            head.size = static_cast<uint64_t>(p[3] & 3) << 11 | static_cast<uint64_t>(p[4]) << 3 | p[5] >> 5;
+            return head.frequency < 13 && head.size > head.header;
+        }
+
+        static bool same(const unsigned char* a, const unsigned char* b) {
+            /** Profile, sample rate and channel configuration, what stays the same from frame to frame **/
+            return (a[1] & 0xF6) == (b[1] & 0xF6) && (a[2] & 0xFD) == (b[2] & 0xFD) && (a[3] & 0xC0) == (b[3] & 0xC0);
+        }
+
+        static bool supported(const HEADER& head) {
+            // LC with a standard layout and one raw data block per frame
+            return head.object == 2 && head.layout != 0 && head.blocks == 1;
+        }
+
+        static bool specific(const unsigned char* p, const uint64_t size, FORMAT::AAC& info) {
+            /** AudioSpecificConfig of an MP4 track, an AAC-LC core with 1024 sample frames and a standard layout **/
+            FLAC::BITS bits(p, size);
+            auto object = [&]() {
+                const unsigned type = bits.read(5);
+                return type == 31 ? 32 + bits.read(6) : type;
+            };
+            auto hz = [&](unsigned& index) {
+                index = bits.read(4);
+                return index == 15 ? bits.read(24) : rate(index);
+            };
+            unsigned type = object();
+            unsigned index = 0;
+            const unsigned sample_rate = hz(index);
+            const unsigned layout = bits.read(4);
+            if (type == 5 || type == 29) {
+                // Explicit SBR or PS, the rate of the extension goes and the core type follows
+                unsigned ignored = 0;
+                hz(ignored);
+                type = object();
+            }
+            // A frame length flag asks for 960 sample frames
+            if (type != 2 || sample_rate == 0 || layout == 0 || layout > 7 || bits.read(1) != 0 || bits.overrun()) {
+                return false;
+            }
+            info.sample_rate = sample_rate;
+            info.frequency = static_cast<unsigned short>(index < 13 ? index : frequency(sample_rate));
+            info.layout = static_cast<unsigned short>(layout);
+            info.channels = static_cast<unsigned short>(count(layout));
+            return true;
+        }
+
+        static bool side(FLAC::BITS& bits, const unsigned frequency, ICS& ics) {
+            /** ics_info, the window sequence and the bands with data **/
+            if (bits.read(1) != 0) {
+                return false;
+            }
+            ics.sequence = bits.read(2);
+            ics.shape = bits.read(1);
+            if (ics.sequence == EIGHT_SHORT) {
+                ics.max_sfb = bits.read(4);
+                const unsigned grouping = bits.read(7);
+                ics.windows = 8;
+                ics.groups = 1;
+                ics.length[0] = 1;
+                // A set bit puts the next window into the same group
+                for (unsigned w = 0; w < 7; w++) {
+                    if (grouping >> (6 - w) & 1) {
+                        ics.length[ics.groups - 1]++;
+                    } else {
+                        ics.length[ics.groups++] = 1;
+                    }
+                }
+                ics.offsets = short_bands(frequency, ics.bands);
+            } else {
+                ics.max_sfb = bits.read(6);
+                ics.windows = 1;
+                ics.groups = 1;
+                ics.length[0] = 1;
+                ics.offsets = long_bands(frequency, ics.bands);
+                // Prediction belongs to AAC Main
+                if (bits.read(1) != 0) {
+                    return false;
+                }
+            }
+            return ics.max_sfb <= ics.bands;
+        }
+
+        static bool sections(FLAC::BITS& bits, ICS& ics) {
+            /** Codebook of every band, runs of bands share one **/
+            const unsigned width = ics.windows == 8 ? 3 : 5;
+            const unsigned escape = (1u << width) - 1;
+            for (unsigned g = 0; g < ics.groups; g++) {
+                unsigned sfb = 0;
+                while (sfb < ics.max_sfb) {
+                    const unsigned book = bits.read(4);
+                    unsigned length = 0;
+                    unsigned step;
+                    while ((step = bits.read(width)) == escape) {
+                        length += escape;
+                        if (bits.overrun()) {
+                            return false;
+                        }
+                    }
+                    length += step;
+                    if (book == 12 || sfb + length > ics.max_sfb) {
+                        return false;
+                    }
+                    std::fill(ics.types[g] + sfb, ics.types[g] + sfb + length, static_cast<unsigned char>(book));
+                    sfb += length;
+                }
+                std::fill(ics.types[g] + ics.max_sfb, ics.types[g] + 64, static_cast<unsigned char>(ZERO));
+            }
+            return true;
+        }
+
+        static bool scalefactors(FLAC::BITS& bits, const int global, ICS& ics) {
+            /** Scalefactors, intensity positions and noise energies, each coded as the step from the last one of its kind **/
+            const TABLES& t = tables();
+            int scale = global;
+            int position = 0;
+            int energy = global - 90;
+            bool first = true;
+            for (unsigned g = 0; g < ics.groups; g++) {
+                for (unsigned sfb = 0; sfb < ics.max_sfb; sfb++) {
+                    const unsigned book = ics.types[g][sfb];
+                    int& value = ics.scale[g][sfb];
+                    if (book == ZERO) {
+                        value = 0;
+                    } else if (book == INTENSITY || book == INTENSITY_OUT) {
+                        position += static_cast<int>(bits.huffman(t.huffman.data(), t.books[0])) - 60;
+                        value = position;
+                    } else if (book == NOISE) {
+                        // The first noise energy is a plain 9-bit step
+                        energy += first ? static_cast<int>(bits.read(9)) - 256 : static_cast<int>(bits.huffman(t.huffman.data(), t.books[0])) - 60;
+                        first = false;
+                        value = energy;
+                    } else {
+                        scale += static_cast<int>(bits.huffman(t.huffman.data(), t.books[0])) - 60;
+                        if (scale < 0 || scale > 255) {
+                            return false;
+                        }
+                        value = scale;
+                    }
+                }
+            }
+            return true;
+        }
+
+        static bool shaping(FLAC::BITS& bits, ICS& ics) {
+            /** tns_data, reflection coefficients turned into direct form filters **/
+            const bool wide = ics.windows == 1;
+            for (unsigned w = 0; w < ics.windows; w++) {
+                TNS& tns = ics.tns;
+                tns.filters[w] = bits.read(wide ? 2 : 1);
+                if (tns.filters[w] == 0) {
+                    continue;
+                }
+                const unsigned resolution = bits.read(1);
+                for (unsigned f = 0; f < tns.filters[w]; f++) {
+                    tns.length[w][f] = bits.read(wide ? 6 : 4);
+                    const unsigned order = bits.read(wide ? 5 : 3);
+                    // Orders above 12 long and 7 short are for other profiles
+                    if (order > (wide ? 12u : 7u)) {
+                        return false;
+                    }
+                    tns.order[w][f] = order;
+                    if (order == 0) {
+                        continue;
+                    }
+                    tns.down[w][f] = bits.read(1) != 0;
+                    const unsigned width = resolution + 3 - bits.read(1);
+                    const double positive = ((1 << (resolution + 2)) - 0.5) / (WAVLIB_PI / 2);
+                    const double negative = ((1 << (resolution + 2)) + 0.5) / (WAVLIB_PI / 2);
+                    double reflection[12];
+                    for (unsigned i = 0; i < order; i++) {
+                        // Sign extended from width bits
+                        const int c = static_cast<int>(bits.read(width) << (32 - width)) >> (32 - width);
+                        reflection[i] = std::sin(c / (c >= 0 ? positive : negative));
+                    }
+                    // Step up recursion to the coefficients of the all-pole filter
+                    double a[13] = {1.0};
+                    for (unsigned m = 1; m <= order; m++) {
+                        double b[13];
+                        for (unsigned i = 1; i < m; i++) {
+                            b[i] = a[i] + reflection[m - 1] * a[m - i];
+                        }
+                        for (unsigned i = 1; i < m; i++) {
+                            a[i] = b[i];
+                        }
+                        a[m] = reflection[m - 1];
+                    }
+                    for (unsigned i = 0; i <= order; i++) {
+                        tns.lpc[w][f][i] = static_cast<float>(a[i]);
+                    }
+                }
+            }
+            return true;
+        }
+
+        static bool spectrum(FLAC::BITS& bits, const ICS& ics, int32_t* lines) {
+            /** Huffman decoded quantized lines in window order, 128 per short window **/
+            const TABLES& t = tables();
+            const uint32_t* lookup = t.huffman.data();
+            std::fill(lines, lines + 1024, 0);
+            auto sign = [&](int32_t& v) {
+                if (v != 0 && bits.read(1)) {
+                    v = -v;
+                }
+            };
+            auto escape = [&](int32_t& v) {
+                // A prefix of n - 4 ones and a zero, then n bits on top of 2 ^ n
+                const int32_t magnitude = v < 0 ? -v : v;
+                if (magnitude != 16) {
+                    return true;
+                }
+                unsigned n = 4;
+                while (bits.read(1)) {
+                    if (++n > 12) {
+                        return false;
+                    }
+                }
+                const auto value = static_cast<int32_t>((1u << n) + bits.read(n));
+                v = v < 0 ? -value : value;
+                return true;
+            };
+            unsigned window = 0;
+            for (unsigned g = 0; g < ics.groups; g++) {
+                for (unsigned sfb = 0; sfb < ics.max_sfb; sfb++) {
+                    const unsigned book = ics.types[g][sfb];
+                    if (book == ZERO || book >= NOISE) {
+                        continue;
+                    }
+                    const uint32_t root = t.books[book];
+                    for (unsigned w = window; w < window + ics.length[g]; w++) {
+                        int32_t* out = lines + 128 * w;
+                        for (unsigned k = ics.offsets[sfb]; k < ics.offsets[sfb + 1]; k += book < 5 ? 4 : 2) {
+                            const auto index = static_cast<int32_t>(bits.huffman(lookup, root));
+                            if (book < 5) {
+                                // Quadruples, books 1 and 2 signed from -1 to 1, books 3 and 4 unsigned up to 2
+                                const int32_t base = book < 3 ? 1 : 0;
+                                out[k] = index / 27 - base;
+                                out[k + 1] = index / 9 % 3 - base;
+                                out[k + 2] = index / 3 % 3 - base;
+                                out[k + 3] = index % 3 - base;
+                                if (book >= 3) {
+                                    for (unsigned i = 0; i < 4; i++) {
+                                        sign(out[k + i]);
+                                    }
+                                }
+                            } else if (book < 7) {
+                                out[k] = index / 9 - 4;
+                                out[k + 1] = index % 9 - 4;
+                            } else {
+                                // Unsigned pairs up to 7, 12 and 16, where 16 is an escape in book 11
+                                const int32_t size = book < 9 ? 8 : book < 11 ? 13 : 17;
+                                out[k] = index / size;
+                                out[k + 1] = index % size;
+                                sign(out[k]);
+                                sign(out[k + 1]);
+                                if (book == ESCAPE && !(escape(out[k]) && escape(out[k + 1]))) {
+                                    return false;
+                                }
+                            }
+                        }
+                    }
+                }
+                window += ics.length[g];
+            }
+            // Pulses lift single lines of a long window
+            for (unsigned p = 0; p < ics.pulses; p++) {
+                int32_t& v = lines[ics.pulse_line[p]];
+                v += v > 0 ? ics.pulse_amplitude[p] : -ics.pulse_amplitude[p];
+            }
+            return !bits.overrun();
+        }
+
+        static float gain(const int exponent) {
+            /** 2 ^ (exponent / 4) **/
+            static const float quarter[4] = {1.0f, 1.18920712f, 1.41421356f, 1.68179283f};
+            return std::ldexp(quarter[exponent & 3], exponent >> 2);
+        }
+
+        static void fuse(const float* a, const float* b, const float* c, float* out, const unsigned n) {
+            /** out = a * b + c, n a multiple of 4, out may be c **/
+            unsigned i = 0;
+#if WAVLIB_SSE2
+            for (; i < n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)), _mm_loadu_ps(c + i)));
+            }
+#elif WAVLIB_NEON
+            for (; i < n; i += 4) {
+                vst1q_f32(out + i, vmlaq_f32(vld1q_f32(c + i), vld1q_f32(a + i), vld1q_f32(b + i)));
+            }
+#endif
+            for (; i < n; i++) {
+                out[i] = a[i] * b[i] + c[i];
+            }
+        }
+
+        static void multiply(const float* a, const float* b, float* out, const unsigned n) {
+            /** out = a * b, n a multiple of 4 **/
+            unsigned i = 0;
+#if WAVLIB_SSE2
+            for (; i < n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+#elif WAVLIB_NEON
+            for (; i < n; i += 4) {
+                vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            }
+#endif
+            for (; i < n; i++) {
+                out[i] = a[i] * b[i];
+            }
+        }
+
+        class DECODER {
+        public:
+            /** Filterbank state of one stream, about 200 KB **/
+            float pcm[8][1024]{};  // Output of the last decoded block, one plane per channel in WAV order
+
+            DECODER() : wide(PLAN::MDCT::get(2048)), narrow(PLAN::MDCT::get(256)) {
+                scratch.resize(std::max(wide->scratch_size(), narrow->scratch_size()));
+            }
+
+            void reset() {
+                std::fill(&overlap[0][0], &overlap[0][0] + 8 * 1024, 0.0f);
+                std::fill(shapes, shapes + 8, 0u);
+            }
+
+            void decode(const unsigned char* block, const uint64_t size, const FORMAT::AAC& info, const uint64_t number) {
+                /** One raw data block into pcm, a block that can't be read decodes as silence and keeps the stream going **/
+                /** number seeds the noise of PNS bands, so a block always decodes the same way **/
+                unsigned channels = 0;
+                bool readable = false;
+                if (block != nullptr) {
+                    FLAC::BITS bits(block, size);
+                    noise = static_cast<uint32_t>(number * 2654435761u) ^ 0x9E3779B9u;
+                    readable = elements(bits, info, channels) && channels == info.channels && !bits.overrun();
+                }
+                const unsigned char* slots = order(info.layout);
+                for (unsigned c = 0; c < info.channels; c++) {
+                    if (!readable) {
+                        // Silence, and the window of the last block for the overlap to fade out with
+                        ics[c].sequence = ONLY_LONG;
+                        ics[c].shape = shapes[c];
+                        ics[c].shaped = false;
+                        std::fill(spectra[c], spectra[c] + 1024, 0.0f);
+                    }
+                    if (ics[c].shaped) {
+                        temporal(ics[c], info.frequency, spectra[c]);
+                    }
+                    synthesize(c, pcm[slots[c]]);
+                }
+            }
+
+        private:
+            bool elements(FLAC::BITS& bits, const FORMAT::AAC& info, unsigned& channels) {
+                /** Syntactic elements up to the end one, the channels of each land in the order they come **/
+                while (true) {
+                    const unsigned id = bits.read(3);
+                    if (bits.overrun()) {
+                        return false;
+                    }
+                    switch (id) {
+                        case 0:  // Single channel
+                        case 3:  // Low frequency effects
+                            bits.read(4);
+                            if (channels + 1 > info.channels || !stream(bits, info.frequency, channels, false)) {
+                                return false;
+                            }
+                            channels += 1;
+                            break;
+                        case 1:  // Channel pair
+                            bits.read(4);
+                            if (channels + 2 > info.channels || !pair(bits, info.frequency, channels)) {
+                                return false;
+                            }
+                            channels += 2;
+                            break;
+                        case 4: {  // Data stream
+                            bits.read(4);
+                            const bool align = bits.read(1) != 0;
+                            unsigned bytes = bits.read(8);
+                            if (bytes == 255) {
+                                bytes += bits.read(8);
+                            }
+                            if (align) {
+                                bits.align();
+                            }
+                            skip(bits, bytes);
+                            break;
+                        }
+                        case 5:  // Program config
+                            program(bits);
+                            break;
+                        case 6: {  // Fill, which is where SBR data sits
+                            unsigned bytes = bits.read(4);
+                            if (bytes == 15) {
+                                bytes += bits.read(8) - 1;
+                            }
+                            skip(bits, bytes);
+                            break;
+                        }
+                        case 7:
+                            return true;
+                        default:
+                            // Coupling channels mix into the others, which no AAC-LC encoder in use writes
+                            return false;
+                    }
+                }
+            }
+
+            static void skip(FLAC::BITS& bits, unsigned bytes) {
+                for (; bytes > 0; bytes--) {
+                    bits.read(8);
+                }
+            }
+
+            static void program(FLAC::BITS& bits) {
+                /** Skip a program config element, the layout comes from the channel configuration **/
+                bits.read(10);
+                const unsigned front = bits.read(4);
+                const unsigned sides = bits.read(4);
+                const unsigned back = bits.read(4);
+                const unsigned lfe = bits.read(2);
+                const unsigned data = bits.read(3);
+                const unsigned coupling = bits.read(4);
+                for (unsigned i = 0; i < 2; i++) {
+                    if (bits.read(1)) {
+                        bits.read(4);
+                    }
+                }
+                if (bits.read(1)) {
+                    bits.read(3);
+                }
+                for (unsigned i = 0; i < front + sides + back; i++) {
+                    bits.read(5);
+                }
+                for (unsigned i = 0; i < lfe + data; i++) {
+                    bits.read(4);
+                }
+                for (unsigned i = 0; i < coupling; i++) {
+                    bits.read(5);
+                }
+                bits.align();
+                skip(bits, bits.read(8));
+            }
+
+            bool pair(FLAC::BITS& bits, const unsigned frequency, const unsigned c) {
+                /** Channel pair element, with mid/side, intensity and correlated noise between the two **/
+                const bool common = bits.read(1) != 0;
+                unsigned mask = 0;
+                if (common) {
+                    if (!side(bits, frequency, ics[c])) {
+                        return false;
+                    }
+                    ICS& right = ics[c + 1];
+                    right.sequence = ics[c].sequence;
+                    right.shape = ics[c].shape;
+                    right.max_sfb = ics[c].max_sfb;
+                    right.windows = ics[c].windows;
+                    right.groups = ics[c].groups;
+                    std::copy(ics[c].length, ics[c].length + 8, right.length);
+                    right.bands = ics[c].bands;
+                    right.offsets = ics[c].offsets;
+                    mask = bits.read(2);
+                    if (mask == 3) {
+                        return false;
+                    }
+                    for (unsigned g = 0; g < ics[c].groups; g++) {
+                        for (unsigned sfb = 0; sfb < ics[c].max_sfb; sfb++) {
+                            used[g][sfb] = mask == 2 || (mask == 1 && bits.read(1) != 0);
+                        }
+                    }
+                }
+                if (!stream(bits, frequency, c, common) || !stream(bits, frequency, c + 1, common)) {
+                    return false;
+                }
+                stereo(ics[c], ics[c + 1], mask, spectra[c], spectra[c + 1]);
+                return true;
+            }
+
+            bool stream(FLAC::BITS& bits, const unsigned frequency, const unsigned c, const bool common) {
+                /** individual_channel_stream into spectra[c] **/
+                ICS& s = ics[c];
+                const auto global = static_cast<int>(bits.read(8));
+                if (!common && !side(bits, frequency, s)) {
+                    return false;
+                }
+                if (!sections(bits, s) || !scalefactors(bits, global, s)) {
+                    return false;
+                }
+                s.pulses = 0;
+                if (bits.read(1)) {
+                    s.pulses = bits.read(2) + 1;
+                    const unsigned start = bits.read(6);
+                    if (s.windows == 8 || start >= s.bands) {
+                        return false;
+                    }
+                    unsigned line = s.offsets[start];
+                    for (unsigned p = 0; p < s.pulses; p++) {
+                        line += bits.read(5);
+                        if (line >= 1024) {
+                            return false;
+                        }
+                        s.pulse_line[p] = line;
+                        s.pulse_amplitude[p] = static_cast<int>(bits.read(4));
+                    }
+                }
+                s.shaped = bits.read(1) != 0;
+                if (s.shaped && !shaping(bits, s)) {
+                    return false;
+                }
+                // Gain control belongs to AAC SSR
+                if (bits.read(1) != 0 || !spectrum(bits, s, lines)) {
+                    return false;
+                }
+                requantize(s, spectra[c]);
+                return true;
+            }
+
+            void requantize(const ICS& s, float* x) {
+                /** Quantized lines to spectral values, noise bands filled, intensity bands left for stereo() **/
+                // The 2 / N of the inverse transform and the 16-bit scale of the output go in here too
+                const float scale = (s.windows == 8 ? 1.0f / 128 : 1.0f / 1024) / 32768.0f;
+                const float* power = tables().power;
+                unsigned window = 0;
+                for (unsigned g = 0; g < s.groups; g++) {
+                    for (unsigned w = window; w < window + s.length[g]; w++) {
+                        const int32_t* q = lines + 128 * w;
+                        float* out = x + 128 * w;
+                        for (unsigned sfb = 0; sfb < s.bands; sfb++) {
+                            const unsigned from = s.offsets[sfb];
+                            const unsigned to = s.offsets[sfb + 1];
+                            const unsigned book = sfb < s.max_sfb ? s.types[g][sfb] : static_cast<unsigned char>(ZERO);
+                            if (book == ZERO || book == INTENSITY || book == INTENSITY_OUT) {
+                                std::fill(out + from, out + to, 0.0f);
+                            } else if (book == NOISE) {
+                                // Random lines scaled to the band energy, 2 ^ (energy / 2 - 50)
+                                float energy = 0.0f;
+                                for (unsigned k = from; k < to; k++) {
+                                    noise = noise * 1664525u + 1013904223u;
+                                    out[k] = static_cast<float>(static_cast<int32_t>(noise));
+                                    energy += out[k] * out[k];
+                                }
+                                const float factor = gain(s.scale[g][sfb] - 100) * scale / std::sqrt(energy);
+                                for (unsigned k = from; k < to; k++) {
+                                    out[k] *= factor;
+                                }
+                            } else {
+                                const float factor = gain(s.scale[g][sfb] - 100) * scale;
+                                for (unsigned k = from; k < to; k++) {
+                                    const int32_t v = q[k];
+                                    const float magnitude = power[std::min(v < 0 ? -v : v, 8191)] * factor;
+                                    out[k] = v < 0 ? -magnitude : magnitude;
+                                }
+                            }
+                        }
+                        std::fill(out + s.offsets[s.bands], out + (s.windows == 8 ? 128 : 1024), 0.0f);
+                    }
+                    window += s.length[g];
+                }
+            }
+
+            void stereo(const ICS& left, const ICS& right, const unsigned mask, float* l, float* r) const {
+                /** Mid/side, intensity and noise shared by both channels, band by band **/
+                unsigned window = 0;
+                for (unsigned g = 0; g < right.groups; g++) {
+                    for (unsigned sfb = 0; sfb < right.max_sfb; sfb++) {
+                        const unsigned book = right.types[g][sfb];
+                        const unsigned other = left.types[g][sfb];
+                        const bool ms = mask != 0 && used[g][sfb];
+                        for (unsigned w = window; w < window + right.length[g]; w++) {
+                            float* a = l + 128 * w;
+                            float* b = r + 128 * w;
+                            const unsigned from = right.offsets[sfb];
+                            const unsigned to = right.offsets[sfb + 1];
+                            if (book == INTENSITY || book == INTENSITY_OUT) {
+                                // The right channel is the left one scaled, mid/side flags flip its phase instead
+                                const bool flip = (book == INTENSITY_OUT) != (mask == 1 && used[g][sfb]);
+                                const float factor = flip ? -gain(-right.scale[g][sfb]) : gain(-right.scale[g][sfb]);
+                                for (unsigned k = from; k < to; k++) {
+                                    b[k] = a[k] * factor;
+                                }
+                            } else if (book == NOISE && other == NOISE) {
+                                if (ms) {
+                                    // Both channels take the same noise, each at its own energy
+                                    const float factor = gain(right.scale[g][sfb] - left.scale[g][sfb]);
+                                    for (unsigned k = from; k < to; k++) {
+                                        b[k] = a[k] * factor;
+                                    }
+                                }
+                            } else if (ms && book != NOISE && other != NOISE) {
+                                for (unsigned k = from; k < to; k++) {
+                                    const float m = a[k];
+                                    const float s = b[k];
+                                    a[k] = m + s;
+                                    b[k] = m - s;
+                                }
+                            }
+                        }
+                    }
+                    window += right.length[g];
+                }
+            }
+
+            static void temporal(const ICS& s, const unsigned frequency, float* x) {
+                /** Temporal noise shaping, an all-pole filter run along the lines of each filtered range **/
+                static const unsigned char limits[2][13] = {{31, 31, 34, 40, 42, 51, 46, 46, 42, 42, 42, 39, 39},
+                                                            {9, 9, 10, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14}};
+                const unsigned limit = std::min<unsigned>(limits[s.windows == 8][frequency], s.max_sfb);
+                for (unsigned w = 0; w < s.windows; w++) {
+                    float* line = x + 128 * w;
+                    unsigned bottom = s.bands;
+                    for (unsigned f = 0; f < s.tns.filters[w]; f++) {
+                        const unsigned top = bottom;
+                        bottom = top > s.tns.length[w][f] ? top - s.tns.length[w][f] : 0;
+                        const unsigned order = s.tns.order[w][f];
+                        if (order == 0) {
+                            continue;
+                        }
+                        const unsigned start = s.offsets[std::min(bottom, limit)];
+                        const unsigned end = s.offsets[std::min(top, limit)];
+                        if (start >= end) {
+                            continue;
+                        }
+                        const float* lpc = s.tns.lpc[w][f];
+                        const unsigned size = end - start;
+                        if (s.tns.down[w][f]) {
+                            for (unsigned m = 0; m < size; m++) {
+                                const unsigned n = end - 1 - m;
+                                float y = line[n];
+                                for (unsigned i = 1; i <= std::min(m, order); i++) {
+                                    y -= lpc[i] * line[n + i];
+                                }
+                                line[n] = y;
+                            }
+                        } else {
+                            for (unsigned m = 0; m < size; m++) {
+                                const unsigned n = start + m;
+                                float y = line[n];
+                                for (unsigned i = 1; i <= std::min(m, order); i++) {
+                                    y -= lpc[i] * line[n - i];
+                                }
+                                line[n] = y;
+                            }
+                        }
+                    }
+                }
+            }
+
+            void synthesize(const unsigned c, float* out) {
+                /** Inverse transform, window and overlap-add of one channel **/
+                const TABLES& t = tables();
+                const ICS& s = ics[c];
+                float* carry = overlap[c];
+                const unsigned before = shapes[c];
+                shapes[c] = s.shape;
+                if (s.sequence != EIGHT_SHORT) {
+                    wide->inverse(spectra[c], buffer, scratch.data());
+                    if (s.sequence == LONG_STOP) {
+                        // Zeros, the rise of a short window and then flat, so the block after eight short ones lines up
+                        std::copy(carry, carry + 448, out);
+                        fuse(buffer + 448, t.rise_short[before], carry + 448, out + 448, 128);
+                        for (unsigned n = 576; n < 1024; n++) {
+                            out[n] = buffer[n] + carry[n];
+                        }
+                    } else {
+                        fuse(buffer, t.rise[before], carry, out, 1024);
+                    }
+                    if (s.sequence == LONG_START) {
+                        std::copy(buffer + 1024, buffer + 1472, carry);
+                        multiply(buffer + 1472, t.fall_short[s.shape], carry + 448, 128);
+                        std::fill(carry + 576, carry + 1024, 0.0f);
+                    } else {
+                        multiply(buffer + 1024, t.fall[s.shape], carry, 1024);
+                    }
+                    return;
+                }
+                // Eight short transforms from line 448 on, each one overlapping the last by half
+                std::fill(buffer, buffer + 2048, 0.0f);
+                float piece[256];
+                for (unsigned w = 0; w < 8; w++) {
+                    narrow->inverse(spectra[c] + 128 * w, piece, scratch.data());
+                    float* at = buffer + 448 + 128 * w;
+                    fuse(piece, t.rise_short[w == 0 ? before : s.shape], at, at, 128);
+                    fuse(piece + 128, t.fall_short[s.shape], at + 128, at + 128, 128);
+                }
+                for (unsigned n = 0; n < 1024; n++) {
+                    out[n] = buffer[n] + carry[n];
+                }
+                std::copy(buffer + 1024, buffer + 2048, carry);
+            }
+
+            std::shared_ptr<const PLAN::MDCT> wide;
+            std::shared_ptr<const PLAN::MDCT> narrow;
+            std::vector<std::complex<float>> scratch;
+            ICS ics[8];
+            bool used[8][64]{};           // Mid/side flags of the channel pair being decoded
+            uint32_t noise = 0;
+            int32_t lines[1024]{};
+            float spectra[8][1024]{};
+            float overlap[8][1024]{};
+            unsigned shapes[8]{};         // Window shape of the last block of each channel
+            float buffer[2048]{};
+        };
+
+        static uint64_t word(const unsigned char* p, const unsigned n) {
+            /** n bytes, big endian **/
+            uint64_t v = 0;
+            for (unsigned i = 0; i < n; i++) {
+                v = v << 8 | p[i];
+            }
+            return v;
+        }
+
+        struct BOX {
+            /** Payload of an MP4 box **/
+            uint64_t body{};
+            uint64_t end{};
+        };
+
+        template<typename AT>
+        static bool child(AT&& at, const uint64_t from, const uint64_t end, const char* type, BOX& box) {
+            /** First box of a type in [from, end), the payload of each box is skipped **/
+            uint64_t position = from;
+            while (position + 8 <= end) {
+                const unsigned char* p = at(position, 8);
+                if (p == nullptr) {
+                    return false;
+                }
+                uint64_t size = word(p, 4);
+                const bool match = std::memcmp(p + 4, type, 4) == 0;
+                uint64_t head = 8;
+                if (size == 1) {
+                    const unsigned char* q = at(position + 8, 8);
+                    if (q == nullptr) {
+                        return false;
+                    }
+                    size = word(q, 8);
+                    head = 16;
+                } else if (size == 0) {
+                    // Runs to the end of the file
+                    size = end - position;
+                }
+                if (size < head || size > end - position) {
+                    return false;
+                }
+                if (match) {
+                    box.body = position + head;
+                    box.end = position + size;
+                    return true;
+                }
+                position += size;
+            }
+            return false;
+        }
+
+        template<typename AT>
+        static bool path(AT&& at, BOX box, std::initializer_list<const char*> types, BOX& found) {
+            /** Nested boxes, each type the first child of the one before **/
+            for (const char* type : types) {
+                if (!child(at, box.body, box.end, type, box)) {
+                    return false;
+                }
+            }
+            found = box;
+            return true;
+        }
+
+        struct MOVIE {
+            /** What the moov box says about the first sound track **/
+            uint64_t movie_scale{};       // Ticks per second of the edit list durations
+            uint64_t media_scale{};       // Ticks per second of the sample table
+            uint64_t duration{};          // Media ticks in the time to sample table
+            uint64_t samples{};           // Samples of the track, raw data blocks for AAC
+            bool edited = false;
+            uint64_t media_time{};        // Media ticks the edit list starts the presentation at
+            uint64_t segment{};           // Movie ticks the presentation lasts, 0 if unknown
+            unsigned bitrate{};           // Average from the decoder config, 0 if unknown
+            BOX table;                    // stbl of the track
+        };
+
+        template<typename AT>
+        static bool movie(AT&& at, const uint64_t size, FORMAT::AAC& info, MOVIE& track) {
+            /** moov of an MP4/M4A file down to the AudioSpecificConfig of the first AAC track **/
+            BOX moov;
+            BOX header;
+            if (!child(at, 0, size, "moov", moov) || !child(at, moov.body, moov.end, "mvhd", header)) {
+                return false;
+            }
+            const unsigned char* p = at(header.body, 24);
+            if (p == nullptr) {
+                return false;
+            }
+            track.movie_scale = word(p + (p[0] == 1 ? 20 : 12), 4);
+            BOX trak;
+            for (uint64_t from = moov.body; child(at, from, moov.end, "trak", trak); from = trak.end) {
+                BOX handler;
+                BOX media;
+                if (!path(at, trak, {"mdia", "hdlr"}, handler) || !path(at, trak, {"mdia", "mdhd"}, media)) {
+                    continue;
+                }
+                p = at(handler.body, 12);
+                if (p == nullptr || std::memcmp(p + 8, "soun", 4) != 0) {
+                    continue;
+                }
+                p = at(media.body, 32);
+                if (p == nullptr) {
+                    return false;
+                }
+                track.media_scale = word(p + (p[0] == 1 ? 20 : 12), 4);
+                BOX stsd;
+                if (!path(at, trak, {"mdia", "minf", "stbl"}, track.table) || !child(at, track.table.body, track.table.end, "stsd", stsd)) {
+                    return false;
+                }
+                // The first sample entry, whose children start after the fields of its sound sample entry version
+                p = at(stsd.body + 8, 26);
+                if (p == nullptr || std::memcmp(p + 4, "mp4a", 4) != 0) {
+                    return false;
+                }
+                const uint64_t entry = stsd.body + 8;
+                const unsigned version = static_cast<unsigned>(word(p + 16, 2));
+                BOX sample{entry + 36 + (version == 1 ? 16 : version == 2 ? 36 : 0), entry + word(p, 4)};
+                BOX esds;
+                if (!child(at, sample.body, sample.end, "esds", esds) && !path(at, sample, {"wave", "esds"}, esds)) {
+                    return false;
+                }
+                if (!config(at, esds, info, track.bitrate)) {
+                    return false;
+                }
+                BOX edits;
+                if (path(at, trak, {"edts", "elst"}, edits)) {
+                    edit(at, edits, track);
+                }
+                return track.media_scale != 0;
+            }
+            return false;
+        }
+
+        template<typename AT>
+        static bool config(AT&& at, const BOX& esds, FORMAT::AAC& info, unsigned& bitrate) {
+            /** ES descriptor, the decoder config inside it and the AudioSpecificConfig inside that **/
+            const uint64_t bytes = std::min<uint64_t>(esds.end - esds.body, 256);
+            const unsigned char* p = at(esds.body, bytes);
+            if (p == nullptr || bytes < 4) {
+                return false;
+            }
+            const unsigned char* end = p + bytes;
+            const unsigned char* q = p + 4;
+            // Tag, then a length in 7-bit groups
+            auto descriptor = [&](const unsigned tag, uint64_t& length) {
+                if (q >= end || *q++ != tag) {
+                    return false;
+                }
+                length = 0;
+                for (unsigned i = 0; i < 4 && q < end; i++) {
+                    const unsigned char b = *q++;
+                    length = length << 7 | (b & 0x7F);
+                    if (!(b & 0x80)) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            uint64_t length = 0;
+            if (!descriptor(3, length) || end - q < 3) {
+                return false;
+            }
+            const unsigned flags = q[2];
+            q += 3;
+            q += flags & 0x80 ? 2 : 0;
+            if (flags & 0x40) {
+                q += q < end ? 1 + *q : 0;
+            }
+            q += flags & 0x20 ? 2 : 0;
+            if (!descriptor(4, length) || end - q < 13) {
+                return false;
+            }
+            // MPEG-4 audio
+            if (q[0] != 0x40) {
+                return false;
+            }
+            bitrate = static_cast<unsigned>(word(q + 9, 4));
+            q += 13;
+            if (!descriptor(5, length) || length > static_cast<uint64_t>(end - q)) {
+                return false;
+            }
+            return specific(q, length, info);
+        }
+
+        template<typename AT>
+        static void edit(AT&& at, const BOX& elst, MOVIE& track) {
+            /** The first edit that shows media, which is where encoders put the priming to drop **/
+            const unsigned char* p = at(elst.body, 8);
+            if (p == nullptr) {
+                return;
+            }
+            const unsigned wide = p[0] == 1 ? 8 : 4;
+            const uint64_t entries = word(p + 4, 4);
+            for (uint64_t i = 0; i < entries; i++) {
+                const unsigned char* e = at(elst.body + 8 + i * (2 * wide + 4), 2 * wide);
+                if (e == nullptr) {
+                    return;
+                }
+                const uint64_t time = word(e + wide, wide);
+                // -1 is an empty edit, a delay before the media starts
+                if (time == (wide == 8 ? UINT64_MAX : 0xFFFFFFFFu)) {
+                    continue;
+                }
+                track.edited = true;
+                track.segment = word(e, wide);
+                track.media_time = time;
+                return;
+            }
+        }
+
+        template<typename AT>
+        static bool duration(AT&& at, MOVIE& track) {
+            /** Media ticks and samples from the time to sample table **/
+            BOX stts;
+            const unsigned char* p = nullptr;
+            if (!child(at, track.table.body, track.table.end, "stts", stts) || (p = at(stts.body, 8)) == nullptr) {
+                return false;
+            }
+            const uint64_t entries = word(p + 4, 4);
+            for (uint64_t i = 0; i < entries; i++) {
+                p = at(stts.body + 8 + i * 8, 8);
+                if (p == nullptr) {
+                    return false;
+                }
+                track.samples += word(p, 4);
+                track.duration += word(p, 4) * word(p + 4, 4);
+            }
+            return true;
+        }
+
+        static void trim(const MOVIE& track, const uint64_t blocks, FORMAT::AAC& info) {
+            /** Samples per channel and decoder skip from the sample table and the edit list **/
+            const uint64_t rate = info.sample_rate;
+            const uint64_t media = track.duration * rate / track.media_scale;
+            const uint64_t total = std::min(blocks * 1024, media);
+            info.skip = track.edited ? std::min(total, track.media_time * rate / track.media_scale) : 0;
+            info.frames = total - info.skip;
+            if (track.edited && track.segment != 0 && track.movie_scale != 0) {
+                info.frames = std::min(info.frames, (track.segment * rate + track.movie_scale - 1) / track.movie_scale);
+            }
+        }
+
+        template<typename AT>
+        static bool mp4(AT&& at, const uint64_t size, FORMAT::AAC& info) {
+            /** Offset and size of every raw data block from the sample size, sample to chunk and chunk offset tables **/
+            MOVIE track;
+            if (!movie(at, size, info, track) || !duration(at, track)) {
+                return false;
+            }
+            const BOX& stbl = track.table;
+            BOX stsz;
+            BOX stsc;
+            BOX stco;
+            bool wide = false;
+            if (!child(at, stbl.body, stbl.end, "stsz", stsz) || !child(at, stbl.body, stbl.end, "stsc", stsc)) {
+                return false;
+            }
+            if (!child(at, stbl.body, stbl.end, "stco", stco)) {
+                wide = true;
+                if (!child(at, stbl.body, stbl.end, "co64", stco)) {
+                    return false;
+                }
+            }
+            // One table at a time, so a window over the file moves forward through each
+            const unsigned char* p = at(stsz.body, 12);
+            if (p == nullptr) {
+                return false;
+            }
+            const uint64_t fixed = word(p + 4, 4);
+            const uint64_t blocks = word(p + 8, 4);
+            if (blocks > (size - stsz.body) / (fixed == 0 ? 4 : 1)) {
+                return false;
+            }
+            info.sizes.resize(blocks);
+            for (uint64_t i = 0; i < blocks; i++) {
+                p = fixed == 0 ? at(stsz.body + 12 + i * 4, 4) : p;
+                if (p == nullptr) {
+                    return false;
+                }
+                info.sizes[i] = static_cast<uint32_t>(fixed == 0 ? word(p, 4) : fixed);
+            }
+            p = at(stco.body, 8);
+            if (p == nullptr) {
+                return false;
+            }
+            const uint64_t chunks = word(p + 4, 4);
+            const unsigned bytes = wide ? 8 : 4;
+            if (chunks > (size - stco.body) / bytes) {
+                return false;
+            }
+            std::vector<uint64_t> offsets(chunks);
+            for (uint64_t i = 0; i < chunks; i++) {
+                p = at(stco.body + 8 + i * bytes, bytes);
+                if (p == nullptr) {
+                    return false;
+                }
+                offsets[i] = word(p, bytes);
+            }
+            p = at(stsc.body, 8);
+            if (p == nullptr) {
+                return false;
+            }
+            // Runs of chunks with the same number of blocks, each run until the first chunk of the next
+            const uint64_t runs = word(p + 4, 4);
+            info.index.clear();
+            info.index.reserve(blocks);
+            uint64_t chunk = 0;
+            uint64_t per = 0;
+            for (uint64_t r = 0; r <= runs && info.index.size() < blocks; r++) {
+                uint64_t next = chunks;
+                uint64_t count = 0;
+                if (r < runs) {
+                    p = at(stsc.body + 8 + r * 12, 8);
+                    if (p == nullptr) {
+                        return false;
+                    }
+                    next = std::min(chunks, word(p, 4) - std::min<uint64_t>(word(p, 4), 1));
+                    count = word(p + 4, 4);
+                }
+                for (; chunk < next && info.index.size() < blocks; chunk++) {
+                    uint64_t offset = offsets[chunk];
+                    for (uint64_t s = 0; s < per && info.index.size() < blocks; s++) {
+                        info.index.push_back(offset);
+                        offset += info.sizes[info.index.size() - 1];
+                    }
+                }
+                per = count;
+            }
+            if (info.index.size() != blocks) {
+                return false;
+            }
+            for (uint64_t i = 0; i < blocks; i++) {
+                if (info.index[i] + info.sizes[i] > size) {
+                    return false;
+                }
+            }
+            trim(track, blocks, info);
+            uint64_t total = 0;
+            for (const uint32_t n : info.sizes) {
+                total += n;
+            }
+            info.bitrate = blocks == 0 ? 0 : static_cast<unsigned>((total * 8 * info.sample_rate + blocks * 512) / (blocks * 1024));
+            return true;
+        }
+
+        template<typename AT>
+        static uint64_t start(AT&& at, const uint64_t size, HEADER& head, unsigned char reference[4]) {
+            /** First ADTS frame after any ID3v2 tags with another one behind it, size if there is none **/
+            uint64_t position = 0;
+            while (const unsigned char* p = at(position, 10)) {
+                const uint64_t skip = MP3::tag(reinterpret_cast<const char*>(p), 10);
+                if (skip == 0) {
+                    break;
+                }
+                position += skip;
+            }
+            for (; position + 7 <= size; position++) {
+                const unsigned char* p = at(position, 7);
+                if (p == nullptr || !header(p, head) || position + head.size > size) {
+                    continue;
+                }
+                std::memcpy(reference, p, 4);
+                HEADER next;
+                const unsigned char* q = at(position + head.size, 7);
+                if (position + head.size == size || (q != nullptr && header(q, next) && same(q, reference))) {
+                    return position;
+                }
+            }
+            return size;
+        }
+
+        template<typename AT>
+        static bool adts(AT&& at, const uint64_t size, FORMAT::AAC& info) {
+            /** Every raw data block of an ADTS stream, damaged stretches are skipped up to the next pair of frames **/
+            HEADER head;
+            unsigned char reference[4];
+            uint64_t position = start(at, size, head, reference);
+            if (position >= size || !supported(head)) {
+                return false;
+            }
+            info.sample_rate = rate(head.frequency);
+            info.frequency = static_cast<unsigned short>(head.frequency);
+            info.layout = static_cast<unsigned short>(head.layout);
+            info.channels = static_cast<unsigned short>(count(head.layout));
+            uint64_t bytes = 0;
+            bool lost = false;
+            while (position + 7 <= size) {
+                const unsigned char* p = at(position, 7);
+                if (p != nullptr && header(p, head) && same(p, reference) && head.blocks == 1 && position + head.size <= size) {
+                    HEADER next;
+                    const unsigned char* q = lost ? at(position + head.size, 7) : nullptr;
+                    if (!lost || position + head.size == size || (q != nullptr && header(q, next) && same(q, reference))) {
+                        info.index.push_back(position + head.header);
+                        info.sizes.push_back(static_cast<uint32_t>(head.size - head.header));
+                        bytes += head.size;
+                        position += head.size;
+                        lost = false;
+                        continue;
+                    }
+                }
+                lost = true;
+                position++;
+            }
+            // Without an edit list the priming and padding stay in, as other decoders of ADTS streams leave them
+            const uint64_t blocks = info.index.size();
+            info.frames = blocks * 1024;
+            info.skip = 0;
+            info.bitrate = blocks == 0 ? 0 : static_cast<unsigned>((bytes * 8 * info.sample_rate + blocks * 512) / (blocks * 1024));
+            return true;
+        }
+
+        template<typename AT>
+        static bool index(AT&& at, const uint64_t size, FORMAT::AAC& info) {
+            /** Every raw data block of an MP4/M4A file or ADTS stream, at(offset, n) as in MP3::index() **/
+            WAVLIB_SCOPE("AAC::index");
+            info = FORMAT::AAC();
+            const unsigned char* p = at(4, 4);
+            if (p != nullptr && std::memcmp(p, "ftyp", 4) == 0) {
+                return mp4(at, size, info);
+            }
+            return adts(at, size, info);
+        }
+
+        template<typename AT>
+        static bool probe(AT&& at, const uint64_t size, FORMAT::AAC& info, bool& exact) {
+            /** Stream parameters and length from the moov box, or from the first frames of an ADTS stream, where exact is false **/
+            /** index only holds the first raw data block **/
+            WAVLIB_SCOPE("AAC::probe");
+            info = FORMAT::AAC();
+            exact = false;
+            const unsigned char* p = at(4, 4);
+            if (p != nullptr && std::memcmp(p, "ftyp", 4) == 0) {
+                MOVIE track;
+                BOX stco;
+                BOX stsz;
+                if (!movie(at, size, info, track) || !duration(at, track) || !child(at, track.table.body, track.table.end, "stsz", stsz)) {
+                    return false;
+                }
+                p = at(stsz.body, 12);
+                if (p == nullptr) {
+                    return false;
+                }
+                const uint64_t blocks = word(p + 8, 4);
+                trim(track, blocks, info);
+                const bool wide = !child(at, track.table.body, track.table.end, "stco", stco);
+                if (wide && !child(at, track.table.body, track.table.end, "co64", stco)) {
+                    return false;
+                }
+                p = at(stco.body + 8, wide ? 8 : 4);
+                if (p != nullptr) {
+                    info.index.push_back(word(p, wide ? 8 : 4));
+                }
+                const uint64_t seconds = track.duration / track.media_scale;
+                info.bitrate = track.bitrate != 0 ? track.bitrate : seconds == 0 ? 0 : static_cast<unsigned>(std::min<uint64_t>(size * 8 / seconds, UINT32_MAX));
+                exact = true;
+                return true;
+            }
+            // The average frame of the first 64 KiB stands for the rest of the stream
+            HEADER head;
+            unsigned char reference[4];
+            uint64_t position = start(at, size, head, reference);
+            if (position >= size || !supported(head)) {
+                return false;
+            }
+            info.sample_rate = rate(head.frequency);
+            info.frequency = static_cast<unsigned short>(head.frequency);
+            info.layout = static_cast<unsigned short>(head.layout);
+            info.channels = static_cast<unsigned short>(count(head.layout));
+            info.index.push_back(position + head.header);
+            const uint64_t first = position;
+            const uint64_t limit = std::min(size, first + 65536);
+            uint64_t blocks = 0;
+            while (position < limit) {
+                p = at(position, 7);
+                if (p == nullptr || !header(p, head) || !same(p, reference)) {
+                    break;
+                }
+                position += head.size;
+                blocks++;
+            }
+            const uint64_t frames = position >= size ? blocks : (size - first) * blocks / (position - first);
+            info.frames = frames * 1024;
+            info.bitrate = static_cast<unsigned>((position - first) * 8 * info.sample_rate / (blocks * 1024));
+            exact = position >= size;
+            return true;
+        }
+
+        static void assign(const FORMAT::AAC& info, FORMAT::WAV& audio) {
+            /** Header of the 32-bit float file this stream decodes to **/
+            audio.format = 3;
+            audio.channels = info.channels;
+            audio.sample_rate = info.sample_rate;
+            audio.sample_size = 32;
+            audio.data_rate = info.sample_rate * info.channels * 4;
+            audio.data_size = info.frames * info.channels * 4;
+            audio.chunks.clear();
+        }
+
+        static uint64_t lead(const FORMAT::AAC& info, const uint64_t block) {
+            /** First block to read for correct output from block on, the one before it fills the overlap **/
+            static_cast<void>(info);
+            return block - std::min<uint64_t>(block, 1);
+        }
+
+        template<typename EMIT>
+        static void render(const unsigned char* data, const uint64_t base, const FORMAT::AAC& info, const uint64_t from, const uint64_t to, DECODER& decoder,
+                           EMIT&& emit) {
+            /** Samples [from, to) of the trimmed stream, data holds the file from base on and at least the blocks lead() asks for **/
+            /** emit(decoder, offset in the block, samples, position in the stream) **/
+            const uint64_t count = info.index.size();
+            const uint64_t begin = info.skip + from;
+            const uint64_t finish = info.skip + to;
+            const uint64_t first = begin / 1024;
+            decoder.reset();
+            for (uint64_t b = lead(info, first), end = (finish + 1023) / 1024; b < end; b++) {
+                // Past the last block the overlap still holds the tail of the stream
+                const unsigned char* block = b < count ? data + (info.index[b] - base) : nullptr;
+                decoder.decode(block, b < count ? info.sizes[b] : 0, info, b);
+                if (b < first) {
+                    continue;
+                }
+                const uint64_t a = std::max(begin, b * 1024);
+                const uint64_t z = std::min(finish, (b + 1) * 1024);
+                emit(decoder, a - b * 1024, z - a, a - info.skip);
+            }
+            WAVLIB_COUNT(SAMPLES_DECODED, (to - from) * info.channels);
+        }
+
+        static void prepare(const FORMAT::AAC& info, FORMAT::WAV& audio) {
+            assign(info, audio);
+            audio.audio.resize(info.frames * info.channels);
+        }
+
+        static void prepare(const FORMAT::AAC& info, FORMAT::PLANAR& audio) {
+            audio.sample_rate = info.sample_rate;
+            audio.resize(info.channels, info.frames);
+        }
+
+        static void store(const DECODER& decoder, const uint64_t offset, const uint64_t n, const uint64_t position, FORMAT::WAV& audio) {
+            const unsigned channels = audio.channels;
+            int32_t* out = audio.audio.data() + position * channels;
+            for (unsigned c = 0; c < channels; c++) {
+                const float* in = decoder.pcm[c] + offset;
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i * channels + c] = MP3::quantize(in[i]);
+                }
+            }
+        }
+
+        static void store(const DECODER& decoder, const uint64_t offset, const uint64_t n, const uint64_t position, FORMAT::PLANAR& audio) {
+            for (unsigned c = 0; c < audio.channels; c++) {
+                std::memcpy(audio.audio.data() + c * audio.stride + position, decoder.pcm[c] + offset, n * sizeof(float));
+            }
+        }
+
+        template<typename AUDIO>
+        static bool decode(const char* bytes, const uint64_t size, AUDIO& audio) {
+            /** A whole file in memory to samples, runs of blocks decode in parallel on the shared pool **/
+            WAVLIB_SCOPE("AAC::decode");
+            const auto* data = reinterpret_cast<const unsigned char*>(bytes);
+            static thread_local FORMAT::AAC info;
+            const bool found = index([&](const uint64_t offset, const uint64_t n) { return offset + n <= size ? data + offset : nullptr; }, size, info);
+            if (!found) {
+                return false;
+            }
+            prepare(info, audio);
+            if (info.frames == 0) {
+                return true;
+            }
+            POOL& pool = POOL::shared();
+            const uint64_t tasks = std::max<uint64_t>(1, std::min<uint64_t>(pool.size() * 4, info.index.size() / 64));
+            pool.run(tasks, [&](const uint64_t task) {
+                static thread_local std::unique_ptr<DECODER> decoder(new DECODER);
+                render(data, 0, info, info.frames * task / tasks, info.frames * (task + 1) / tasks, *decoder,
+                       [&](const DECODER& state, const uint64_t offset, const uint64_t n, const uint64_t position) { store(state, offset, n, position, audio); });
+            });
+            return true;
+        }
+    };
+
+    struct CPX {
+        /** Complex helpers, std::complex multiplication checks for NaN and is much slower **/
+        typedef std::complex<float> cpx;
+
+        static cpx mul(const cpx a, const cpx b) {
+            return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+        }
+
+        static cpx neg_i(const cpx a) {
+            /** -i * a **/
+            return {a.imag(), -a.real()};
+        }
+
+#if WAVLIB_SSE2
+        typedef __m128 PAIR;  // Two interleaved complex numbers
+
+        struct TWIDDLE {
+            __m128 real;
+            __m128 imag;
+        };
+
+        static PAIR load(const cpx* p) {
+            return _mm_loadu_ps(reinterpret_cast<const float*>(p));
+        }
+
+        static void store(cpx* p, const PAIR v) {
+            _mm_storeu_ps(reinterpret_cast<float*>(p), v);
+        }
+
+        static PAIR add(const PAIR a, const PAIR b) {
+            return _mm_add_ps(a, b);
+        }
+
+        static PAIR sub(const PAIR a, const PAIR b) {
+            return _mm_sub_ps(a, b);
+        }
+
+        static TWIDDLE twiddle(const cpx w) {
+            return {_mm_set1_ps(w.real()), _mm_setr_ps(-w.imag(), w.imag(), -w.imag(), w.imag())};
+        }
+
+        static PAIR mul(const PAIR a, const TWIDDLE& w) {
+            const PAIR swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm_add_ps(_mm_mul_ps(a, w.real), _mm_mul_ps(swapped, w.imag));
+        }
+
+        static PAIR neg_i(const PAIR a) {
+            const PAIR swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm_xor_ps(swapped, _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f));
+        }
+
+        static PAIR scale(const PAIR a, const float f) {
+            return _mm_mul_ps(a, _mm_set1_ps(f));
+        }
+#elif WAVLIB_NEON
+        typedef float32x4_t PAIR;  // Two interleaved complex numbers
+
+        struct TWIDDLE {
+            float32x4_t real;
+            float32x4_t imag;
+        };
+
+        static PAIR load(const cpx* p) {
+            return vld1q_f32(reinterpret_cast<const float*>(p));
+        }
+
+        static void store(cpx* p, const PAIR v) {
+            vst1q_f32(reinterpret_cast<float*>(p), v);
+        }
+
+        static PAIR add(const PAIR a, const PAIR b) {
+            return vaddq_f32(a, b);
+        }
+
+        static PAIR sub(const PAIR a, const PAIR b) {
+            return vsubq_f32(a, b);
+        }
+
+        static TWIDDLE twiddle(const cpx w) {
+            const float imag[4] = {-w.imag(), w.imag(), -w.imag(), w.imag()};
+            return {vdupq_n_f32(w.real()), vld1q_f32(imag)};
+        }
+
+        static PAIR mul(const PAIR a, const TWIDDLE& w) {
+            return vmlaq_f32(vmulq_f32(a, w.real), vrev64q_f32(a), w.imag);
+        }
+
+        static PAIR neg_i(const PAIR a) {
+            const float sign[4] = {1.0f, -1.0f, 1.0f, -1.0f};
+            return vmulq_f32(vrev64q_f32(a), vld1q_f32(sign));
+        }
+
+        static PAIR scale(const PAIR a, const float f) {
+            return vmulq_n_f32(a, f);
+        }
+#endif
+    };
+
+    struct FIR {
+        /** Inner products for FIR filters, the kernel is picked once and handed out as a function pointer **/
+        typedef float (*DOT)(const float*, const float*, uint64_t);
+
+        static DOT dot() {
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                return avx2_dot;
+            }
+#if WAVLIB_SSE2
+            return sse_dot;
+#endif
+#elif WAVLIB_NEON
+            return neon_dot;
+#endif
+            return scalar_dot;
+        }
+
+        static float scalar_dot(const float* x, const float* h, const uint64_t n) {
+            float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            uint64_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                sum[0] += x[i] * h[i];
+                sum[1] += x[i + 1] * h[i + 1];
+                sum[2] += x[i + 2] * h[i + 2];
+                sum[3] += x[i + 3] * h[i + 3];
+            }
+            for (; i < n; i++) {
+                sum[0] += x[i] * h[i];
+            }
+            return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+        }
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static float avx2_dot(const float* x, const float* h, const uint64_t n) {
+            __m256 a = _mm256_setzero_ps();
+            __m256 b = _mm256_setzero_ps();
+            uint64_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i)));
+                b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(h + i + 8)));
+            }
+            for (; i + 8 <= n; i += 8) {
+                a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i)));
+            }
+            a = _mm256_add_ps(a, b);
+            __m128 r = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+            r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+            r = _mm_add_ss(r, _mm_shuffle_ps(r, r, 1));
+            float sum = _mm_cvtss_f32(r);
+            for (; i < n; i++) {
+                sum += x[i] * h[i];
+            }
+            return sum;
+        }
+
+#if WAVLIB_SSE2
+        static float sse_dot(const float* x, const float* h, const uint64_t n) {
+            __m128 a = _mm_setzero_ps();
+            __m128 b = _mm_setzero_ps();
+            uint64_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+                b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(h + i + 4)));
+            }
+            a = _mm_add_ps(a, b);
+            a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+            a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+            float sum = _mm_cvtss_f32(a);
+            for (; i < n; i++) {
+                sum += x[i] * h[i];
+            }
+            return sum;
+        }
+#endif
+#elif WAVLIB_NEON
+        static float neon_dot(const float* x, const float* h, const uint64_t n) {
+            float32x4_t a = vdupq_n_f32(0.0f);
+            float32x4_t b = vdupq_n_f32(0.0f);
+            uint64_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                a = vmlaq_f32(a, vld1q_f32(x + i), vld1q_f32(h + i));
+                b = vmlaq_f32(b, vld1q_f32(x + i + 4), vld1q_f32(h + i + 4));
+            }
+            a = vaddq_f32(a, b);
+            const float32x2_t pair = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+            float sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+            for (; i < n; i++) {
+                sum += x[i] * h[i];
+            }
+            return sum;
+        }
+#endif
+    };
+
+    struct FEATURE {
+        /** Kernels behind the mel features, picked once and handed out as function pointers like FIR::dot **/
+        typedef void (*POWER)(const std::complex<float>*, float*, uint64_t);
+        typedef void (*LOG)(float*, uint64_t, float, float);
+
+        static POWER power() {
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                return avx2_power;
+            }
+#if WAVLIB_SSE2
+            return sse_power;
+#endif
+#elif WAVLIB_NEON
+            return neon_power;
+#endif
+            return scalar_power;
+        }
+
+        static LOG log() {
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                return avx2_log;
+            }
+#elif WAVLIB_NEON
+            return neon_log;
+#endif
+            return scalar_log;
+        }
+
+        static bool compression(const std::string& log, float& scale) {
+            /** "log10", "db" (10 log10), "ln" or "none", scale multiplies the natural log and is 0 for none **/
+            if (log == "log10") {
+                scale = static_cast<float>(1.0 / std::log(10.0));
+            } else if (log == "db") {
+                scale = static_cast<float>(10.0 / std::log(10.0));
+            } else if (log == "ln") {
+                scale = 1.0f;
+            } else if (log == "none") {
+                scale = 0.0f;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        static void scalar_power(const std::complex<float>* in, float* out, const uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                out[i] = in[i].real() * in[i].real() + in[i].imag() * in[i].imag();
+            }
+        }
+
+        static void scalar_log(float* x, const uint64_t n, const float floor, const float scale) {
+            /** x = scale * ln(max(x, floor)) in place **/
+            for (uint64_t i = 0; i < n; i++) {
+                x[i] = scale * std::log(std::max(x[i], floor));
+            }
+        }
+
+        // ln(x) = e ln(2) + ln(m) with m in [sqrt(1/2), sqrt(2)), Cephes polynomial for ln(1 + f)
+        static constexpr float LOG_P[9] = {7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f};
+
+#if WAVLIB_X86
+        WAVLIB_TARGET("avx2") static void avx2_power(const std::complex<float>* in, float* out, const uint64_t n) {
+            const auto* p = reinterpret_cast<const float*>(in);
+            uint64_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 a = _mm256_loadu_ps(p + 2 * i);
+                const __m256 b = _mm256_loadu_ps(p + 2 * i + 8);
+                // hadd pairs up re^2 + im^2 within each 128-bit lane, the permute restores the order
+                const __m256 sum = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+                _mm256_storeu_ps(out + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), 0xD8)));
+            }
+            scalar_power(in + i, out + i, n - i);
+        }
+
+        WAVLIB_TARGET("avx2") static void avx2_log(float* x, const uint64_t n, const float floor, const float scale) {
+            const __m256 lower = _mm256_set1_ps(floor);
+            const __m256 factor = _mm256_set1_ps(scale);
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 half = _mm256_set1_ps(0.5f);
+            const __m256 root = _mm256_set1_ps(1.41421356f);
+            const __m256i mantissa = _mm256_set1_epi32(0x007FFFFF);
+            const __m256i bias = _mm256_set1_epi32(127);
+            uint64_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 v = _mm256_max_ps(_mm256_loadu_ps(x + i), lower);
+                const __m256i bits = _mm256_castps_si256(v);
+                __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), bias));
+                __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, mantissa), _mm256_castps_si256(one)));
+                const __m256 big = _mm256_cmp_ps(m, root, _CMP_GT_OQ);
+                m = _mm256_blendv_ps(m, _mm256_mul_ps(m, half), big);
+                e = _mm256_add_ps(e, _mm256_and_ps(big, one));
+                const __m256 f = _mm256_sub_ps(m, one);
+                const __m256 z = _mm256_mul_ps(f, f);
+                __m256 y = _mm256_set1_ps(LOG_P[0]);
+                for (int k = 1; k < 9; k++) {
+                    y = _mm256_add_ps(_mm256_mul_ps(y, f), _mm256_set1_ps(LOG_P[k]));
+                }
+                y = _mm256_mul_ps(_mm256_mul_ps(y, f), z);
+                y = _mm256_sub_ps(y, _mm256_mul_ps(half, z));
+                const __m256 ln = _mm256_add_ps(_mm256_mul_ps(e, _mm256_set1_ps(0.693147181f)), _mm256_add_ps(f, y));
+                _mm256_storeu_ps(x + i, _mm256_mul_ps(ln, factor));
+            }
+            scalar_log(x + i, n - i, floor, scale);
+        }
+
+#if WAVLIB_SSE2
+        static void sse_power(const std::complex<float>* in, float* out, const uint64_t n) {
+            const auto* p = reinterpret_cast<const float*>(in);
+            uint64_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m128 a = _mm_loadu_ps(p + 2 * i);
+                const __m128 b = _mm_loadu_ps(p + 2 * i + 4);
+                const __m128 a2 = _mm_mul_ps(a, a);
+                const __m128 b2 = _mm_mul_ps(b, b);
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_shuffle_ps(a2, b2, 0x88), _mm_shuffle_ps(a2, b2, 0xDD)));
+            }
+            scalar_power(in + i, out + i, n - i);
+        }
+#endif
+#elif WAVLIB_NEON
+        static void neon_power(const std::complex<float>* in, float* out, const uint64_t n) {
+            const auto* p = reinterpret_cast<const float*>(in);
+            uint64_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const float32x4x2_t v = vld2q_f32(p + 2 * i);
+                vst1q_f32(out + i, vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]));
+            }
+            scalar_power(in + i, out + i, n - i);
+        }
+
+        static void neon_log(float* x, const uint64_t n, const float floor, const float scale) {
+            const float32x4_t lower = vdupq_n_f32(floor);
+            const float32x4_t one = vdupq_n_f32(1.0f);
+            const float32x4_t root = vdupq_n_f32(1.41421356f);
+            uint64_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const float32x4_t v = vmaxq_f32(vld1q_f32(x + i), lower);
+                const int32x4_t bits = vreinterpretq_s32_f32(v);
+                float32x4_t e = vcvtq_f32_s32(vsubq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(127)));
+                float32x4_t m = vreinterpretq_f32_s32(vorrq_s32(vandq_s32(bits, vdupq_n_s32(0x007FFFFF)), vreinterpretq_s32_f32(one)));
+                const uint32x4_t big = vcgtq_f32(m, root);
+                m = vbslq_f32(big, vmulq_n_f32(m, 0.5f), m);
+                e = vaddq_f32(e, vreinterpretq_f32_u32(vandq_u32(big, vreinterpretq_u32_f32(one))));
+                const float32x4_t f = vsubq_f32(m, one);
+                const float32x4_t z = vmulq_f32(f, f);
+                float32x4_t y = vdupq_n_f32(LOG_P[0]);
+                for (int k = 1; k < 9; k++) {
+                    y = vmlaq_f32(vdupq_n_f32(LOG_P[k]), y, f);
+                }
+                y = vmulq_f32(vmulq_f32(y, f), z);
+                y = vmlsq_f32(y, vdupq_n_f32(0.5f), z);
+                const float32x4_t ln = vmlaq_f32(vaddq_f32(f, y), e, vdupq_n_f32(0.693147181f));
+                vst1q_f32(x + i, vmulq_n_f32(ln, scale));
+            }
+            scalar_log(x + i, n - i, floor, scale);
+        }
+#endif
+    };
+
+    struct METER {
+        /** Level statistics in one pass, peak, sums, clipping and silence all come out of the same loads **/
+        struct LEVELS {
+            float peak = 0.0f;
+            double sum = 0.0;
+            double squares = 0.0;
+            uint64_t clipped = 0;
+            uint64_t silent = 0;
+            uint64_t count = 0;
+        };
+
+        static void measure(const float* x, const uint64_t n, const float clip, const float quiet, LEVELS& levels) {
+            /** Add n samples, |x| >= clip counts as clipped and |x| < quiet as silent **/
+            // Partial sums stay in float for 64 samples per lane, then move over to double
+            const uint64_t block = 256;
+            for (uint64_t first = 0; first < n; first += block) {
+                accumulate(x + first, std::min(block, n - first), clip, quiet, levels);
+            }
+            levels.count += n;
+        }
+
+        static void finish(const LEVELS& levels, FORMAT::STATS& stats) {
+            const double count = static_cast<double>(std::max<uint64_t>(levels.count, 1));
+            stats.peak = levels.peak;
+            stats.rms = std::sqrt(levels.squares / count);
+            stats.dc = levels.sum / count;
+            stats.clipped = levels.clipped;
+            stats.silence = static_cast<double>(levels.silent) / count;
+        }
+
+        static float full_scale(const unsigned bits, const bool floating) {
+            /** Largest magnitude a format reaches once decoded, integers stop one step short of 1 **/
+            return floating || bits == 0 ? 1.0f : static_cast<float>(1.0 - std::ldexp(1.0, 1 - static_cast<int>(bits)));
+        }
+
+        static void accumulate(const float* x, const uint64_t n, const float clip, const float quiet, LEVELS& levels) {
+            float peak = levels.peak;
+            float sum = 0.0f;
+            float squares = 0.0f;
+            uint64_t clipped = 0;
+            uint64_t silent = 0;
+            uint64_t i = 0;
+#if WAVLIB_SSE2
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            const __m128 top = _mm_set1_ps(clip);
+            const __m128 floor = _mm_set1_ps(quiet);
+            __m128 vpeak = _mm_set1_ps(peak);
+            __m128 vsum = _mm_setzero_ps();
+            __m128 vsquares = _mm_setzero_ps();
+            // Comparisons give all ones, so subtracting them counts
+            __m128i vclipped = _mm_setzero_si128();
+            __m128i vsilent = _mm_setzero_si128();
+            for (; i + 4 <= n; i += 4) {
+                const __m128 v = _mm_loadu_ps(x + i);
+                const __m128 a = _mm_andnot_ps(sign, v);
+                vpeak = _mm_max_ps(vpeak, a);
+                vsum = _mm_add_ps(vsum, v);
+                vsquares = _mm_add_ps(vsquares, _mm_mul_ps(v, v));
+                vclipped = _mm_sub_epi32(vclipped, _mm_castps_si128(_mm_cmpge_ps(a, top)));
+                vsilent = _mm_sub_epi32(vsilent, _mm_castps_si128(_mm_cmplt_ps(a, floor)));
+            }
+            alignas(16) float lanes[3][4];
+            alignas(16) int32_t counts[2][4];
+            _mm_store_ps(lanes[0], vpeak);
+            _mm_store_ps(lanes[1], vsum);
+            _mm_store_ps(lanes[2], vsquares);
+            _mm_store_si128(reinterpret_cast<__m128i*>(counts[0]), vclipped);
+            _mm_store_si128(reinterpret_cast<__m128i*>(counts[1]), vsilent);
+            for (int k = 0; k < 4; k++) {
+                peak = std::max(peak, lanes[0][k]);
+                sum += lanes[1][k];
+                squares += lanes[2][k];
+                clipped += static_cast<uint64_t>(counts[0][k]);
+                silent += static_cast<uint64_t>(counts[1][k]);
+            }
+#elif WAVLIB_NEON
+            const float32x4_t top = vdupq_n_f32(clip);
+            const float32x4_t floor = vdupq_n_f32(quiet);
+            float32x4_t vpeak = vdupq_n_f32(peak);
+            float32x4_t vsum = vdupq_n_f32(0.0f);
+            float32x4_t vsquares = vdupq_n_f32(0.0f);
+            uint32x4_t vclipped = vdupq_n_u32(0);
+            uint32x4_t vsilent = vdupq_n_u32(0);
+            for (; i + 4 <= n; i += 4) {
+                const float32x4_t v = vld1q_f32(x + i);
+                const float32x4_t a = vabsq_f32(v);
+                vpeak = vmaxq_f32(vpeak, a);
+                vsum = vaddq_f32(vsum, v);
+                vsquares = vmlaq_f32(vsquares, v, v);
+                vclipped = vsubq_u32(vclipped, vcgeq_f32(a, top));
+                vsilent = vsubq_u32(vsilent, vcltq_f32(a, floor));
+            }
+            float lanes[3][4];
+            uint32_t counts[2][4];
+            vst1q_f32(lanes[0], vpeak);
+            vst1q_f32(lanes[1], vsum);
+            vst1q_f32(lanes[2], vsquares);
+            vst1q_u32(counts[0], vclipped);
+            vst1q_u32(counts[1], vsilent);
+            for (int k = 0; k < 4; k++) {
+                peak = std::max(peak, lanes[0][k]);
+                sum += lanes[1][k];
+                squares += lanes[2][k];
+                clipped += counts[0][k];
+                silent += counts[1][k];
+            }
+#endif
+            for (; i < n; i++) {
+                const float a = std::abs(x[i]);
+                peak = std::max(peak, a);
+                sum += x[i];
+                squares += x[i] * x[i];
+                clipped += a >= clip ? 1 : 0;
+                silent += a < quiet ? 1 : 0;
+            }
+            levels.peak = peak;
+            levels.sum += sum;
+            levels.squares += squares;
+            levels.clipped += clipped;
+            levels.silent += silent;
+        }
+    };
+
+    class POOL {
+    public:
+        /** Persistent worker threads for data-parallel loops **/
+        static POOL& shared() {
+            static POOL pool(std::max(1u, std::thread::hardware_concurrency()));
+            return pool;
+        }
+
+        explicit POOL(const unsigned threads) {
+            for (unsigned i = 1; i < threads; i++) {
+                workers.emplace_back([this] { loop(); });
+            }
+        }
+
+        POOL(const POOL&) = delete;
+        POOL& operator=(const POOL&) = delete;
+
+        ~POOL() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        unsigned size() const {
+            return static_cast<unsigned>(workers.size()) + 1;
+        }
+
+        template<typename BODY>
+        void run(const uint64_t tasks, BODY&& body) {
+            /** Call body(task) for every task in [0, tasks) and wait, the calling thread helps out **/
+            /** Nested or concurrent calls run inline instead of queueing behind each other **/
+            std::unique_lock<std::mutex> busy(serial, std::try_to_lock);
+            if (!busy.owns_lock() || worker() || workers.empty() || tasks <= 1) {
+                for (uint64_t task = 0; task < tasks; task++) {
+                    body(task);
+                }
+                return;
+            }
+            // Type erased by hand, std::function would allocate for larger captures
+            typedef typename std::remove_reference<BODY>::type TYPE;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                current.body = const_cast<void*>(static_cast<const void*>(&body));
+                current.call = [](void* job, const uint64_t task) {
+                    (*static_cast<TYPE*>(job))(task);
+                };
+                total = tasks;
+                next = 0;
+                generation++;
+            }
+            wake.notify_all();
+            work();
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [this] { return active == 0; });
+            current = JOB();
+        }
+
+    private:
+        static bool& worker() {
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+        void work() {
+            uint64_t task;
+            while ((task = next.fetch_add(1)) < total) {
+                current.call(current.body, task);
+            }
+        }
+
+        void loop() {
+            worker() = true;
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                wake.wait(guard, [&] { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+                active++;
+                guard.unlock();
+                work();
+                guard.lock();
+                if (--active == 0) {
+                    done.notify_all();
+                }
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex serial;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        struct JOB {
+            void* body = nullptr;
+            void (*call)(void*, uint64_t) = nullptr;
+        };
+
+        JOB current;
+        std::atomic<uint64_t> next{0};
+        std::atomic<uint64_t> total{0};
+        uint64_t generation = 0;
+        uint64_t active = 0;
+        bool stop = false;
+    };
+
+    struct DATA {
+        static std::string read(std::istream& file, uint64_t length) {
+            if (!file) {
+                return "";
+            }
+            std::string buffer(length, '\0'); // Preallocate the string with the given length
+            file.read(&buffer[0], static_cast<int64_t>(length));
+            return buffer;
+        }
+
+        static bool write(std::ostream& file, const std::string& data) {
+            if (!file) {
+                return false;
+            }
+            file.write(data.c_str(), static_cast<int64_t>(data.size()));
+            return true;
+        }
+
+        static bool write(std::ostream& file, const char* data) {
+            /** Chunk ids, without this string literals would pick the integer overload **/
+            if (!file) {
+                return false;
+            }
+            file.write(data, static_cast<int64_t>(std::strlen(data)));
+            return true;
+        }
+
+        template<typename integer>
+        static bool write(std::ostream& file, const integer& data) {
+            if (!file) {
+                return false;
+            }
+            char buffer[sizeof(decltype(data))];
+            character::int2Char(data, buffer);
+            file.write(buffer, sizeof(decltype(data)));
+            return true;
+        }
+    };
+
+    struct MEMORY {
+        /** Read-only file mapping, released when the last owner goes away **/
+        static std::shared_ptr<const char> map(const std::string& filename, uint64_t& size) {
+            WAVLIB_SCOPE("MEMORY::map");
+            size = 0;
+#if _WIN32
+            HANDLE file = CreateFileW(ONLY_WIN32::StringToWString(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) {
+                return nullptr;
+            }
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+                CloseHandle(file);
+                return nullptr;
+            }
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            CloseHandle(file);
+            if (mapping == NULL) {
+                return nullptr;
+            }
+            const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (view == NULL) {
+                return nullptr;
+            }
+            size = static_cast<uint64_t>(length.QuadPart);
+            return std::shared_ptr<const char>(static_cast<const char*>(view), [](const char* p) {
+                UnmapViewOfFile(p);
+            });
+#else
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return nullptr;
+            }
+            struct stat info{};
+            if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+                ::close(fd);
+                return nullptr;
+            }
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            WAVLIB_COUNT(SYSCALLS, 4);
+            if (view == MAP_FAILED) {
+                return nullptr;
+            }
+            size = static_cast<uint64_t>(info.st_size);
+            return std::shared_ptr<const char>(static_cast<const char*>(view), [size](const char* p) {
+                munmap(const_cast<char*>(p), static_cast<size_t>(size));
+            });
+#endif
+        }
+
+        static bool read(const std::string& filename, std::vector<char>& buffer, uint64_t& size, std::string& error) {
+            /** Read a whole file into buffer, which only ever grows so it can be reused for the next file **/
+            WAVLIB_SCOPE("MEMORY::read");
+            size = 0;
+#if _WIN32
+            std::ifstream file(ONLY_WIN32::StringToWString(filename).c_str(), std::ios::binary | std::ios::ate);
+            if (!file.is_open()) {
+                error = "cannot open file";
+                return false;
+            }
+            const std::streamoff length = file.tellg();
+            if (length <= 0) {
+                error = "empty file";
+                return false;
+            }
+            if (buffer.size() < static_cast<uint64_t>(length)) {
+                buffer.resize(static_cast<uint64_t>(length));
+            }
+            file.seekg(0);
+            file.read(buffer.data(), length);
+            size = static_cast<uint64_t>(file.gcount());
+#else
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                error = std::generic_category().message(errno);
+                return false;
+            }
+            struct stat info{};
+            if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+                error = info.st_size <= 0 ? "empty file" : std::generic_category().message(errno);
+                ::close(fd);
+                return false;
+            }
+#if defined(POSIX_FADV_SEQUENTIAL)
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            const auto length = static_cast<uint64_t>(info.st_size);
+            if (buffer.size() < length) {
+                buffer.resize(length);
+            }
+            while (size < length) {
+                const ssize_t count = ::pread(fd, buffer.data() + size, static_cast<size_t>(length - size), static_cast<off_t>(size));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count <= 0) {
+                    break;
+                }
+                size += static_cast<uint64_t>(count);
+            }
+            ::close(fd);
+            WAVLIB_COUNT(SYSCALLS, 3);
+#endif
+            WAVLIB_COUNT(BYTES_READ, size);
+            if (size == 0) {
+                error = "read failed";
+                return false;
+            }
+            return true;
+        }
+
+        static void prefetch(const std::string& filename) {
+            /** Ask the kernel to start reading a file we are about to need **/
+#if !_WIN32 && defined(POSIX_FADV_WILLNEED)
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+                ::close(fd);
+            }
+#else
+            (void) filename;
+#endif
+        }
+    };
+
+#if _WIN32
+    struct ONLY_WIN32 {
+        static std::string WStringToString(const std::wstring& wstr){
+            int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), NULL, 0, NULL, NULL);
+            std::string strTo(sizeNeeded, 0);
+            WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), &strTo[0], sizeNeeded, NULL, NULL);
+            return strTo;
+        }
+
+        static std::wstring StringToWString(const std::string& str){
+            int sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+            std::wstring wstrTo(sizeNeeded, 0);
+            MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], sizeNeeded);
+            return wstrTo;
+        }
+    };
+#endif
+
+    struct LOAD {
+        static bool WAV(std::ifstream& file, FORMAT::WAV& audio) {
+            WAVLIB_SCOPE("LOAD::WAV");
+            if (!file.is_open()) {
+                return false;
+            }
+
+            STREAM source{file};
+            RIFF riff;
+            if (!scan(source, riff, true) || !assign(riff, audio)) {
+                return false;
+            }
+
+            const FORMAT::SAMPLE type = PCM::type(audio.format, audio.sample_size);
+            const int sample_byte = audio.sample_size / 8;
+            // Whole frames only, a truncated data chunk loses its partial last frame like in FILE and MAPPED
+            const uint64_t block_align = static_cast<uint64_t>(sample_byte) * audio.channels;
+            audio.audio.clear();
+            if (audio.data_size != UINT64_MAX) {
+                audio.audio.reserve(audio.data_size / sample_byte);
+            }
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            char* buffer = workspace.allocate<char>(1024 * 1024 * 4);
+            const uint64_t block = std::max<uint64_t>(1, 1024 * 1024 * 4 / block_align) * block_align;
+
+            uint64_t remaining = audio.data_size - audio.data_size % block_align;
+            uint64_t consumed = 0;
+            while (remaining > 0) {
+                file.read(buffer, static_cast<std::streamsize>(std::min(block, remaining)));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                WAVLIB_COUNT(BYTES_READ, file.gcount());
+                consumed += static_cast<uint64_t>(file.gcount());
+                uint64_t bytes_read = static_cast<uint64_t>(file.gcount()) / block_align * block_align;
+                if (bytes_read == 0) {
+                    break;
+                }
+                uint64_t offset = audio.audio.size();
+                audio.audio.resize(offset + bytes_read / sample_byte);
+                PCM::decode(buffer, bytes_read / sample_byte, type, audio.audio.data() + offset);
+                remaining -= bytes_read;
+            }
+
+            // Index whatever follows the samples, eg. a trailing LIST chunk
+            if (audio.data_size != UINT64_MAX && consumed == audio.data_size - audio.data_size % block_align) {
+                source.position += consumed;
+                if (source.skip(audio.data_size - consumed + (audio.data_size & 1))) {
+                    scan(source, riff, false);
+                    audio.chunks = riff.chunks;
+                }
+            }
+            return true;
+        }
+
+        static bool header(std::istream& file, FORMAT::WAV& audio) {
+            /** Parse the RIFF header and stop at the first byte of the data section **/
+            /** Only reads forward, so pipes and live captures work too **/
+            STREAM source{file};
+            RIFF riff;
+            return scan(source, riff, true) && assign(riff, audio);
+        }
+
+        static bool MAPPED(const std::shared_ptr<const char>& map, const uint64_t size, FORMAT::MAPPED_WAV& audio) {
+            /** Parse the RIFF chunks in place, the data section is never copied **/
+            WAVLIB_SCOPE("LOAD::MAPPED");
+            if (map == nullptr) {
+                return false;
+            }
+            BUFFER source{map.get(), size};
+            static thread_local RIFF riff;
+            riff.reset();
+            if (!scan(source, riff, false) || !riff.data || !riff.fmt) {
+                return false;
+            }
+
+            audio.format = riff.format;
+            audio.channels = riff.channels;
+            audio.sample_rate = riff.sample_rate;
+            audio.data_rate = riff.data_rate;
+            audio.sample_size = riff.sample_size;
+            audio.type = PCM::type(audio.format, audio.sample_size);
+            audio.block_align = static_cast<unsigned short>(audio.channels * PCM::bytes(audio.type));
+
+            // Truncated files keep whatever is actually there
+            const uint64_t data_size = std::min(riff.data_size, size - riff.data_offset);
+            audio.frames = data_size / audio.block_align;
+            audio.data_size = audio.frames * audio.block_align;
+            audio.data = map.get() + riff.data_offset;
+            audio.map = map;
+            audio.chunks = riff.chunks;
+            return true;
+        }
+
+        struct RIFF {
+            /** Everything the chunk walk learns about a file **/
+            bool rf64 = false;            // RF64 / BW64, sizes come from the ds64 chunk
+            bool fmt = false;
+            bool data = false;
+            unsigned short format{};      // Sub format for WAVE_FORMAT_EXTENSIBLE
+            unsigned short channels{};
+            unsigned int sample_rate{};
+            unsigned int data_rate{};
+            unsigned short sample_size{};
+            uint64_t data_offset{};
+            uint64_t data_size{};
+            uint64_t ds64_data_size{};
+            std::vector<FORMAT::CHUNK> chunks;
+
+            void reset() {
+                /** Forget the last file but keep the storage of the chunk list **/
+                std::vector<FORMAT::CHUNK> keep;
+                keep.swap(chunks);
+                keep.clear();
+                *this = RIFF();
+                chunks.swap(keep);
+            }
+        };
+
+        struct BUFFER {
+            /** Chunk source over bytes already in memory **/
+            const char* base;
+            uint64_t size;
+            uint64_t position = 0;
+
+            bool read(char* out, const uint64_t count) {
+                if (count > size - position) {
+                    return false;
+                }
+                std::memcpy(out, base + position, count);
+                position += count;
+                return true;
+            }
+
+            bool skip(const uint64_t count) {
+                if (count > size - position) {
+                    position = size;
+                    return false;
+                }
+                position += count;
+                return true;
+            }
+        };
+
+        struct STREAM {
+            /** Chunk source over a forward-only stream **/
+            std::istream& file;
+            uint64_t position = 0;
+
+            bool read(char* out, const uint64_t count) {
+                file.read(out, static_cast<std::streamsize>(count));
+                WAVLIB_COUNT(BYTES_READ, file.gcount());
+                position += static_cast<uint64_t>(file.gcount());
+                return static_cast<uint64_t>(file.gcount()) == count;
+            }
+
+            bool skip(uint64_t count) {
+                while (count > 0) {
+                    const auto step = static_cast<std::streamsize>(std::min<uint64_t>(count, 1u << 30));
+                    file.ignore(step);
+                    position += static_cast<uint64_t>(file.gcount());
+                    if (file.gcount() != step) {
+                        return false;
+                    }
+                    count -= static_cast<uint64_t>(step);
+                }
+                return true;
+            }
+        };
+
+        template<typename SOURCE>
+        static bool scan(SOURCE& source, RIFF& riff, const bool stop_at_data) {
+            /** Walk the chunk headers, jumping over every payload that isn't needed **/
+            /** Stops at the first byte of the data payload when stop_at_data is set, otherwise at the end **/
+            WAVLIB_SCOPE("LOAD::scan");
+            char field[40];
+            if (source.position == 0) {
+                if (!source.read(field, 12) || std::memcmp(field + 8, "WAVE", 4) != 0) {
+                    return false;
+                }
+                if (std::memcmp(field, "RF64", 4) == 0 || std::memcmp(field, "BW64", 4) == 0) {
+                    riff.rf64 = true;
+                } else if (std::memcmp(field, "RIFF", 4) != 0) {
+                    return false;
+                }
+            }
+
+            while (source.read(field, 8)) {
+                FORMAT::CHUNK chunk;
+                chunk.id.assign(field, 4);
+                chunk.offset = source.position;
+                chunk.size = integer::char_2_uint32(field + 4);
+                uint64_t consumed = 0;
+
+                if (chunk.id == "ds64" && riff.rf64 && chunk.size >= 24) {
+                    // riff size, data size, sample count, then a table we don't need
+                    consumed = 24;
+                    if (!source.read(field, consumed)) {
+                        return false;
+                    }
+                    riff.ds64_data_size = integer::char_2_uint32(field + 8) | static_cast<uint64_t>(integer::char_2_uint32(field + 12)) << 32;
+                } else if (chunk.id == "fmt " && chunk.size >= 16) {
+                    consumed = std::min<uint64_t>(chunk.size, 40);
+                    if (!source.read(field, consumed)) {
+                        return false;
+                    }
+                    riff.format = integer::char_2_uint16(field);
+                    riff.channels = integer::char_2_uint16(field + 2);
+                    riff.sample_rate = integer::char_2_uint32(field + 4);
+                    riff.data_rate = integer::char_2_uint32(field + 8);
+                    riff.sample_size = integer::char_2_uint16(field + 14);
+                    // WAVE_FORMAT_EXTENSIBLE keeps the real format tag at the start of the sub format GUID
+                    if (riff.format == 0xFFFE && consumed >= 26) {
+                        riff.format = integer::char_2_uint16(field + 24);
+                    }
+                    if (riff.channels == 0 || PCM::type(riff.format, riff.sample_size) == FORMAT::SAMPLE::UNKNOWN) {
+                        return false;
+                    }
+                    riff.fmt = true;
+                } else if (chunk.id == "data" && !riff.data) {
+                    if (riff.rf64 && chunk.size == 0xFFFFFFFF) {
+                        chunk.size = riff.ds64_data_size;
+                    } else if (chunk.size == 0xFFFFFFFF) {
+                        // Written by a stream that could not go back to patch the size
+                        chunk.size = UINT64_MAX;
+                    }
+                    riff.data = true;
+                    riff.data_offset = chunk.offset;
+                    riff.data_size = chunk.size;
+                    if (stop_at_data || chunk.size == UINT64_MAX) {
+                        riff.chunks.push_back(chunk);
+                        return riff.fmt;
+                    }
+                }
+                riff.chunks.push_back(chunk);
+
+                // Chunks are word aligned
+                if (!source.skip(chunk.size - consumed + (chunk.size & 1))) {
+                    break;
+                }
+            }
+            return riff.fmt && riff.data;
+        }
+
+        static bool assign(const RIFF& riff, FORMAT::WAV& audio) {
+            if (!riff.fmt || !riff.data) {
+                return false;
+            }
+            audio.format = riff.format;
+            audio.channels = riff.channels;
+            audio.sample_rate = riff.sample_rate;
+            audio.data_rate = riff.data_rate;
+            audio.sample_size = riff.sample_size;
+            audio.data_size = riff.data_size;
+            audio.chunks = riff.chunks;
+            return true;
+        }
+
+        enum class CODEC { WAV, FLAC, MP3, AAC };
+
+        template<typename READ>
+        static CODEC codec(READ&& read) {
+            /** What the first bytes after any ID3v2 tag say, read(out, n, offset) returns the bytes it got **/
+            char head[10] = {};
+            if (read(head, 10, 0) < 4) {
+                return CODEC::WAV;
+            }
+            // MP4 files open with an ftyp box
+            if (std::memcmp(head + 4, "ftyp", 4) == 0) {
+                return CODEC::AAC;
+            }
+            const uint64_t tag = MP3::tag(head, 10);
+            if (tag != 0 && read(head, 7, tag) != 7) {
+                return CODEC::WAV;
+            }
+            MP3::HEADER frame;
+            AAC::HEADER adts;
+            const auto* bytes = reinterpret_cast<const unsigned char*>(head);
+            if (std::memcmp(head, "fLaC", 4) == 0) {
+                return CODEC::FLAC;
+            }
+            if (AAC::header(bytes, adts)) {
+                return CODEC::AAC;
+            }
+            return MP3::header(bytes, frame) ? CODEC::MP3 : CODEC::WAV;
+        }
+
+        template<typename AUDIO>
+        static bool FILE(const std::string& filename, AUDIO& audio) {
+            /** Positioned reads through the per-thread workspace, no stream buffers and no mapping **/
+            /** A warm loop that loads into the same object allocates nothing **/
+            WAVLIB_SCOPE("LOAD::FILE");
+            FILE_HANDLE file;
+            if (!file.open(filename, true)) {
+                return false;
+            }
+            const CODEC kind = codec([&](char* out, const uint64_t n, const uint64_t offset) { return file.read(out, n, offset); });
+            if (kind != CODEC::WAV) {
+                // Compressed frames are small next to the samples, so the whole file goes through memory
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                char* raw = workspace.allocate<char>(file.size());
+                if (file.read(raw, file.size(), 0) != file.size()) {
+                    return false;
+                }
+                if (kind == CODEC::AAC) {
+                    return AAC::decode(raw, file.size(), audio);
+                }
+                return kind == CODEC::FLAC ? FLAC::decode(raw, file.size(), audio) : MP3::decode(raw, file.size(), audio);
+            }
+            FILE_HANDLE::SOURCE source{file};
+            static thread_local RIFF riff;
+            riff.reset();
+            if (!scan(source, riff, false) || !riff.data || riff.data_offset > file.size()) {
+                return false;
+            }
+
+            const FORMAT::SAMPLE type = PCM::type(riff.format, riff.sample_size);
+            const uint64_t block_align = riff.channels * PCM::bytes(type);
+            // Truncated files keep whatever is actually there
+            const uint64_t frames = std::min(riff.data_size, file.size() - riff.data_offset) / block_align;
+            prepare(riff, frames, audio);
+
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t block = std::max<uint64_t>(1, (1 << 20) / block_align);
+            char* raw = workspace.allocate<char>(std::min(block, frames) * block_align);
+            for (uint64_t first = 0; first < frames; first += block) {
+                const uint64_t count = std::min(block, frames - first);
+                if (file.read(raw, count * block_align, riff.data_offset + first * block_align) != count * block_align) {
+                    return false;
+                }
+                decode(raw, first, count, type, audio);
+            }
+            return true;
+        }
+
+        static void prepare(const RIFF& riff, const uint64_t frames, FORMAT::WAV& audio) {
+            assign(riff, audio);
+            audio.audio.resize(frames * riff.channels);
+        }
+
+        static void prepare(const RIFF& riff, const uint64_t frames, FORMAT::PLANAR& audio) {
+            audio.sample_rate = riff.sample_rate;
+            audio.resize(riff.channels, frames);
+        }
+
+        template<typename AUDIO>
+        static bool BATCH(const std::vector<std::string>& filenames, std::vector<AUDIO>& audio, std::vector<std::string>& errors, const unsigned threads) {
+            /** Files are spread over a pool sized for I/O, so reads and decodes of different files overlap **/
+            /** The caller's result buffers are kept and refilled, a file that fails leaves its entry empty **/
+            WAVLIB_SCOPE("LOAD::BATCH");
+            audio.resize(filenames.size());
+            errors.assign(filenames.size(), std::string());
+            std::unique_ptr<POOL> own;
+            if (threads != 0) {
+                own.reset(new POOL(threads));
+            }
+            POOL& pool = own ? *own : io();
+            const uint64_t ahead = pool.size();
+            std::atomic<uint64_t> failed{0};
+            pool.run(filenames.size(), [&](const uint64_t i) {
+                if (i + ahead < filenames.size()) {
+                    MEMORY::prefetch(filenames[i + ahead]);
+                }
+                // Every worker keeps its file buffer for the next file, unless the file was a large one
+                static thread_local std::vector<char> buffer;
+                // One bad file must not take the others down, whatever it throws ends up in its own error
+                try {
+                    batch(filenames[i], buffer, audio[i], errors[i]);
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+                if (buffer.capacity() > BATCH_BUFFER) {
+                    std::vector<char>().swap(buffer);
+                }
+                if (!errors[i].empty()) {
+                    audio[i] = AUDIO();
+                    failed++;
+                }
+            });
+            return failed == 0;
+        }
+
+        static constexpr uint64_t BATCH_BUFFER = uint64_t(64) << 20;  // Largest file buffer a BATCH worker keeps between files
+
+        template<typename AUDIO>
+        static void batch(const std::string& filename, std::vector<char>& buffer, AUDIO& audio, std::string& error) {
+            /** One file of a BATCH, failures are reported through error **/
+            uint64_t size = 0;
+            if (!MEMORY::read(filename, buffer, size, error)) {
+                return;
+            }
+            const CODEC type = codec([&](char* out, const uint64_t n, const uint64_t offset) {
+                if (offset >= size) {
+                    return uint64_t{0};
+                }
+                const uint64_t got = std::min(n, size - offset);
+                std::memcpy(out, buffer.data() + offset, got);
+                return got;
+            });
+            if (type == CODEC::FLAC && !FLAC::decode(buffer.data(), size, audio)) {
+                error = "not a supported FLAC file";
+            }
+            if (type == CODEC::MP3 && !MP3::decode(buffer.data(), size, audio)) {
+                error = "not a supported MP3 file";
+            }
+            if (type == CODEC::AAC && !AAC::decode(buffer.data(), size, audio)) {
+                error = "not a supported AAC file";
+            }
+            if (type != CODEC::WAV) {
+                return;
+            }
+            // Parse in place, the aliasing pointer owns nothing
+            FORMAT::MAPPED_WAV mapped;
+            if (!MAPPED(std::shared_ptr<const char>(std::shared_ptr<const char>(), buffer.data()), size, mapped)) {
+                error = "not a supported WAV file";
+                return;
+            }
+            decode(mapped, audio);
+            mapped.map.reset();
+        }
+
+        static POOL& io() {
+            /** Shared by the batch loaders, sized so reads of some files overlap the decoding of others **/
+            static POOL pool(std::max(4u, 2 * std::thread::hardware_concurrency()));
+            return pool;
+        }
+
+        static bool PROBE(const FILE_HANDLE& file, FORMAT::INFO& info, std::string& error) {
+            /** Format and length from the headers alone, a few hundred bytes for WAV and FLAC, the first frames of an MP3 **/
+            /** or ADTS stream and the moov box of an MP4 **/
+            WAVLIB_SCOPE("LOAD::PROBE");
+            info = FORMAT::INFO();
+            info.file_size = file.size();
+            if (file.size() == 0) {
+                error = "empty file";
+                return false;
+            }
+            const CODEC kind = codec([&](char* out, const uint64_t n, const uint64_t offset) { return file.read(out, n, offset); });
+            if (kind == CODEC::WAV) {
+                FILE_HANDLE::SOURCE source{file};
+                static thread_local RIFF riff;
+                riff.reset();
+                if (!scan(source, riff, true) || riff.data_offset > file.size()) {
+                    error = "not a supported WAV file";
+                    return false;
+                }
+                const FORMAT::SAMPLE type = PCM::type(riff.format, riff.sample_size);
+                const uint64_t block_align = riff.channels * PCM::bytes(type);
+                info.codec = "wav";
+                info.format = riff.format;
+                info.channels = riff.channels;
+                info.sample_rate = riff.sample_rate;
+                info.sample_size = riff.sample_size;
+                info.bitrate = static_cast<unsigned int>(std::min<uint64_t>(static_cast<uint64_t>(riff.sample_rate) * block_align * 8, UINT32_MAX));
+                // Truncated files and streams that never patched the size keep whatever is actually there
+                info.frames = std::min(riff.data_size, file.size() - riff.data_offset) / block_align;
+                info.exact = true;
+                info.data_offset = riff.data_offset;
+            } else if (kind == CODEC::FLAC) {
+                FILE_HANDLE::SOURCE source{file};
+                static thread_local FORMAT::FLAC flac;
+                if (!FLAC::metadata(source, flac)) {
+                    error = "not a supported FLAC file";
+                    return false;
+                }
+                info.codec = "flac";
+                info.channels = flac.channels;
+                info.sample_rate = flac.sample_rate;
+                info.sample_size = flac.sample_size;
+                info.frames = flac.frames;
+                info.exact = flac.frames != 0;
+                info.data_offset = flac.audio_offset;
+                const uint64_t bytes = file.size() - std::min(file.size(), flac.audio_offset);
+                info.bitrate = flac.frames == 0 ? 0 : static_cast<unsigned int>(std::min<uint64_t>(bytes * 8 * flac.sample_rate / flac.frames, UINT32_MAX));
+            } else {
+                // A window over the file that follows the requests, the sync search moves forward one byte at a time
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                const uint64_t capacity = 16384;
+                char* window = workspace.allocate<char>(capacity);
+                uint64_t base = 0;
+                uint64_t length = 0;
+                auto at = [&](const uint64_t offset, const uint64_t n) -> const unsigned char* {
+                    if (n > capacity || offset + n > file.size()) {
+                        return nullptr;
+                    }
+                    if (offset < base || offset + n > base + length) {
+                        base = offset;
+                        length = file.read(window, std::min(capacity, file.size() - offset), offset);
+                        if (n > length) {
+                            return nullptr;
+                        }
+                    }
+                    return reinterpret_cast<const unsigned char*>(window + (offset - base));
+                };
+                if (kind == CODEC::AAC) {
+                    static thread_local FORMAT::AAC aac;
+                    if (!AAC::probe(at, file.size(), aac, info.exact)) {
+                        error = "not a supported AAC file";
+                        return false;
+                    }
+                    info.codec = "aac";
+                    info.channels = aac.channels;
+                    info.sample_rate = aac.sample_rate;
+                    info.bitrate = aac.bitrate;
+                    info.frames = aac.frames;
+                    info.data_offset = aac.index.empty() ? 0 : aac.index[0];
+                } else {
+                    static thread_local FORMAT::MP3 mp3;
+                    if (!MP3::probe(at, file.size(), mp3, info.exact)) {
+                        error = "not a supported MP3 file";
+                        return false;
+                    }
+                    info.codec = "mp3";
+                    info.channels = mp3.channels;
+                    info.sample_rate = mp3.sample_rate;
+                    info.bitrate = mp3.bitrate;
+                    info.frames = mp3.frames;
+                    info.data_offset = mp3.index.empty() ? 0 : mp3.index[0];
+                }
+            }
+            info.duration = info.sample_rate == 0 ? 0.0 : static_cast<double>(info.frames) / info.sample_rate;
+            return true;
+        }
+
+        template<typename EMIT>
+        static uint64_t SCAN(const std::vector<std::string>& filenames, const bool levels, const unsigned threads, EMIT&& emit) {
+            /** PROBE every file, and with levels measure its samples too, emit(i, stats, error) runs on the worker **/
+            /** that finished file i. Returns how many files failed **/
+            WAVLIB_SCOPE("LOAD::SCAN");
+            std::unique_ptr<POOL> own;
+            if (threads != 0) {
+                own.reset(new POOL(threads));
+            }
+            POOL& pool = own ? *own : io();
+            std::atomic<uint64_t> failed{0};
+            pool.run(filenames.size(), [&](const uint64_t i) {
+                FORMAT::STATS stats;
+                std::string error;
+                if (!measure(filenames[i], levels, stats, error)) {
+                    failed++;
+                }
+                emit(i, static_cast<const FORMAT::STATS&>(stats), static_cast<const std::string&>(error));
+            });
+            return failed;
+        }
+
+        static bool measure(const std::string& filename, const bool levels, FORMAT::STATS& stats, std::string& error) {
+            /** One file of SCAN, the samples go through METER block by block and are never kept **/
+            FILE_HANDLE file;
+            if (!file.open(filename, levels)) {
+                error = "cannot open file";
+                return false;
+            }
+            if (!PROBE(file, stats.info, error)) {
+                return false;
+            }
+            if (!levels) {
+                return true;
+            }
+            const float quiet = 0.001f;  // -60 dBFS
+            METER::LEVELS meter;
+            FORMAT::INFO& info = stats.info;
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            if (info.codec == "wav") {
+                // Decode a block at a time into floats that stay in cache, channels don't matter to the levels
+                const FORMAT::SAMPLE type = PCM::type(info.format, info.sample_size);
+                const uint64_t block_align = info.channels * PCM::bytes(type);
+                const uint64_t block = std::max<uint64_t>(1, (1 << 18) / block_align);
+                char* raw = workspace.allocate<char>(std::min(block, info.frames) * block_align);
+                float* samples = workspace.allocate<float>(std::min(block, info.frames) * info.channels);
+                const float clip = METER::full_scale(info.sample_size, type == FORMAT::SAMPLE::F32 || type == FORMAT::SAMPLE::F64);
+                for (uint64_t first = 0; first < info.frames; first += block) {
+                    const uint64_t count = std::min(block, info.frames - first);
+                    if (file.read(raw, count * block_align, info.data_offset + first * block_align) != count * block_align) {
+                        error = "read failed";
+                        return false;
+                    }
+                    PCM::decode(raw, count * info.channels, type, samples);
+                    METER::measure(samples, count * info.channels, clip, quiet, meter);
+                }
+            } else {
+                // Frames go through the decoders of RANGE_READER in order, a frame or a batch of frames at a time
+                const bool flac = info.codec == "flac";
+                const std::string kind = flac ? "FLAC" : info.codec == "aac" ? "AAC" : "MP3";
+                file.close();
+                RANGE_READER reader;
+                if (!reader.open(filename, true)) {
+                    error = "not a supported " + kind + " file";
+                    return false;
+                }
+                const float clip = METER::full_scale(info.sample_size, !flac);
+                // FLAC hands out interleaved frames, one channel is gathered into a block before it is measured
+                const uint64_t block = 4096;
+                float* gathered = workspace.allocate<float>(block);
+                const bool decoded = reader.visit(0, reader.frames(), [&](const uint64_t, const unsigned short, const float* samples, const uint64_t stride, const uint64_t n) {
+                    if (stride == 1) {
+                        METER::measure(samples, n, clip, quiet, meter);
+                        return;
+                    }
+                    for (uint64_t first = 0; first < n; first += block) {
+                        const uint64_t count = std::min(block, n - first);
+                        for (uint64_t i = 0; i < count; i++) {
+                            gathered[i] = samples[(first + i) * stride];
+                        }
+                        METER::measure(gathered, count, clip, quiet, meter);
+                    }
+                });
+                if (!decoded) {
+                    error = "not a supported " + kind + " file";
+                    return false;
+                }
+                // The frame index gives the exact length even when the headers don't
+                info.frames = reader.frames();
+                info.exact = true;
+                info.duration = info.sample_rate == 0 ? 0.0 : static_cast<double>(info.frames) / info.sample_rate;
+            }
+            METER::finish(meter, stats);
+            return true;
+        }
+
+        static void decode(const FORMAT::MAPPED_WAV& in, FORMAT::WAV& audio) {
+            audio.format = in.format;
+            audio.channels = in.channels;
+            audio.sample_rate = in.sample_rate;
+            audio.data_rate = in.data_rate;
+            audio.sample_size = in.sample_size;
+            audio.data_size = in.data_size;
+            audio.audio.resize(in.frames * in.channels);
+            PCM::decode(in.data, audio.audio.size(), in.type, audio.audio.data());
+        }
+
+        static void decode(const FORMAT::MAPPED_WAV& in, FORMAT::PLANAR& audio) {
+            PLANAR(in, audio);
+        }
+
+        static bool PLANAR(const FORMAT::MAPPED_WAV& in, FORMAT::PLANAR& audio) {
+            /** Decode and de-interleave once, in blocks that stay in cache **/
+            WAVLIB_SCOPE("LOAD::PLANAR");
+            if (in.data == nullptr || in.channels == 0) {
+                return false;
+            }
+            audio.sample_rate = in.sample_rate;
+            audio.resize(in.channels, in.frames);
+            decode(in.data, 0, in.frames, in.type, audio);
+            return true;
+        }
+
+        static void decode(const char* data, const uint64_t first, const uint64_t count, const FORMAT::SAMPLE type, FORMAT::WAV& audio) {
+            /** count interleaved frames that belong at frame first **/
+            PCM::decode(data, count * audio.channels, type, audio.audio.data() + first * audio.channels);
+        }
+
+        static void decode(const char* data, const uint64_t first, const uint64_t count, const FORMAT::SAMPLE type, FORMAT::PLANAR& audio) {
+            if (audio.channels == 1) {
+                PCM::decode(data, count, type, audio.audio.data() + first);
+                return;
+            }
+            // De-interleave through a block that stays in cache
+            const uint64_t block = 4096;
+            const uint64_t block_align = audio.channels * PCM::bytes(type);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            float* buffer = workspace.allocate<float>(block * audio.channels);
+            for (uint64_t start = 0; start < count; start += block) {
+                const uint64_t n = std::min(block, count - start);
+                PCM::decode(data + start * block_align, n * audio.channels, type, buffer);
+                for (unsigned short c = 0; c < audio.channels; c++) {
+                    float* channel = audio.audio.data() + c * audio.stride + first + start;
+                    const float* source = buffer + c;
+                    for (uint64_t i = 0; i < n; i++) {
+                        channel[i] = source[i * audio.channels];
+                    }
+                }
+            }
+        }
+    };
+
+    struct DUMP {
+        /** Sizes and rates in the header are derived from the samples, the caller's values are not trusted **/
+        static bool WAV(std::ostream& file, const FORMAT::WAV& audio) {
+            WAVLIB_SCOPE("DUMP::WAV");
+            if (!file) {
+                return false;
+            }
+
+            const FORMAT::SAMPLE type = PCM::type(audio.format, audio.sample_size);
+            if (type == FORMAT::SAMPLE::UNKNOWN || audio.channels == 0) {
+                return false;
+            }
+
+            char head[80];
+            const uint64_t data_size = audio.audio.size() * PCM::bytes(type);
+            const uint64_t start = header(head, audio, data_size);
+            file.write(head, static_cast<std::streamsize>(start));
+            WAVLIB_COUNT(SYSCALLS, 1);
+
+            // Encode in large blocks, one write each
+            const uint64_t block = 1 << 20;
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            char* buffer = workspace.allocate<char>(block * PCM::bytes(type) + 1);
+            for (uint64_t i = 0; i < audio.audio.size(); i += block) {
+                const uint64_t count = std::min(block, static_cast<uint64_t>(audio.audio.size()) - i);
+                PCM::encode(audio.audio.data() + i, count, type, buffer);
+                uint64_t bytes = count * PCM::bytes(type);
+                // The data chunk is word aligned
+                if (i + count == audio.audio.size() && (data_size & 1)) {
+                    buffer[bytes++] = 0;
+                }
+                file.write(buffer, static_cast<std::streamsize>(bytes));
+                WAVLIB_COUNT(SYSCALLS, 1);
+            }
+            WAVLIB_COUNT(BYTES_WRITTEN, start + data_size + (data_size & 1));
+            return static_cast<bool>(file);
+        }
+
+#if !_WIN32
+        static bool FILE(const std::string& filename, const FORMAT::WAV& audio) {
+            /** Blocks are encoded in parallel and each one lands at its own offset with pwrite **/
+            WAVLIB_SCOPE("DUMP::FILE");
+            const FORMAT::SAMPLE type = PCM::type(audio.format, audio.sample_size);
+            if (type == FORMAT::SAMPLE::UNKNOWN || audio.channels == 0) {
+                return false;
+            }
+            int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+
+            char head[80];
+            const uint64_t width = PCM::bytes(type);
+            const uint64_t data_size = audio.audio.size() * width;
+            const uint64_t start = header(head, audio, data_size);
+            bool result = ftruncate(fd, static_cast<off_t>(start + data_size + (data_size & 1))) == 0;
+            WAVLIB_COUNT(SYSCALLS, 2);
+            result = result && put(fd, head, start, 0);
+
+            const uint64_t block = 1 << 20;
+            std::atomic<bool> failed{false};
+            POOL::shared().run((audio.audio.size() + block - 1) / block, [&](const uint64_t task) {
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                const uint64_t first = task * block;
+                const uint64_t count = std::min(block, static_cast<uint64_t>(audio.audio.size()) - first);
+                char* buffer = workspace.allocate<char>(count * width);
+                PCM::encode(audio.audio.data() + first, count, type, buffer);
+                if (!put(fd, buffer, count * width, start + first * width)) {
+                    failed = true;
+                }
+            });
+            // The pad byte of an odd sized data chunk is already zero from ftruncate
+            result = result && !failed;
+            return ::close(fd) == 0 && result;
+        }
+
+        static bool put(const int fd, const char* data, const uint64_t bytes, const uint64_t offset) {
+            uint64_t done = 0;
+            while (done < bytes) {
+                const ssize_t count = ::pwrite(fd, data + done, static_cast<size_t>(std::min<uint64_t>(bytes - done, 1u << 30)), static_cast<off_t>(offset + done));
+                WAVLIB_COUNT(SYSCALLS, 1);
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count <= 0) {
+                    return false;
+                }
+                done += static_cast<uint64_t>(count);
+            }
+            WAVLIB_COUNT(BYTES_WRITTEN, done);
+            return true;
+        }
+#endif
+
+        static bool header(std::ostream& file, const FORMAT::WAV& audio, const bool reserve = false) {
+            /** Header for audio.data_size bytes of samples, written in one go **/
+            char head[80];
+            file.write(head, static_cast<std::streamsize>(header(head, audio, audio.data_size, reserve)));
+            return static_cast<bool>(file);
+        }
+
+        static uint64_t header(char* out, const FORMAT::WAV& audio, const uint64_t data_size, const bool reserve = false) {
+            /** Build the whole header in out (80 bytes at most), returns its length **/
+            /** Sizes past 4 GB switch to RF64, with the real sizes in a ds64 chunk **/
+            /** reserve puts a JUNK chunk the size of ds64 in front of fmt, so the header can turn into RF64 in place later (EBU 3306) **/
+            const uint64_t block_align = static_cast<uint64_t>(audio.channels) * (audio.sample_size / 8);
+            const uint64_t riff_size = data_size + (data_size & 1) + 36;
+            const uint64_t junk = reserve ? 36 : 0;
+            const bool rf64 = data_size != 0xFFFFFFFF && riff_size + junk > 0xFFFFFFFF;
+            char* p = out;
+            auto put = [&p](const char* id) {
+                std::memcpy(p, id, 4);
+                p += 4;
+            };
+
+            put(rf64 ? "RF64" : "RIFF");
+            character::int2Char(static_cast<unsigned int>(rf64 ? 0xFFFFFFFF : std::min<uint64_t>(riff_size + junk, 0xFFFFFFFF)), p);
+            p += 4;
+            put("WAVE");
+            if (rf64) {
+                put("ds64");
+                character::int2Char(static_cast<unsigned int>(28), p);
+                character::int2Char(static_cast<uint64_t>(riff_size + 36), p + 4);
+                character::int2Char(static_cast<uint64_t>(data_size), p + 12);
+                character::int2Char(static_cast<uint64_t>(block_align ? data_size / block_align : 0), p + 20);
+                character::int2Char(static_cast<unsigned int>(0), p + 28);
+                p += 32;
+            } else if (reserve) {
+                put("JUNK");
+                character::int2Char(static_cast<unsigned int>(28), p);
+                std::memset(p + 4, 0, 28);
+                p += 32;
+            }
+
+            put("fmt ");
+            character::int2Char(static_cast<unsigned int>(16), p);
+            character::int2Char(static_cast<unsigned short>(audio.format), p + 4);
+            character::int2Char(static_cast<unsigned short>(audio.channels), p + 6);
+            character::int2Char(static_cast<unsigned int>(audio.sample_rate), p + 8);
+            character::int2Char(static_cast<unsigned int>(audio.sample_rate * block_align), p + 12);
+            character::int2Char(static_cast<unsigned short>(block_align), p + 16);
+            character::int2Char(static_cast<unsigned short>(audio.sample_size), p + 18);
+            p += 20;
+
+            put("data");
+            character::int2Char(static_cast<unsigned int>(rf64 ? 0xFFFFFFFF : std::min<uint64_t>(data_size, 0xFFFFFFFF)), p);
+            p += 4;
+            return static_cast<uint64_t>(p - out);
+        }
+
+        class REPORT {
+        public:
+            /** SCAN results as CSV or as a JSON array, one row per file in the order they are written **/
+            REPORT(std::ostream& file, const bool json) : file(file), json(json) {
+                if (json) {
+                    file << "[";
+                } else {
+                    file << "file,codec,format,channels,sample_rate,sample_size,bitrate,frames,duration,exact,peak,rms,dc,clipped,silence,error\n";
+                }
+            }
+
+            void write(const std::string& filename, const FORMAT::STATS& stats, const std::string& error) {
+                const FORMAT::INFO& info = stats.info;
+                const std::string fields[] = {text(filename), text(info.codec), number(info.format), number(info.channels), number(info.sample_rate),
+                                              number(info.sample_size), number(info.bitrate), number(info.frames), number(info.duration),
+                                              info.exact ? "true" : "false", number(stats.peak), number(stats.rms), number(stats.dc),
+                                              number(stats.clipped), number(stats.silence), text(error)};
+                static const char* names[] = {"file", "codec", "format", "channels", "sample_rate", "sample_size", "bitrate", "frames", "duration",
+                                              "exact", "peak", "rms", "dc", "clipped", "silence", "error"};
+                std::string row = json ? (rows == 0 ? "\n  {" : ",\n  {") : "";
+                for (uint64_t k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+                    if (json) {
+                        row += (k == 0 ? "\"" : ", \"") + std::string(names[k]) + "\": " + fields[k];
+                    } else {
+                        row += (k == 0 ? "" : ",") + fields[k];
+                    }
+                }
+                row += json ? "}" : "\n";
+                file.write(row.data(), static_cast<std::streamsize>(row.size()));
+                WAVLIB_COUNT(BYTES_WRITTEN, row.size());
+                rows++;
+            }
+
+            bool finish() {
+                if (json) {
+                    file << (rows == 0 ? "]\n" : "\n]\n");
+                }
+                file.flush();
+                return static_cast<bool>(file);
+            }
+
+        private:
+            std::string text(const std::string& value) const {
+                /** A quoted string, escaped for JSON, or for CSV only quoted when it has to be **/
+                std::string out = "\"";
+                if (!json) {
+                    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+                        return value;
+                    }
+                    for (const char c : value) {
+                        out += c == '"' ? "\"\"" : std::string(1, c);
+                    }
+                    return out + "\"";
+                }
+                for (const char c : value) {
+                    if (c == '"' || c == '\\') {
+                        out += '\\';
+                        out += c;
+                    } else if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+                }
+                return out + "\"";
+            }
+
+            static std::string number(const double value) {
+                char out[32];
+                std::snprintf(out, sizeof(out), "%.9g", std::isfinite(value) ? value : 0.0);
+                return out;
+            }
+
+            static std::string number(const uint64_t value) {
+                return std::to_string(value);
+            }
+
+            static std::string number(const unsigned int value) {
+                return std::to_string(value);
+            }
+
+            static std::string number(const unsigned short value) {
+                return std::to_string(value);
+            }
+
+            std::ostream& file;
+            const bool json;
+            uint64_t rows = 0;
+        };
+    };
+
+    struct PADDING {
+        /** Padding modes of torch.nn.functional.pad, "reflect" leaves out the edge sample and "replicate" repeats it **/
+        /** "symmetric" mirrors including the edge sample, as numpy.pad and PyWavelets do **/
+        enum class MODE { CONSTANT, REFLECT, REPLICATE, CIRCULAR, SYMMETRIC };
+
+        static bool mode(const std::string& name, MODE& out) {
+            /** "constant", "reflect", "replicate", "circular" or "symmetric" **/
+            if (name == "constant") {
+                out = MODE::CONSTANT;
+            } else if (name == "reflect") {
+                out = MODE::REFLECT;
+            } else if (name == "replicate") {
+                out = MODE::REPLICATE;
+            } else if (name == "circular") {
+                out = MODE::CIRCULAR;
+            } else if (name == "symmetric") {
+                out = MODE::SYMMETRIC;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        static bool valid(const uint64_t size, const int64_t left, const int64_t right, const MODE mode) {
+            /** Negative pads are rejected, reflect needs each pad shorter than the input, the others need any input **/
+            if (left < 0 || right < 0) {
+                return false;
+            }
+            const auto length = static_cast<int64_t>(size);
+            switch (mode) {
+                case MODE::CONSTANT: return true;
+                case MODE::REFLECT: return (left == 0 && right == 0) || (left < length && right < length);
+                default: return (left == 0 && right == 0) || length > 0;
+            }
+        }
+
+        template<typename T>
+        class VIEW {
+        public:
+            /** A signal with virtual padding on both sides, nothing is copied until a window crosses an edge **/
+            /** Windows inside the signal point straight into it, so framing costs O(edge) extra memory traffic **/
+            VIEW() = default;
+
+            VIEW(const T* in, const uint64_t size, const int64_t left, const int64_t right, const MODE mode, const T value = T(0))
+                : in(in), count(size), left(left), right(right), kind(mode), value(value), ok(PADDING::valid(size, left, right, mode)) {}
+
+            bool valid() const {
+                return ok;
+            }
+
+            uint64_t size() const {
+                /** Length with both pads **/
+                return count + static_cast<uint64_t>(left + right);
+            }
+
+            T at(const int64_t i) const {
+                /** Sample i of the padded signal **/
+                return sample(i - left);
+            }
+
+            const T* window(const uint64_t start, const uint64_t n, T* buffer) const {
+                /** n samples of the padded signal from start, either a pointer into the input or buffer filled with them **/
+                const int64_t first = static_cast<int64_t>(start) - left;
+                if (first >= 0 && static_cast<uint64_t>(first) + n <= count) {
+                    return in + first;
+                }
+                // Copy the part inside the signal in one go, only the samples past the edges go through source()
+                const int64_t inside = std::max<int64_t>(first, 0);
+                const int64_t stop = std::min<int64_t>(first + static_cast<int64_t>(n), static_cast<int64_t>(count));
+                for (int64_t i = first; i < std::min(inside, first + static_cast<int64_t>(n)); i++) {
+                    buffer[i - first] = sample(i);
+                }
+                if (inside < stop) {
+                    std::copy(in + inside, in + stop, buffer + (inside - first));
+                }
+                for (int64_t i = std::max(stop, inside); i < first + static_cast<int64_t>(n); i++) {
+                    buffer[i - first] = sample(i);
+                }
+                return buffer;
+            }
+
+            void copy(T* out) const {
+                /** The whole padded signal into out, size() samples **/
+                window(0, size(), out);
+            }
+
+        private:
+            T sample(const int64_t i) const {
+                // i relative to the start of the input
+                if (i >= 0 && i < static_cast<int64_t>(count)) {
+                    return in[i];
+                }
+                return kind == MODE::CONSTANT ? value : in[source(i)];
+            }
+
+            uint64_t source(const int64_t i) const {
+                const auto length = static_cast<int64_t>(count);
+                if (i >= 0 && i < length) {
+                    return static_cast<uint64_t>(i);
+                }
+                switch (kind) {
+                    case MODE::REFLECT: return static_cast<uint64_t>(i < 0 ? -i : 2 * (length - 1) - i);
+                    case MODE::REPLICATE: return i < 0 ? 0 : static_cast<uint64_t>(length - 1);
+                    case MODE::CIRCULAR: return static_cast<uint64_t>((i % length + length) % length);
+                    case MODE::SYMMETRIC: {
+                        // Mirrored copies alternate, so the pattern repeats every 2 length samples
+                        const int64_t j = (i % (2 * length) + 2 * length) % (2 * length);
+                        return static_cast<uint64_t>(j < length ? j : 2 * length - 1 - j);
+                    }
+                    default: return 0;
+                }
+            }
+
+            const T* in = nullptr;
+            uint64_t count = 0;
+            int64_t left = 0;
+            int64_t right = 0;
+            MODE kind = MODE::CONSTANT;
+            T value = T(0);
+            bool ok = false;
+        };
+
+        static bool reflection(const COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad) {
+            return padded(in, out, pad, MODE::REFLECT, {});
+        }
+
+        static bool constant(const COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad, std::complex<float> value) {
+            return padded(in, out, pad, MODE::CONSTANT, value);
+        }
+
+        static bool replication(const COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad) {
+            return padded(in, out, pad, MODE::REPLICATE, {});
+        }
+
+        static bool circular(const COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad) {
+            return padded(in, out, pad, MODE::CIRCULAR, {});
+        }
+
+        template<typename T>
+        static bool reflection(const T* in, const uint64_t size, T* out, const int64_t* pad) {
+            /** pad holds the left and right pad, out holds size + pad[0] + pad[1] samples and must not overlap in **/
+            return padded(in, size, out, pad, MODE::REFLECT, T(0));
+        }
+
+        template<typename T>
+        static bool constant(const T* in, const uint64_t size, T* out, const int64_t* pad, const T value) {
+            return padded(in, size, out, pad, MODE::CONSTANT, value);
+        }
+
+        template<typename T>
+        static bool replication(const T* in, const uint64_t size, T* out, const int64_t* pad) {
+            return padded(in, size, out, pad, MODE::REPLICATE, T(0));
+        }
+
+        template<typename T>
+        static bool circular(const T* in, const uint64_t size, T* out, const int64_t* pad) {
+            return padded(in, size, out, pad, MODE::CIRCULAR, T(0));
+        }
+
+    private:
+        template<typename T>
+        static bool padded(const T* in, const uint64_t size, T* out, const int64_t* pad, const MODE mode, const T value) {
+            const VIEW<T> view(in, size, pad[0], pad[1], mode, value);
+            if (!view.valid()) {
+                return false;
+            }
+            view.copy(out);
+            return true;
+        }
+
+        static bool padded(const COMPLEX_VEC& in, COMPLEX_VEC& out, const std::vector<int64_t>& pad, const MODE mode, const std::complex<float> value) {
+            /** out is resized to exactly in.size() + pad[0] + pad[1], in and out may be the same vector **/
+            if (pad.size() != 2 || !valid(in.size(), pad[0], pad[1], mode)) {
+                return false;
+            }
+            const uint64_t length = in.size() + static_cast<uint64_t>(pad[0] + pad[1]);
+            if (&in == &out) {
+                COMPLEX_VEC result(length);
+                padded(in.data(), in.size(), result.data(), pad.data(), mode, value);
+                out.swap(result);
+                return true;
+            }
+            out.resize(length);
+            return padded(in.data(), in.size(), out.data(), pad.data(), mode, value);
+        }
+    };
+
+    struct WAVELET {
+        /** Discrete wavelet transform kernels, outputs are computed in independent tiles so a level runs in parallel **/
+        /** Decimation happens before filtering: the signal is split into even and odd samples (the polyphase form that **/
+        /** lifting factorizes), so only the kept outputs are ever computed **/
+        static constexpr uint64_t TILE = 4096;  // Coefficients per parallel task
+
+        static bool mode(const std::string& name, PADDING::MODE& extension, bool& periodization) {
+            /** PyWavelets signal extension modes: "symmetric", "reflect", "zero", "constant" (edge) or "periodization" **/
+            periodization = name == "periodization";
+            if (name == "symmetric") {
+                extension = PADDING::MODE::SYMMETRIC;
+            } else if (name == "reflect") {
+                extension = PADDING::MODE::REFLECT;
+            } else if (name == "zero") {
+                extension = PADDING::MODE::CONSTANT;
+            } else if (name == "constant") {
+                extension = PADDING::MODE::REPLICATE;
+            } else if (periodization) {
+                extension = PADDING::MODE::CIRCULAR;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        static uint64_t length(const uint64_t size, const uint64_t taps, const bool periodization) {
+            /** Coefficients per band of one level, floor((size + taps - 1) / 2), or ceil(size / 2) with periodization **/
+            return periodization ? (size + 1) / 2 : (size + taps - 1) / 2;
+        }
+
+        static uint64_t max_level(const uint64_t size, const uint64_t taps) {
+            /** Deepest level whose input is still at least taps - 1 long (pywt.dwt_max_level) **/
+            uint64_t level = 0;
+            const uint64_t reach = std::max<uint64_t>(taps - 1, 1);
+            while ((size >> (level + 1)) >= reach) {
+                level++;
+            }
+            return level;
+        }
+
+        static void analysis(const PLAN::WAVELET& wavelet, const float* x, const uint64_t size, const PADDING::MODE extension, const bool periodization,
+                             const uint64_t first, const uint64_t count, float* approx, float* detail) {
+            /** Outputs first .. first + count of one level, out[o] = sum(f[j] x[2o + 1 - j]) over the extended signal **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t F = wavelet.taps();
+            const uint64_t P = F / 2;
+            const uint64_t span = 2 * (count + P - 1);
+            float* window = workspace.allocate<float>(span);
+            // window[t] is sample 2 first + 2 - F + t of the extended signal
+            if (periodization) {
+                // An odd length is made even by repeating the last sample, then the signal repeats
+                const uint64_t period = size + size % 2;
+                const int64_t start = static_cast<int64_t>(2 * first + 1) - static_cast<int64_t>(P);
+                for (uint64_t t = 0; t < span; t++) {
+                    const int64_t i = start + static_cast<int64_t>(t);
+                    const auto at = static_cast<uint64_t>((i % static_cast<int64_t>(period) + static_cast<int64_t>(period)) % static_cast<int64_t>(period));
+                    window[t] = x[std::min(at, size - 1)];
+                }
+            } else if (extension == PADDING::MODE::REFLECT && size < F) {
+                // Shorter than the filter, the reflections repeat with period 2 size - 2 as in pywt, one sample stays constant
+                const auto period = static_cast<int64_t>(2 * size - 2);
+                const int64_t start = static_cast<int64_t>(2 * first + 2) - static_cast<int64_t>(F);
+                for (uint64_t t = 0; t < span; t++) {
+                    const int64_t i = period == 0 ? 0 : ((start + static_cast<int64_t>(t)) % period + period) % period;
+                    window[t] = x[i < static_cast<int64_t>(size) ? i : period - i];
+                }
+            } else {
+                // Symmetric extension repeats its mirror images on its own when the signal is shorter than the filter
+                const auto pad = static_cast<int64_t>(F - 1);
+                const PADDING::VIEW<float> view(x, size, pad, pad, extension);
+                const float* samples = view.window(2 * first + 1, span, window);
+                if (samples != window) {
+                    std::copy(samples, samples + span, window);
+                }
+            }
+            decimate(wavelet, window, count, approx + first, detail + first);
+        }
+
+        static void decimate(const PLAN::WAVELET& wavelet, const float* window, const uint64_t count, float* approx, float* detail) {
+            /** count outputs of both bands from window, which holds 2 (count + taps / 2 - 1) samples of the extended signal **/
+            /** starting where the first output's filter does, out[o] = sum(f[j] window[2o + taps - 1 - j]) **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t F = wavelet.taps();
+            const uint64_t P = F / 2;
+            const uint64_t half = count + P - 1;
+            float* even = workspace.allocate<float>(half);
+            float* odd = workspace.allocate<float>(half);
+            for (uint64_t t = 0; t < half; t++) {
+                even[t] = window[2 * t];
+                odd[t] = window[2 * t + 1];
+            }
+            const float* bands[2] = {wavelet.dec_lo().data(), wavelet.dec_hi().data()};
+            float* out[2] = {approx, detail};
+            float* taps = workspace.allocate<float>(2 * P);
+            for (int band = 0; band < 2; band++) {
+                for (uint64_t k = 0; k < P; k++) {
+                    taps[k] = bands[band][F - 1 - 2 * k];
+                    taps[P + k] = bands[band][F - 2 - 2 * k];
+                }
+                correlate(even, taps, P, 1, count, out[band], false);
+                correlate(odd, taps + P, P, 1, count, out[band], true);
+            }
+        }
+
+        static void synthesis(const PLAN::WAVELET& wavelet, const float* approx, const float* detail, const uint64_t size, const uint64_t shift,
+                              const uint64_t first, const uint64_t count, float* out) {
+            /** out[n] = y[n + shift] for n in first .. first + count, y[m] = sum(approx[k] rec_lo[m - 2k] + detail[k] rec_hi[m - 2k]) **/
+            /** Coefficients outside 0 .. size count as zero **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t F = wavelet.taps();
+            const uint64_t P = F / 2;
+            // Even outputs y[2q] and odd outputs y[2q + 1] are two correlations over the same coefficients
+            const uint64_t m0 = first + shift;
+            const uint64_t q0 = m0 / 2;
+            const uint64_t pairs = (m0 + count - 1) / 2 + 1 - q0;
+            const uint64_t span = pairs + P - 1;
+            float* a = workspace.allocate<float>(span);
+            float* d = workspace.allocate<float>(span);
+            const int64_t base = static_cast<int64_t>(q0) - static_cast<int64_t>(P) + 1;
+            for (uint64_t t = 0; t < span; t++) {
+                const int64_t k = base + static_cast<int64_t>(t);
+                const bool inside = k >= 0 && k < static_cast<int64_t>(size);
+                a[t] = inside ? approx[k] : 0.0f;
+                d[t] = inside ? detail[k] : 0.0f;
+            }
+            float* phases = workspace.allocate<float>(2 * pairs);
+            float* taps = workspace.allocate<float>(4 * P);
+            const float* lo = wavelet.rec_lo().data();
+            const float* hi = wavelet.rec_hi().data();
+            for (uint64_t parity = 0; parity < 2; parity++) {
+                for (uint64_t k = 0; k < P; k++) {
+                    taps[k] = lo[2 * (P - 1 - k) + parity];
+                    taps[P + k] = hi[2 * (P - 1 - k) + parity];
+                }
+                correlate(a, taps, P, 1, pairs, phases + parity * pairs, false);
+                correlate(d, taps + P, P, 1, pairs, phases + parity * pairs, true);
+            }
+            for (uint64_t n = 0; n < count; n++) {
+                const uint64_t m = m0 + n;
+                out[first + n] = phases[(m & 1) * pairs + m / 2 - q0];
+            }
+        }
+
+        static void stationary(const PLAN::WAVELET& wavelet, const float* x, const uint64_t size, const uint64_t dilation,
+                               const uint64_t first, const uint64_t count, float* approx, float* detail) {
+            /** One level of the undecimated transform with the filters spread dilation apart, the signal repeats **/
+            /** out[n] = sum(f[k] x[n + (F / 2 - k) dilation]) **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t F = wavelet.taps();
+            const uint64_t reach = (F - 1) * dilation;
+            float* window = workspace.allocate<float>(count + reach);
+            periodic(x, size, static_cast<int64_t>(first) + static_cast<int64_t>(F / 2 * dilation) - static_cast<int64_t>(reach), count + reach, window);
+            correlate(window, wavelet.rec_lo().data(), F, dilation, count, approx + first, false);
+            correlate(window, wavelet.rec_hi().data(), F, dilation, count, detail + first, false);
+        }
+
+        static void inverse_stationary(const PLAN::WAVELET& wavelet, const float* approx, const float* detail, const uint64_t size, const uint64_t dilation,
+                                       const uint64_t first, const uint64_t count, float* out) {
+            /** The undecimated filters form a tight frame, so half the adjoint of stationary() is its inverse **/
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const uint64_t F = wavelet.taps();
+            const uint64_t reach = (F - 1) * dilation;
+            const int64_t start = static_cast<int64_t>(first) - static_cast<int64_t>(F / 2 * dilation);
+            float* a = workspace.allocate<float>(count + reach);
+            float* d = workspace.allocate<float>(count + reach);
+            periodic(approx, size, start, count + reach, a);
+            periodic(detail, size, start, count + reach, d);
+            correlate(a, wavelet.dec_lo().data(), F, dilation, count, out + first, false);
+            correlate(d, wavelet.dec_hi().data(), F, dilation, count, out + first, true);
+            for (uint64_t n = first; n < first + count; n++) {
+                out[n] *= 0.5f;
+            }
+        }
+
+        static void periodic(const float* x, const uint64_t size, const int64_t start, const uint64_t count, float* out) {
+            /** x[start .. start + count) of the periodic extension of x, copied a period at a time **/
+            auto at = static_cast<uint64_t>((start % static_cast<int64_t>(size) + static_cast<int64_t>(size)) % static_cast<int64_t>(size));
+            for (uint64_t written = 0; written < count;) {
+                const uint64_t run = std::min(count - written, size - at);
+                std::copy(x + at, x + at + run, out + written);
+                written += run;
+                at = 0;
+            }
+        }
+
+        static void correlate(const float* a, const float* u, const uint64_t taps, const uint64_t stride, const uint64_t count, float* out, const bool add) {
+            /** out[n] = sum(u[k] a[n + k stride]) for n < count, added to out when add is set **/
+            uint64_t n = 0;
+#if WAVLIB_X86
+            if (CPU::avx2()) {
+                for (; n + 32 <= count; n += 32) {
+                    avx2_correlate(a + n, u, taps, stride, out + n, add, std::make_index_sequence<4>());
+                }
+            }
+#endif
+#if WAVLIB_SSE2 || WAVLIB_NEON
+            for (; n + 16 <= count; n += 16) {
+                correlate(a + n, u, taps, stride, out + n, add, std::make_index_sequence<4>());
+            }
+#endif
+            for (; n < count; n++) {
+                float sum = add ? out[n] : 0.0f;
+                for (uint64_t k = 0; k < taps; k++) {
+                    sum += u[k] * a[n + k * stride];
+                }
+                out[n] = sum;
+            }
+        }
+
+        template<size_t... G>
+        static void correlate(const float* a, const float* u, const uint64_t taps, const uint64_t stride, float* out, const bool add, std::index_sequence<G...>) {
+            /** 4 * sizeof...(G) consecutive outputs, vector lanes run over the outputs and every sum stays in a register **/
+#if WAVLIB_SSE2
+            __m128 sum[sizeof...(G)] = {(add ? _mm_loadu_ps(out + 4 * G) : _mm_setzero_ps())...};
+            for (uint64_t k = 0; k < taps; k++) {
+                const __m128 v = _mm_set1_ps(u[k]);
+                const float* x = a + k * stride;
+                ((sum[G] = _mm_add_ps(sum[G], _mm_mul_ps(v, _mm_loadu_ps(x + 4 * G)))), ...);
+            }
+            (_mm_storeu_ps(out + 4 * G, sum[G]), ...);
+#elif WAVLIB_NEON
+            float32x4_t sum[sizeof...(G)] = {(add ? vld1q_f32(out + 4 * G) : vdupq_n_f32(0.0f))...};
+            for (uint64_t k = 0; k < taps; k++) {
+                const float* x = a + k * stride;
+                ((sum[G] = vmlaq_n_f32(sum[G], vld1q_f32(x + 4 * G), u[k])), ...);
+            }
+            (vst1q_f32(out + 4 * G, sum[G]), ...);
+#else
+            for (uint64_t n = 0; n < 4 * sizeof...(G); n++) {
+                float sum = add ? out[n] : 0.0f;
+                for (uint64_t k = 0; k < taps; k++) {
+                    sum += u[k] * a[n + k * stride];
+                }
+                out[n] = sum;
+            }
+#endif
+        }
+
+#if WAVLIB_X86
+        template<size_t... G>
+        WAVLIB_TARGET("avx2") static void avx2_correlate(const float* a, const float* u, const uint64_t taps, const uint64_t stride, float* out, const bool add, std::index_sequence<G...>) {
+            __m256 sum[sizeof...(G)] = {(add ? _mm256_loadu_ps(out + 8 * G) : _mm256_setzero_ps())...};
+            for (uint64_t k = 0; k < taps; k++) {
+                const __m256 v = _mm256_broadcast_ss(u + k);
+                const float* x = a + k * stride;
+                ((sum[G] = _mm256_add_ps(sum[G], _mm256_mul_ps(v, _mm256_loadu_ps(x + 8 * G)))), ...);
+            }
+            (_mm256_storeu_ps(out + 8 * G, sum[G]), ...);
+        }
+#endif
+    };
+
+    struct SIGNAL {
+        static bool DFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            /** Discrete Fourier Transform **/
+            /** Direct O(n^2) evaluation in double precision, meant as a reference for FFT **/
+            const uint64_t n = in.size();
+            if (n == 0) {
+                return false;
+            }
+            COMPLEX_VEC result(n);
+            for (uint64_t k = 0; k < n; k++) {
+                std::complex<double> sum = 0;
+                for (uint64_t j = 0; j < n; j++) {
+                    const double angle = -2.0 * WAVLIB_PI * static_cast<double>((j * k) % n) / static_cast<double>(n);
+                    sum += std::complex<double>(in[j]) * std::complex<double>(std::cos(angle), std::sin(angle));
+                }
+                result[k] = std::complex<float>(sum);
+            }
+            out.swap(result);
+            return true;
+        }
+
+        static bool FFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            /** Fast Fourier Transform **/
+            WAVLIB_SCOPE("SIGNAL::FFT");
+            if (in.empty()) {
+                return false;
+            }
+            PLAN::FFT::get(in.size())->forward(in, out);
+            return true;
+        }
+
+        static bool IFFT(const COMPLEX_VEC& in, COMPLEX_VEC& out) {
+            /** Inverse Fast Fourier Transform, normalized by 1 / n **/
+            WAVLIB_SCOPE("SIGNAL::IFFT");
+            if (in.empty()) {
+                return false;
+            }
+            PLAN::FFT::get(in.size())->inverse(in, out);
+            const float scale = 1.0f / static_cast<float>(in.size());
+            for (auto& value : out) {
+                value *= scale;
+            }
+            return true;
+        }
+
+        static bool RFFT(const std::vector<float>& in, COMPLEX_VEC& out) {
+            /** Real input FFT, returns the n / 2 + 1 non-negative frequency bins **/
+            WAVLIB_SCOPE("SIGNAL::RFFT");
+            if (in.empty()) {
+                return false;
+            }
+            PLAN::RFFT::get(in.size())->forward(in.data(), out);
+            return true;
+        }
+
+        static bool IRFFT(const COMPLEX_VEC& in, std::vector<float>& out, const uint64_t n) {
+            /** Inverse of RFFT for a signal of n samples, normalized by 1 / n **/
+            WAVLIB_SCOPE("SIGNAL::IRFFT");
+            if (n == 0 || in.size() < n / 2 + 1) {
+                return false;
+            }
+            out.resize(n);
+            PLAN::RFFT::get(n)->inverse(in, out.data());
+            const float scale = 1.0f / static_cast<float>(n);
+            for (auto& value : out) {
+                value *= scale;
+            }
+            return true;
+        }
+
+        static bool STFT(COMPLEX_VEC& in,
+                         COMPLEX_VEC& out,
+                         const int frame_size,
+                         const int hop_length,
+                         COMPLEX_VEC& window,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const bool normalized = false,
+                         const bool onesided = false) {
+            /** Short-Time Fourier Transform **/
+            /** Please ensure the window is set to periodic **/
+            /** out is frames x bins in row-major order, bins = onesided ? frame_size / 2 + 1 : frame_size **/
+            /** onesided treats the input as real and only uses the real parts **/
+            /** center pads frame_size / 2 samples on both sides by pad_mode, "reflect", "constant", "replicate", "circular" or "symmetric" **/
+            /** A shorter window is centered and zero padded, a longer one keeps its centered frame_size samples, as in ONLINE::STFT **/
+            if (frame_size < 1 || hop_length < 1) {
+                return false;
+            }
+            const auto n = static_cast<uint64_t>(frame_size);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const float* taper = analysis_window(window, n, normalized ? 1.0f / std::sqrt(static_cast<float>(n)) : 1.0f, workspace.allocate<float>(n));
+            return stft(in.data(), in.size(), out, n, static_cast<uint64_t>(hop_length), taper, center, pad_mode, onesided);
+        }
+
+        static bool STFT(const FORMAT::SPAN<const float> in,
+                         COMPLEX_VEC& out,
+                         const int frame_size,
+                         const int hop_length,
+                         const FORMAT::SPAN<const float> window,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const bool normalized = false,
+                         const bool onesided = true) {
+            /** Short-Time Fourier Transform of a real signal, e.g. one channel of FORMAT::PLANAR **/
+            if (frame_size < 1 || hop_length < 1) {
+                return false;
+            }
+            const auto n = static_cast<uint64_t>(frame_size);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const float* taper = analysis_window(window, n, normalized ? 1.0f / std::sqrt(static_cast<float>(n)) : 1.0f, workspace.allocate<float>(n));
+            return stft(in.data, in.size, out, n, static_cast<uint64_t>(hop_length), taper, center, pad_mode, onesided);
+        }
+
+        static bool ISTFT(COMPLEX_VEC& in,
+                          COMPLEX_VEC& out,
+                          const int frame_size,
+                          const int hop_length,
+                          COMPLEX_VEC& window,
+                          const bool center = true,
+                          const bool normalized = false,
+                          const bool onesided = false,
+                          const int64_t length = -1) {
+            /** Inverse Short-Time Fourier Transform, overlap-add with window-sum normalization **/
+            /** in is frames x bins as produced by STFT, length < 0 keeps the natural length **/
+            if (frame_size < 1 || hop_length < 1) {
+                return false;
+            }
+            const auto n = static_cast<uint64_t>(frame_size);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const float* taper = analysis_window(window, n, 1.0f, workspace.allocate<float>(n));
+            return istft(in, out, n, static_cast<uint64_t>(hop_length), taper, center, normalized, onesided, length);
+        }
+
+        static bool ISTFT(const COMPLEX_VEC& in,
+                          REAL_VEC& out,
+                          const int frame_size,
+                          const int hop_length,
+                          const FORMAT::SPAN<const float> window,
+                          const bool center = true,
+                          const bool normalized = false,
+                          const bool onesided = true,
+                          const int64_t length = -1) {
+            /** Inverse Short-Time Fourier Transform back to a real signal, only the real parts are kept **/
+            if (frame_size < 1 || hop_length < 1) {
+                return false;
+            }
+            const auto n = static_cast<uint64_t>(frame_size);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            const float* taper = analysis_window(window, n, 1.0f, workspace.allocate<float>(n));
+            return istft(in, out, n, static_cast<uint64_t>(hop_length), taper, center, normalized, onesided, length);
+        }
+
+        template<typename T>
+        static bool stft(const T* in,
+                         const uint64_t size,
+                         COMPLEX_VEC& out,
+                         const uint64_t n,
+                         const uint64_t hop,
+                         const float* taper,
+                         const bool center,
+                         const std::string& pad_mode,
+                         const bool onesided) {
+            /** Shared STFT core for real (float) and complex samples **/
+            WAVLIB_SCOPE("SIGNAL::STFT");
+            PADDING::VIEW<T> signal;
+            if (!framed(in, size, n, center, pad_mode, signal) || signal.size() < n) {
+                return false;
+            }
+
+            const uint64_t frames = 1 + (signal.size() - n) / hop;
+            const uint64_t bins = onesided ? n / 2 + 1 : n;
+            out.resize(frames * bins);
+
+            // Frames are independent, every task transforms a run of them straight into out
+            const uint64_t chunk = 32;
+            const auto complex = onesided ? nullptr : PLAN::FFT::get(n);
+            const auto real = onesided ? PLAN::RFFT::get(n) : nullptr;
+            POOL::shared().run((frames + chunk - 1) / chunk, [&](const uint64_t task) {
+                // Only frames over an edge are assembled in edge, the rest read the input in place
+                WORKSPACE& local = WORKSPACE::local();
+                WORKSPACE::SCOPE inner(local);
+                T* edge = local.allocate<T>(n);
+                const uint64_t last = std::min(frames, (task + 1) * chunk);
+                for (uint64_t t = task * chunk; t < last; t++) {
+                    frame(signal.window(t * hop, n, edge), taper, complex.get(), real.get(), out.data() + t * bins);
+                }
+            });
+            return true;
+        }
+
+        template<typename VEC>
+        static bool istft(const COMPLEX_VEC& in,
+                          VEC& out,
+                          const uint64_t n,
+                          const uint64_t hop,
+                          const float* taper,
+                          const bool center,
+                          const bool normalized,
+                          const bool onesided,
+                          const int64_t length) {
+            /** Shared ISTFT core, VEC is COMPLEX_VEC or REAL_VEC **/
+            WAVLIB_SCOPE("SIGNAL::ISTFT");
+            const uint64_t bins = onesided ? n / 2 + 1 : n;
+            const uint64_t frames = in.size() / bins;
+            if (frames == 0 || in.size() % bins != 0) {
+                return false;
+            }
+
+            const float scale = (normalized ? std::sqrt(static_cast<float>(n)) : 1.0f) / static_cast<float>(n);
+            const uint64_t total = n + (frames - 1) * hop;
+            const uint64_t offset = center ? n / 2 : 0;
+            uint64_t size = total - std::min(total, 2 * offset);
+            if (length >= 0) {
+                size = static_cast<uint64_t>(length);
+            }
+            out.assign(size, 0);
+
+            // Output tiles are independent, each one gathers the frames that overlap it
+            const uint64_t tile = 64 * hop;
+            const uint64_t end = std::min(total, offset + size);
+            const auto complex = onesided ? nullptr : PLAN::FFT::get(n);
+            const auto real = onesided ? PLAN::RFFT::get(n) : nullptr;
+            const uint64_t scratch = n + (onesided ? (n + 1) / 2 + real->scratch_size() : complex->scratch_size());
+            POOL::shared().run((end - offset + tile - 1) / tile, [&](const uint64_t task) {
+                const uint64_t begin = offset + task * tile;
+                const uint64_t stop = std::min(end, begin + tile);
+                const uint64_t first = begin >= n ? (begin - n) / hop + 1 : 0;
+                const uint64_t last = std::min(frames, (stop - 1) / hop + 1);
+                const uint64_t span = stop - begin;
+
+                static thread_local std::vector<float> envelope;
+                static thread_local std::vector<std::complex<float>> buffer;
+                envelope.assign(span, 0.0f);
+                buffer.assign(span, 0.0f);
+                std::complex<float>* work = PLAN::FFT::workspace(scratch);
+
+                for (uint64_t t = first; t < last; t++) {
+                    inverse_frame(in.data() + t * bins, complex.get(), real.get(), work, work + n);
+                    const uint64_t from = std::max(begin, t * hop);
+                    const uint64_t to = std::min(stop, t * hop + n);
+                    for (uint64_t i = from; i < to; i++) {
+                        const float w = taper[i - t * hop];
+                        buffer[i - begin] += work[i - t * hop] * (w * scale);
+                        envelope[i - begin] += w * w;
+                    }
+                }
+                for (uint64_t i = 0; i < span; i++) {
+                    store(out[begin + i - offset], envelope[i] > 1e-11f ? buffer[i] / envelope[i] : buffer[i]);
+                }
+            });
+            return true;
+        }
+
+        template<typename T>
+        static bool framed(const T* in, const uint64_t size, const uint64_t n, const bool center, const std::string& pad_mode, PADDING::VIEW<T>& view) {
+            /** in as the frames see it, centered frames get n / 2 samples of virtual padding on both sides **/
+            /** false for an unknown pad_mode or a pad the mode can't produce **/
+            PADDING::MODE mode = PADDING::MODE::CONSTANT;
+            if (center && !PADDING::mode(pad_mode, mode)) {
+                return false;
+            }
+            const int64_t pad = center ? static_cast<int64_t>(n / 2) : 0;
+            view = PADDING::VIEW<T>(in, size, pad, pad, mode);
+            return view.valid();
+        }
+
+        static void store(std::complex<float>& out, const std::complex<float> value) {
+            out = value;
+        }
+
+        static void store(float& out, const std::complex<float> value) {
+            out = value.real();
+        }
+
+        static std::vector<float> analysis_window(const COMPLEX_VEC& window, const uint64_t n, const float scale) {
+            std::vector<float> taper(n);
+            analysis_window(window, n, scale, taper.data());
+            return taper;
+        }
+
+        static std::vector<float> analysis_window(const FORMAT::SPAN<const float> window, const uint64_t n, const float scale) {
+            std::vector<float> taper(n);
+            analysis_window(window, n, scale, taper.data());
+            return taper;
+        }
+
+        static float* analysis_window(const COMPLEX_VEC& window, const uint64_t n, const float scale, float* taper) {
+            /** Real window of length n into taper, shorter windows are centered and zero padded, empty means rectangular **/
+            /** Longer windows keep their centered n samples **/
+            std::fill(taper, taper + n, window.empty() ? scale : 0.0f);
+            const uint64_t size = std::min<uint64_t>(window.size(), n);
+            const uint64_t skip = (window.size() - size) / 2;
+            const uint64_t offset = (n - size) / 2;
+            for (uint64_t i = 0; i < size; i++) {
+                taper[offset + i] = window[skip + i].real() * scale;
+            }
+            return taper;
+        }
+
+        static float* analysis_window(const FORMAT::SPAN<const float> window, const uint64_t n, const float scale, float* taper) {
+            std::fill(taper, taper + n, window.empty() ? scale : 0.0f);
+            const uint64_t size = std::min<uint64_t>(window.size, n);
+            const uint64_t skip = (window.size - size) / 2;
+            const uint64_t offset = (n - size) / 2;
+            for (uint64_t i = 0; i < size; i++) {
+                taper[offset + i] = window[skip + i] * scale;
+            }
+            return taper;
+        }
+
+        template<typename T>
+        static void frame(const T* x, const float* taper, const PLAN::FFT* complex, const PLAN::RFFT* real, std::complex<float>* out) {
+            /** Window one frame and transform it into out with whichever plan is given **/
+            /** Scratch comes from the per-thread workspace **/
+            if (real != nullptr) {
+                const uint64_t n = real->size();
+                std::complex<float>* work = PLAN::FFT::workspace((n + 1) / 2 + real->scratch_size());
+                auto* samples = reinterpret_cast<float*>(work);
+                for (uint64_t i = 0; i < n; i++) {
+                    samples[i] = std::real(x[i]) * taper[i];
+                }
+                real->forward(samples, out, work + (n + 1) / 2);
+            } else {
+                const uint64_t n = complex->size();
+                std::complex<float>* work = PLAN::FFT::workspace(complex->scratch_size());
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i] = x[i] * taper[i];
+                }
+                complex->forward(out, out, work);
+            }
+        }
+
+        static void inverse_frame(const std::complex<float>* in, const PLAN::FFT* complex, const PLAN::RFFT* real, std::complex<float>* out, std::complex<float>* scratch) {
+            /** Unnormalized inverse transform of one frame into size() complex samples **/
+            if (real != nullptr) {
+                const uint64_t n = real->size();
+                auto* samples = reinterpret_cast<float*>(scratch);
+                real->inverse(in, samples, scratch + (n + 1) / 2);
+                for (uint64_t i = 0; i < n; i++) {
+                    out[i] = samples[i];
+                }
+            } else {
+                complex->inverse(in, out, scratch);
+            }
+        }
+
+        static bool RESAMPLE(const FORMAT::SPAN<const float> in, REAL_VEC& out, const unsigned int in_rate, const unsigned int out_rate) {
+            /** Polyphase sample rate conversion of a whole signal **/
+            WAVLIB_SCOPE("SIGNAL::RESAMPLE");
+            const auto plan = PLAN::POLYPHASE::get(in_rate, out_rate);
+            if (!plan) {
+                return false;
+            }
+            // Resample straight into out, unless in is a view of out's own storage
+            static thread_local REAL_VEC spare;
+            const bool alias = overlaps(in, out);
+            REAL_VEC& result = alias ? spare : out;
+            result.resize(plan->output_size(in.size));
+            resample(*plan, in.data, in.size, result.data(), result.size());
+            if (alias) {
+                out.swap(spare);
+            }
+            return true;
+        }
+
+        static bool RESAMPLE(const FORMAT::PLANAR& in, FORMAT::PLANAR& out, const unsigned int sample_rate) {
+            /** Resample every channel to sample_rate, in and out may be the same object **/
+            WAVLIB_SCOPE("SIGNAL::RESAMPLE");
+            const auto plan = PLAN::POLYPHASE::get(in.sample_rate, sample_rate);
+            if (!plan || in.channels == 0) {
+                return false;
+            }
+            // In place conversions go through a spare that keeps the old storage for next time
+            static thread_local FORMAT::PLANAR spare;
+            FORMAT::PLANAR& result = &in == &out ? spare : out;
+            result.sample_rate = sample_rate;
+            result.resize(in.channels, plan->output_size(in.frames));
+            for (unsigned short c = 0; c < in.channels; c++) {
+                resample(*plan, in.channel(c).data, in.frames, result.channel(c).data, result.frames);
+            }
+            if (&result != &out) {
+                std::swap(out, spare);
+            }
+            return true;
+        }
+
+        static bool RESAMPLE(const FORMAT::WAV& in, FORMAT::WAV& out, const unsigned int sample_rate) {
+            /** Resample interleaved integer audio, results are rounded and clipped to the range of the format **/
+            WAVLIB_SCOPE("SIGNAL::RESAMPLE");
+            const auto plan = PLAN::POLYPHASE::get(in.sample_rate, sample_rate);
+            const FORMAT::SAMPLE type = PCM::type(in.format, in.sample_size);
+            // 8-bit samples are unsigned, the filter runs on the signed value
+            double offset = 0, low = 0, high = 0;
+            if (!plan || !limits(in, offset, low, high)) {
+                return false;
+            }
+            const uint64_t channels = in.channels;
+            const uint64_t frames = in.audio.size() / channels;
+            const uint64_t length = plan->output_size(frames);
+
+            static thread_local std::vector<int> spare;
+            std::vector<int>& audio = &in == &out ? spare : out.audio;
+            audio.resize(length * channels);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            float* source = workspace.allocate<float>(frames);
+            float* target = workspace.allocate<float>(length);
+            for (uint64_t c = 0; c < channels; c++) {
+                for (uint64_t i = 0; i < frames; i++) {
+                    source[i] = static_cast<float>(in.audio[i * channels + c] - offset);
+                }
+                resample(*plan, source, frames, target, length);
+                for (uint64_t i = 0; i < length; i++) {
+                    audio[i * channels + c] = quantize(target[i], offset, low, high);
+                }
+            }
+
+            out.format = in.format;
+            out.channels = in.channels;
+            out.sample_size = in.sample_size;
+            out.sample_rate = sample_rate;
+            out.data_rate = static_cast<unsigned int>(static_cast<uint64_t>(sample_rate) * channels * PCM::bytes(type));
+            out.data_size = static_cast<unsigned int>(std::min<uint64_t>(length * channels * PCM::bytes(type), 0xFFFFFFFF));
+            if (&audio != &out.audio) {
+                out.audio.swap(audio);
+            }
+            return true;
+        }
+
+        static bool MEL(const COMPLEX_VEC& spectrum, REAL_VEC& out, const unsigned int sample_rate, const int n_fft, const int n_mels = 80, const std::string& log = "log10") {
+            /** Mel features of a onesided STFT (frames x (n_fft / 2 + 1)), out is frames x n_mels **/
+            /** log is "log10" (Whisper), "db" (librosa power_to_db without top_db), "ln" (Kaldi) or "none", power is floored at 1e-10 before the log **/
+            WAVLIB_SCOPE("SIGNAL::MEL");
+            float scale = 0.0f;
+            if (n_fft < 2 || n_mels < 1 || !FEATURE::compression(log, scale)) {
+                return false;
+            }
+            const auto plan = PLAN::MEL::get(sample_rate, static_cast<uint64_t>(n_fft), static_cast<uint64_t>(n_mels));
+            if (!plan || spectrum.empty() || spectrum.size() % plan->bins() != 0) {
+                return false;
+            }
+            const uint64_t bins = plan->bins();
+            const uint64_t frames = spectrum.size() / bins;
+            out.resize(frames * plan->mels());
+
+            const uint64_t chunk = 64;
+            POOL::shared().run((frames + chunk - 1) / chunk, [&](const uint64_t task) {
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                float* power = workspace.allocate<float>(bins);
+                const uint64_t last = std::min(frames, (task + 1) * chunk);
+                for (uint64_t t = task * chunk; t < last; t++) {
+                    features(spectrum.data() + t * bins, *plan, power, scale, out.data() + t * plan->mels());
+                }
+            });
+            return true;
+        }
+
+        static bool MEL(const FORMAT::SPAN<const float> in,
+                        REAL_VEC& out,
+                        const unsigned int sample_rate,
+                        const int n_fft = 400,
+                        const int hop_length = 160,
+                        const int n_mels = 80,
+                        const bool center = true,
+                        const std::string& pad_mode = "reflect",
+                        const std::string& log = "log10") {
+            /** Mel spectrogram of a real signal with a periodic Hann window, out is frames x n_mels **/
+            /** Framing, FFT, power, filters and log run per frame, the complex spectrogram is never stored **/
+            /** Whisper uses n_fft 400, hop 160 and 80 mels at 16 kHz, then drops the last frame and rescales the log10 values **/
+            WAVLIB_SCOPE("SIGNAL::MEL");
+            const auto mels = static_cast<uint64_t>(n_mels);
+            return melspectrogram(in, sample_rate, n_fft, hop_length, n_mels, center, pad_mode, log,
+                                  [&](const uint64_t frames) { out.resize(frames * mels); },
+                                  [&](const uint64_t first, const uint64_t count, const float* block) {
+                                      std::copy(block, block + count * mels, out.data() + first * mels);
+                                  });
+        }
+
+        static bool DCT(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int n, const int type = 2) {
+            /** Orthonormal DCT of every row of n values, type 2 or its inverse type 3 (scipy norm="ortho") **/
+            WAVLIB_SCOPE("SIGNAL::DCT");
+            if (n < 1 || (type != 2 && type != 3) || in.size == 0 || in.size % static_cast<uint64_t>(n) != 0) {
+                return false;
+            }
+            const auto size = static_cast<uint64_t>(n);
+            const auto plan = PLAN::DCT::get(size);
+            const uint64_t rows = in.size / size;
+            static thread_local REAL_VEC spare;
+            const bool alias = overlaps(in, out);
+            REAL_VEC& result = alias ? spare : out;
+            result.resize(in.size);
+
+            const uint64_t chunk = 256;
+            POOL::shared().run((rows + chunk - 1) / chunk, [&](const uint64_t task) {
+                const uint64_t first = task * chunk;
+                const uint64_t count = std::min(chunk, rows - first);
+                if (type == 2) {
+                    plan->batch(in.data + first * size, count, result.data() + first * size, size);
+                    return;
+                }
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                auto* scratch = workspace.allocate<std::complex<float>>(plan->scratch_size());
+                for (uint64_t t = first; t < first + count; t++) {
+                    plan->inverse(in.data + t * size, result.data() + t * size, scratch);
+                }
+            });
+            if (alias) {
+                out.swap(spare);
+            }
+            return true;
+        }
+
+        static bool CEPSTRUM(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int n_mels, const int n_mfcc = 13, const int lifter = 0) {
+            /** Cepstral coefficients of log mel frames, eg. from ONLINE::MEL, out is frames x n_mfcc **/
+            /** The first n_mfcc values of an orthonormal DCT-II, then liftered when lifter > 0 **/
+            WAVLIB_SCOPE("SIGNAL::CEPSTRUM");
+            if (n_mels < 1 || n_mfcc < 1 || n_mfcc > n_mels || lifter < 0 || in.size == 0 || in.size % static_cast<uint64_t>(n_mels) != 0) {
+                return false;
+            }
+            const auto mels = static_cast<uint64_t>(n_mels);
+            const auto keep = static_cast<uint64_t>(n_mfcc);
+            const auto plan = PLAN::DCT::get(mels);
+            const std::vector<float> weights = liftering(keep, lifter);
+            const uint64_t rows = in.size / mels;
+            static thread_local REAL_VEC spare;
+            const bool alias = overlaps(in, out);
+            REAL_VEC& result = alias ? spare : out;
+            result.resize(rows * keep);
+
+            const uint64_t chunk = 256;
+            POOL::shared().run((rows + chunk - 1) / chunk, [&](const uint64_t task) {
+                const uint64_t first = task * chunk;
+                const uint64_t count = std::min(chunk, rows - first);
+                plan->batch(in.data + first * mels, count, result.data() + first * keep, keep);
+                lift(result.data() + first * keep, count, weights);
+            });
+            if (alias) {
+                out.swap(spare);
+            }
+            return true;
+        }
+
+        static bool MFCC(const COMPLEX_VEC& spectrum,
+                         REAL_VEC& out,
+                         const unsigned int sample_rate,
+                         const int n_fft,
+                         const int n_mfcc = 13,
+                         const int n_mels = 40,
+                         const int lifter = 0,
+                         const std::string& log = "db") {
+            /** MFCCs of a onesided STFT (frames x (n_fft / 2 + 1)), out is frames x n_mfcc **/
+            WAVLIB_SCOPE("SIGNAL::MFCC");
+            REAL_VEC mel;
+            return MEL(spectrum, mel, sample_rate, n_fft, n_mels, log) && CEPSTRUM(mel, out, n_mels, n_mfcc, lifter);
+        }
+
+        static bool MFCC(const FORMAT::SPAN<const float> in,
+                         REAL_VEC& out,
+                         const unsigned int sample_rate,
+                         const int n_mfcc = 13,
+                         const int n_fft = 400,
+                         const int hop_length = 160,
+                         const int n_mels = 40,
+                         const int lifter = 0,
+                         const bool center = true,
+                         const std::string& pad_mode = "reflect",
+                         const std::string& log = "db") {
+            /** MFCCs of a real signal, out is frames x n_mfcc, framed and filtered like MEL **/
+            /** Each block of log mel frames goes through the DCT while it is still in cache, the mel spectrogram is never stored **/
+            /** The "db" log and lifter follow librosa and torchaudio (without top_db), "ln" and lifter 22 are the Kaldi style **/
+            WAVLIB_SCOPE("SIGNAL::MFCC");
+            if (n_mfcc < 1 || n_mfcc > n_mels || lifter < 0) {
+                return false;
+            }
+            const auto mels = static_cast<uint64_t>(n_mels);
+            const auto keep = static_cast<uint64_t>(n_mfcc);
+            const auto plan = PLAN::DCT::get(mels);
+            const std::vector<float> weights = liftering(keep, lifter);
+            return melspectrogram(in, sample_rate, n_fft, hop_length, n_mels, center, pad_mode, log,
+                                  [&](const uint64_t frames) { out.resize(frames * keep); },
+                                  [&](const uint64_t first, const uint64_t count, const float* block) {
+                                      plan->batch(block, count, out.data() + first * keep, keep);
+                                      lift(out.data() + first * keep, count, weights);
+                                  });
+        }
+
+        static bool DELTA(const FORMAT::SPAN<const float> in, REAL_VEC& out, const int features, const int width = 9, const int order = 1) {
+            /** Regression deltas over time of frames x features, out has the same shape **/
+            /** d[t] = sum(i (c[t + i] - c[t - i])) / 2 sum(i^2) for i up to width / 2, edges repeat the first and last frame (HTK) **/
+            /** order 2 is the delta of the delta **/
+            WAVLIB_SCOPE("SIGNAL::DELTA");
+            if (features < 1 || width < 3 || width % 2 == 0 || order < 1 || in.size == 0 || in.size % static_cast<uint64_t>(features) != 0) {
+                return false;
+            }
+            const auto size = static_cast<uint64_t>(features);
+            const auto half = static_cast<int64_t>(width / 2);
+            const uint64_t frames = in.size / size;
+            float norm = 0.0f;
+            for (int64_t i = 1; i <= half; i++) {
+                norm += static_cast<float>(2 * i * i);
+            }
+            static thread_local REAL_VEC spare;
+            static thread_local REAL_VEC previous;
+            const bool alias = overlaps(in, out);
+            REAL_VEC& result = alias ? spare : out;
+            const float* source = in.data;
+            for (int pass = 0; pass < order; pass++) {
+                if (pass > 0) {
+                    previous.swap(result);
+                    source = previous.data();
+                }
+                result.resize(in.size);
+                const uint64_t chunk = 256;
+                POOL::shared().run((frames + chunk - 1) / chunk, [&](const uint64_t task) {
+                    const uint64_t last = std::min(frames, (task + 1) * chunk);
+                    for (uint64_t t = task * chunk; t < last; t++) {
+                        float* d = result.data() + t * size;
+                        std::fill(d, d + size, 0.0f);
+                        for (int64_t i = 1; i <= half; i++) {
+                            const int64_t back = std::max<int64_t>(0, static_cast<int64_t>(t) - i);
+                            const int64_t ahead = std::min<int64_t>(static_cast<int64_t>(frames) - 1, static_cast<int64_t>(t) + i);
+                            const float* a = source + static_cast<uint64_t>(ahead) * size;
+                            const float* b = source + static_cast<uint64_t>(back) * size;
+                            const float weight = static_cast<float>(i) / norm;
+                            for (uint64_t f = 0; f < size; f++) {
+                                d[f] += weight * (a[f] - b[f]);
+                            }
+                        }
+                    }
+                });
+            }
+            if (alias) {
+                out.swap(spare);
+            }
+            return true;
+        }
+
+        template<typename PREPARE, typename STAGE>
+        static bool melspectrogram(const FORMAT::SPAN<const float> in,
+                                   const unsigned int sample_rate,
+                                   const int n_fft,
+                                   const int hop_length,
+                                   const int n_mels,
+                                   const bool center,
+                                   const std::string& pad_mode,
+                                   const std::string& log,
+                                   PREPARE&& prepare,
+                                   STAGE&& stage) {
+            /** Log mel frames of a real signal, prepare(frames) runs first, then stage(first, count, block) on the pool **/
+            /** threads for every block of up to 32 frames, block holds count x n_mels values in per-thread memory **/
+            float scale = 0.0f;
+            if (n_fft < 2 || hop_length < 1 || n_mels < 1 || !FEATURE::compression(log, scale)) {
+                return false;
+            }
+            const auto n = static_cast<uint64_t>(n_fft);
+            const auto hop = static_cast<uint64_t>(hop_length);
+            const auto plan = PLAN::MEL::get(sample_rate, n, static_cast<uint64_t>(n_mels));
+            if (!plan) {
+                return false;
+            }
+            const auto window = W::Hann(n_fft);
+            const auto real = PLAN::RFFT::get(n);
+
+            PADDING::VIEW<float> signal;
+            if (!framed(in.data, in.size, n, center, pad_mode, signal) || signal.size() < n) {
+                return false;
+            }
+            const uint64_t frames = 1 + (signal.size() - n) / hop;
+            const uint64_t bins = plan->bins();
+            prepare(frames);
+
+            const uint64_t chunk = 32;
+            POOL::shared().run((frames + chunk - 1) / chunk, [&](const uint64_t task) {
+                WORKSPACE& local = WORKSPACE::local();
+                WORKSPACE::SCOPE inner(local);
+                auto* spectrum = local.allocate<std::complex<float>>(bins);
+                auto* scratch = local.allocate<std::complex<float>>(real->scratch_size());
+                float* samples = local.allocate<float>(n);
+                float* power = local.allocate<float>(bins);
+                float* block = local.allocate<float>(chunk * plan->mels());
+                float* edge = local.allocate<float>(n);
+                const float* taper = window->data();
+                const uint64_t first = task * chunk;
+                const uint64_t last = std::min(frames, first + chunk);
+                for (uint64_t t = first; t < last; t++) {
+                    const float* x = signal.window(t * hop, n, edge);
+                    for (uint64_t i = 0; i < n; i++) {
+                        samples[i] = x[i] * taper[i];
+                    }
+                    real->forward(samples, spectrum, scratch);
+                    features(spectrum, *plan, power, scale, block + (t - first) * plan->mels());
+                }
+                stage(first, last - first, static_cast<const float*>(block));
+            });
+            return true;
+        }
+
+        static std::vector<float> liftering(const uint64_t n_mfcc, const int lifter) {
+            /** Cepstral lifter 1 + lifter / 2 sin(pi (k + 1) / lifter) as in librosa, empty for none **/
+            std::vector<float> weights;
+            if (lifter > 0) {
+                weights.resize(n_mfcc);
+                for (uint64_t k = 0; k < n_mfcc; k++) {
+                    weights[k] = static_cast<float>(1.0 + 0.5 * lifter * std::sin(WAVLIB_PI * static_cast<double>(k + 1) / lifter));
+                }
+            }
+            return weights;
+        }
+
+        static void lift(float* rows, const uint64_t count, const std::vector<float>& weights) {
+            const uint64_t size = weights.size();
+            for (uint64_t t = 0; t < count && size != 0; t++) {
+                for (uint64_t k = 0; k < size; k++) {
+                    rows[t * size + k] *= weights[k];
+                }
+            }
+        }
+
+        static bool overlaps(const FORMAT::SPAN<const float> in, const REAL_VEC& out) {
+            /** Whether in views any of out's storage, so out can't be written before in is read **/
+            const auto begin = reinterpret_cast<uintptr_t>(out.data());
+            const auto first = reinterpret_cast<uintptr_t>(in.data);
+            return in.size != 0 && first < begin + out.capacity() * sizeof(float) && begin < first + in.size * sizeof(float);
+        }
+
+        static void features(const std::complex<float>* spectrum, const PLAN::MEL& plan, float* power, const float scale, float* out) {
+            /** Power, mel filters and log of one frame **/
+            static const FEATURE::POWER square = FEATURE::power();
+            static const FEATURE::LOG compress = FEATURE::log();
+            square(spectrum, power, plan.bins());
+            plan.apply(power, out);
+            if (scale != 0.0f) {
+                compress(out, plan.mels(), 1e-10f, scale);
+            }
+        }
+
+        static bool WSOLA(const FORMAT::WAV& in, FORMAT::WAV* const* out, const float* rates, const uint64_t variants,
+                          const int frame_size, const int hop_length, const int tolerance) {
+            /** Time stretch by every rate with ONLINE::WSOLA, the decoded input is shared and variants run in parallel **/
+            WAVLIB_SCOPE("SIGNAL::WSOLA");
+            double offset = 0, low = 0, high = 0;
+            if (!limits(in, offset, low, high) || !stretchable(rates, variants) || frame_size < 2 || hop_length < 1 || hop_length > frame_size || tolerance < 0) {
+                return false;
+            }
+            const uint64_t channels = in.channels;
+            const uint64_t frames = in.audio.size() / channels;
+            const FORMAT::WAV shape = header(in);
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            float* source = workspace.allocate<float>(frames * channels);
+            for (uint64_t i = 0; i < frames * channels; i++) {
+                source[i] = static_cast<float>(in.audio[i] - offset);
+            }
+
+            POOL::shared().run(variants, [&](const uint64_t task) {
+                ONLINE::WSOLA engine(in.channels, rates[task], frame_size, hop_length, tolerance);
+                std::vector<int>& audio = out[task]->audio;
+                audio.resize(stretched(frames, rates[task]) * channels);
+                uint64_t written = 0;
+                auto emit = [&](const float* samples, const uint64_t count) {
+                    for (uint64_t i = 0; i < count * channels; i++) {
+                        audio[written + i] = quantize(samples[i], offset, low, high);
+                    }
+                    written += count * channels;
+                };
+                const uint64_t block = 1 << 14;
+                for (uint64_t first = 0; first < frames; first += block) {
+                    engine.push(source + first * channels, std::min(block, frames - first), emit);
+                }
+                engine.flush(emit);
+                retime(shape, *out[task]);
+            });
+            return true;
+        }
+
+        static bool PV(const FORMAT::WAV& in, FORMAT::WAV* const* out, const float* rates, const uint64_t variants,
+                       const int n_fft, const int hop_length) {
+            /** Time stretch by every rate with the phase vocoder, the analysis STFT is computed once for all variants **/
+            /** Frames and alignment match ONLINE::PV, so the results are the same as streaming each variant **/
+            WAVLIB_SCOPE("SIGNAL::PV");
+            double offset = 0, low = 0, high = 0;
+            if (!limits(in, offset, low, high) || !stretchable(rates, variants) || n_fft < 2 || hop_length < 1 || hop_length > n_fft) {
+                return false;
+            }
+            const uint64_t channels = in.channels;
+            const uint64_t frames = in.audio.size() / channels;
+            const auto n = static_cast<uint64_t>(n_fft);
+            const auto hop = static_cast<uint64_t>(hop_length);
+            const uint64_t bins = n / 2 + 1;
+            const FORMAT::WAV shape = header(in);
+
+            // Analysis frames each variant needs to complete its output, the shared STFT covers the longest
+            uint64_t total = 0;
+            for (uint64_t v = 0; v < variants; v++) {
+                total = std::max(total, analysis_frames(frames, rates[v], n, hop));
+            }
+            WORKSPACE& workspace = WORKSPACE::local();
+            WORKSPACE::SCOPE scope(workspace);
+            auto* spectra = workspace.allocate<std::complex<float>>(channels * total * bins);
+            POOL::shared().run(channels, [&](const uint64_t c) {
+                ONLINE::STFT stft(n_fft, hop_length);
+                WORKSPACE& local = WORKSPACE::local();
+                WORKSPACE::SCOPE inner(local);
+                float* block = local.allocate<float>(hop);
+                std::complex<float>* target = spectra + c * total * bins;
+                for (uint64_t first = 0; first < total * hop; first += hop) {
+                    for (uint64_t i = 0; i < hop; i++) {
+                        const uint64_t at = first + i;
+                        block[i] = at < frames ? static_cast<float>(in.audio[at * channels + c] - offset) : 0.0f;
+                    }
+                    stft.push(block, hop, [&](const std::complex<float>* spectrum) {
+                        std::copy(spectrum, spectrum + bins, target);
+                        target += bins;
+                    });
+                }
+            });
+
+            POOL::shared().run(variants, [&](const uint64_t task) {
+                const float rate = rates[task];
+                const uint64_t length = stretched(frames, rate);
+                const uint64_t skip = ONLINE::PV::lead(n, hop, rate);
+                const uint64_t needed = (skip + length + hop - 1) / hop;
+                const uint64_t used = analysis_frames(frames, rate, n, hop);
+                WORKSPACE& local = WORKSPACE::local();
+                WORKSPACE::SCOPE inner(local);
+                float* samples = local.allocate<float>(needed * hop);
+                std::vector<int>& audio = out[task]->audio;
+                audio.resize(length * channels);
+                for (uint64_t c = 0; c < channels; c++) {
+                    ONLINE::VOCODER vocoder(n_fft, rate);
+                    ONLINE::ISTFT istft(n_fft, hop_length);
+                    uint64_t count = 0;
+                    const std::complex<float>* source = spectra + c * total * bins;
+                    for (uint64_t t = 0; t < used && count < needed; t++) {
+                        vocoder.push(source + t * bins, [&](const std::complex<float>* frame) {
+                            if (count < needed) {
+                                istft.push(frame, samples + count * hop);
+                                count++;
+                            }
+                        });
+                    }
+                    for (uint64_t i = 0; i < length; i++) {
+                        audio[i * channels + c] = quantize(samples[skip + i], offset, low, high);
+                    }
+                }
+                retime(shape, *out[task]);
+            });
+            return true;
+        }
+
+        static uint64_t stretched(const uint64_t frames, const float rate) {
+            return static_cast<uint64_t>(std::nearbyint(static_cast<double>(frames) / rate));
+        }
+
+        static uint64_t analysis_frames(const uint64_t frames, const float rate, const uint64_t n, const uint64_t hop) {
+            /** ONLINE::VOCODER emits output frame k once analysis frame floor(k rate) + 1 has arrived **/
+            const uint64_t needed = (ONLINE::PV::lead(n, hop, rate) + stretched(frames, rate) + hop - 1) / hop;
+            if (needed == 0) {
+                return 0;
+            }
+            return static_cast<uint64_t>(std::floor(static_cast<double>(needed - 1) * static_cast<double>(rate))) + 2;
+        }
+
+        static bool stretchable(const float* rates, const uint64_t variants) {
+            for (uint64_t v = 0; v < variants; v++) {
+                if (!(rates[v] > 0.0f) || !std::isfinite(rates[v])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool limits(const FORMAT::WAV& audio, double& offset, double& low, double& high) {
+            /** Integer range of the samples in audio.audio, 8-bit samples are unsigned and get centered by offset **/
+            const FORMAT::SAMPLE type = PCM::type(audio.format, audio.sample_size);
+            if (audio.channels == 0 || type == FORMAT::SAMPLE::UNKNOWN) {
+                return false;
+            }
+            offset = type == FORMAT::SAMPLE::U8 ? 128.0 : 0.0;
+            low = -2147483648.0;
+            high = 2147483647.0;
+            if (type != FORMAT::SAMPLE::S32 && type != FORMAT::SAMPLE::F32 && type != FORMAT::SAMPLE::F64) {
+                high = std::ldexp(1.0, audio.sample_size - 1) - 1.0;
+                low = -high - 1.0;
+            }
+            return true;
+        }
+
+        static int quantize(const float value, const double offset, const double low, const double high) {
+            return static_cast<int>(std::min(high, std::max(low, std::nearbyint(static_cast<double>(value)))) + offset);
+        }
+
+        static FORMAT::WAV header(const FORMAT::WAV& in) {
+            /** Format fields of in without the samples, read before any output that may alias it is written **/
+            FORMAT::WAV shape;
+            shape.format = in.format;
+            shape.channels = in.channels;
+            shape.sample_rate = in.sample_rate;
+            shape.data_rate = in.data_rate;
+            shape.sample_size = in.sample_size;
+            return shape;
+        }
+
+        static void retime(const FORMAT::WAV& shape, FORMAT::WAV& out) {
+            /** Same format as shape, data_size follows the new number of samples **/
+            const FORMAT::SAMPLE type = PCM::type(shape.format, shape.sample_size);
+            out.format = shape.format;
+            out.channels = shape.channels;
+            out.sample_rate = shape.sample_rate;
+            out.data_rate = shape.data_rate;
+            out.sample_size = shape.sample_size;
+            out.data_size = std::min<uint64_t>(out.audio.size() * PCM::bytes(type), 0xFFFFFFFF);
+        }
+
+        static void resample(const PLAN::POLYPHASE& plan, const float* in, const uint64_t size, float* out, const uint64_t length) {
+            /** Output blocks only depend on the input, so they are spread over the pool **/
+            const uint64_t chunk = 1 << 15;
+            POOL::shared().run((length + chunk - 1) / chunk, [&](const uint64_t task) {
+                const uint64_t first = task * chunk;
+                plan.run(in, size, first, std::min(chunk, length - first), out + first);
+            });
+        }
+
+        static bool DWT(const FORMAT::SPAN<const float> in, REAL_VEC& approx, REAL_VEC& detail, const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            /** Single level Discrete Wavelet Transform, the same coefficients as pywt.dwt **/
+            /** wavelet is "haar", "db1" to "db20" or "sym2" to "sym20", mode is a PyWavelets extension mode: "symmetric", **/
+            /** "reflect", "zero", "constant" or "periodization". Both bands hold floor((size + taps - 1) / 2) coefficients, **/
+            /** or ceil(size / 2) with "periodization". A signal shorter than the filter is extended by repeating the mirror **/
+            /** images, as pywt does **/
+            WAVLIB_SCOPE("SIGNAL::DWT");
+            std::vector<REAL_VEC> bands;
+            if (!wavedec(&in, 1, wavelet, 1, mode, &bands)) {
+                return false;
+            }
+            approx.swap(bands[0]);
+            detail.swap(bands[1]);
+            return true;
+        }
+
+        static bool IDWT(const FORMAT::SPAN<const float> approx, const FORMAT::SPAN<const float> detail, REAL_VEC& out,
+                         const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            /** Inverse of DWT, 2 size - taps + 2 samples, or 2 size with "periodization" **/
+            /** approx may be one coefficient longer than detail, the extra one is dropped as in pywt.waverec **/
+            WAVLIB_SCOPE("SIGNAL::IDWT");
+            const FORMAT::SPAN<const float> bands[2] = {approx, detail};
+            return waverec(bands, 1, 1, wavelet, mode, &out);
+        }
+
+        static bool WAVEDEC(const FORMAT::SPAN<const float> in, std::vector<REAL_VEC>& out, const std::string& wavelet = "db4", const int level = 0,
+                            const std::string& mode = "symmetric") {
+            /** Multilevel decomposition, out is [cA_level, cD_level, ..., cD_1] like pywt.wavedec **/
+            /** level 0 goes as deep as pywt.dwt_max_level. Every level runs in tiles of coefficients spread over the pool **/
+            WAVLIB_SCOPE("SIGNAL::WAVEDEC");
+            return wavedec(&in, 1, wavelet, level, mode, &out);
+        }
+
+        static bool WAVEDEC(const FORMAT::PLANAR& in, std::vector<std::vector<REAL_VEC>>& out, const std::string& wavelet = "db4", const int level = 0,
+                            const std::string& mode = "symmetric") {
+            /** WAVEDEC of every channel, out[c] holds the bands of channel c, channels and tiles run in parallel **/
+            WAVLIB_SCOPE("SIGNAL::WAVEDEC");
+            std::vector<FORMAT::SPAN<const float>> channels(in.channels);
+            for (unsigned short c = 0; c < in.channels; c++) {
+                channels[c] = in.channel(c);
+            }
+            std::vector<std::vector<REAL_VEC>> bands(in.channels);
+            if (!wavedec(channels.data(), channels.size(), wavelet, level, mode, bands.data())) {
+                return false;
+            }
+            out.swap(bands);
+            return true;
+        }
+
+        static bool WAVEREC(const std::vector<REAL_VEC>& in, REAL_VEC& out, const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            /** Multilevel reconstruction from [cA_n, cD_n, ..., cD_1], inverse of WAVEDEC **/
+            /** An odd length input comes back one sample longer, as with pywt.waverec **/
+            WAVLIB_SCOPE("SIGNAL::WAVEREC");
+            if (in.size() < 2) {
+                return false;
+            }
+            std::vector<FORMAT::SPAN<const float>> bands(in.begin(), in.end());
+            return waverec(bands.data(), 1, in.size() - 1, wavelet, mode, &out);
+        }
+
+        static bool WAVEREC(const std::vector<std::vector<REAL_VEC>>& in, FORMAT::PLANAR& out, const unsigned int sample_rate,
+                            const std::string& wavelet = "db4", const std::string& mode = "symmetric") {
+            /** WAVEREC of every channel into out, all channels must have the same band layout **/
+            WAVLIB_SCOPE("SIGNAL::WAVEREC");
+            if (in.empty() || in.size() > std::numeric_limits<unsigned short>::max() || in[0].size() < 2) {
+                return false;
+            }
+            const uint64_t levels = in[0].size() - 1;
+            std::vector<FORMAT::SPAN<const float>> bands;
+            for (const std::vector<REAL_VEC>& channel : in) {
+                if (channel.size() != levels + 1) {
+                    return false;
+                }
+                bands.insert(bands.end(), channel.begin(), channel.end());
+            }
+            std::vector<REAL_VEC> channels(in.size());
+            if (!waverec(bands.data(), in.size(), levels, wavelet, mode, channels.data())) {
+                return false;
+            }
+            out.sample_rate = sample_rate;
+            out.resize(static_cast<unsigned short>(in.size()), channels[0].size());
+            for (unsigned short c = 0; c < out.channels; c++) {
+                std::copy(channels[c].begin(), channels[c].end(), out.channel(c).data);
+            }
+            return true;
+        }
+
+        static bool SWT(const FORMAT::SPAN<const float> in, std::vector<REAL_VEC>& out, const std::string& wavelet = "db4", const int level = 1) {
+            /** Stationary (undecimated) Wavelet Transform, out is [cA_level, cD_level, ..., cD_1] with size samples each **/
+            /** The signal is periodic, as in pywt.swt(..., trim_approx=True), but the size need not divide by 2^level **/
+            WAVLIB_SCOPE("SIGNAL::SWT");
+            const auto plan = PLAN::WAVELET::get(wavelet);
+            if (!plan || in.size == 0 || level < 1 || level > 30) {
+                return false;
+            }
+            const uint64_t levels = static_cast<uint64_t>(level);
+            const uint64_t size = in.size;
+            std::vector<REAL_VEC> bands(levels + 1);
+            REAL_VEC current, next(size);
+            for (uint64_t l = 1; l <= levels; l++) {
+                REAL_VEC& detail = bands[levels + 1 - l];
+                detail.resize(size);
+                const float* x = l == 1 ? in.data : current.data();
+                POOL::shared().run((size + WAVELET::TILE - 1) / WAVELET::TILE, [&](const uint64_t task) {
+                    const uint64_t first = task * WAVELET::TILE;
+                    WAVELET::stationary(*plan, x, size, uint64_t(1) << (l - 1), first, std::min(WAVELET::TILE, size - first), next.data(), detail.data());
+                });
+                current.swap(next);
+                next.resize(size);
+            }
+            bands[0].swap(current);
+            out.swap(bands);
+            return true;
+        }
+
+        static bool ISWT(const std::vector<REAL_VEC>& in, REAL_VEC& out, const std::string& wavelet = "db4") {
+            /** Inverse of SWT from [cA_n, cD_n, ..., cD_1] **/
+            WAVLIB_SCOPE("SIGNAL::ISWT");
+            const auto plan = PLAN::WAVELET::get(wavelet);
+            if (!plan || in.size() < 2 || in.size() > 31 || in[0].empty()) {
+                return false;
+            }
+            const uint64_t levels = in.size() - 1;
+            const uint64_t size = in[0].size();
+            for (const REAL_VEC& band : in) {
+                if (band.size() != size) {
+                    return false;
+                }
+            }
+            REAL_VEC current, next(size);
+            for (uint64_t l = levels; l >= 1; l--) {
+                const float* approx = l == levels ? in[0].data() : current.data();
+                const float* detail = in[levels + 1 - l].data();
+                POOL::shared().run((size + WAVELET::TILE - 1) / WAVELET::TILE, [&](const uint64_t task) {
+                    const uint64_t first = task * WAVELET::TILE;
+                    WAVELET::inverse_stationary(*plan, approx, detail, size, uint64_t(1) << (l - 1), first, std::min(WAVELET::TILE, size - first), next.data());
+                });
+                current.swap(next);
+                next.resize(size);
+            }
+            out.swap(current);
+            return true;
+        }
+
+        static bool CWT(const FORMAT::SPAN<const float> in, COMPLEX_VEC& out, const std::vector<float>& scales, const std::string& wavelet = "morlet") {
+            /** Continuous Wavelet Transform, out holds one row of size coefficients per scale, scales are in samples **/
+            /** "morlet" (w0 = 6, analytic) or "mexh" (Mexican hat), each scale normalized to unit energy (Torrence & Compo) **/
+            /** W[s][n] = sum(x[m] conj(psi((m - n) / s)) / sqrt(s)), evaluated in the frequency domain. Long signals go in **/
+            /** overlap-save blocks, each block is transformed once and shared by all scales, and every (scale, block) **/
+            /** pair runs on the pool. The signal is zero outside of it **/
+            WAVLIB_SCOPE("SIGNAL::CWT");
+            const bool morlet = wavelet == "morlet";
+            if ((!morlet && wavelet != "mexh") || in.size == 0 || scales.empty()) {
+                return false;
+            }
+            float widest = 0.0f;
+            for (const float s : scales) {
+                if (!(s > 0.0f) || !std::isfinite(s)) {
+                    return false;
+                }
+                widest = std::max(widest, s);
+            }
+            const uint64_t size = in.size;
+            const uint64_t rows = scales.size();
+            // Both wavelets are below 1e-7 of their peak 6 scales away from the centre
+            const uint64_t halo = static_cast<uint64_t>(std::ceil(6.0 * widest)) + 1;
+            uint64_t n = 1;
+            while (n < size + 2 * halo && n < std::max<uint64_t>(8 * halo, 16384)) {
+                n <<= 1;
+            }
+            const uint64_t valid = n - 2 * halo;
+            const uint64_t blocks = (size + valid - 1) / valid;
+            const uint64_t bins = n / 2 + 1;
+            const auto real = PLAN::RFFT::get(n);
+            const auto complex = PLAN::FFT::get(n);
+
+            // Frequency responses with the 1 / n of the inverse folded in, then the spectrum of every block
+            REAL_VEC response(rows * n);
+            POOL::shared().run(rows, [&](const uint64_t r) {
+                const double s = scales[r];
+                const double norm = std::sqrt(2.0 * WAVLIB_PI * s) / static_cast<double>(n);
+                for (uint64_t k = 0; k < n; k++) {
+                    const double w = 2.0 * WAVLIB_PI * (k <= n / 2 ? static_cast<double>(k) : static_cast<double>(k) - static_cast<double>(n)) / static_cast<double>(n);
+                    const double sw = s * w;
+                    const double value = morlet ? (w > 0.0 ? std::pow(WAVLIB_PI, -0.25) * std::exp(-0.5 * (sw - 6.0) * (sw - 6.0)) : 0.0)
+                                                : sw * sw * std::exp(-0.5 * sw * sw) / std::sqrt(std::tgamma(2.5));
+                    response[r * n + k] = static_cast<float>(value * norm);
+                }
+            });
+            COMPLEX_VEC spectra(blocks * bins);
+            POOL::shared().run(blocks, [&](const uint64_t b) {
+                WORKSPACE& workspace = WORKSPACE::local();
+                WORKSPACE::SCOPE scope(workspace);
+                float* block = workspace.allocate<float>(n);
+                const int64_t start = static_cast<int64_t>(b * valid) - static_cast<int64_t>(halo);
+                for (uint64_t t = 0; t < n; t++) {
+                    const int64_t i = start + static_cast<int64_t>(t);
+                    block[t] = i >= 0 && i < static_cast<int64_t>(size) ? in.data[i] : 0.0f;
+                }
+                real->forward(block, spectra.data() + b * bins, PLAN::FFT::workspace(real->scratch_size()));
+            });
+
+            out.resize(rows * size);
+            POOL::shared().run(rows * blocks, [&](const uint64_t task) {
+                const uint64_t r = task / blocks;
+                const uint64_t b = task % blocks;
+                const std::complex<float>* X = spectra.data() + b * bins;
+                const float* R = response.data() + r * n;
+                std::complex<float>* work = PLAN::FFT::workspace(n + complex->scratch_size());
+                // The negative frequencies of a real block are the conjugates of the positive ones
+                for (uint64_t k = 0; k < n; k++) {
+                    work[k] = (k < bins ? X[k] : std::conj(X[n - k])) * R[k];
+                }
+                complex->inverse(work, work, work + n);
+                const uint64_t first = b * valid;
+                const uint64_t count = std::min(valid, size - first);
+                std::copy(work + halo, work + halo + count, out.data() + r * size + first);
+            });
+            return true;
+        }
+
+        static bool wavedec(const FORMAT::SPAN<const float>* channels, const uint64_t count, const std::string& name, const int level,
+                            const std::string& mode, std::vector<REAL_VEC>* out) {
+            /** Shared WAVEDEC core, every channel has channels[0].size samples, out[c] receives the bands of channel c **/
+            const auto plan = PLAN::WAVELET::get(name);
+            PADDING::MODE extension{};
+            bool periodization = false;
+            if (!plan || count == 0 || !WAVELET::mode(mode, extension, periodization)) {
+                return false;
+            }
+            const uint64_t taps = plan->taps();
+            uint64_t size = channels[0].size;
+            const uint64_t levels = level > 0 ? static_cast<uint64_t>(level) : WAVELET::max_level(size, taps);
+            // Any signal can be extended, and no level leaves fewer coefficients than one
+            if (size == 0 || levels == 0 || levels > 64) {
+                return false;
+            }
+            for (uint64_t c = 1; c < count; c++) {
+                if (channels[c].size != size) {
+                    return false;
+                }
+            }
+
+            std::vector<std::vector<REAL_VEC>> bands(count, std::vector<REAL_VEC>(levels + 1));
+            std::vector<REAL_VEC> current(count), next(count);
+            for (uint64_t l = 1; l <= levels; l++) {
+                const uint64_t length = WAVELET::length(size, taps, periodization);
+                const uint64_t index = levels + 1 - l;
+                for (uint64_t c = 0; c < count; c++) {
+                    next[c].resize(length);
+                    bands[c][index].resize(length);
+                }
+                const uint64_t tiles = (length + WAVELET::TILE - 1) / WAVELET::TILE;
+                POOL::shared().run(count * tiles, [&](const uint64_t task) {
+                    const uint64_t c = task / tiles;
+                    const uint64_t first = task % tiles * WAVELET::TILE;
+                    const float* x = l == 1 ? channels[c].data : current[c].data();
+                    WAVELET::analysis(*plan, x, size, extension, periodization, first, std::min(WAVELET::TILE, length - first), next[c].data(), bands[c][index].data());
+                });
+                current.swap(next);
+                size = length;
+            }
+            for (uint64_t c = 0; c < count; c++) {
+                bands[c][0].swap(current[c]);
+                out[c].swap(bands[c]);
+            }
+            return true;
+        }
+
+        static bool waverec(const FORMAT::SPAN<const float>* bands, const uint64_t count, const uint64_t levels, const std::string& name,
+                            const std::string& mode, REAL_VEC* out) {
+            /** Shared WAVEREC core, bands[c (levels + 1) + i] is band i of channel c **/
+            const auto plan = PLAN::WAVELET::get(name);
+            PADDING::MODE extension{};
+            bool periodization = false;
+            if (!plan || count == 0 || levels == 0 || !WAVELET::mode(mode, extension, periodization)) {
+                return false;
+            }
+            const uint64_t taps = plan->taps();
+            const uint64_t stride = levels + 1;
+            // Check the layout first, the approximation may be one longer than the detail it pairs with
+            uint64_t length = bands[0].size;
+            for (uint64_t i = 1; i <= levels; i++) {
+                const uint64_t size = bands[i].size;
+                if (length == size + 1) {
+                    length = size;
+                }
+                if (size == 0 || length != size || (!periodization && 2 * size + 2 <= taps)) {
+                    return false;
+                }
+                length = periodization ? 2 * size : 2 * size + 2 - taps;
+            }
+            for (uint64_t c = 1; c < count; c++) {
+                for (uint64_t i = 0; i <= levels; i++) {
+                    if (bands[c * stride + i].size != bands[i].size) {
+                        return false;
+                    }
+                }
+            }
+
+            // Periodization wraps the coefficients by taps / 2 on both sides, the other modes keep the valid part
+            const uint64_t wrap = periodization ? taps / 2 : 0;
+            const uint64_t shift = periodization ? 3 * wrap - 1 : taps - 2;
+            std::vector<REAL_VEC> current(count), next(count), approx(count), detail(count);
+            for (uint64_t i = 1; i <= levels; i++) {
+                const uint64_t size = bands[i].size;
+                const uint64_t output = periodization ? 2 * size : 2 * size + 2 - taps;
+                for (uint64_t c = 0; c < count; c++) {
+                    next[c].resize(output);
+                    if (periodization) {
+                        approx[c].resize(size + 2 * wrap);
+                        detail[c].resize(size + 2 * wrap);
+                        const float* a = i == 1 ? bands[c * stride].data : current[c].data();
+                        WAVELET::periodic(a, size, -static_cast<int64_t>(wrap), size + 2 * wrap, approx[c].data());
+                        WAVELET::periodic(bands[c * stride + i].data, size, -static_cast<int64_t>(wrap), size + 2 * wrap, detail[c].data());
+                    }
+                }
+                const uint64_t tiles = (output + WAVELET::TILE - 1) / WAVELET::TILE;
+                POOL::shared().run(count * tiles, [&](const uint64_t task) {
+                    const uint64_t c = task / tiles;
+                    const uint64_t first = task % tiles * WAVELET::TILE;
+                    const float* a = periodization ? approx[c].data() : i == 1 ? bands[c * stride].data : current[c].data();
+                    const float* d = periodization ? detail[c].data() : bands[c * stride + i].data;
+                    WAVELET::synthesis(*plan, a, d, size + 2 * wrap, shift, first, std::min(WAVELET::TILE, output - first), next[c].data());
+                });
+                current.swap(next);
+            }
+            for (uint64_t c = 0; c < count; c++) {
+                out[c].swap(current[c]);
+            }
+            return true;
+        }
+    };
+
+    struct WINDOW {
+        /** Windows are real, complex containers get a zero imaginary part **/
+        /** out is resized to window_length, so a reused longer vector keeps nothing of its old contents **/
+        template<typename VEC>
+        static bool Hann(VEC& out, const int window_length, const bool periodic=true) {
+            WAVLIB_SCOPE("WINDOW::Hann");
+            if (window_length < 1) {
+                return false;
+            }
+            out.resize(static_cast<uint64_t>(window_length));
+            if (window_length == 1) {
+                set(out[0], 1);
+                return true;
+            }
+            int offset = 0;
+            if (!periodic) {
+                offset = -1;
+            }
+            for (int i = 0; i < window_length; i++) {
+                set(out[i], static_cast<float>(0.5 * (1.0 - cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)))));
+            }
+            return true;
+        }
+
+        template<typename VEC>
+        static bool Hamming(VEC& out, const int window_length, const bool periodic=true, const float alpha=0.54, const float beta=0.46) {
+            WAVLIB_SCOPE("WINDOW::Hamming");
+            if (window_length < 1) {
+                return false;
+            }
+            out.resize(static_cast<uint64_t>(window_length));
+            if (window_length == 1) {
+                set(out[0], 1);
+                return true;
+            }
+            int offset = 0;
+            if (!periodic) {
+                offset = -1;
+            }
+            for (int i = 0; i < window_length; i++) {
+                set(out[i], alpha - beta * cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)));
+            }
+            return true;
+        }
+
+        template<typename VEC>
+        static bool Kaiser(VEC& out, const int window_length, const bool periodic=true, const float beta=12.0) {
+            /** Note: beta = alpha * pi **/
+            WAVLIB_SCOPE("WINDOW::Kaiser");
+            if (window_length < 1) {
+                return false;
+            }
+            out.resize(static_cast<uint64_t>(window_length));
+            if (window_length == 1) {
+                set(out[0], 1);
+                return true;
+            }
+            int offset = 0;
+            if (!periodic) {
+                offset = -1;
+            }
+            const float denominator = std::cyl_bessel_if(0, beta);
+            for (int i = 0; i < window_length; i++) {
+                set(out[i], std::cyl_bessel_if(0, beta * sqrtf(static_cast<float>(1.0) - powf(static_cast<float>((i - (window_length + offset) / 2.0) / ((window_length + offset) / 2.0)), 2.0))) / denominator);
+            }
+            return true;
+        }
+
+        template<typename VEC>
+        static bool Blackman(VEC& out, const int window_length, const bool periodic=true) {
+            WAVLIB_SCOPE("WINDOW::Blackman");
+            if (window_length < 1) {
+                return false;
+            }
+            out.resize(static_cast<uint64_t>(window_length));
+            if (window_length == 1) {
+                set(out[0], 1);
+                return true;
+            }
+            int offset = 0;
+            if (!periodic) {
+                offset = -1;
+            }
+            for (int i = 0; i < window_length; i++) {
+                set(out[i], static_cast<float>(0.42 - 0.5 * cosf(static_cast<float>(2.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset)) + 0.08 * cosf(static_cast<float>(4.0 * WAVLIB_PI * i) / static_cast<float>(window_length + offset))));
+            }
+            return true;
+        }
+
+        template<typename VEC>
+        static bool Bartlett(VEC& out, const int window_length, const bool periodic=true) {
+            WAVLIB_SCOPE("WINDOW::Bartlett");
+            if (window_length < 1) {
+                return false;
+            }
+            out.resize(static_cast<uint64_t>(window_length));
+            if (window_length == 1) {
+                set(out[0], 1);
+                return true;
+            }
+            int offset = 0;
+            if (!periodic) {
+                offset = -1;
+            }
+            int i = 0;
+            for (; i <= (window_length + offset) / 2; i++) {
+                set(out[i], static_cast<float>(static_cast<float>(2.0 * i) / static_cast<float>(window_length + offset)));
+            }
+            // The symmetric window ends on its last sample, which is 0
+            for (; i < window_length; i++) {
+                set(out[i], static_cast<float>(2.0 - (static_cast<float>(2.0 * i) / static_cast<float>(window_length + offset))));
+            }
+            return true;
+        }
+
+        enum class TYPE { HANN, HAMMING, KAISER, BLACKMAN, BARTLETT };
+
+        struct KEY {
+            TYPE type;
+            int length;
+            bool periodic;
+            float alpha;
+            float beta;
+
+            bool operator==(const KEY& other) const {
+                return type == other.type && length == other.length && periodic == other.periodic && alpha == other.alpha && beta == other.beta;
+            }
+        };
+
+        struct HASH {
+            std::size_t operator()(const KEY& key) const {
+                uint32_t alpha = 0;
+                uint32_t beta = 0;
+                std::memcpy(&alpha, &key.alpha, sizeof(alpha));
+                std::memcpy(&beta, &key.beta, sizeof(beta));
+                uint64_t h = static_cast<uint64_t>(key.length) * 2 + key.periodic;
+                h = h * 31 + static_cast<uint64_t>(key.type);
+                h = h * 0x9E3779B97F4A7C15ull + alpha;
+                h = h * 0x9E3779B97F4A7C15ull + beta;
+                return static_cast<std::size_t>(h ^ (h >> 29));
+            }
+        };
+
+        static std::shared_ptr<const REAL_VEC> get(const TYPE type, const int window_length, const bool periodic, const float alpha, const float beta) {
+            /** Windows are cached per key, with -DWAVLIB_WINDOW_TABLES the periodic Hann window of the common STFT sizes **/
+            /** comes from compile time tables instead of being computed on the first request **/
+            WAVLIB_SCOPE("WINDOW::get");
+            if (window_length < 1) {
+                return nullptr;
+            }
+            static std::mutex lock;
+            static std::unordered_map<KEY, std::shared_ptr<const REAL_VEC>, HASH> cache;
+            const KEY key{type, window_length, periodic, alpha, beta};
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                auto it = cache.find(key);
+                if (it != cache.end()) {
+                    return it->second;
+                }
+            }
+            auto window = std::make_shared<REAL_VEC>();
+            switch (type) {
+                case TYPE::HANN:
+                    if (!periodic || !table(window_length, *window)) {
+                        Hann(*window, window_length, periodic);
+                    }
+                    break;
+                case TYPE::HAMMING: Hamming(*window, window_length, periodic, alpha, beta); break;
+                case TYPE::KAISER: Kaiser(*window, window_length, periodic, beta); break;
+                case TYPE::BLACKMAN: Blackman(*window, window_length, periodic); break;
+                case TYPE::BARTLETT: Bartlett(*window, window_length, periodic); break;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            return cache.emplace(key, std::move(window)).first->second;
+        }
+
+#ifdef WAVLIB_WINDOW_TABLES
+        template<int N>
+        struct TABLE {
+            /** Periodic Hann window of length N, evaluated by the compiler **/
+            static constexpr std::array<float, N> generate() {
+                std::array<float, N> values{};
+                for (int i = 0; i < N; i++) {
+                    values[i] = static_cast<float>(0.5 * (1.0 - cosine(2.0 * WAVLIB_PI * i / N)));
+                }
+                return values;
+            }
+
+            static constexpr std::array<float, N> values = generate();
+        };
+
+        static constexpr double cosine(double x) {
+            // x is in [0, 2 pi), cos(x) = -cos(x - pi) keeps the series argument within [-pi, pi]
+            x -= WAVLIB_PI;
+            const double square = x * x;
+            double term = 1.0;
+            double sum = 1.0;
+            for (int k = 1; k < 24; k++) {
+                term *= -square / ((2 * k - 1) * (2 * k));
+                sum += term;
+            }
+            return -sum;
+        }
+#endif
+
+        static bool table(const int window_length, REAL_VEC& out) {
+#ifdef WAVLIB_WINDOW_TABLES
+            const float* values = nullptr;
+            switch (window_length) {
+                case 256: values = TABLE<256>::values.data(); break;
+                case 512: values = TABLE<512>::values.data(); break;
+                case 1024: values = TABLE<1024>::values.data(); break;
+                case 2048: values = TABLE<2048>::values.data(); break;
+                case 4096: values = TABLE<4096>::values.data(); break;
+                default: return false;
+            }
+            out.assign(values, values + window_length);
+            return true;
+#else
+            // Evaluating the tables costs every translation unit about a second of compile time
+            static_cast<void>(window_length);
+            static_cast<void>(out);
+            return false;
+#endif
+        }
+
+        static void set(std::complex<float>& out, const float value) {
+            out = {value, 0.0f};
+        }
+
+        static void set(float& out, const float value) {
+            out = value;
+        }
+    };
+
+    struct OUTPUT {
+        static bool audio_info(const FORMAT::WAV& audio) {
+            if (audio.format == 1) {
+                std::cout << "Type of format: PCM" << std::endl;
+            } else if (audio.format == 3) {
+                std::cout << "Type of format: IEEE float" << std::endl;
+            } else {
+                std::cout << "Type of format: Unknown" << std::endl;
+            }
+            std::cout << "Number of Channels: " << audio.channels << std::endl;
+            std::cout << "Sample Rate: " << audio.sample_rate << std::endl;
+            std::cout << "Bit Depth: " << audio.sample_size << std::endl;
+            std::cout << "Data Rate: " << audio.data_rate << std::endl;
+            std::cout << "Data Size: " << audio.data_size << std::endl;
+            return true;
+        }
+
+        static bool vector_info(const COMPLEX_VEC& vec) {
+            std::cout << "[";
+            for (int64_t i = 0; i < static_cast<int64_t>(vec.size()) - 1; i++) {
+                std::cout << vec[i] << ", ";
+            }
+            std::cout << vec[vec.size() - 1] << "]" << std::endl;
+            return true;
+        }
+    };
+
+};
+
+#endif // WAV_LIB_H